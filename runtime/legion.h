@@ -3006,6 +3006,37 @@ namespace Legion {
                                     LogicalPartition upper_bound,
                                     const DomainPoint &point);
       
+      /**
+       * Compute the projection for every point in a launch domain
+       * with a single call. The results must be placed in the
+       * same order that a Domain::DomainPointIterator visits the
+       * points of the launch domain. The default implementation
+       * invokes the per-point 'project' method for each point.
+       * Functors that can compute all their results at once more
+       * cheaply than one point at a time should override it.
+       * @param mappable the operation requesting the projection
+       * @param index the index of the region requirement being projected
+       * @param upper_bound the upper bound logical region
+       * @param launch_domain the domain of points to project
+       * @param results vector to fill in with one region per point
+       */
+      virtual void project_domain(const Mappable *mappable, unsigned index,
+                                  LogicalRegion upper_bound,
+                                  const Domain &launch_domain,
+                                  std::vector<LogicalRegion> &results);
+      /**
+       * Same method as above, but with a partition as an upper bound
+       * @param mappable the operation requesting the projection
+       * @param index the index of the region requirement being projected
+       * @param upper_bound the upper bound logical partition
+       * @param launch_domain the domain of points to project
+       * @param results vector to fill in with one region per point
+       */
+      virtual void project_domain(const Mappable *mappable, unsigned index,
+                                  LogicalPartition upper_bound,
+                                  const Domain &launch_domain,
+                                  std::vector<LogicalRegion> &results);
+
       /**
        * Indicate whether calls to this projection functor
        * must be serialized or can be performed in parallel.
@@ -3014,6 +3045,18 @@ namespace Legion {
        */
       virtual bool is_exclusive(void) const { return false; }
 
+      /**
+       * Indicate whether this projection functor is a pure
+       * function of the upper bound and the point being projected.
+       * The result must not depend on the mappable, the index of the
+       * region requirement, or any state of the functor that changes
+       * over time. The runtime will memoize the results of functional
+       * projection functors for each launch domain and upper bound
+       * and reuse them across index space launches without invoking
+       * the functor again.
+       */
+      virtual bool is_functional(void) const { return false; }
+
       /**
        * Specify the depth which this projection function goes
        * for all the points in an index space launch from 
@@ -6310,6 +6353,11 @@ namespace Legion {
        * -lg:no_dyn   Disable dynamic disjointness tests when the runtime
        *              has been compiled with macro DYNAMIC_TESTS defined
        *              which enables dynamic disjointness testing.
+       * -lg:memoize  Memoize the results of map_task calls for tasks
+       *              launched inside of dynamic traces. When a trace is
+       *              replayed the recorded mappings are reused without
+       *              invoking the mapper as long as all the chosen
+       *              instances can still be acquired.
        * -lg:epoch <int> Change the size of garbage collection epochs. The
        *              default value is 64. Increasing it adds latency to
        *              the garbage collection but makes it more efficient.
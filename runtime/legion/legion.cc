@@ -2870,6 +2870,30 @@ namespace Legion {
       return LogicalRegion::NO_REGION;
     }
     
+    //--------------------------------------------------------------------------
+    void ProjectionFunctor::project_domain(const Mappable *mappable,
+                            unsigned index, LogicalRegion upper_bound,
+                            const Domain &launch_domain,
+                            std::vector<LogicalRegion> &results)
+    //--------------------------------------------------------------------------
+    {
+      results.reserve(results.size() + launch_domain.get_volume());
+      for (Domain::DomainPointIterator itr(launch_domain); itr; itr++)
+        results.push_back(project(mappable, index, upper_bound, itr.p));
+    }
+
+    //--------------------------------------------------------------------------
+    void ProjectionFunctor::project_domain(const Mappable *mappable,
+                            unsigned index, LogicalPartition upper_bound,
+                            const Domain &launch_domain,
+                            std::vector<LogicalRegion> &results)
+    //--------------------------------------------------------------------------
+    {
+      results.reserve(results.size() + launch_domain.get_volume());
+      for (Domain::DomainPointIterator itr(launch_domain); itr; itr++)
+        results.push_back(project(mappable, index, upper_bound, itr.p));
+    }
+
     /////////////////////////////////////////////////////////////
     // Coloring Serializer 
     /////////////////////////////////////////////////////////////
@@ -25,6 +25,7 @@
 #include <vector>
 #include <limits>
 #include <stddef.h>
+#include <stdint.h>
 #include <functional>
 #include <stdlib.h>
 #ifndef __MACH__
@@ -140,6 +141,7 @@ namespace Legion {
       TASK_IMPL_ALLOC,
       VARIANT_IMPL_ALLOC,
       LAYOUT_CONSTRAINTS_ALLOC,
+      ANALYSIS_ARENA_ALLOC,
       LAST_ALLOC, // must be last
     };
 
@@ -227,6 +229,7 @@ namespace Legion {
                                    size_t size, int elems=1);
       static void trace_free(Runtime *&rt, AllocationType a, 
                              size_t size, int elems=1);
+      static void trace_arena(size_t allocations, size_t heap_blocks);
     };
 
     // A Helper class for determining if we have an allocation type
@@ -573,6 +576,181 @@ namespace Legion {
 #endif
     };
 
+    /**
+     * \class AnalysisArena
+     * A bump allocator for the short-lived STL data structures that
+     * are built during a single analysis pass of an operation, such 
+     * as the events and users found while computing the preconditions
+     * for a region requirement on a view. Declare one on the stack in
+     * the function that owns the data structures and construct them
+     * with an ArenaAllocator for it. The first INLINE_BYTES of memory
+     * come from the arena itself so most passes never go to the heap,
+     * after that it chains together heap blocks which are all freed
+     * when the arena is destroyed. Memory is never reused before then
+     * so it should not be used for data structures with lots of churn.
+     */
+    class AnalysisArena {
+    public:
+      static const size_t INLINE_BYTES = 1024;
+      static const size_t BLOCK_BYTES = 8192;
+    public:
+      struct ArenaBlock {
+      public:
+        ArenaBlock *next;
+        size_t size;
+      };
+    public:
+      inline AnalysisArena(void);
+      inline ~AnalysisArena(void);
+    private:
+      AnalysisArena(const AnalysisArena &rhs);
+      AnalysisArena& operator=(const AnalysisArena &rhs);
+    public:
+      inline void* allocate(size_t bytes, size_t alignment);
+    protected:
+      inline void* allocate_block(size_t bytes, size_t alignment);
+    protected:
+      char *next_free, *limit;
+      ArenaBlock *blocks;
+#ifdef TRACE_ALLOCATION
+      size_t allocations, heap_blocks;
+#endif
+      char buffer[INLINE_BYTES];
+    };
+
+    //--------------------------------------------------------------------------
+    inline AnalysisArena::AnalysisArena(void)
+      : next_free(buffer), limit(buffer + INLINE_BYTES), blocks(NULL)
+#ifdef TRACE_ALLOCATION
+        , allocations(0), heap_blocks(0)
+#endif
+    //--------------------------------------------------------------------------
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    inline AnalysisArena::~AnalysisArena(void)
+    //--------------------------------------------------------------------------
+    {
+      while (blocks != NULL)
+      {
+        ArenaBlock *next = blocks->next;
+        legion_free(ANALYSIS_ARENA_ALLOC, blocks, blocks->size);
+        blocks = next;
+      }
+#ifdef TRACE_ALLOCATION
+      if (allocations > 0)
+        LegionAllocation::trace_arena(allocations, heap_blocks);
+#endif
+    }
+
+    //--------------------------------------------------------------------------
+    inline void* AnalysisArena::allocate(size_t bytes, size_t alignment)
+    //--------------------------------------------------------------------------
+    {
+#ifdef TRACE_ALLOCATION
+      allocations++;
+#endif
+      // Alignments are always powers of two
+      char *result = (char*)(((uintptr_t)next_free + alignment - 1) & 
+                              ~(uintptr_t)(alignment - 1));
+      if ((result + bytes) > limit)
+        return allocate_block(bytes, alignment);
+      next_free = result + bytes;
+      return result;
+    }
+
+    //--------------------------------------------------------------------------
+    inline void* AnalysisArena::allocate_block(size_t bytes, size_t alignment)
+    //--------------------------------------------------------------------------
+    {
+      size_t block_size = sizeof(ArenaBlock) + bytes + alignment;
+      if (block_size < BLOCK_BYTES)
+        block_size = BLOCK_BYTES;
+      ArenaBlock *block = 
+        (ArenaBlock*)legion_malloc(ANALYSIS_ARENA_ALLOC, block_size);
+#ifdef DEBUG_LEGION
+      assert(block != NULL);
+#endif
+      block->next = blocks;
+      block->size = block_size;
+      blocks = block;
+#ifdef TRACE_ALLOCATION
+      heap_blocks++;
+#endif
+      char *start = (char*)(block + 1);
+      char *result = (char*)(((uintptr_t)start + alignment - 1) &
+                              ~(uintptr_t)(alignment - 1));
+      next_free = result + bytes;
+      limit = start + (block_size - sizeof(ArenaBlock));
+      return result;
+    }
+
+    /**
+     * \class ArenaAllocator
+     * An STL allocator that takes its memory from an AnalysisArena.
+     * Deallocation does nothing since all the memory is returned
+     * when the arena is destroyed, so the data structure must not
+     * outlive the arena that it was constructed with.
+     */
+    template<typename T>
+    class ArenaAllocator {
+    public:
+      typedef size_t          size_type;
+      typedef ptrdiff_t difference_type;
+      typedef T*                pointer;
+      typedef const T*    const_pointer;
+      typedef T&              reference;
+      typedef const T&  const_reference;
+      typedef T              value_type;
+    public:
+      template<typename U>
+      struct rebind {
+        typedef ArenaAllocator<U> other;
+      };
+    public:
+      inline ArenaAllocator(AnalysisArena &a) : arena(&a) { }
+      inline ~ArenaAllocator(void) { }
+      inline ArenaAllocator(const ArenaAllocator<T> &rhs) 
+        : arena(rhs.arena) { }
+      template<typename U>
+      inline ArenaAllocator(const ArenaAllocator<U> &rhs)
+        : arena(rhs.arena) { }
+    public:
+      inline pointer address(reference r) { return &r; }
+      inline const_pointer address(const_reference r) { return &r; }
+    public:
+      inline pointer allocate(size_type cnt, const void* = 0) {
+        return reinterpret_cast<pointer>(arena->allocate(cnt * sizeof(T),
+                                          AlignmentTrait<T>::AlignmentOf));
+      }
+      inline void deallocate(pointer p, size_type size) { 
+        // Nothing to do, freed when the arena is destroyed
+      }
+    public:
+      inline size_type max_size(void) const {
+        return std::numeric_limits<size_type>::max() / sizeof(T);
+      }
+    public:
+#if __cplusplus >= 201103L
+      template<class U, class... Args>
+      inline void construct(U *p, Args&&... args) 
+        { ::new((void*)p) U(std::forward<Args>(args)...); }
+      template<class U>
+      inline void destroy(U *p) { p->~U(); }
+#else
+      inline void construct(pointer p, const T &t) { new(p) T(t); }
+      inline void destroy(pointer p) { p->~T(); }
+#endif
+    public:
+      inline bool operator==(ArenaAllocator const &a) const
+                                           { return (arena == a.arena); }
+      inline bool operator!=(ArenaAllocator const &a) const
+                                           { return !operator==(a); }
+    public:
+      AnalysisArena *arena;
+    };
+
     template<typename T, AllocationType A = LAST_ALLOC,
              typename COMPARATOR = std::less<T> >
     struct LegionSet {
@@ -581,6 +759,7 @@ namespace Legion {
       typedef std::set<T, COMPARATOR, AlignedAllocator<T> > aligned;
       typedef std::set<T, COMPARATOR, 
                        LegionAllocator<T, A, true/*aligned*/> > track_aligned;
+      typedef std::set<T, COMPARATOR, ArenaAllocator<T> > arena;
     };
 
     template<typename T, AllocationType A = LAST_ALLOC>
@@ -589,6 +768,7 @@ namespace Legion {
       typedef std::list<T, AlignedAllocator<T> > aligned;
       typedef std::list<T, 
                         LegionAllocator<T, A, true/*aligned*/> > track_aligned;
+      typedef std::list<T, ArenaAllocator<T> > arena;
     };
 
     template<typename T, AllocationType A = LAST_ALLOC>
@@ -616,6 +796,8 @@ namespace Legion {
                            AlignedAllocator<std::pair<const T1, T2> > > aligned;
       typedef std::map<T1, T2, COMPARATOR, LegionAllocator<
                    std::pair<const T1, T2>, A, true/*aligned*/> > track_aligned;
+      typedef std::map<T1, T2, COMPARATOR, 
+                       ArenaAllocator<std::pair<const T1, T2> > > arena;
     };
   }; // namespace Internal
 }; // namespace Legion
@@ -2420,6 +2420,174 @@ namespace Legion {
       projections[function].insert(node);
     }
 
+    /////////////////////////////////////////////////////////////
+    // LogicalUserIndex
+    /////////////////////////////////////////////////////////////
+
+    //--------------------------------------------------------------------------
+    template<AllocationType ALLOC>
+    void LogicalUserIndex<ALLOC>::record(UserList &users)
+    //--------------------------------------------------------------------------
+    {
+      if (!active || !valid)
+        return;
+      // If anything else changed since the last time we saw the
+      // list then we'll need to rebuild before the next search
+      if (users.size() != (indexed + 1))
+      {
+        valid = false;
+        return;
+      }
+      UserIterator last = users.end();
+      add_user(--last);
+      indexed++;
+    }
+
+    //--------------------------------------------------------------------------
+    template<AllocationType ALLOC>
+    bool LogicalUserIndex<ALLOC>::find_users(UserList &users,
+                                             const FieldMask &mask,
+                                   std::vector<IndexedUser> &candidates,
+                                             bool &sweep)
+    //--------------------------------------------------------------------------
+    {
+      sweep = false;
+      if (!active)
+      {
+        // Not worth indexing until there are enough users to search
+        if (users.size() < DEFAULT_LOGICAL_USER_INDEX_THRESHOLD)
+          return false;
+        active = true;
+        valid = false;
+      }
+      else if (users.size() < (DEFAULT_LOGICAL_USER_INDEX_THRESHOLD / 2))
+      {
+        // Stop indexing once the list has shrunk back down
+        active = false;
+        buckets.clear();
+        pruned.clear();
+        return false;
+      }
+      if (!valid || (users.size() != indexed))
+        rebuild(users);
+      // Users we never overlap with would never be tested for whether
+      // they can be pruned, so every so often have the caller walk
+      // all of the users and check them all
+      const size_t sweep_queries = (LogicalUser::TIMEOUT > 0) ?
+        std::max<size_t>(LogicalUser::TIMEOUT, indexed / 8) : 0;
+      if (++queries > sweep_queries)
+      {
+        queries = 0;
+        sweep = true;
+        return false;
+      }
+      unsigned num_buckets = 0;
+      int idx = mask.find_first_set();
+      while (idx >= 0)
+      {
+        const unsigned bucket = idx / DEFAULT_LOGICAL_USER_INDEX_BUCKET_FIELDS;
+        const std::vector<IndexedUser> &bucket_users = buckets[bucket];
+        candidates.insert(candidates.end(),
+                          bucket_users.begin(), bucket_users.end());
+        // If we're going to look at most of the users anyway then
+        // it is cheaper to just walk all of them
+        if (candidates.size() >= indexed)
+        {
+          candidates.clear();
+          return false;
+        }
+        num_buckets++;
+        const unsigned next = (bucket + 1) *
+          DEFAULT_LOGICAL_USER_INDEX_BUCKET_FIELDS;
+        idx = (next < MAX_FIELDS) ? mask.find_next_set(next) : -1;
+      }
+      // Put the candidates back in list order so we register
+      // dependences in the same order as a walk of the list would
+      if (num_buckets > 1)
+      {
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                         candidates.end());
+      }
+      if (!pruned.empty())
+      {
+        unsigned next = 0;
+        for (unsigned cand = 0; cand < candidates.size(); cand++)
+        {
+          if (pruned.find(candidates[cand].stamp) != pruned.end())
+            continue;
+          if (next != cand)
+            candidates[next] = candidates[cand];
+          next++;
+        }
+        candidates.resize(next);
+      }
+      if ((2 * candidates.size()) >= indexed)
+      {
+        candidates.clear();
+        return false;
+      }
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    template<AllocationType ALLOC>
+    void LogicalUserIndex<ALLOC>::erase(UserList &users,
+                                        const IndexedUser &user)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(valid);
+      assert(indexed > 0);
+#endif
+      users.erase(user.user);
+      indexed--;
+      // Buckets still hold the erased user, so remember not to
+      // return it and rebuild once there are too many of them
+      pruned.insert(user.stamp);
+      if (pruned.size() > indexed)
+        valid = false;
+    }
+
+    //--------------------------------------------------------------------------
+    template<AllocationType ALLOC>
+    void LogicalUserIndex<ALLOC>::rebuild(UserList &users)
+    //--------------------------------------------------------------------------
+    {
+      buckets.clear();
+      buckets.resize(MAX_FIELDS / DEFAULT_LOGICAL_USER_INDEX_BUCKET_FIELDS);
+      pruned.clear();
+      next_stamp = 0;
+      for (UserIterator it = users.begin(); it != users.end(); it++)
+        add_user(it);
+      indexed = users.size();
+      valid = true;
+    }
+
+    //--------------------------------------------------------------------------
+    template<AllocationType ALLOC>
+    void LogicalUserIndex<ALLOC>::add_user(UserIterator user)
+    //--------------------------------------------------------------------------
+    {
+      const IndexedUser entry(next_stamp++, user);
+      int idx = user->field_mask.find_first_set();
+      while (idx >= 0)
+      {
+        const unsigned bucket = idx / DEFAULT_LOGICAL_USER_INDEX_BUCKET_FIELDS;
+        buckets[bucket].push_back(entry);
+        const unsigned next = (bucket + 1) *
+          DEFAULT_LOGICAL_USER_INDEX_BUCKET_FIELDS;
+        idx = (next < MAX_FIELDS) ? user->field_mask.find_next_set(next) : -1;
+      }
+    }
+
+    template class LogicalUserIndex<CURR_LOGICAL_ALLOC>;
+    template class LogicalUserIndex<PREV_LOGICAL_ALLOC>;
+    // Never used but perform_dependence_checks is also instantiated
+    // for the other kinds of lists of logical users
+    template class LogicalUserIndex<CLOSE_LOGICAL_ALLOC>;
+    template class LogicalUserIndex<LOGICAL_REC_ALLOC>;
+
     /////////////////////////////////////////////////////////////
     // LogicalState 
     ///////////////////////////////////////////////////////////// 
@@ -2483,6 +2651,7 @@ namespace Legion {
           it->op->remove_mapping_reference(it->gen); 
         }
         curr_epoch_users.clear();
+        curr_epoch_index.invalidate();
       }
       if (!prev_epoch_users.empty())
       {
@@ -2493,6 +2662,7 @@ namespace Legion {
           it->op->remove_mapping_reference(it->gen); 
         }
         prev_epoch_users.clear();
+        prev_epoch_index.invalidate();
       }
     }
 
@@ -2572,7 +2742,9 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       // See if we can get some coalescing going on here
-      std::map<ProjectionEpochID,ProjectionEpoch*> to_add; 
+      AnalysisArena local_arena;
+      LegionMap<ProjectionEpochID,ProjectionEpoch*>::arena 
+        to_add(std::less<ProjectionEpochID>(), local_arena);
       for (std::list<ProjectionEpoch*>::iterator it = 
             projection_epochs.begin(); it != 
             projection_epochs.end(); /*nothing*/)
@@ -2584,8 +2756,8 @@ namespace Legion {
           continue;
         }
         const ProjectionEpochID next_epoch_id = (*it)->epoch_id + 1;
-        std::map<ProjectionEpochID,ProjectionEpoch*>::iterator finder = 
-          to_add.find(next_epoch_id);
+        LegionMap<ProjectionEpochID,ProjectionEpoch*>::arena::iterator 
+          finder = to_add.find(next_epoch_id);
         if (finder == to_add.end())
         {
           ProjectionEpoch *next_epoch = 
@@ -2606,8 +2778,8 @@ namespace Legion {
       }
       if (!to_add.empty())
       {
-        for (std::map<ProjectionEpochID,ProjectionEpoch*>::const_iterator it = 
-              to_add.begin(); it != to_add.end(); it++)
+        for (LegionMap<ProjectionEpochID,ProjectionEpoch*>::arena::
+              const_iterator it = to_add.begin(); it != to_add.end(); it++)
           projection_epochs.push_back(it->second);
       }
     }
@@ -574,6 +574,60 @@ namespace Legion {
       std::map<ProjectionFunction*,std::set<IndexSpaceNode*> > projections;
     };
 
+    /**
+     * \class LogicalUserIndex
+     * An index from buckets of fields to the users in an epoch
+     * list of a logical state that use any of those fields so
+     * that dependence analysis on a long list of users only has
+     * to visit the ones that might overlap. Users that are pruned
+     * through the index are remembered until the next rebuild;
+     * any other change to the list that is not a push recorded
+     * with the index must invalidate it.
+     */
+    template<AllocationType ALLOC>
+    class LogicalUserIndex {
+    public:
+      typedef typename LegionList<LogicalUser,ALLOC>::track_aligned UserList;
+      typedef typename UserList::iterator UserIterator;
+      struct IndexedUser {
+      public:
+        IndexedUser(void) : stamp(0) { }
+        IndexedUser(uint64_t s, UserIterator u) : stamp(s), user(u) { }
+      public:
+        inline bool operator<(const IndexedUser &rhs) const
+          { return (stamp < rhs.stamp); }
+        inline bool operator==(const IndexedUser &rhs) const
+          { return (stamp == rhs.stamp); }
+      public:
+        uint64_t stamp; // increases with the position in the list
+        UserIterator user;
+      };
+    public:
+      LogicalUserIndex(void)
+        : active(false), valid(false), indexed(0),
+          next_stamp(0), queries(0) { }
+    public:
+      // Must be called after every push onto the back of the users
+      void record(UserList &users);
+      inline void invalidate(void) { valid = false; }
+      // Returns false if the caller should walk all the users instead,
+      // in which case sweep says whether the caller should also check
+      // whether the users it doesn't overlap with can be pruned
+      bool find_users(UserList &users, const FieldMask &mask,
+                      std::vector<IndexedUser> &candidates, bool &sweep);
+      void erase(UserList &users, const IndexedUser &user);
+    protected:
+      void rebuild(UserList &users);
+      void add_user(UserIterator user);
+    protected:
+      bool active, valid;
+      size_t indexed;
+      uint64_t next_stamp;
+      size_t queries;
+      std::vector<std::vector<IndexedUser> > buckets;
+      std::set<uint64_t> pruned;
+    };
+
     /**
      * \class LogicalState
      * Track all the information about the current state
@@ -612,6 +666,8 @@ namespace Legion {
                                                             curr_epoch_users;
       LegionList<LogicalUser,PREV_LOGICAL_ALLOC>::track_aligned 
                                                             prev_epoch_users;
+      LogicalUserIndex<CURR_LOGICAL_ALLOC> curr_epoch_index;
+      LogicalUserIndex<PREV_LOGICAL_ALLOC> prev_epoch_index;
     public:
       // Fields which we know have been mutated below in the region tree
       FieldMask dirty_below;
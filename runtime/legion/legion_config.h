@@ -102,6 +102,26 @@
 #ifndef DEFAULT_MAX_TASK_WINDOW
 #define DEFAULT_MAX_TASK_WINDOW         1024
 #endif
+// Initial number of slots in the ring used by each context for
+// tracking its outstanding child operations (must be a power of 2)
+#ifndef DEFAULT_CHILD_OPS_RING_SIZE
+#define DEFAULT_CHILD_OPS_RING_SIZE     64
+#endif
+// Maximum number of points for which each functional projection
+// functor will memoize results across index space launches
+#ifndef DEFAULT_MAX_PROJECTION_MEMO_POINTS
+#define DEFAULT_MAX_PROJECTION_MEMO_POINTS  (1 << 20)
+#endif
+// Number of events with users in an epoch of a materialized view
+// before the view starts indexing those events by the fields they use
+#ifndef DEFAULT_VIEW_USER_INDEX_THRESHOLD
+#define DEFAULT_VIEW_USER_INDEX_THRESHOLD  64
+#endif
+// Number of consecutive fields grouped into each bucket of the index
+// of users of a materialized view (must be a power of 2)
+#ifndef DEFAULT_VIEW_USER_INDEX_BUCKET_FIELDS
+#define DEFAULT_VIEW_USER_INDEX_BUCKET_FIELDS  8
+#endif
 // Default amount of hysteresis on the task window in the
 // form of a percentage (must be between 0 and 100)
 #ifndef DEFAULT_TASK_WINDOW_HYSTERESIS
@@ -130,6 +150,16 @@
 #ifndef DEFAULT_LOGICAL_USER_TIMEOUT
 #define DEFAULT_LOGICAL_USER_TIMEOUT    32
 #endif
+// Number of users in an epoch list of a logical state before the
+// list starts indexing those users by the fields they use
+#ifndef DEFAULT_LOGICAL_USER_INDEX_THRESHOLD
+#define DEFAULT_LOGICAL_USER_INDEX_THRESHOLD  64
+#endif
+// Number of consecutive fields grouped into each bucket of the index
+// of logical users of an epoch list (must be a power of 2)
+#ifndef DEFAULT_LOGICAL_USER_INDEX_BUCKET_FIELDS
+#define DEFAULT_LOGICAL_USER_INDEX_BUCKET_FIELDS  8
+#endif
 // Number of events to place in each GC epoch
 // Large counts improve efficiency but add latency to
 // garbage collection.  Smaller count reduce efficiency
@@ -562,6 +592,7 @@ typedef enum legion_error_t {
   ERROR_NON_DENSE_RECTANGLE = 548,
   ERROR_LIBRARY_COUNT_MISMATCH = 549, 
   ERROR_MPI_INTEROP_MISCONFIGURATION = 550,
+  ERROR_INVALID_SPY_FILE = 551,
   
 
   LEGION_WARNING_FUTURE_NONLEAF = 1000,
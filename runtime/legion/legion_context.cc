@@ -1925,7 +1925,9 @@ namespace Legion {
         remote_context(remote), full_inner_context(full_inner),
         parent_req_indexes(parent_indexes), virtual_mapped(virt_mapped), 
         total_children_count(0), total_close_count(0), 
-        outstanding_children_count(0), outstanding_prepipeline(0),
+        outstanding_children_count(0), child_ops_head(0), child_ops_tail(0),
+        executing_children_count(0), executed_children_count(0),
+        complete_children_count(0), outstanding_prepipeline(0),
         outstanding_dependence(false), outstanding_post_task(0),
         current_trace(NULL), valid_wait_event(false), outstanding_subtasks(0),
         pending_subtasks(0), pending_frames(0), currently_active_context(false),
@@ -4639,12 +4641,9 @@ namespace Legion {
       {
         AutoLock child_lock(child_op_lock);
 #ifdef DEBUG_LEGION
-        assert(executing_children.find(op) == executing_children.end());
-        assert(executed_children.find(op) == executed_children.end());
-        assert(complete_children.find(op) == complete_children.end());
         outstanding_children[op->get_ctx_index()] = op;
 #endif       
-        executing_children[op] = op->get_generation();
+        insert_child_slot(op);
         // Bump our priority if the context is not active as it means
         // that the runtime is currently not ahead of execution
         if (!currently_active_context)
@@ -4828,25 +4827,99 @@ namespace Legion {
       }
     }
 
+    //--------------------------------------------------------------------------
+    void InnerContext::insert_child_slot(Operation *op)
+    //--------------------------------------------------------------------------
+    {
+      // Should be holding the child op lock in exclusive mode
+      const unsigned index = op->get_ctx_index();
+      // Skip past any children at the front of the ring that have committed
+      while ((child_ops_head != child_ops_tail) &&
+             (find_child_slot(child_ops_head).state == CHILD_OP_EMPTY))
+        child_ops_head++;
+      if (child_ops_head == child_ops_tail)
+        child_ops_head = child_ops_tail = index;
+      // Children usually arrive in order but don't have to
+      const unsigned lower = (index < child_ops_head) ? index : child_ops_head;
+      const unsigned upper = (index < child_ops_tail) ? child_ops_tail : 
+                                                        (index + 1);
+      if ((upper - lower) > child_ops.size())
+      {
+        // Grow the ring and move the live children over to it
+        size_t new_size = child_ops.empty() ? 
+          DEFAULT_CHILD_OPS_RING_SIZE : child_ops.size();
+        while (new_size < (upper - lower))
+          new_size *= 2;
+        std::vector<ChildOpSlot> new_ops(new_size);
+        for (unsigned idx = child_ops_head; idx != child_ops_tail; idx++)
+        {
+          const ChildOpSlot &slot = find_child_slot(idx);
+          if (slot.state != CHILD_OP_EMPTY)
+            new_ops[idx & (new_size - 1)] = slot;
+        }
+        child_ops.swap(new_ops);
+      }
+      child_ops_head = lower;
+      child_ops_tail = upper;
+      ChildOpSlot &slot = find_child_slot(index);
+#ifdef DEBUG_LEGION
+      assert(slot.state == CHILD_OP_EMPTY);
+#endif
+      slot.op = op;
+      slot.gen = op->get_generation();
+      slot.state = CHILD_OP_EXECUTING;
+      __sync_fetch_and_add(&executing_children_count, 1);
+    }
+
+    //--------------------------------------------------------------------------
+    InnerContext::ChildOpState InnerContext::transition_child(Operation *op,
+                                                              ChildOpState to)
+    //--------------------------------------------------------------------------
+    {
+      // Should be holding the child op lock in at least shared mode
+      if (child_ops.empty())
+        return CHILD_OP_EMPTY;
+      ChildOpSlot &slot = find_child_slot(op->get_ctx_index());
+      if (slot.op != op)
+        return CHILD_OP_EMPTY;
+      unsigned *const counts[4] = { NULL, &executing_children_count,
+                      &executed_children_count, &complete_children_count };
+      // Count the child in its new state before we remove it from the
+      // old one so that the counts never all look zero while it is live
+      if (to != CHILD_OP_EMPTY)
+        __sync_fetch_and_add(counts[to], 1);
+      int previous = slot.state;
+      while (previous != CHILD_OP_EMPTY)
+      {
+        const int actual = 
+          __sync_val_compare_and_swap(&slot.state, previous, int(to));
+        if (actual == previous)
+          break;
+        previous = actual;
+      }
+      if (previous != CHILD_OP_EMPTY)
+        __sync_fetch_and_add(counts[previous], -1);
+      else if (to != CHILD_OP_EMPTY)
+        __sync_fetch_and_add(counts[to], -1);
+      return ChildOpState(previous);
+    }
+
     //--------------------------------------------------------------------------
     void InnerContext::register_child_executed(Operation *op)
     //--------------------------------------------------------------------------
     {
       RtUserEvent to_trigger;
       {
-        AutoLock child_lock(child_op_lock);
-        std::map<Operation*,GenerationID>::iterator 
-          finder = executing_children.find(op);
-#ifdef DEBUG_LEGION
-        assert(finder != executing_children.end());
-        assert(executed_children.find(op) == executed_children.end());
-        assert(complete_children.find(op) == complete_children.end());
-#endif
-        // Now put it in the list of executing operations
-        // Note this doesn't change the number of active children
-        // so there's no need to trigger any window waits
-        executed_children.insert(*finder);
-        executing_children.erase(finder);
+        // Only need the lock in shared mode since we are just changing
+        // the state of the child and not the shape of the ring
+        AutoLock child_lock(child_op_lock,1,false/*exclusive*/);
+#ifdef DEBUG_LEGION
+        const ChildOpState previous = 
+#endif
+          transition_child(op, CHILD_OP_EXECUTED);
+#ifdef DEBUG_LEGION
+        assert(previous == CHILD_OP_EXECUTING);
+#endif
         // Add some hysteresis here so that we have some runway for when
         // the paused task resumes it can run for a little while.
         int outstanding_count = 
@@ -4854,14 +4927,14 @@ namespace Legion {
 #ifdef DEBUG_LEGION
         assert(outstanding_count >= 0);
 #endif
+        // The window wait event can only be set while holding the lock
+        // in exclusive mode, so whoever clears the flag gets to trigger it
         if (valid_wait_event && (context_configuration.max_window_size > 0) &&
             (outstanding_count <=
              int((100 - context_configuration.hysteresis_percentage) * 
-                 context_configuration.max_window_size / 100)))
-        {
+                 context_configuration.max_window_size / 100)) &&
+            __sync_bool_compare_and_swap(&valid_wait_event, true, false))
           to_trigger = window_wait;
-          valid_wait_event = false;
-        }
       }
       if (to_trigger.exists())
         Runtime::trigger_event(to_trigger);
@@ -4873,24 +4946,20 @@ namespace Legion {
     {
       bool needs_trigger = false;
       {
-        AutoLock child_lock(child_op_lock);
-        std::map<Operation*,GenerationID>::iterator finder = 
-          executed_children.find(op);
+        AutoLock child_lock(child_op_lock,1,false/*exclusive*/);
 #ifdef DEBUG_LEGION
-        assert(finder != executed_children.end());
-        assert(complete_children.find(op) == complete_children.end());
-        assert(executing_children.find(op) == executing_children.end());
+        const ChildOpState previous = 
+#endif
+          transition_child(op, CHILD_OP_COMPLETE);
+#ifdef DEBUG_LEGION
+        assert(previous == CHILD_OP_EXECUTED);
 #endif
-        // Put it on the list of complete children to complete
-        complete_children.insert(*finder);
-        executed_children.erase(finder);
         // See if we need to trigger the all children complete call
-        if (task_executed && executing_children.empty() && 
-            executed_children.empty() && !children_complete_invoked)
-        {
+        if (task_executed && (executing_children_count == 0) && 
+            (executed_children_count == 0) && !children_complete_invoked &&
+            __sync_bool_compare_and_swap(&children_complete_invoked, 
+                                         false, true))
           needs_trigger = true;
-          children_complete_invoked = true;
-        }
       }
       if (needs_trigger && (owner_task != NULL))
         owner_task->trigger_children_complete();
@@ -4902,24 +4971,25 @@ namespace Legion {
     {
       bool needs_trigger = false;
       {
-        AutoLock child_lock(child_op_lock);
-        std::map<Operation*,GenerationID>::iterator finder = 
-          complete_children.find(op);
 #ifdef DEBUG_LEGION
-        assert(finder != complete_children.end());
-        assert(executing_children.find(op) == executing_children.end());
-        assert(executed_children.find(op) == executed_children.end());
+        // Need exclusive access to update the outstanding children
+        AutoLock child_lock(child_op_lock);
         outstanding_children.erase(op->get_ctx_index());
+        const ChildOpState previous = 
+#else
+        AutoLock child_lock(child_op_lock,1,false/*exclusive*/);
+#endif
+          transition_child(op, CHILD_OP_EMPTY);
+#ifdef DEBUG_LEGION
+        assert(previous == CHILD_OP_COMPLETE);
 #endif
-        complete_children.erase(finder);
         // See if we need to trigger the all children commited call
-        if (task_executed && executing_children.empty() && 
-            executed_children.empty() && complete_children.empty() &&
-            !children_commit_invoked)
-        {
+        if (task_executed && (executing_children_count == 0) && 
+            (executed_children_count == 0) && 
+            (complete_children_count == 0) && !children_commit_invoked &&
+            __sync_bool_compare_and_swap(&children_commit_invoked, 
+                                         false, true))
           needs_trigger = true;
-          children_commit_invoked = true;
-        }
       }
       if (needs_trigger && (owner_task != NULL))
         owner_task->trigger_children_committed();
@@ -4931,15 +5001,15 @@ namespace Legion {
     {
       RtUserEvent to_trigger;
       {
-        AutoLock child_lock(child_op_lock);
-        // Remove it from everything and then see if we need to
-        // trigger the window wait event
-        executing_children.erase(op);
-        executed_children.erase(op);
-        complete_children.erase(op);
 #ifdef DEBUG_LEGION
+        AutoLock child_lock(child_op_lock);
         outstanding_children.erase(op->get_ctx_index());
+#else
+        AutoLock child_lock(child_op_lock,1,false/*exclusive*/);
 #endif
+        // Remove it from the ring and then see if we need to
+        // trigger the window wait event
+        transition_child(op, CHILD_OP_EMPTY);
         int outstanding_count = 
           __sync_add_and_fetch(&outstanding_children_count,-1);
 #ifdef DEBUG_LEGION
@@ -4948,11 +5018,9 @@ namespace Legion {
         if (valid_wait_event && (context_configuration.max_window_size > 0) &&
             (outstanding_count <=
              int((100 - context_configuration.hysteresis_percentage) *
-                 context_configuration.max_window_size / 100)))
-        {
+                 context_configuration.max_window_size / 100)) &&
+            __sync_bool_compare_and_swap(&valid_wait_event, true, false))
           to_trigger = window_wait;
-          valid_wait_event = false;
-        }
       }
       if (to_trigger.exists())
         Runtime::trigger_event(to_trigger);
@@ -4964,23 +5032,23 @@ namespace Legion {
     {
       // Don't both taking the lock since this is for debugging
       // and isn't actually called anywhere
-      for (std::map<Operation*,GenerationID>::const_iterator it =
-            executing_children.begin(); it != executing_children.end(); it++)
-      {
-        Operation *op = it->first;
-        printf("Executing Child %p\n",op);
-      }
-      for (std::map<Operation*,GenerationID>::const_iterator it =
-            executed_children.begin(); it != executed_children.end(); it++)
+      for (unsigned idx = child_ops_head; idx != child_ops_tail; idx++)
       {
-        Operation *op = it->first;
-        printf("Executed Child %p\n",op);
-      }
-      for (std::map<Operation*,GenerationID>::const_iterator it =
-            complete_children.begin(); it != complete_children.end(); it++)
-      {
-        Operation *op = it->first;
-        printf("Complete Child %p\n",op);
+        const ChildOpSlot &slot = find_child_slot(idx);
+        switch (slot.state)
+        {
+          case CHILD_OP_EXECUTING:
+            printf("Executing Child %p\n",slot.op);
+            break;
+          case CHILD_OP_EXECUTED:
+            printf("Executed Child %p\n",slot.op);
+            break;
+          case CHILD_OP_COMPLETE:
+            printf("Complete Child %p\n",slot.op);
+            break;
+          default:
+            break;
+        }
       }
     }
 
@@ -5054,139 +5122,38 @@ namespace Legion {
       const unsigned next_fence_index = op->get_ctx_index();
       // We only need the list of previous operations if we are recording
       // mapping dependences for this fence
-      if (!execution)
       {
-        // Mapping analysis only
+        // The ring is ordered by context index, so we only need to look
+        // at the children between the previous fence and this one
         AutoLock child_lock(child_op_lock,1,false/*exclusive*/);
-        for (std::map<Operation*,GenerationID>::const_iterator it = 
-              executing_children.begin(); it != executing_children.end(); it++)
-        {
-          if (it->first->get_generation() != it->second)
-            continue;
-          const unsigned op_index = it->first->get_ctx_index();
-          // If it's older than the previous fence then we don't care
-          if (op_index < current_mapping_fence_index)
-            continue;
-          // Record a dependence if it didn't come after our fence
-          if (op_index < next_fence_index)
-            previous_operations.insert(*it);
-        }
-        for (std::map<Operation*,GenerationID>::const_iterator it = 
-              executed_children.begin(); it != executed_children.end(); it++)
-        {
-          if (it->first->get_generation() != it->second)
-            continue;
-          const unsigned op_index = it->first->get_ctx_index();
-          // If it's older than the previous fence then we don't care
-          if (op_index < current_mapping_fence_index)
-            continue;
-          // Record a dependence if it didn't come after our fence
-          if (op_index < next_fence_index)
-            previous_operations.insert(*it);
-        }
-        for (std::map<Operation*,GenerationID>::const_iterator it = 
-              complete_children.begin(); it != complete_children.end(); it++)
-        {
-          if (it->first->get_generation() != it->second)
-            continue;
-          const unsigned op_index = it->first->get_ctx_index();
-          // If it's older than the previous fence then we don't care
-          if (op_index < current_mapping_fence_index)
-            continue;
-          // Record a dependence if it didn't come after our fence
-          if (op_index < next_fence_index)
-            previous_operations.insert(*it);
-        }
-      }
-      else if (!mapping)
-      {
-        // Execution analysis only
-        AutoLock child_lock(child_op_lock,1,false/*exclusive*/);
-        for (std::map<Operation*,GenerationID>::const_iterator it = 
-              executing_children.begin(); it != executing_children.end(); it++)
-        {
-          if (it->first->get_generation() != it->second)
-            continue;
-          const unsigned op_index = it->first->get_ctx_index();
-          // If it's older than the previous fence then we don't care
-          if (op_index < current_execution_fence_index)
-            continue;
-          // Record a dependence if it didn't come after our fence
-          if (op_index < next_fence_index)
-            previous_events.insert(it->first->get_completion_event());
-        }
-        for (std::map<Operation*,GenerationID>::const_iterator it = 
-              executed_children.begin(); it != executed_children.end(); it++)
-        {
-          if (it->first->get_generation() != it->second)
+        unsigned first_index = execution ? 
+          (mapping ? std::min(current_mapping_fence_index,
+                              current_execution_fence_index) :
+           current_execution_fence_index) : current_mapping_fence_index;
+        if (first_index < child_ops_head)
+          first_index = child_ops_head;
+        const unsigned last_index = (next_fence_index < child_ops_tail) ?
+          next_fence_index : child_ops_tail;
+        for (unsigned idx = first_index; idx < last_index; idx++)
+        {
+          const ChildOpSlot &slot = find_child_slot(idx);
+          if (slot.state == CHILD_OP_EMPTY)
             continue;
-          const unsigned op_index = it->first->get_ctx_index();
-          // If it's older than the previous fence then we don't care
-          if (op_index < current_execution_fence_index)
+          Operation *child = slot.op;
+          const GenerationID child_gen = slot.gen;
+          if (child->get_generation() != child_gen)
             continue;
-          // Record a dependence if it didn't come after our fence
-          if (op_index < next_fence_index)
-            previous_events.insert(it->first->get_completion_event());
-        }
-        for (std::map<Operation*,GenerationID>::const_iterator it = 
-              complete_children.begin(); it != complete_children.end(); it++)
-        {
-          if (it->first->get_generation() != it->second)
-            continue;
-          const unsigned op_index = it->first->get_ctx_index();
-          // If it's older than the previous fence then we don't care
-          if (op_index < current_execution_fence_index)
-            continue;
-          // Record a dependence if it didn't come after our fence
-          if (op_index < next_fence_index)
-            previous_events.insert(it->first->get_completion_event());
-        }
-      }
-      else
-      {
-        // Both mapping and execution analysis at the same time
-        AutoLock child_lock(child_op_lock,1,false/*exclusive*/);
-        for (std::map<Operation*,GenerationID>::const_iterator it = 
-              executing_children.begin(); it != executing_children.end(); it++)
-        {
-          if (it->first->get_generation() != it->second)
-            continue;
-          const unsigned op_index = it->first->get_ctx_index();
-          // If it's younger than our fence we don't care
-          if (op_index >= next_fence_index)
-            continue;
-          if (op_index >= current_mapping_fence_index)
-            previous_operations.insert(*it);
-          if (op_index >= current_execution_fence_index)
-            previous_events.insert(it->first->get_completion_event());
-        }
-        for (std::map<Operation*,GenerationID>::const_iterator it = 
-              executed_children.begin(); it != executed_children.end(); it++)
-        {
-          if (it->first->get_generation() != it->second)
-            continue;
-          const unsigned op_index = it->first->get_ctx_index();
-          // If it's younger than our fence we don't care
-          if (op_index >= next_fence_index)
-            continue;
-          if (op_index >= current_mapping_fence_index)
-            previous_operations.insert(*it);
-          if (op_index >= current_execution_fence_index)
-            previous_events.insert(it->first->get_completion_event());
-        }
-        for (std::map<Operation*,GenerationID>::const_iterator it = 
-              complete_children.begin(); it != complete_children.end(); it++)
-        {
-          if (it->first->get_generation() != it->second)
-            continue;
-          const unsigned op_index = it->first->get_ctx_index();
-          // If it's younger than our fence we don't care
-          if (op_index >= next_fence_index)
-            continue;
-          if (op_index >= current_mapping_fence_index)
-            previous_operations.insert(*it);
-          if (op_index >= current_execution_fence_index)
-            previous_events.insert(it->first->get_completion_event());
+          if (mapping && (idx >= current_mapping_fence_index))
+            previous_operations[child] = child_gen;
+          if (execution && (idx >= current_execution_fence_index))
+          {
+            // Children can commit while we are looking at them so make
+            // sure the event we read is still for the same generation
+            const ApEvent child_done = child->get_completion_event();
+            __sync_synchronize();
+            if (child->get_generation() == child_gen)
+              previous_events.insert(child_done);
+          }
         }
       }
 
@@ -6215,8 +6182,8 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       AutoLock chil_lock(child_op_lock);
-      if (task_executed && executing_children.empty() && 
-          executed_children.empty() && !children_complete_invoked)
+      if (task_executed && (executing_children_count == 0) && 
+          (executed_children_count == 0) && !children_complete_invoked)
       {
         children_complete_invoked = true;
         return true;
@@ -6229,9 +6196,9 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       AutoLock child_lock(child_op_lock);
-      if (task_executed && executing_children.empty() && 
-          executed_children.empty() && complete_children.empty() && 
-          !children_commit_invoked)
+      if (task_executed && (executing_children_count == 0) && 
+          (executed_children_count == 0) && 
+          (complete_children_count == 0) && !children_commit_invoked)
       {
         children_commit_invoked = true;
         return true;
@@ -6442,16 +6409,12 @@ namespace Legion {
           AutoLock child_lock(child_op_lock);
           // Only need to do this for executing and executed children
           // We know that any complete children are done
-          for (std::map<Operation*,GenerationID>::const_iterator it = 
-                executing_children.begin(); it != 
-                executing_children.end(); it++)
-          {
-            preconditions.insert(it->first->get_mapped_event());
-          }
-          for (std::map<Operation*,GenerationID>::const_iterator it = 
-                executed_children.begin(); it != executed_children.end(); it++)
+          for (unsigned idx = child_ops_head; idx != child_ops_tail; idx++)
           {
-            preconditions.insert(it->first->get_mapped_event());
+            const ChildOpSlot &slot = find_child_slot(idx);
+            if ((slot.state == CHILD_OP_EXECUTING) ||
+                (slot.state == CHILD_OP_EXECUTED))
+              preconditions.insert(slot.op->get_mapped_event());
           }
 #ifdef DEBUG_LEGION
           assert(!task_executed);
@@ -6459,14 +6422,15 @@ namespace Legion {
           // Now that we know the last registration has taken place we
           // can mark that we are done executing
           task_executed = true;
-          if (executing_children.empty() && executed_children.empty())
+          if ((executing_children_count == 0) && 
+              (executed_children_count == 0))
           {
             if (!children_complete_invoked)
             {
               need_complete = true;
               children_complete_invoked = true;
             }
-            if (complete_children.empty() && 
+            if ((complete_children_count == 0) && 
                 !children_commit_invoked)
             {
               need_commit = true;
@@ -1041,18 +1041,45 @@ namespace Legion {
     protected:
       const std::vector<unsigned>           &parent_req_indexes;
       const std::vector<bool>               &virtual_mapped;
+    public:
+      enum ChildOpState {
+        CHILD_OP_EMPTY = 0,
+        CHILD_OP_EXECUTING = 1,
+        CHILD_OP_EXECUTED = 2,
+        CHILD_OP_COMPLETE = 3,
+      };
+      struct ChildOpSlot {
+      public:
+        ChildOpSlot(void)
+          : op(NULL), gen(0), state(CHILD_OP_EMPTY) { }
+      public:
+        Operation *op;
+        GenerationID gen;
+        volatile int state;
+      };
+    protected:
+      inline ChildOpSlot& find_child_slot(unsigned ctx_index)
+        { return child_ops[ctx_index & (child_ops.size() - 1)]; }
+      void insert_child_slot(Operation *op);
+      ChildOpState transition_child(Operation *op, ChildOpState to);
     protected:
       mutable LocalLock                     child_op_lock;
       // Track whether this task has finished executing
       unsigned total_children_count; // total number of sub-operations
       unsigned total_close_count; 
       unsigned outstanding_children_count;
-      LegionMap<Operation*,GenerationID,
-                EXECUTING_CHILD_ALLOC>::tracked executing_children;
-      LegionMap<Operation*,GenerationID,
-                EXECUTED_CHILD_ALLOC>::tracked executed_children;
-      LegionMap<Operation*,GenerationID,
-                COMPLETE_CHILD_ALLOC>::tracked complete_children; 
+      // Children that are executing, executed or complete but not yet
+      // committed live in a ring indexed by their context index. The ring
+      // only changes shape while holding the child op lock exclusively, 
+      // the state transitions of individual children happen atomically 
+      // while holding it in shared mode, and the per-state counts are 
+      // maintained with atomics so we can tell when all children are done
+      std::vector<ChildOpSlot>              child_ops;
+      unsigned                              child_ops_head; // oldest live
+      unsigned                              child_ops_tail; // newest + 1
+      unsigned                              executing_children_count;
+      unsigned                              executed_children_count;
+      unsigned                              complete_children_count;
 #ifdef DEBUG_LEGION
       // In debug mode also keep track of them in context order so
       // we can see what the longest outstanding operation is which
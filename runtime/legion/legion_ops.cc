@@ -90,6 +90,7 @@ namespace Legion {
       execution_fence_event = ApEvent::NO_AP_EVENT;
       trace = NULL;
       tracing = false;
+      trace_local_id = 0;
       must_epoch = NULL;
 #ifdef DEBUG_LEGION
       assert(mapped_event.exists());
@@ -698,6 +699,9 @@ namespace Legion {
         assert(!mapped);
         mapped = true;
       }
+#endif
+#ifdef TRACE_ALLOCATION
+      runtime->trace_mapped_operation();
 #endif
       Runtime::trigger_event(mapped_event, wait_on);
     }
@@ -4920,7 +4924,7 @@ namespace Legion {
         ProjectionFunction *function = 
           runtime->find_projection_function(src_requirements[idx].projection);
         function->project_points(this, idx, src_requirements[idx],
-                                 runtime, projection_points);
+                                 runtime, index_domain, projection_points);
       }
       for (unsigned idx = 0; idx < dst_requirements.size(); idx++)
       {
@@ -4930,7 +4934,7 @@ namespace Legion {
           runtime->find_projection_function(dst_requirements[idx].projection);
         function->project_points(this, src_requirements.size() + idx, 
                                  dst_requirements[idx], runtime, 
-                                 projection_points);
+                                 index_domain, projection_points);
       }
 #ifdef DEBUG_LEGION
       // Check for interfering point requirements in debug mode
@@ -11691,7 +11695,7 @@ namespace Legion {
         std::vector<ProjectionPoint*> projection_points(points.begin(),
                                                         points.end());
         function->project_points(this, 0/*idx*/, requirement,
-                                 runtime, projection_points);
+                                 runtime, index_domain, projection_points);
         // No need to check the validity of the points, we know they are good
         if (runtime->legion_spy_enabled)
         {
@@ -13391,7 +13395,7 @@ namespace Legion {
       std::vector<ProjectionPoint*> projection_points(points.begin(),
                                                       points.end());
       function->project_points(this, 0/*idx*/, requirement,
-                               runtime, projection_points);
+                               runtime, index_domain, projection_points);
 #ifdef DEBUG_LEGION
       // Check for interfering point requirements in debug mode
       check_point_requirements();
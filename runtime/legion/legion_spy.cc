@@ -19,6 +19,10 @@
 #include "legion/legion_spy.h"
 #include "legion/runtime.h"
 
+#include <map>
+#include <sstream>
+#include <string>
+
 namespace Legion {
   namespace Internal {
 
@@ -259,6 +263,160 @@ namespace Legion {
       }
     }
 
+
+    namespace LegionSpy {
+
+      bool binary_logging = false;
+
+      // Thread buffers are handed to the file once they hold this much
+      static const size_t BINARY_FLUSH_SIZE = 1 << 16;
+
+      static FILE *binary_file = NULL;
+      static LocalLock binary_lock;
+      // All the thread buffers ever made so they can be drained at exit
+      static BinaryBuffer *binary_buffers = NULL;
+      static std::map<std::string,unsigned> binary_kinds;
+      static __thread BinaryBuffer *local_binary_buffer = NULL;
+
+      //------------------------------------------------------------------------
+      static void write_binary_buffer(BinaryBuffer *buffer)
+      //------------------------------------------------------------------------
+      {
+        // Caller must be holding the binary lock
+        if (buffer->used == 0)
+          return;
+        if (fwrite(buffer->data, 1, buffer->used, binary_file) != buffer->used)
+          REPORT_LEGION_ERROR(ERROR_INVALID_SPY_FILE,
+                              "Unable to write Legion Spy log file")
+        buffer->used = 0;
+      }
+
+      //------------------------------------------------------------------------
+      static void close_binary_log(void)
+      //------------------------------------------------------------------------
+      {
+        // This runs at exit after all the runtime's threads are gone
+        for (BinaryBuffer *buffer = binary_buffers; 
+              buffer != NULL; buffer = buffer->next)
+          write_binary_buffer(buffer);
+        fclose(binary_file);
+        binary_file = NULL;
+        binary_logging = false;
+      }
+
+      //------------------------------------------------------------------------
+      void open_binary_log(const char *filename, AddressSpaceID space)
+      //------------------------------------------------------------------------
+      {
+        // Multiple runtime instances in one process share a file
+        if (binary_file != NULL)
+          return;
+        std::string name(filename);
+        const size_t pct = name.find_first_of('%', 0);
+        if (pct != std::string::npos)
+        {
+          std::stringstream ss;
+          ss << name.substr(0, pct) << space << name.substr(pct + 1);
+          name = ss.str();
+        }
+        binary_file = fopen(name.c_str(), "wb");
+        if (binary_file == NULL)
+          REPORT_LEGION_ERROR(ERROR_INVALID_SPY_FILE,
+              "Unable to open Legion Spy log file %s for writing!", 
+              name.c_str())
+        // The header is text, everything after the blank line is records
+        fprintf(binary_file, "FileType: BinaryLegionSpy v: 1.0\n");
+        fprintf(binary_file, "Node: %d\n\n", space);
+        binary_logging = true;
+        atexit(close_binary_log);
+        log_legion_spy_config();
+      }
+
+      //------------------------------------------------------------------------
+      unsigned register_record_kind(const char *format)
+      //------------------------------------------------------------------------
+      {
+        AutoLock b_lock(binary_lock);
+        std::map<std::string,unsigned>::const_iterator finder = 
+          binary_kinds.find(format);
+        if (finder != binary_kinds.end())
+          return finder->second;
+        // Kind 0 is reserved for definitions of the other kinds
+        const unsigned kind = binary_kinds.size() + 1;
+        binary_kinds[format] = kind;
+        // Write the definition straight to the file so it precedes any
+        // thread buffer that could contain a record of this kind
+        BinaryBuffer definition;
+        definition.data = NULL;
+        definition.size = 0;
+        definition.used = 0;
+        definition.add_varint(0);
+        definition.add_varint(kind);
+        const size_t length = strlen(format);
+        definition.add_varint(length);
+        definition.ensure(length);
+        memcpy(definition.data + definition.used, format, length);
+        definition.used += length;
+        write_binary_buffer(&definition);
+        free(definition.data);
+        return kind;
+      }
+
+      //------------------------------------------------------------------------
+      void BinaryBuffer::grow(size_t bytes)
+      //------------------------------------------------------------------------
+      {
+        size_t new_size = (size == 0) ? (2 * BINARY_FLUSH_SIZE) : (2 * size);
+        while (new_size < (used + bytes))
+          new_size *= 2;
+        data = (char*)realloc(data, new_size);
+        if (data == NULL)
+          REPORT_LEGION_ERROR(ERROR_INVALID_SPY_FILE,
+                              "Out of memory for Legion Spy logging")
+        size = new_size;
+      }
+
+      //------------------------------------------------------------------------
+      static BinaryBuffer* get_local_binary_buffer(void)
+      //------------------------------------------------------------------------
+      {
+        if (local_binary_buffer != NULL)
+          return local_binary_buffer;
+        BinaryBuffer *buffer = new BinaryBuffer();
+        buffer->data = NULL;
+        buffer->size = 0;
+        buffer->used = 0;
+        buffer->grow(0);
+        AutoLock b_lock(binary_lock);
+        buffer->next = binary_buffers;
+        binary_buffers = buffer;
+        local_binary_buffer = buffer;
+        return buffer;
+      }
+
+      //------------------------------------------------------------------------
+      BinaryRecord::BinaryRecord(unsigned kind)
+        : buffer(get_local_binary_buffer())
+      //------------------------------------------------------------------------
+      {
+        buffer->add_varint(kind);
+      }
+
+      //------------------------------------------------------------------------
+      BinaryRecord::~BinaryRecord(void)
+      //------------------------------------------------------------------------
+      {
+        // Records are never split across writes so only hand off the
+        // buffer once a record is complete
+        if (buffer->used >= BINARY_FLUSH_SIZE)
+        {
+          AutoLock b_lock(binary_lock);
+          write_binary_buffer(buffer);
+        }
+      }
+
+    }; // namespace LegionSpy
+
   }; // namespace Internal  
 }; // namespace Legion
 
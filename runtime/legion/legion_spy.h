@@ -35,85 +35,273 @@ namespace Legion {
 
       extern Realm::Logger log_spy;
 
+      // Binary logging: when -lg:spy_logfile is given, each record is
+      // written as its arguments in varint form to a per-node file instead
+      // of being formatted into text. A record kind is assigned to each
+      // distinct format string the first time it is used and its
+      // definition is written into the file ahead of any records of that
+      // kind, so the reader in tools/legion_spy.py can turn the records
+      // back into the same lines that the text logging would produce.
+      extern bool binary_logging;
+
+      void open_binary_log(const char *filename, AddressSpaceID space);
+      unsigned register_record_kind(const char *format);
+
+      struct BinaryBuffer {
+      public:
+        inline void ensure(size_t bytes)
+        {
+          if ((used + bytes) > size)
+            grow(bytes);
+        }
+        inline void add_varint(unsigned long long value)
+        {
+          ensure(10);
+          while (value >= 0x80)
+          {
+            data[used++] = (char)((value & 0x7F) | 0x80);
+            value >>= 7;
+          }
+          data[used++] = (char)value;
+        }
+        void grow(size_t bytes);
+      public:
+        char *data;
+        size_t size, used;
+        BinaryBuffer *next;
+      };
+
+      // Writes one record into the calling thread's buffer, which is
+      // handed to the file in large chunks
+      class BinaryRecord {
+      public:
+        explicit BinaryRecord(unsigned kind);
+        ~BinaryRecord(void);
+      public:
+        // integers are zig-zag encoded from their sign- or zero-extended
+        // 64-bit values so that the reader can reproduce printf's
+        // interpretation of them for whatever conversion the format uses
+        inline BinaryRecord& operator<<(long long value)
+        {
+          buffer->add_varint(((unsigned long long)value << 1) ^
+                             (unsigned long long)(value >> 63));
+          return *this;
+        }
+        inline BinaryRecord& operator<<(unsigned long long value)
+          { return (*this) << (long long)value; }
+        inline BinaryRecord& operator<<(int value)
+          { return (*this) << (long long)value; }
+        inline BinaryRecord& operator<<(unsigned value)
+          { return (*this) << (unsigned long long)value; }
+        inline BinaryRecord& operator<<(long value)
+          { return (*this) << (long long)value; }
+        inline BinaryRecord& operator<<(unsigned long value)
+          { return (*this) << (unsigned long long)value; }
+        inline BinaryRecord& operator<<(bool value)
+          { return (*this) << (long long)(value ? 1 : 0); }
+        inline BinaryRecord& operator<<(const char *value)
+        {
+          if (value == NULL)
+            value = "(null)";
+          const size_t length = strlen(value);
+          buffer->add_varint(length);
+          buffer->ensure(length);
+          memcpy(buffer->data + buffer->used, value, length);
+          buffer->used += length;
+          return *this;
+        }
+        inline BinaryRecord& operator<<(char *value)
+          { return (*this) << (const char*)value; }
+        // enums and any other integral types
+        template<typename T>
+        inline BinaryRecord& operator<<(T value)
+          { return (*this) << (long long)value; }
+      private:
+        BinaryBuffer *const buffer;
+      };
+
+      static inline void log_binary(unsigned kind)
+      {
+        BinaryRecord record(kind);
+      }
+
+      template<typename T1>
+      static inline void log_binary(unsigned kind, T1 a1)
+      {
+        BinaryRecord record(kind);
+        record << a1;
+      }
+
+      template<typename T1, typename T2>
+      static inline void log_binary(unsigned kind, T1 a1, T2 a2)
+      {
+        BinaryRecord record(kind);
+        record << a1 << a2;
+      }
+
+      template<typename T1, typename T2, typename T3>
+      static inline void log_binary(unsigned kind, T1 a1, T2 a2, T3 a3)
+      {
+        BinaryRecord record(kind);
+        record << a1 << a2 << a3;
+      }
+
+      template<typename T1, typename T2, typename T3, typename T4>
+      static inline void log_binary(unsigned kind, T1 a1, T2 a2, T3 a3, T4 a4)
+      {
+        BinaryRecord record(kind);
+        record << a1 << a2 << a3 << a4;
+      }
+
+      template<typename T1, typename T2, typename T3, typename T4,
+               typename T5>
+      static inline void log_binary(unsigned kind, T1 a1, T2 a2, T3 a3, T4 a4,
+                                    T5 a5)
+      {
+        BinaryRecord record(kind);
+        record << a1 << a2 << a3 << a4 << a5;
+      }
+
+      template<typename T1, typename T2, typename T3, typename T4,
+               typename T5, typename T6>
+      static inline void log_binary(unsigned kind, T1 a1, T2 a2, T3 a3, T4 a4,
+                                    T5 a5, T6 a6)
+      {
+        BinaryRecord record(kind);
+        record << a1 << a2 << a3 << a4 << a5 << a6;
+      }
+
+      template<typename T1, typename T2, typename T3, typename T4,
+               typename T5, typename T6, typename T7>
+      static inline void log_binary(unsigned kind, T1 a1, T2 a2, T3 a3, T4 a4,
+                                    T5 a5, T6 a6, T7 a7)
+      {
+        BinaryRecord record(kind);
+        record << a1 << a2 << a3 << a4 << a5 << a6 << a7;
+      }
+
+      template<typename T1, typename T2, typename T3, typename T4,
+               typename T5, typename T6, typename T7, typename T8>
+      static inline void log_binary(unsigned kind, T1 a1, T2 a2, T3 a3, T4 a4,
+                                    T5 a5, T6 a6, T7 a7, T8 a8)
+      {
+        BinaryRecord record(kind);
+        record << a1 << a2 << a3 << a4 << a5 << a6 << a7 << a8;
+      }
+
+      template<typename T1, typename T2, typename T3, typename T4,
+               typename T5, typename T6, typename T7, typename T8,
+               typename T9>
+      static inline void log_binary(unsigned kind, T1 a1, T2 a2, T3 a3, T4 a4,
+                                    T5 a5, T6 a6, T7 a7, T8 a8, T9 a9)
+      {
+        BinaryRecord record(kind);
+        record << a1 << a2 << a3 << a4 << a5 << a6 << a7 << a8 << a9;
+      }
+
+      template<typename T1, typename T2, typename T3, typename T4,
+               typename T5, typename T6, typename T7, typename T8,
+               typename T9, typename T10>
+      static inline void log_binary(unsigned kind, T1 a1, T2 a2, T3 a3, T4 a4,
+                                    T5 a5, T6 a6, T7 a7, T8 a8, T9 a9, T10 a10)
+      {
+        BinaryRecord record(kind);
+        record << a1 << a2 << a3 << a4 << a5 << a6 << a7 << a8 << a9 << a10;
+      }
+
+      // Every record goes through this macro so that the format string
+      // stays the single description of both the text and binary forms
+#define LEGION_SPY_LOG(fmt, ...)                                          \
+      do {                                                                \
+        if (LegionSpy::binary_logging)                                    \
+        {                                                                 \
+          static const unsigned __spy_kind =                              \
+            LegionSpy::register_record_kind(fmt);                         \
+          LegionSpy::log_binary(__spy_kind, ##__VA_ARGS__);               \
+        }                                                                 \
+        else                                                              \
+          log_spy.print(fmt, ##__VA_ARGS__);                              \
+      } while (0)
+
       // One time logger calls to record what gets logged
       static inline void log_legion_spy_config(void)
       {
 #ifdef LEGION_SPY
-        log_spy.print("Legion Spy Detailed Logging");
+        LEGION_SPY_LOG("Legion Spy Detailed Logging");
 #else
-        log_spy.print("Legion Spy Logging");
+        LEGION_SPY_LOG("Legion Spy Logging");
 #endif
       }
 
       // Logger calls for the machine architecture
       static inline void log_processor_kind(unsigned kind, const char *name)
       {
-        log_spy.print("Processor Kind %d %s", kind, name);
+        LEGION_SPY_LOG("Processor Kind %d %s", kind, name);
       }
 
       static inline void log_memory_kind(unsigned kind, const char *name)
       {
-        log_spy.print("Memory Kind %d %s", kind, name);
+        LEGION_SPY_LOG("Memory Kind %d %s", kind, name);
       }
 
       static inline void log_processor(IDType unique_id, unsigned kind)
       {
-        log_spy.print("Processor " IDFMT " %u", 
+        LEGION_SPY_LOG("Processor " IDFMT " %u", 
 		      unique_id, kind);
       }
 
       static inline void log_memory(IDType unique_id, size_t capacity,
           unsigned kind)
       {
-        log_spy.print("Memory " IDFMT " %zu %u", 
+        LEGION_SPY_LOG("Memory " IDFMT " %zu %u", 
 		      unique_id, capacity, kind);
       }
 
       static inline void log_proc_mem_affinity(IDType proc_id, 
             IDType mem_id, unsigned bandwidth, unsigned latency)
       {
-        log_spy.print("Processor Memory " IDFMT " " IDFMT " %u %u", 
+        LEGION_SPY_LOG("Processor Memory " IDFMT " " IDFMT " %u %u", 
 		      proc_id, mem_id, bandwidth, latency);
       }
 
       static inline void log_mem_mem_affinity(IDType mem1, 
           IDType mem2, unsigned bandwidth, unsigned latency)
       {
-        log_spy.print("Memory Memory " IDFMT " " IDFMT " %u %u", 
+        LEGION_SPY_LOG("Memory Memory " IDFMT " " IDFMT " %u %u", 
 		      mem1, mem2, bandwidth, latency);
       }
 
       // Logger calls for the shape of region trees
       static inline void log_top_index_space(IDType unique_id)
       {
-        log_spy.print("Index Space " IDFMT "", unique_id);
+        LEGION_SPY_LOG("Index Space " IDFMT "", unique_id);
       }
 
       static inline void log_index_space_name(IDType unique_id,
                                               const char* name)
       {
-        log_spy.print("Index Space Name " IDFMT " %s",
+        LEGION_SPY_LOG("Index Space Name " IDFMT " %s",
 		      unique_id, name);
       }
 
       static inline void log_index_partition(IDType parent_id, 
                 IDType unique_id, bool disjoint, LegionColor point)
       {
-        log_spy.print("Index Partition " IDFMT " " IDFMT " %u %lld",
+        LEGION_SPY_LOG("Index Partition " IDFMT " " IDFMT " %u %lld",
 		      parent_id, unique_id, disjoint, point); 
       }
 
       static inline void log_index_partition_name(IDType unique_id,
                                                   const char* name)
       {
-        log_spy.print("Index Partition Name " IDFMT " %s",
+        LEGION_SPY_LOG("Index Partition Name " IDFMT " %s",
 		      unique_id, name);
       }
 
       static inline void log_index_subspace(IDType parent_id, 
                               IDType unique_id, const DomainPoint &point)
       {
-        log_spy.print("Index Subspace " IDFMT " " IDFMT " %u %d %d %d",
+        LEGION_SPY_LOG("Index Subspace " IDFMT " " IDFMT " %u %d %d %d",
 		      parent_id, unique_id, point.dim,
                       (int)point.point_data[0],
                       (int)point.point_data[1],
@@ -122,20 +310,20 @@ namespace Legion {
 
       static inline void log_field_space(unsigned unique_id)
       {
-        log_spy.print("Field Space %u", unique_id);
+        LEGION_SPY_LOG("Field Space %u", unique_id);
       }
 
       static inline void log_field_space_name(unsigned unique_id,
                                               const char* name)
       {
-        log_spy.print("Field Space Name %u %s",
+        LEGION_SPY_LOG("Field Space Name %u %s",
 		      unique_id, name);
       }
 
       static inline void log_field_creation(unsigned unique_id, 
                                 unsigned field_id, size_t size)
       {
-        log_spy.print("Field Creation %u %u %ld", 
+        LEGION_SPY_LOG("Field Creation %u %u %ld", 
 		      unique_id, field_id, long(size));
       }
 
@@ -143,14 +331,14 @@ namespace Legion {
                                         unsigned field_id,
                                         const char* name)
       {
-        log_spy.print("Field Name %u %u %s",
+        LEGION_SPY_LOG("Field Name %u %u %s",
 		      unique_id, field_id, name);
       }
 
       static inline void log_top_region(IDType index_space, 
                       unsigned field_space, unsigned tree_id)
       {
-        log_spy.print("Region " IDFMT " %u %u", 
+        LEGION_SPY_LOG("Region " IDFMT " %u %u", 
 		      index_space, field_space, tree_id);
       }
 
@@ -158,7 +346,7 @@ namespace Legion {
                       unsigned field_space, unsigned tree_id,
                       const char* name)
       {
-        log_spy.print("Logical Region Name " IDFMT " %u %u %s", 
+        LEGION_SPY_LOG("Logical Region Name " IDFMT " %u %u %s", 
 		      index_space, field_space, tree_id, name);
       }
 
@@ -166,7 +354,7 @@ namespace Legion {
                       unsigned field_space, unsigned tree_id,
                       const char* name)
       {
-        log_spy.print("Logical Partition Name " IDFMT " %u %u %s", 
+        LEGION_SPY_LOG("Logical Partition Name " IDFMT " %u %u %s", 
 		      index_partition, field_space, tree_id, name);
       }
 
@@ -176,7 +364,7 @@ namespace Legion {
                                     const Point<DIM,T> &point)
       {
         LEGION_STATIC_ASSERT(DIM <= 3);
-        log_spy.print("Index Space Point " IDFMT " %d %lld %lld %lld", handle,
+        LEGION_SPY_LOG("Index Space Point " IDFMT " %d %lld %lld %lld", handle,
                       DIM, (long long)(point[0]), 
                       (long long)((DIM < 2) ? 0 : point[1]),
                       (long long)((DIM < 3) ? 0 : point[2]));
@@ -187,7 +375,7 @@ namespace Legion {
                                               const Rect<DIM,T> &rect)
       {
         LEGION_STATIC_ASSERT(DIM <= 3);
-        log_spy.print("Index Space Rect " IDFMT " %d "
+        LEGION_SPY_LOG("Index Space Rect " IDFMT " %d "
                       "%lld %lld %lld %lld %lld %lld", handle, DIM, 
                       (long long)(rect.lo[0]),
                       (long long)((DIM < 2) ? 0 : rect.lo[1]), 
@@ -199,20 +387,20 @@ namespace Legion {
 
       static inline void log_empty_index_space(IDType handle)
       {
-        log_spy.print("Empty Index Space " IDFMT "", handle);
+        LEGION_SPY_LOG("Empty Index Space " IDFMT "", handle);
       }
 
       // Logger calls for operations 
       static inline void log_task_name(TaskID task_id, const char *name)
       {
-        log_spy.print("Task ID Name %d %s", task_id, name);
+        LEGION_SPY_LOG("Task ID Name %d %s", task_id, name);
       }
 
       static inline void log_task_variant(TaskID task_id, unsigned variant_id,
                                           bool inner, bool leaf, 
                                           bool idempotent, const char *name)
       {
-        log_spy.print("Task Variant %d %d %d %d %d %s", task_id, variant_id,
+        LEGION_SPY_LOG("Task Variant %d %d %d %d %d %s", task_id, variant_id,
                                                inner, leaf, idempotent, name);
       }
 
@@ -220,7 +408,7 @@ namespace Legion {
                                             UniqueID unique_id,
                                             const char *name)
       {
-        log_spy.print("Top Task %u %llu %s", 
+        LEGION_SPY_LOG("Top Task %u %llu %s", 
 		      task_id, unique_id, name);
       }
 
@@ -229,7 +417,7 @@ namespace Legion {
                                              Processor::TaskFuncID task_id,
                                              const char *name)
       {
-        log_spy.print("Individual Task %llu %u %llu %s", 
+        LEGION_SPY_LOG("Individual Task %llu %u %llu %s", 
 		      context, task_id, unique_id, name);
       }
 
@@ -238,20 +426,20 @@ namespace Legion {
                                         Processor::TaskFuncID task_id,
                                         const char *name)
       {
-        log_spy.print("Index Task %llu %u %llu %s",
+        LEGION_SPY_LOG("Index Task %llu %u %llu %s",
 		      context, task_id, unique_id, name);
       }
 
       static inline void log_mapping_operation(UniqueID context,
                                                UniqueID unique_id)
       {
-        log_spy.print("Mapping Operation %llu %llu", context, unique_id);
+        LEGION_SPY_LOG("Mapping Operation %llu %llu", context, unique_id);
       }
 
       static inline void log_fill_operation(UniqueID context,
                                             UniqueID unique_id)
       {
-        log_spy.print("Fill Operation %llu %llu", context, unique_id);
+        LEGION_SPY_LOG("Fill Operation %llu %llu", context, unique_id);
       }
 
       static inline void log_close_operation(UniqueID context,
@@ -259,7 +447,7 @@ namespace Legion {
                                              bool is_intermediate_close_op,
                                              bool read_only_close_op)
       {
-        log_spy.print("Close Operation %llu %llu %u %u",
+        LEGION_SPY_LOG("Close Operation %llu %llu %u %u",
 		      context, unique_id, is_intermediate_close_op ? 1 : 0,
 		      read_only_close_op ? 1 : 0);
       }
@@ -267,100 +455,100 @@ namespace Legion {
       static inline void log_open_operation(UniqueID context,
                                             UniqueID unique_id)
       {
-        log_spy.print("Open Operation %llu %llu", context, unique_id);
+        LEGION_SPY_LOG("Open Operation %llu %llu", context, unique_id);
       }
 
       static inline void log_advance_operation(UniqueID context,
                                                UniqueID unique_id)
       {
-        log_spy.print("Advance Operation %llu %llu", context, unique_id);
+        LEGION_SPY_LOG("Advance Operation %llu %llu", context, unique_id);
       }
 
       static inline void log_internal_op_creator(UniqueID internal_op_id,
                                                  UniqueID creator_op_id,
                                                  int idx)
       {
-        log_spy.print("Internal Operation Creator %llu %llu %d",
+        LEGION_SPY_LOG("Internal Operation Creator %llu %llu %d",
 		      internal_op_id, creator_op_id, idx);
       }
 
       static inline void log_fence_operation(UniqueID context,
                                              UniqueID unique_id)
       {
-        log_spy.print("Fence Operation %llu %llu",
+        LEGION_SPY_LOG("Fence Operation %llu %llu",
 		      context, unique_id);
       }
 
       static inline void log_trace_operation(UniqueID context,
                                              UniqueID unique_id)
       {
-        log_spy.print("Trace Operation %llu %llu",
+        LEGION_SPY_LOG("Trace Operation %llu %llu",
                       context, unique_id);
       }
 
       static inline void log_copy_operation(UniqueID context,
                                             UniqueID unique_id)
       {
-        log_spy.print("Copy Operation %llu %llu",
+        LEGION_SPY_LOG("Copy Operation %llu %llu",
 		      context, unique_id);
       }
 
       static inline void log_acquire_operation(UniqueID context,
                                                UniqueID unique_id)
       {
-        log_spy.print("Acquire Operation %llu %llu",
+        LEGION_SPY_LOG("Acquire Operation %llu %llu",
 		      context, unique_id);
       }
 
       static inline void log_release_operation(UniqueID context,
                                                UniqueID unique_id)
       {
-        log_spy.print("Release Operation %llu %llu",
+        LEGION_SPY_LOG("Release Operation %llu %llu",
 		      context, unique_id);
       }
 
       static inline void log_deletion_operation(UniqueID context,
                                                 UniqueID deletion)
       {
-        log_spy.print("Deletion Operation %llu %llu",
+        LEGION_SPY_LOG("Deletion Operation %llu %llu",
 		      context, deletion);
       }
 
       static inline void log_attach_operation(UniqueID context,
                                               UniqueID attach)
       {
-        log_spy.print("Attach Operation %llu %llu", 
+        LEGION_SPY_LOG("Attach Operation %llu %llu", 
                       context, attach);
       }
 
       static inline void log_detach_operation(UniqueID context,
                                               UniqueID detach)
       {
-        log_spy.print("Detach Operation %llu %llu",
+        LEGION_SPY_LOG("Detach Operation %llu %llu",
                       context, detach);
       }
 
       static inline void log_dynamic_collective(UniqueID context, 
                                                 UniqueID collective)
       {
-        log_spy.print("Dynamic Collective %llu %llu", context, collective);
+        LEGION_SPY_LOG("Dynamic Collective %llu %llu", context, collective);
       }
 
       static inline void log_timing_operation(UniqueID context, UniqueID timing)
       {
-        log_spy.print("Timing Operation %llu %llu", context, timing);
+        LEGION_SPY_LOG("Timing Operation %llu %llu", context, timing);
       }
 
       static inline void log_predicate_operation(UniqueID context, 
                                                  UniqueID pred_op)
       {
-        log_spy.print("Predicate Operation %llu %llu", context, pred_op);
+        LEGION_SPY_LOG("Predicate Operation %llu %llu", context, pred_op);
       }
 
       static inline void log_must_epoch_operation(UniqueID context,
                                                   UniqueID must_op)
       {
-        log_spy.print("Must Epoch Operation %llu %llu", context, must_op);
+        LEGION_SPY_LOG("Must Epoch Operation %llu %llu", context, must_op);
       }
 
       static inline void log_dependent_partition_operation(UniqueID context,
@@ -368,14 +556,14 @@ namespace Legion {
                                                            IDType pid,
                                                            int kind)
       {
-        log_spy.print("Dependent Partition Operation %llu %llu " IDFMT " %d",
+        LEGION_SPY_LOG("Dependent Partition Operation %llu %llu " IDFMT " %d",
 		      context, unique_id, pid, kind);
       }
 
       static inline void log_pending_partition_operation(UniqueID context,
                                                          UniqueID unique_id)
       {
-        log_spy.print("Pending Partition Operation %llu %llu",
+        LEGION_SPY_LOG("Pending Partition Operation %llu %llu",
 		      context, unique_id);
       }
 
@@ -383,24 +571,24 @@ namespace Legion {
                                                       IDType pid,
                                                       int kind)
       {
-        log_spy.print("Pending Partition Target %llu " IDFMT " %d", unique_id,
+        LEGION_SPY_LOG("Pending Partition Target %llu " IDFMT " %d", unique_id,
 		      pid, kind);
       }
 
       static inline void log_index_slice(UniqueID index_id, UniqueID slice_id)
       {
-        log_spy.print("Index Slice %llu %llu", index_id, slice_id);
+        LEGION_SPY_LOG("Index Slice %llu %llu", index_id, slice_id);
       }
 
       static inline void log_slice_slice(UniqueID slice_one, UniqueID slice_two)
       {
-        log_spy.print("Slice Slice %llu %llu", slice_one, slice_two);
+        LEGION_SPY_LOG("Slice Slice %llu %llu", slice_one, slice_two);
       }
 
       static inline void log_slice_point(UniqueID slice_id, UniqueID point_id,
                                          const DomainPoint &point)
       {
-        log_spy.print("Slice Point %llu %llu %u %d %d %d", 
+        LEGION_SPY_LOG("Slice Point %llu %llu %u %d %d %d", 
 		      slice_id, point_id,
 		      point.dim, (int)point.point_data[0],
 		      (int)point.point_data[1], (int)point.point_data[2]);
@@ -408,13 +596,13 @@ namespace Legion {
 
       static inline void log_point_point(UniqueID p1, UniqueID p2)
       {
-        log_spy.print("Point Point %llu %llu", p1, p2);
+        LEGION_SPY_LOG("Point Point %llu %llu", p1, p2);
       }
 
       static inline void log_index_point(UniqueID index_id, UniqueID point_id,
                                          const DomainPoint &point)
       {
-        log_spy.print("Index Point %llu %llu %u %d %d %d", index_id, point_id,
+        LEGION_SPY_LOG("Index Point %llu %llu %u %d %d %d", index_id, point_id,
                       point.dim, (int)point.point_data[0],
                       (int)point.point_data[1], (int)point.point_data[2]);
       }
@@ -422,18 +610,18 @@ namespace Legion {
       static inline void log_child_operation_index(UniqueID parent_id, 
                                        unsigned index, UniqueID child_id)
       {
-        log_spy.print("Operation Index %llu %d %llu", parent_id,index,child_id);
+        LEGION_SPY_LOG("Operation Index %llu %d %llu", parent_id,index,child_id);
       }
 
       static inline void log_close_operation_index(UniqueID parent_id,
                                         unsigned index, UniqueID child_id)
       {
-        log_spy.print("Close Index %llu %d %llu", parent_id, index, child_id);
+        LEGION_SPY_LOG("Close Index %llu %d %llu", parent_id, index, child_id);
       }
 
       static inline void log_predicated_false_op(UniqueID unique_id)
       {
-        log_spy.print("Predicate False %lld", unique_id);
+        LEGION_SPY_LOG("Predicate False %lld", unique_id);
       }
 
       // Logger calls for mapping dependence analysis 
@@ -442,7 +630,7 @@ namespace Legion {
           unsigned field_component, unsigned tree_id, unsigned privilege, 
           unsigned coherence, unsigned redop, IDType parent_index)
       {
-        log_spy.print("Logical Requirement %llu %u %u " IDFMT " %u %u "
+        LEGION_SPY_LOG("Logical Requirement %llu %u %u " IDFMT " %u %u "
 		      "%u %u %u " IDFMT, unique_id, index, region, 
                       index_component, field_component, tree_id,
 		      privilege, coherence, redop, parent_index);
@@ -454,7 +642,7 @@ namespace Legion {
         for (std::set<unsigned>::const_iterator it = logical_fields.begin();
               it != logical_fields.end(); it++)
         {
-          log_spy.print("Logical Requirement Field %llu %u %u", 
+          LEGION_SPY_LOG("Logical Requirement Field %llu %u %u", 
 			unique_id, index, *it);
         }
       }
@@ -465,7 +653,7 @@ namespace Legion {
         for (std::vector<FieldID>::const_iterator it = logical_fields.begin();
               it != logical_fields.end(); it++)
         {
-          log_spy.print("Logical Requirement Field %llu %u %u", 
+          LEGION_SPY_LOG("Logical Requirement Field %llu %u %u", 
 			unique_id, index, *it);
         }
       }
@@ -473,13 +661,13 @@ namespace Legion {
       static inline void log_projection_function(ProjectionID pid,
                                                  int depth)
       {
-        log_spy.print("Projection Function %u %d", pid, depth);
+        LEGION_SPY_LOG("Projection Function %u %d", pid, depth);
       }
 
       static inline void log_requirement_projection(UniqueID unique_id,
                                       unsigned index, ProjectionID pid)
       {
-        log_spy.print("Logical Requirement Projection %llu %u %u", 
+        LEGION_SPY_LOG("Logical Requirement Projection %llu %u %u", 
                       unique_id, index, pid);
       }
 
@@ -488,13 +676,14 @@ namespace Legion {
                                                      const Rect<DIM,T> &rect)
       {
         LEGION_STATIC_ASSERT(DIM <= 3);
-        log_spy.print() << "Index Launch Rect " << unique_id << " "
-                        << DIM << " " << rect.lo[0]
-                        << " " << ((DIM < 2) ? 0 : rect.lo[1])
-                        << " " << ((DIM < 3) ? 0 : rect.lo[2])
-                        << " " << rect.hi[0]
-                        << " " << ((DIM < 2) ? 0 : rect.hi[1])
-                        << " " << ((DIM < 3) ? 0 : rect.hi[2]);
+        LEGION_SPY_LOG("Index Launch Rect %llu %d "
+                       "%lld %lld %lld %lld %lld %lld", unique_id, DIM,
+                       (long long)(rect.lo[0]),
+                       (long long)((DIM < 2) ? 0 : rect.lo[1]),
+                       (long long)((DIM < 3) ? 0 : rect.lo[2]),
+                       (long long)(rect.hi[0]),
+                       (long long)((DIM < 2) ? 0 : rect.hi[1]),
+                       (long long)((DIM < 3) ? 0 : rect.hi[2]));
       }
 
       // Logger calls for futures
@@ -502,7 +691,7 @@ namespace Legion {
                                              ApEvent future_event, 
                                              const DomainPoint &point)
       {
-        log_spy.print("Future Creation %llu " IDFMT " %u %d %d %d",
+        LEGION_SPY_LOG("Future Creation %llu " IDFMT " %u %d %d %d",
                       creator_id, future_event.id, point.dim,
                       (int)point.point_data[0], 
                       (point.dim > 1) ? (int)point.point_data[1] : 0,
@@ -512,13 +701,13 @@ namespace Legion {
       static inline void log_future_use(UniqueID user_id, 
                                         ApEvent future_event)
       {
-        log_spy.print("Future Usage %llu " IDFMT "", user_id, future_event.id);
+        LEGION_SPY_LOG("Future Usage %llu " IDFMT "", user_id, future_event.id);
       }
 
       static inline void log_predicate_use(UniqueID pred_id,
                                            UniqueID previous_predicate)
       {
-        log_spy.print("Predicate Use %llu %llu", pred_id, previous_predicate);
+        LEGION_SPY_LOG("Predicate Use %llu %llu", pred_id, previous_predicate);
       }
 
       // Logger call for physical instances
@@ -526,14 +715,14 @@ namespace Legion {
                                                IDType inst_id, IDType mem_id,
                                                ReductionOpID redop)
       {
-        log_spy.print("Physical Instance " IDFMT " " IDFMT " " IDFMT " %d", 
+        LEGION_SPY_LOG("Physical Instance " IDFMT " " IDFMT " " IDFMT " %d", 
 		      inst_event.id, inst_id, mem_id, redop);
       }
 
       static inline void log_physical_instance_region(ApEvent inst_event, 
                                                       LogicalRegion handle)
       {
-        log_spy.print("Physical Instance Region " IDFMT " %d %d %d",
+        LEGION_SPY_LOG("Physical Instance Region " IDFMT " %d %d %d",
                       inst_event.id, handle.get_index_space().get_id(), 
                       handle.get_field_space().get_id(), handle.get_tree_id());
       }
@@ -541,21 +730,21 @@ namespace Legion {
       static inline void log_physical_instance_field(ApEvent inst_event,
                                                      FieldID field_id)
       {
-        log_spy.print("Physical Instance Field " IDFMT " %d", 
+        LEGION_SPY_LOG("Physical Instance Field " IDFMT " %d", 
                       inst_event.id, field_id);
       }
 
       static inline void log_physical_instance_creator(ApEvent inst_event, 
                                            UniqueID creator_id, IDType proc_id)
       {
-        log_spy.print("Physical Instance Creator " IDFMT " %lld " IDFMT "",
+        LEGION_SPY_LOG("Physical Instance Creator " IDFMT " %lld " IDFMT "",
                       inst_event.id, creator_id, proc_id);
       }
 
       static inline void log_physical_instance_creation_region(
                                       ApEvent inst_event, LogicalRegion handle)
       {
-        log_spy.print("Physical Instance Creation Region " IDFMT " %d %d %d",
+        LEGION_SPY_LOG("Physical Instance Creation Region " IDFMT " %d %d %d",
                       inst_event.id, handle.get_index_space().get_id(), 
                       handle.get_field_space().get_id(), handle.get_tree_id());
       }
@@ -563,114 +752,114 @@ namespace Legion {
       static inline void log_instance_specialized_constraint(ApEvent inst_event,
                                   SpecializedKind kind, ReductionOpID redop)
       {
-        log_spy.print("Instance Specialized Constraint " IDFMT " %d %d",
+        LEGION_SPY_LOG("Instance Specialized Constraint " IDFMT " %d %d",
                       inst_event.id, kind, redop);
       }
 
       static inline void log_instance_memory_constraint(ApEvent inst_event,
                                                      Memory::Kind kind)
       {
-        log_spy.print("Instance Memory Constraint " IDFMT " %d", 
+        LEGION_SPY_LOG("Instance Memory Constraint " IDFMT " %d", 
                       inst_event.id, kind);
       }
 
       static inline void log_instance_field_constraint(ApEvent inst_event,
                       bool contiguous, bool inorder, size_t num_fields)
       {
-        log_spy.print("Instance Field Constraint " IDFMT " %d %d %zd",
+        LEGION_SPY_LOG("Instance Field Constraint " IDFMT " %d %d %zd",
             inst_event.id, (contiguous ? 1 : 0), (inorder ? 1 : 0), num_fields);
       }
 
       static inline void log_instance_field_constraint_field(ApEvent inst_event,
                                                              FieldID fid)
       {
-        log_spy.print("Instance Field Constraint Field " IDFMT " %d",
+        LEGION_SPY_LOG("Instance Field Constraint Field " IDFMT " %d",
                       inst_event.id, fid);
       }
 
       static inline void log_instance_ordering_constraint(ApEvent inst_event,
                                   bool contiguous, size_t num_dimensions)
       {
-        log_spy.print("Instance Ordering Constraint " IDFMT " %d %zd",
+        LEGION_SPY_LOG("Instance Ordering Constraint " IDFMT " %d %zd",
                       inst_event.id, (contiguous ? 1 : 0), num_dimensions);
       }
 
       static inline void log_instance_ordering_constraint_dimension(
                                     ApEvent inst_event, DimensionKind dim)
       {
-        log_spy.print("Instance Ordering Constraint Dimension " IDFMT " %d",
+        LEGION_SPY_LOG("Instance Ordering Constraint Dimension " IDFMT " %d",
                       inst_event.id, dim);
       }
 
       static inline void log_instance_splitting_constraint(ApEvent inst_event,
                               DimensionKind dim, size_t value, bool chunks)
       {
-        log_spy.print("Instance Splitting Constraint " IDFMT " %d %zd %d",
+        LEGION_SPY_LOG("Instance Splitting Constraint " IDFMT " %d %zd %d",
                       inst_event.id, dim, value, (chunks ? 1 : 0));
       }
 
       static inline void log_instance_dimension_constraint(ApEvent inst_event,
                         DimensionKind dim, EqualityKind eqk, size_t value)
       {
-        log_spy.print("Instance Dimension Constraint " IDFMT " %d %d %zd",
+        LEGION_SPY_LOG("Instance Dimension Constraint " IDFMT " %d %d %zd",
                       inst_event.id, dim, eqk, value);
       }
 
       static inline void log_instance_alignment_constraint(ApEvent inst_event,
                           FieldID fid, EqualityKind eqk, size_t alignment)
       {
-        log_spy.print("Instance Alignment Constraint " IDFMT " %d %d %zd",
+        LEGION_SPY_LOG("Instance Alignment Constraint " IDFMT " %d %d %zd",
                       inst_event.id, fid, eqk, alignment);
       }
 
       static inline void log_instance_offset_constraint(ApEvent inst_event,
                                       FieldID fid, long offset)
       {
-        log_spy.print("Instance Offset Constraint " IDFMT " %d %ld",
+        LEGION_SPY_LOG("Instance Offset Constraint " IDFMT " %d %ld",
                       inst_event.id, fid, offset);
       }
 
       // Logger calls for mapping decisions
       static inline void log_variant_decision(UniqueID unique_id, unsigned vid)
       {
-        log_spy.print("Variant Decision %llu %u", unique_id, vid);
+        LEGION_SPY_LOG("Variant Decision %llu %u", unique_id, vid);
       }
 
       static inline void log_mapping_decision(UniqueID unique_id, 
                                 unsigned index, FieldID fid, ApEvent inst_event)
       {
-        log_spy.print("Mapping Decision %llu %d %d " IDFMT "", unique_id,
+        LEGION_SPY_LOG("Mapping Decision %llu %d %d " IDFMT "", unique_id,
 		      index, fid, inst_event.id);
       }
 
       static inline void log_post_mapping_decision(UniqueID unique_id, 
                                 unsigned index, FieldID fid, ApEvent inst_event)
       {
-        log_spy.print("Post Mapping Decision %llu %d %d " IDFMT "", unique_id,
+        LEGION_SPY_LOG("Post Mapping Decision %llu %d %d " IDFMT "", unique_id,
 		      index, fid, inst_event.id);
       }
 
       static inline void log_temporary_instance(UniqueID unique_id,
                                 unsigned index, FieldID fid, ApEvent inst_event)
       {
-        log_spy.print("Temporary Instance %llu %d %d " IDFMT "", unique_id,
+        LEGION_SPY_LOG("Temporary Instance %llu %d %d " IDFMT "", unique_id,
                       index, fid, inst_event.id);
       }
 
       static inline void log_task_priority(UniqueID unique_id, 
                                            TaskPriority priority)
       {
-        log_spy.print("Task Priority %llu %d", unique_id, priority);
+        LEGION_SPY_LOG("Task Priority %llu %d", unique_id, priority);
       }
 
       static inline void log_task_processor(UniqueID unique_id, IDType proc_id)
       {
-        log_spy.print("Task Processor %llu " IDFMT "", unique_id, proc_id);
+        LEGION_SPY_LOG("Task Processor %llu " IDFMT "", unique_id, proc_id);
       }
 
       static inline void log_task_premapping(UniqueID unique_id, unsigned index)
       {
-        log_spy.print("Task Premapping %llu %d", unique_id, index);
+        LEGION_SPY_LOG("Task Premapping %llu %d", unique_id, index);
       }
 
       static inline void log_tunable_value(UniqueID unique_id, unsigned index,
@@ -698,7 +887,7 @@ namespace Legion {
           }
         }
         buffer[byte_index] = '\0';
-        log_spy.print("Task Tunable %llu %d %zd %s\n", 
+        LEGION_SPY_LOG("Task Tunable %llu %d %zd %s\n", 
                       unique_id, index, num_bytes, buffer);
         free(buffer);
       }
@@ -706,14 +895,14 @@ namespace Legion {
       static inline void log_phase_barrier_arrival(UniqueID unique_id,
                                                    ApBarrier barrier)
       {
-        log_spy.print("Phase Barrier Arrive %llu " IDFMT "",
+        LEGION_SPY_LOG("Phase Barrier Arrive %llu " IDFMT "",
                       unique_id, barrier.id);
       }
 
       static inline void log_phase_barrier_wait(UniqueID unique_id,
                                                 ApEvent previous)
       {
-        log_spy.print("Phase Barrier Wait %llu " IDFMT "",
+        LEGION_SPY_LOG("Phase Barrier Wait %llu " IDFMT "",
                       unique_id, previous.id);
       }
 
@@ -729,7 +918,7 @@ namespace Legion {
                 UniqueID prev_id, unsigned prev_idx, UniqueID next_id, 
                 unsigned next_idx, unsigned dep_type)
       {
-        log_spy.print("Mapping Dependence %llu %llu %u %llu %u %d", 
+        LEGION_SPY_LOG("Mapping Dependence %llu %llu %u %llu %u %d", 
 		      context, prev_id, prev_idx,
 		      next_id, next_idx, dep_type);
       }
@@ -738,51 +927,51 @@ namespace Legion {
       static inline void log_disjoint_close_field(UniqueID close_id,
                                                   FieldID fid)
       {
-        log_spy.print("Disjoint Close Field %llu %d", close_id, fid);
+        LEGION_SPY_LOG("Disjoint Close Field %llu %d", close_id, fid);
       }
 
       // Logger calls for realm events
       static inline void log_event_dependence(LgEvent one, LgEvent two)
       {
         if (one != two)
-          log_spy.print("Event Event " IDFMT " " IDFMT, 
+          LEGION_SPY_LOG("Event Event " IDFMT " " IDFMT, 
 			one.id, two.id);
       }
 
       static inline void log_ap_user_event(ApUserEvent event)
       {
-        log_spy.print("Ap User Event " IDFMT, event.id);
+        LEGION_SPY_LOG("Ap User Event " IDFMT, event.id);
       }
 
       static inline void log_rt_user_event(RtUserEvent event)
       {
-        log_spy.print("Rt User Event " IDFMT, event.id);
+        LEGION_SPY_LOG("Rt User Event " IDFMT, event.id);
       }
 
       static inline void log_pred_event(PredEvent event)
       {
-        log_spy.print("Pred Event " IDFMT, event.id);
+        LEGION_SPY_LOG("Pred Event " IDFMT, event.id);
       }
 
       static inline void log_ap_user_event_trigger(ApUserEvent event)
       {
-        log_spy.print("Ap User Event Trigger " IDFMT, event.id);
+        LEGION_SPY_LOG("Ap User Event Trigger " IDFMT, event.id);
       }
 
       static inline void log_rt_user_event_trigger(RtUserEvent event)
       {
-        log_spy.print("Rt User Event Trigger " IDFMT, event.id);
+        LEGION_SPY_LOG("Rt User Event Trigger " IDFMT, event.id);
       }
 
       static inline void log_pred_event_trigger(PredEvent event)
       {
-        log_spy.print("Pred Event Trigger " IDFMT, event.id);
+        LEGION_SPY_LOG("Pred Event Trigger " IDFMT, event.id);
       }
 
       static inline void log_operation_events(UniqueID uid,
                                               LgEvent pre, LgEvent post)
       {
-        log_spy.print("Operation Events %llu " IDFMT " " IDFMT,
+        LEGION_SPY_LOG("Operation Events %llu " IDFMT " " IDFMT,
 		      uid, pre.id, post.id);
       }
 
@@ -790,7 +979,7 @@ namespace Legion {
                                          LogicalRegion handle,
                                          LgEvent pre, LgEvent post)
       {
-        log_spy.print("Copy Events %llu %d %d %d " IDFMT " " IDFMT,
+        LEGION_SPY_LOG("Copy Events %llu %d %d %d " IDFMT " " IDFMT,
                       op_unique_id,
                       handle.get_index_space().get_id(),
                       handle.get_field_space().get_id(), handle.get_tree_id(), 
@@ -801,7 +990,7 @@ namespace Legion {
                                         ApEvent src_event, FieldID dst_fid,
                                         ApEvent dst_event, ReductionOpID redop)
       {
-        log_spy.print("Copy Field " IDFMT " %d " IDFMT " %d " IDFMT " %d",
+        LEGION_SPY_LOG("Copy Field " IDFMT " %d " IDFMT " %d " IDFMT " %d",
                   post.id, src_fid, src_event.id, dst_fid, dst_event.id, redop);
       }
 
@@ -809,7 +998,7 @@ namespace Legion {
                                             IDType index, unsigned field,
                                             unsigned tree_id)
       {
-        log_spy.print("Copy Intersect " IDFMT " %d " IDFMT " %d %d",
+        LEGION_SPY_LOG("Copy Intersect " IDFMT " %d " IDFMT " %d %d",
                       post.id, is_region, index, field, tree_id);
       }
 
@@ -818,7 +1007,7 @@ namespace Legion {
                                          LgEvent pre, LgEvent post,
                                          UniqueID fill_unique_id)
       {
-        log_spy.print("Fill Events %llu %d %d %d " IDFMT " " IDFMT " %llu",
+        LEGION_SPY_LOG("Fill Events %llu %d %d %d " IDFMT " " IDFMT " %llu",
 		      op_unique_id, handle.get_index_space().get_id(),
 		      handle.get_field_space().get_id(), handle.get_tree_id(),
 		      pre.id, post.id, fill_unique_id);
@@ -827,7 +1016,7 @@ namespace Legion {
       static inline void log_fill_field(LgEvent post, 
                                         FieldID fid, ApEvent dst_event)
       {
-        log_spy.print("Fill Field " IDFMT " %d " IDFMT, 
+        LEGION_SPY_LOG("Fill Field " IDFMT " %d " IDFMT, 
                       post.id, fid, dst_event.id);
       }
 
@@ -835,7 +1024,7 @@ namespace Legion {
                                             IDType index, unsigned field,
                                             unsigned tree_id)
       {
-        log_spy.print("Fill Intersect " IDFMT " %d " IDFMT " %d %d",
+        LEGION_SPY_LOG("Fill Intersect " IDFMT " %d " IDFMT " %d %d",
 		      post.id, is_region, index, field, tree_id);
       } 
 
@@ -848,7 +1037,7 @@ namespace Legion {
         // which of course breaks Legion Spy's way of logging deppart
         // operations uniquely as their completion event
         assert(pre != post);
-        log_spy.print("Deppart Events %llu %d " IDFMT " " IDFMT,
+        LEGION_SPY_LOG("Deppart Events %llu %d " IDFMT " " IDFMT,
                       op_unique_id, handle.get_id(), pre.id, post.id);
       }
 #endif
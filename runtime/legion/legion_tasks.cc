@@ -3367,6 +3367,60 @@ namespace Legion {
       }
     }
 
+    //--------------------------------------------------------------------------
+    DynamicTrace* SingleTask::find_memoizing_trace(unsigned &trace_local_id)
+    //--------------------------------------------------------------------------
+    {
+      if (!runtime->memoize_traced_mappings || (trace == NULL))
+        return NULL;
+      trace_local_id = get_trace_local_id();
+      return trace->as_dynamic_trace();
+    }
+
+    //--------------------------------------------------------------------------
+    bool SingleTask::replay_memoized_mapping(DynamicTrace *memo_trace,
+                                             unsigned trace_local_id,
+                                             Mapper::MapTaskOutput &output)
+    //--------------------------------------------------------------------------
+    {
+      Mapper::MapTaskOutput memoized;
+      if (!memo_trace->find_memoized_mapping(trace_local_id, index_point,
+                                             current_proc, memoized))
+        return false;
+      if (memoized.chosen_instances.size() != regions.size())
+        return false;
+      // The memoized instances have to be acquired just as if the 
+      // mapper had picked them, if any were collected since the last
+      // replay then we fall back to asking the mapper again
+      std::map<PhysicalManager*,std::pair<unsigned,bool> > &acquired = 
+        *get_acquired_instances_ref();
+      std::vector<PhysicalManager*> unacquired;
+      for (unsigned idx = 0; idx < memoized.chosen_instances.size(); idx++)
+      {
+        const std::vector<MappingInstance> &chosen = 
+          memoized.chosen_instances[idx];
+        for (std::vector<MappingInstance>::const_iterator it = 
+              chosen.begin(); it != chosen.end(); it++)
+        {
+          PhysicalManager *manager = it->impl;
+          if ((manager == NULL) || manager->is_virtual_manager())
+            continue;
+          if (acquired.find(manager) == acquired.end())
+            unacquired.push_back(manager);
+        }
+      }
+      if (!unacquired.empty())
+      {
+        runtime->forest->perform_missing_acquires(this, acquired, unacquired);
+        for (std::vector<PhysicalManager*>::const_iterator it = 
+              unacquired.begin(); it != unacquired.end(); it++)
+          if (acquired.find(*it) == acquired.end())
+            return false;
+      }
+      output = memoized;
+      return true;
+    }
+
     //--------------------------------------------------------------------------
     void SingleTask::invoke_mapper(MustEpochOp *must_epoch_owner)
     //--------------------------------------------------------------------------
@@ -3382,7 +3436,20 @@ namespace Legion {
       // Now we can invoke the mapper to do the mapping
       if (mapper == NULL)
         mapper = runtime->find_mapper(current_proc, map_id);
-      mapper->invoke_map_task(this, &input, &output);
+      // If we are being replayed as part of a memoizing trace then see
+      // if we can reuse the mapping decisions from a previous replay
+      unsigned trace_local_id = 0;
+      DynamicTrace *memo_trace = ((must_epoch_owner == NULL) && 
+          early_mapped_regions.empty()) ? 
+        find_memoizing_trace(trace_local_id) : NULL;
+      if ((memo_trace == NULL) || 
+          !replay_memoized_mapping(memo_trace, trace_local_id, output))
+      {
+        mapper->invoke_map_task(this, &input, &output);
+        if (memo_trace != NULL)
+          memo_trace->memoize_mapping(trace_local_id, index_point,
+                                      current_proc, output);
+      }
       // Sort out any profiling requests that we need to perform
       if (!output.task_prof_requests.empty())
       {
@@ -6446,6 +6513,21 @@ namespace Legion {
       point_termination = Runtime::create_ap_user_event();
     }
 
+    //--------------------------------------------------------------------------
+    DynamicTrace* PointTask::find_memoizing_trace(unsigned &trace_local_id)
+    //--------------------------------------------------------------------------
+    {
+      // Point tasks are never traced themselves, but they can use the
+      // trace of the index task that they came from if it is local
+      if (!runtime->memoize_traced_mappings || slice_owner->is_remote())
+        return NULL;
+      LegionTrace *owner_trace = slice_owner->index_owner->get_trace();
+      if (owner_trace == NULL)
+        return NULL;
+      trace_local_id = slice_owner->index_owner->get_trace_local_id();
+      return owner_trace->as_dynamic_trace();
+    }
+
     //--------------------------------------------------------------------------
     void PointTask::send_back_created_state(AddressSpaceID target)
     //--------------------------------------------------------------------------
@@ -8375,7 +8457,8 @@ namespace Legion {
         {
           ProjectionFunction *function = 
             runtime->find_projection_function(regions[idx].projection);
-          function->project_points(regions[idx], idx, runtime, points);
+          function->project_points(this, idx, runtime, 
+                                   internal_domain, points);
         }
       }
       // Update the no access regions
@@ -482,6 +482,10 @@ namespace Legion {
                     VariantImpl *impl, const char *call_name) const;
     protected:
       void invoke_mapper(MustEpochOp *must_epoch_owner);
+      virtual DynamicTrace* find_memoizing_trace(unsigned &trace_local_id);
+      bool replay_memoized_mapping(DynamicTrace *memo_trace, 
+                                   unsigned trace_local_id,
+                                   Mapper::MapTaskOutput &output);
       void map_all_regions(ApEvent user_event,
                            MustEpochOp *must_epoch_owner = NULL); 
       void perform_post_mapping(void);
@@ -849,6 +853,8 @@ namespace Legion {
       void initialize_point(SliceTask *owner, const DomainPoint &point,
                             const FutureMap &point_arguments);
       void send_back_created_state(AddressSpaceID target);
+    protected:
+      virtual DynamicTrace* find_memoizing_trace(unsigned &trace_local_id);
     public:
       virtual void record_reference_mutation_effect(RtEvent event);
     protected:
@@ -418,6 +418,38 @@ namespace Legion {
 #endif
     } 
 
+    //--------------------------------------------------------------------------
+    bool DynamicTrace::find_memoized_mapping(unsigned trace_local_id,
+                                       const DomainPoint &point, Processor proc,
+                                       Mapper::MapTaskOutput &output) const
+    //--------------------------------------------------------------------------
+    {
+      AutoLock m_lock(memo_lock,1,false/*exclusive*/);
+      std::map<std::pair<unsigned,DomainPoint>,MemoizedMapping>::const_iterator
+        finder = memoized_mappings.find(
+            std::pair<unsigned,DomainPoint>(trace_local_id, point));
+      if (finder == memoized_mappings.end())
+        return false;
+      // Only valid if we are mapping on the same processor as last time
+      if (finder->second.mapped_proc != proc)
+        return false;
+      output = finder->second.output;
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    void DynamicTrace::memoize_mapping(unsigned trace_local_id,
+                                       const DomainPoint &point, Processor proc,
+                                       const Mapper::MapTaskOutput &output)
+    //--------------------------------------------------------------------------
+    {
+      AutoLock m_lock(memo_lock);
+      MemoizedMapping &mapping = memoized_mappings[
+        std::pair<unsigned,DomainPoint>(trace_local_id, point)];
+      mapping.mapped_proc = proc;
+      mapping.output = output;
+    }
+
     //--------------------------------------------------------------------------
     bool DynamicTrace::handles_region_tree(RegionTreeID tid) const
     //--------------------------------------------------------------------------
@@ -448,6 +480,7 @@ namespace Legion {
         {
           operations.push_back(key);
           op_map[key] = index;
+          op->set_trace_local_id(index);
           // Add a new vector for storing dependences onto the back
           dependences.push_back(LegionVector<DependenceRecord>::aligned());
           // Record meta-data about the trace for verifying that
@@ -497,6 +530,7 @@ namespace Legion {
           const LegionVector<DependenceRecord>::aligned &deps = 
                                                           dependences[index];
           operations.push_back(key);
+          op->set_trace_local_id(index);
 #ifdef LEGION_SPY
           current_uids.push_back(op->get_unique_op_id());
           num_regions.push_back(op->get_region_count());
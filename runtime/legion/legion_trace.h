@@ -178,6 +178,11 @@ namespace Legion {
         Operation::OpKind kind;
         unsigned count;
       }; 
+      struct MemoizedMapping {
+      public:
+        Processor mapped_proc;
+        Mapper::MapTaskOutput output;
+      };
     public:
       DynamicTrace(TraceID tid, TaskContext *ctx);
       DynamicTrace(const DynamicTrace &rhs);
@@ -212,6 +217,13 @@ namespace Legion {
                                     const FieldMask &dependent_mask);
       virtual void record_aliased_children(unsigned req_index, unsigned depth,
                                            const FieldMask &aliased_mask);
+    public:
+      // Called by mapping threads when memoizing map_task calls
+      bool find_memoized_mapping(unsigned trace_local_id,
+                                 const DomainPoint &point, Processor proc,
+                                 Mapper::MapTaskOutput &output) const;
+      void memoize_mapping(unsigned trace_local_id, const DomainPoint &point,
+                           Processor proc,const Mapper::MapTaskOutput &output);
     protected:
       // Insert a normal dependence for the current operation
       void insert_dependence(const DependenceRecord &record);
@@ -237,6 +249,12 @@ namespace Legion {
       std::deque<LegionVector<DependenceRecord>::aligned> dependences;
       // Metadata for checking the validity of a trace when it is replayed
       std::vector<OperationInfo> op_info;
+    protected:
+      // The results of map_task calls for the tasks in the trace keyed
+      // by their index in the trace and their point in any index launch
+      mutable LocalLock memo_lock;
+      std::map<std::pair<unsigned,DomainPoint>,MemoizedMapping> 
+                                                        memoized_mappings;
     protected:
       const TraceID tid;
       bool fixed;
@@ -628,9 +628,12 @@ namespace Legion {
         perform_remote_valid_check(copy_mask, versions,reading || (redop != 0));
       }
       FieldMask filter_mask;
-      std::set<ApEvent> dead_events;
-      LegionMap<ApEvent,FieldMask>::aligned filter_current_users, 
-                                           filter_previous_users;
+      // These only live as long as this analysis so use an arena
+      AnalysisArena local_arena;
+      LegionSet<ApEvent>::arena dead_events(std::less<ApEvent>(), local_arena);
+      LegionMap<ApEvent,FieldMask>::arena 
+        filter_current_users(std::less<ApEvent>(), local_arena),
+        filter_previous_users(std::less<ApEvent>(), local_arena);
       LegionMap<VersionID,FieldMask>::aligned advance_versions, add_versions;
       if (reading)
       {
@@ -694,16 +697,17 @@ namespace Legion {
         // Need exclusive permissions to modify data structures
         AutoLock v_lock(view_lock);
         if (!dead_events.empty())
-          for (std::set<ApEvent>::const_iterator it = dead_events.begin();
+          for (LegionSet<ApEvent>::arena::const_iterator it = 
+                dead_events.begin();
                 it != dead_events.end(); it++)
             filter_local_users(*it); 
         if (!filter_previous_users.empty())
-          for (LegionMap<ApEvent,FieldMask>::aligned::const_iterator it = 
+          for (LegionMap<ApEvent,FieldMask>::arena::const_iterator it = 
                 filter_previous_users.begin(); it != 
                 filter_previous_users.end(); it++)
             filter_previous_user(it->first, it->second);
         if (!filter_current_users.empty())
-          for (LegionMap<ApEvent,FieldMask>::aligned::const_iterator it = 
+          for (LegionMap<ApEvent,FieldMask>::arena::const_iterator it = 
                 filter_current_users.begin(); it !=
                 filter_current_users.end(); it++)
             filter_current_user(it->first, it->second);
@@ -743,8 +747,10 @@ namespace Legion {
         perform_remote_valid_check(copy_mask, versions,reading || (redop != 0));
       }
       FieldMask filter_mask;
-      std::set<ApEvent> dead_events;
-      LegionMap<ApEvent,FieldMask>::aligned filter_current_users; 
+      AnalysisArena local_arena;
+      LegionSet<ApEvent>::arena dead_events(std::less<ApEvent>(), local_arena);
+      LegionMap<ApEvent,FieldMask>::arena 
+        filter_current_users(std::less<ApEvent>(), local_arena);
       LegionMap<VersionID,FieldMask>::aligned advance_versions, add_versions;
       if (reading)
       {
@@ -802,7 +808,8 @@ namespace Legion {
         // Need exclusive permissions to modify data structures
         AutoLock v_lock(view_lock);
         if (!dead_events.empty())
-          for (std::set<ApEvent>::const_iterator it = dead_events.begin();
+          for (LegionSet<ApEvent>::arena::const_iterator it = 
+                dead_events.begin();
                 it != dead_events.end(); it++)
             filter_local_users(*it); 
         if (!advance_versions.empty() || !add_versions.empty())
@@ -1047,9 +1054,11 @@ namespace Legion {
         perform_remote_valid_check(user_mask, versions, 
                                    !HAS_WRITE_DISCARD(usage));
       }
-      std::set<ApEvent> dead_events;
-      LegionMap<ApEvent,FieldMask>::aligned filter_current_users, 
-                                           filter_previous_users;
+      AnalysisArena local_arena;
+      LegionSet<ApEvent>::arena dead_events(std::less<ApEvent>(), local_arena);
+      LegionMap<ApEvent,FieldMask>::arena 
+        filter_current_users(std::less<ApEvent>(), local_arena),
+        filter_previous_users(std::less<ApEvent>(), local_arena);
       if (IS_READ_ONLY(usage))
       {
         AutoLock v_lock(view_lock,1,false/*exclusive*/);
@@ -1090,16 +1099,17 @@ namespace Legion {
         // Need exclusive permissions to modify data structures
         AutoLock v_lock(view_lock);
         if (!dead_events.empty())
-          for (std::set<ApEvent>::const_iterator it = dead_events.begin();
+          for (LegionSet<ApEvent>::arena::const_iterator it = 
+                dead_events.begin();
                 it != dead_events.end(); it++)
             filter_local_users(*it); 
         if (!filter_previous_users.empty())
-          for (LegionMap<ApEvent,FieldMask>::aligned::const_iterator it = 
+          for (LegionMap<ApEvent,FieldMask>::arena::const_iterator it = 
                 filter_previous_users.begin(); it != 
                 filter_previous_users.end(); it++)
             filter_previous_user(it->first, it->second);
         if (!filter_current_users.empty())
-          for (LegionMap<ApEvent,FieldMask>::aligned::const_iterator it = 
+          for (LegionMap<ApEvent,FieldMask>::arena::const_iterator it = 
                 filter_current_users.begin(); it !=
                 filter_current_users.end(); it++)
             filter_current_user(it->first, it->second);
@@ -1137,8 +1147,10 @@ namespace Legion {
         perform_remote_valid_check(user_mask, versions, 
                                    !HAS_WRITE_DISCARD(usage));
       }
-      std::set<ApEvent> dead_events;
-      LegionMap<ApEvent,FieldMask>::aligned filter_current_users;
+      AnalysisArena local_arena;
+      LegionSet<ApEvent>::arena dead_events(std::less<ApEvent>(), local_arena);
+      LegionMap<ApEvent,FieldMask>::arena 
+        filter_current_users(std::less<ApEvent>(), local_arena);
       if (IS_READ_ONLY(usage))
       {
         AutoLock v_lock(view_lock,1,false/*exclusive*/);
@@ -1175,7 +1187,8 @@ namespace Legion {
         // Need exclusive permissions to modify data structures
         AutoLock v_lock(view_lock);
         if (!dead_events.empty())
-          for (std::set<ApEvent>::const_iterator it = dead_events.begin();
+          for (LegionSet<ApEvent>::arena::const_iterator it = 
+                dead_events.begin();
                 it != dead_events.end(); it++)
             filter_local_users(*it); 
       }
@@ -2019,6 +2032,7 @@ namespace Legion {
         (*event_users.users.multi_users)[user] = user_mask;
         event_users.user_mask |= user_mask;
       }
+      current_index.record(term_event, user_mask, current_epoch_users);
     }
 
     //--------------------------------------------------------------------------
@@ -2454,6 +2468,7 @@ namespace Legion {
           }
         }
       }
+      previous_index.record(user_event, summary_overlap, previous_epoch_users);
     }
 
     //--------------------------------------------------------------------------
@@ -2561,6 +2576,135 @@ namespace Legion {
       }
     }
 
+    //--------------------------------------------------------------------------
+    void MaterializedView::EventUserIndex::record(ApEvent event,
+                                                  const FieldMask &mask,
+                     const LegionMap<ApEvent,EventUsers>::aligned &users)
+    //--------------------------------------------------------------------------
+    {
+      if (!active)
+      {
+        // Not worth indexing until there are enough events to search
+        if (users.size() >= DEFAULT_VIEW_USER_INDEX_THRESHOLD)
+          rebuild(users);
+        return;
+      }
+      int idx = mask.find_first_set();
+      while (idx >= 0)
+      {
+        const unsigned bucket = idx / DEFAULT_VIEW_USER_INDEX_BUCKET_FIELDS;
+        if (buckets[bucket].insert(event).second)
+          recorded++;
+        const unsigned next = (bucket + 1) * 
+          DEFAULT_VIEW_USER_INDEX_BUCKET_FIELDS;
+        idx = (next < MAX_FIELDS) ? mask.find_next_set(next) : -1;
+      }
+      // Entries are only removed by rebuilding, so do that whenever
+      // the index has doubled in size since the last time
+      if (recorded > rebuilt)
+        rebuild(users);
+    }
+
+    //--------------------------------------------------------------------------
+    void MaterializedView::EventUserIndex::rebuild(
+                     const LegionMap<ApEvent,EventUsers>::aligned &users)
+    //--------------------------------------------------------------------------
+    {
+      buckets.clear();
+      recorded = 0;
+      rebuilt = 0;
+      // Stop indexing once the epoch has shrunk back down
+      active = (users.size() >= (DEFAULT_VIEW_USER_INDEX_THRESHOLD / 2));
+      if (!active)
+        return;
+      buckets.resize(MAX_FIELDS / DEFAULT_VIEW_USER_INDEX_BUCKET_FIELDS);
+      for (LegionMap<ApEvent,EventUsers>::aligned::const_iterator it = 
+            users.begin(); it != users.end(); it++)
+      {
+        int idx = it->second.user_mask.find_first_set();
+        while (idx >= 0)
+        {
+          const unsigned bucket = idx / DEFAULT_VIEW_USER_INDEX_BUCKET_FIELDS;
+          buckets[bucket].insert(it->first);
+          rebuilt++;
+          const unsigned next = (bucket + 1) * 
+            DEFAULT_VIEW_USER_INDEX_BUCKET_FIELDS;
+          idx = (next < MAX_FIELDS) ? 
+            it->second.user_mask.find_next_set(next) : -1;
+        }
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    bool MaterializedView::EventUserIndex::find_events(const FieldMask &mask,
+                                                       size_t total_events,
+                                             std::vector<ApEvent> &events) const
+    //--------------------------------------------------------------------------
+    {
+      if (!active)
+        return false;
+      unsigned num_buckets = 0;
+      int idx = mask.find_first_set();
+      while (idx >= 0)
+      {
+        const unsigned bucket = idx / DEFAULT_VIEW_USER_INDEX_BUCKET_FIELDS;
+        const std::set<ApEvent> &bucket_events = buckets[bucket];
+        events.insert(events.end(), bucket_events.begin(), bucket_events.end());
+        // If we're going to look at most of the events anyway then
+        // it is cheaper to just scan all of them
+        if (events.size() >= total_events)
+          return false;
+        num_buckets++;
+        const unsigned next = (bucket + 1) * 
+          DEFAULT_VIEW_USER_INDEX_BUCKET_FIELDS;
+        idx = (next < MAX_FIELDS) ? mask.find_next_set(next) : -1;
+      }
+      if (num_buckets > 1)
+      {
+        std::sort(events.begin(), events.end());
+        events.erase(std::unique(events.begin(), events.end()), events.end());
+      }
+      return ((2 * events.size()) < total_events);
+    }
+
+    //--------------------------------------------------------------------------
+    MaterializedView::EventUserIterator::EventUserIterator(
+                        const LegionMap<ApEvent,EventUsers>::aligned &u,
+                        const EventUserIndex &index, const FieldMask &mask)
+      : users(u), next_candidate(0)
+    //--------------------------------------------------------------------------
+    {
+      indexed = index.find_events(mask, users.size(), candidates);
+      if (indexed)
+        find_next_candidate();
+      else
+        current = users.begin();
+    }
+
+    //--------------------------------------------------------------------------
+    void MaterializedView::EventUserIterator::step(void)
+    //--------------------------------------------------------------------------
+    {
+      if (indexed)
+        find_next_candidate();
+      else
+        current++;
+    }
+
+    //--------------------------------------------------------------------------
+    void MaterializedView::EventUserIterator::find_next_candidate(void)
+    //--------------------------------------------------------------------------
+    {
+      // Skip any events that have been filtered since they were indexed
+      while (next_candidate < candidates.size())
+      {
+        current = users.find(candidates[next_candidate++]);
+        if (current != users.end())
+          return;
+      }
+      current = users.end();
+    }
+
     //--------------------------------------------------------------------------
     template<bool TRACK_DOM>
     void MaterializedView::find_current_preconditions(
@@ -2572,15 +2716,15 @@ namespace Legion {
                                                  const UniqueID op_id,
                                                  const unsigned index,
                                                std::set<ApEvent> &preconditions,
-                                               std::set<ApEvent> &dead_events,
-                           LegionMap<ApEvent,FieldMask>::aligned &filter_events,
+                                        LegionSet<ApEvent>::arena &dead_events,
+                           LegionMap<ApEvent,FieldMask>::arena &filter_events,
                                                  FieldMask &observed,
                                                  FieldMask &non_dominated)
     //--------------------------------------------------------------------------
     {
       // Caller must be holding the lock
-      for (LegionMap<ApEvent,EventUsers>::aligned::const_iterator cit = 
-           current_epoch_users.begin(); cit != current_epoch_users.end(); cit++)
+      for (EventUserIterator cit(current_epoch_users, current_index, 
+            user_mask); cit.valid(); cit.step())
       {
         if (cit->first == term_event)
           continue;
@@ -2647,13 +2791,12 @@ namespace Legion {
                                                  const UniqueID op_id,
                                                  const unsigned index,
                                                std::set<ApEvent> &preconditions,
-                                               std::set<ApEvent> &dead_events)
+                                        LegionSet<ApEvent>::arena &dead_events)
     //--------------------------------------------------------------------------
     {
       // Caller must be holding the lock
-      for (LegionMap<ApEvent,EventUsers>::aligned::const_iterator pit = 
-            previous_epoch_users.begin(); pit != 
-            previous_epoch_users.end(); pit++)
+      for (EventUserIterator pit(previous_epoch_users, previous_index, 
+            user_mask); pit.valid(); pit.step())
       {
         if (pit->first == term_event)
           continue;
@@ -2704,15 +2847,15 @@ namespace Legion {
                                                  const UniqueID op_id,
                                                  const unsigned index,
                            LegionMap<ApEvent,FieldMask>::aligned &preconditions,
-                                                 std::set<ApEvent> &dead_events,
-                           LegionMap<ApEvent,FieldMask>::aligned &filter_events,
+                                        LegionSet<ApEvent>::arena &dead_events,
+                           LegionMap<ApEvent,FieldMask>::arena &filter_events,
                                                  FieldMask &observed,
                                                  FieldMask &non_dominated)
     //--------------------------------------------------------------------------
     {
       // Caller must be holding the lock
-      for (LegionMap<ApEvent,EventUsers>::aligned::const_iterator cit = 
-           current_epoch_users.begin(); cit != current_epoch_users.end(); cit++)
+      for (EventUserIterator cit(current_epoch_users, current_index, 
+            user_mask); cit.valid(); cit.step())
       {
 #if !defined(LEGION_SPY) && !defined(EVENT_GRAPH_TRACE)
         // We're about to do a bunch of expensive tests, 
@@ -2790,13 +2933,12 @@ namespace Legion {
                                                  const UniqueID op_id,
                                                  const unsigned index,
                            LegionMap<ApEvent,FieldMask>::aligned &preconditions,
-                                                 std::set<ApEvent> &dead_events)
+                                        LegionSet<ApEvent>::arena &dead_events)
     //--------------------------------------------------------------------------
     {
       // Caller must be holding the lock
-      for (LegionMap<ApEvent,EventUsers>::aligned::const_iterator pit = 
-            previous_epoch_users.begin(); pit != 
-            previous_epoch_users.end(); pit++)
+      for (EventUserIterator pit(previous_epoch_users, previous_index, 
+            user_mask); pit.valid(); pit.step())
       {
 #if !defined(LEGION_SPY) && !defined(EVENT_GRAPH_TRACE)
         // We're about to do a bunch of expensive tests, 
@@ -2861,12 +3003,12 @@ namespace Legion {
 
     //--------------------------------------------------------------------------
     void MaterializedView::find_previous_filter_users(const FieldMask &dom_mask,
-                            LegionMap<ApEvent,FieldMask>::aligned &filter_users)
+                            LegionMap<ApEvent,FieldMask>::arena &filter_users)
     //--------------------------------------------------------------------------
     {
       // Lock better be held by caller
-      for (LegionMap<ApEvent,EventUsers>::aligned::const_iterator it = 
-           previous_epoch_users.begin(); it != previous_epoch_users.end(); it++)
+      for (EventUserIterator it(previous_epoch_users, previous_index, 
+            dom_mask); it.valid(); it.step())
       {
         FieldMask overlap = it->second.user_mask & dom_mask;
         if (!overlap)
@@ -3604,6 +3746,8 @@ namespace Legion {
               derez.deserialize(new_mask);
               current_users.user_mask |= new_mask;
             }
+            current_index.record(current_event, current_users.user_mask, 
+                                 current_epoch_users);
           }
           else
           {
@@ -3630,6 +3774,8 @@ namespace Legion {
                 current_users.user_mask |= new_mask;
               }
             }
+            current_index.record(current_event, current_users.user_mask, 
+                                 current_epoch_users);
             // Didn't have it before so update the collect events
             if (outstanding_gc_events.find(current_event) == 
                   outstanding_gc_events.end())
@@ -3674,6 +3820,8 @@ namespace Legion {
               derez.deserialize(new_mask);
               previous_users.user_mask |= new_mask;
             }
+            previous_index.record(previous_event, previous_users.user_mask, 
+                                  previous_epoch_users);
           }
           else
           {
@@ -3700,6 +3848,8 @@ namespace Legion {
                 previous_users.user_mask |= new_mask;
               }
             }
+            previous_index.record(previous_event, previous_users.user_mask, 
+                                  previous_epoch_users);
             // Didn't have it before so update the collect events
             if (outstanding_gc_events.find(previous_event) == 
                   outstanding_gc_events.end())
@@ -263,6 +263,50 @@ namespace Legion {
         } users;
         bool single;
       };
+      // An index from buckets of fields to the events in an epoch that
+      // have users of any of those fields. Entries are only added between
+      // periodic rebuilds so it may still contain events whose users have
+      // since been filtered for those fields; searches must continue to
+      // test the users, but can skip all the events that don't overlap.
+      class EventUserIndex {
+      public:
+        EventUserIndex(void)
+          : active(false), recorded(0), rebuilt(0) { }
+      public:
+        // Must be called while holding the lock in exclusive mode
+        // whenever the users of an event in an epoch are extended
+        void record(ApEvent event, const FieldMask &mask,
+                    const LegionMap<ApEvent,EventUsers>::aligned &users);
+        // Returns false if the caller should scan all the users instead
+        bool find_events(const FieldMask &mask, size_t total_events,
+                         std::vector<ApEvent> &events) const;
+      protected:
+        void rebuild(const LegionMap<ApEvent,EventUsers>::aligned &users);
+      protected:
+        bool active;
+        size_t recorded, rebuilt;
+        std::vector<std::set<ApEvent> > buckets;
+      };
+      // Iterates either all the events in an epoch or just the ones
+      // that the index says might overlap with a given field mask
+      class EventUserIterator {
+      public:
+        EventUserIterator(const LegionMap<ApEvent,EventUsers>::aligned &users,
+                          const EventUserIndex &index, const FieldMask &mask);
+      public:
+        inline bool valid(void) const { return (current != users.end()); }
+        void step(void);
+        inline const LegionMap<ApEvent,EventUsers>::aligned::value_type*
+          operator->(void) const { return &(*current); }
+      protected:
+        void find_next_candidate(void);
+      protected:
+        const LegionMap<ApEvent,EventUsers>::aligned &users;
+        std::vector<ApEvent> candidates;
+        unsigned next_candidate;
+        bool indexed;
+        LegionMap<ApEvent,EventUsers>::aligned::const_iterator current;
+      };
     public:
       MaterializedView(RegionTreeForest *ctx, DistributedID did,
                        AddressSpaceID owner_proc, 
@@ -541,8 +585,8 @@ namespace Legion {
                                       const UniqueID op_id,
                                       const unsigned index,
                                       std::set<ApEvent> &preconditions,
-                                      std::set<ApEvent> &dead_events,
-                  LegionMap<ApEvent,FieldMask>::aligned &filter_events,
+                  LegionSet<ApEvent>::arena &dead_events,
+                  LegionMap<ApEvent,FieldMask>::arena &filter_events,
                                       FieldMask &observed, 
                                       FieldMask &non_dominated);
       void find_previous_preconditions(const FieldMask &user_mask,
@@ -553,7 +597,7 @@ namespace Legion {
                                       const UniqueID op_id,
                                       const unsigned index,
                                       std::set<ApEvent> &preconditions,
-                                      std::set<ApEvent> &dead_events);
+                  LegionSet<ApEvent>::arena &dead_events);
       // Overloaded versions for being precise about copy preconditions
       template<bool TRACK_DOM>
       void find_current_preconditions(const FieldMask &user_mask,
@@ -563,8 +607,8 @@ namespace Legion {
                                       const UniqueID op_id,
                                       const unsigned index,
                   LegionMap<ApEvent,FieldMask>::aligned &preconditions,
-                                      std::set<ApEvent> &dead_events,
-                  LegionMap<ApEvent,FieldMask>::aligned &filter_events,
+                  LegionSet<ApEvent>::arena &dead_events,
+                  LegionMap<ApEvent,FieldMask>::arena &filter_events,
                                       FieldMask &observed, 
                                       FieldMask &non_dominated);
       void find_previous_preconditions(const FieldMask &user_mask,
@@ -574,9 +618,9 @@ namespace Legion {
                                       const UniqueID op_id,
                                       const unsigned index,
                   LegionMap<ApEvent,FieldMask>::aligned &preconditions,
-                                      std::set<ApEvent> &dead_events);
+                  LegionSet<ApEvent>::arena &dead_events);
       void find_previous_filter_users(const FieldMask &dominated_mask,
-                  LegionMap<ApEvent,FieldMask>::aligned &filter_events);
+                  LegionMap<ApEvent,FieldMask>::arena &filter_events);
       inline bool has_local_precondition(PhysicalUser *prev_user,
                                      const RegionUsage &next_user,
                                      const LegionColor child_color,
@@ -663,6 +707,9 @@ namespace Legion {
       // the view tree that less frequently filter their sub-users.
       LegionMap<ApEvent,EventUsers>::aligned current_epoch_users;
       LegionMap<ApEvent,EventUsers>::aligned previous_epoch_users;
+      // Views of instances with many fields and many outstanding users
+      // also index the events in each epoch by the fields they use
+      EventUserIndex current_index, previous_index;
       // Also keep a set of events for which we have outstanding
       // garbage collection meta-tasks so we don't launch more than one
       // We need this even though we have the data structures above because
@@ -6245,9 +6245,21 @@ namespace Legion {
       assert(disjoint_ready.exists() && !disjoint_ready.has_triggered());
       assert(ready_event == disjoint_ready);
 #endif
-      // Now do the pairwise disjointness tests
       disjoint = true;
-      if (total_children == max_linearized_color)
+      if (implicit_runtime->dynamic_independence_tests)
+      {
+        // Sweep over the bounds of all the children at once rather than
+        // doing the pairwise tests which are quadratic in the number of
+        // children, this stops as soon as it finds an overlapping pair
+        LegionColor c1 = 0, c2 = 0;
+        if (find_aliased_children(c1, c2))
+        {
+          disjoint = false;
+          record_disjointness(false/*disjoint*/, c1, c2);
+        }
+      }
+      // Otherwise do the pairwise disjointness tests
+      else if (total_children == max_linearized_color)
       {
         for (LegionColor c1 = 0; disjoint && 
               (c1 < max_linearized_color); c1++)
@@ -9344,6 +9356,8 @@ namespace Legion {
           closer.perform_dependence_analysis(user, open_below,
                                              state.curr_epoch_users,
                                              state.prev_epoch_users);
+          state.curr_epoch_index.invalidate();
+          state.prev_epoch_index.invalidate();
           // Note we don't need to update the version numbers because
           // that happened when we recorded dirty fields below. 
           // However, we do need to mark that there is no longer any
@@ -9354,6 +9368,7 @@ namespace Legion {
           closer.update_state(state);
           // Now we can add the close operations to the current epoch
           closer.register_close_operations(state.curr_epoch_users);
+          state.curr_epoch_index.invalidate();
         }
         // See if we have any open_only fields to merge
         if (!arrived || proj_info.is_projecting())
@@ -9443,7 +9458,9 @@ namespace Legion {
                        true/*record*/,false/*has skip*/,true/*track dom*/>(
                           user, state.curr_epoch_users, user.field_mask, 
                           open_below, arrived/*validates*/ && 
-                                        !proj_info.is_projecting());
+                                        !proj_info.is_projecting(),
+                          NULL/*to skip*/, 0/*skip gen*/,
+                          &state.curr_epoch_index);
       FieldMask non_dominated_mask = user.field_mask - dominator_mask;
       // For the fields that weren't dominated, we have to check
       // those fields against the previous epoch's users
@@ -9453,7 +9470,9 @@ namespace Legion {
                       true/*record*/, false/*has skip*/, false/*track dom*/>(
                         user, state.prev_epoch_users, non_dominated_mask, 
                         open_below, arrived/*validates*/ && 
-                                      !proj_info.is_projecting());
+                                      !proj_info.is_projecting(),
+                        NULL/*to skip*/, 0/*skip gen*/,
+                        &state.prev_epoch_index);
       }
       // If we dominated and this is our final destination then we 
       // can filter the operations since we actually do dominate them
@@ -9655,6 +9674,7 @@ namespace Legion {
       open->end_dependence_analysis();
       // Now add this to the current list
       state.curr_epoch_users.push_back(open_user);
+      state.curr_epoch_index.record(state.curr_epoch_users);
     }
 
     //--------------------------------------------------------------------------
@@ -9708,6 +9728,7 @@ namespace Legion {
       advances[advance] = advance_user;
       // Add it to the list of current epoch users even if we're tracing 
       state.curr_epoch_users.push_back(advance_user);
+      state.curr_epoch_index.record(state.curr_epoch_users);
     }
 
     //--------------------------------------------------------------------------
@@ -9725,6 +9746,7 @@ namespace Legion {
         user.op->add_mapping_reference(user.gen);
         // Add ourselves to the current epoch
         state.curr_epoch_users.push_back(user);
+        state.curr_epoch_index.record(state.curr_epoch_users);
       }
     }
 
@@ -9825,14 +9847,16 @@ namespace Legion {
             perform_dependence_checks<CURR_LOGICAL_ALLOC,
                     false/*record*/, true/*has skip*/, true/*track dom*/>(
               advance_user, state.curr_epoch_users, advance_user.field_mask,
-              empty_below, false/*validates*/, create_user.op, create_user.gen);
+              empty_below, false/*validates*/, create_user.op, create_user.gen,
+              &state.curr_epoch_index);
       FieldMask non_dominated_mask = advance_user.field_mask - dominator_mask;
       if (!!non_dominated_mask)
       {
         perform_dependence_checks<PREV_LOGICAL_ALLOC,
                     false/*record*/, true/*has skip*/, false/*track dom*/>(
               advance_user, state.prev_epoch_users, non_dominated_mask,
-              empty_below, false/*validates*/, create_user.op, create_user.gen);
+              empty_below, false/*validates*/, create_user.op, create_user.gen,
+              &state.prev_epoch_index);
       }
       // Can't filter here because we need our creator to record
       // the same dependences in case it has to generate closes or opens later
@@ -9852,6 +9876,8 @@ namespace Legion {
                                      state.curr_epoch_users, closing_mask);
       perform_closing_checks<PREV_LOGICAL_ALLOC>(closer, read_only_close,
                                      state.prev_epoch_users, closing_mask);
+      state.curr_epoch_index.invalidate();
+      state.prev_epoch_index.invalidate();
       // If this is not a read-only close, then capture the 
       // close information
       ClosedNode *closed_node = NULL;
@@ -11091,6 +11117,7 @@ namespace Legion {
         else
           it++; // still has non-dominated fields
       }
+      state.prev_epoch_index.invalidate();
     }
 
     //--------------------------------------------------------------------------
@@ -11144,6 +11171,8 @@ namespace Legion {
         else
           it++; // not empty so keep going
       }
+      state.curr_epoch_index.invalidate();
+      state.prev_epoch_index.invalidate();
     }
 
     //--------------------------------------------------------------------------
@@ -11346,6 +11375,8 @@ namespace Legion {
         else
           it++;
       }
+      state.curr_epoch_index.invalidate();
+      state.prev_epoch_index.invalidate();
     } 
 
     //--------------------------------------------------------------------------
@@ -11387,6 +11418,8 @@ namespace Legion {
             closer.perform_dependence_analysis(user, open_below,
                                                state.curr_epoch_users,
                                                state.prev_epoch_users);
+            state.curr_epoch_index.invalidate();
+            state.prev_epoch_index.invalidate();
             // Note we don't need to update the version numbers because
             // that happened when we recorded dirty fields below. 
             // However, we do need to mark that there is no longer any
@@ -11397,13 +11430,16 @@ namespace Legion {
             closer.update_state(state);
             // Now we can add the close operations to the current epoch
             closer.register_close_operations(state.curr_epoch_users);
+            state.curr_epoch_index.invalidate();
           }
           // Perform our checks on dependences
           FieldMask dominator_mask = 
                  perform_dependence_checks<CURR_LOGICAL_ALLOC,
                            true/*record*/,false/*has skip*/,true/*track dom*/>(
                               user, state.curr_epoch_users, check_mask, 
-                              open_below, false/*validates*/);
+                              open_below, false/*validates*/,
+                              NULL/*to skip*/, 0/*skip gen*/,
+                              &state.curr_epoch_index);
           FieldMask non_dominated_mask = check_mask - dominator_mask;
           // For the fields that weren't dominated, we have to check
           // those fields against the previous epoch's users
@@ -11412,7 +11448,9 @@ namespace Legion {
             perform_dependence_checks<PREV_LOGICAL_ALLOC,
                          true/*record*/, false/*has skip*/, false/*track dom*/>(
                          user, state.prev_epoch_users, non_dominated_mask, 
-                         open_below, false/*validates*/);
+                         open_below, false/*validates*/,
+                         NULL/*to skip*/, 0/*skip gen*/,
+                         &state.prev_epoch_index);
           }
         }
         // If we have any split fields we have to record them
@@ -12579,6 +12617,8 @@ namespace Legion {
       // to issue the distinct copies to the low-level runtime
       // Issue a copy for each of the different precondition sets
       const AddressSpaceID local_space = context->runtime->address_space;
+      // The views to update for each set are only needed for this call
+      AnalysisArena local_arena;
       for (LegionList<EventSet>::aligned::iterator pit = 
             precondition_sets.begin(); pit != 
             precondition_sets.end(); pit++)
@@ -12587,7 +12627,8 @@ namespace Legion {
         // Build the src and dst fields vectors
         std::vector<CopySrcDstField> src_fields;
         std::vector<CopySrcDstField> dst_fields;
-        LegionMap<MaterializedView*,FieldMask>::aligned update_views;
+        LegionMap<MaterializedView*,FieldMask>::arena 
+          update_views(std::less<MaterializedView*>(), local_arena);
         for (LegionMap<MaterializedView*,FieldMask>::aligned::const_iterator 
               it = src_instances.begin(); it != src_instances.end(); it++)
         {
@@ -12615,7 +12656,7 @@ namespace Legion {
           // Register copy post with the source views
           // Note it is up to the caller to make sure the event
           // gets registered with the destination
-          for (LegionMap<MaterializedView*,FieldMask>::aligned::const_iterator 
+          for (LegionMap<MaterializedView*,FieldMask>::arena::const_iterator 
                 it = update_views.begin(); it != update_views.end(); it++)
           {
             it->first->add_copy_user(0/*redop*/, copy_post, src_versions,
@@ -13375,6 +13416,98 @@ namespace Legion {
       tracking_contexts.erase(context);
     }
 
+    //--------------------------------------------------------------------------
+    template<bool RECORD, bool TRACK_DOM>
+    /*static*/ inline bool RegionTreeNode::check_logical_user(
+      const LogicalUser &user, LogicalUser &prev_user,
+      const FieldMask &user_check_mask, bool validates_regions, bool tracing,
+      FieldMask &dominator_mask, FieldMask &observed_mask)
+    //--------------------------------------------------------------------------
+    {
+      // Returns true if the previous user can be pruned from its list
+      FieldMask overlap = user_check_mask & prev_user.field_mask;
+      if (!!overlap)
+      {
+        if (TRACK_DOM)
+          observed_mask |= overlap;
+        DependenceType dtype = check_dependence_type(prev_user.usage, 
+                                                     user.usage);
+        bool validate = validates_regions;
+        switch (dtype)
+        {
+          case NO_DEPENDENCE:
+            {
+              // No dependence so remove bits from the dominator mask
+              dominator_mask -= prev_user.field_mask;
+              break;
+            }
+          case ANTI_DEPENDENCE:
+          case ATOMIC_DEPENDENCE:
+          case SIMULTANEOUS_DEPENDENCE:
+            {
+              // Mark that these kinds of dependences are not allowed
+              // to validate region inputs
+              validate = false;
+              // No break so we register dependences just like
+              // a true dependence
+            }
+          case TRUE_DEPENDENCE:
+            {
+#ifdef LEGION_SPY
+              LegionSpy::log_mapping_dependence(
+                  user.op->get_context()->get_unique_id(),
+                  prev_user.uid, prev_user.idx, user.uid, user.idx, dtype);
+#endif
+              if (RECORD)
+                user.op->record_logical_dependence(prev_user);
+              // If we can validate a region record which of our
+              // predecessors regions we are validating, otherwise
+              // just register a normal dependence
+              if (user.op->register_region_dependence(user.idx, prev_user.op,
+                                                      prev_user.gen, 
+                                                      prev_user.idx,
+                                                      dtype, validate,
+                                                      overlap))
+              {
+#ifndef LEGION_SPY
+                // Now we can prune it from the list
+                return true;
+#else
+                return false;
+#endif
+              }
+              // hasn't commited, reset timeout and continue
+              prev_user.timeout = LogicalUser::TIMEOUT;
+              return false;
+            }
+          default:
+            assert(false); // should never get here
+        }
+      }
+      // If we didn't register any kind of dependence, check
+      // to see if the timeout has expired.  Note that it is
+      // unsound to do this if we are tracing so don't perform
+      // the check in that case.
+      if (tracing)
+        return false;
+      if (prev_user.timeout <= 0)
+      {
+        // Timeout has expired.  Check whether the operation
+        // has committed. If it has prune it from the list.
+        // Otherwise reset its timeout and continue.
+#ifndef LEGION_SPY
+        if (prev_user.op->is_operation_committed(prev_user.gen))
+          return true;
+#endif
+        // Operation hasn't committed (or we can't prune things
+        // early for these cases), reset timeout
+        prev_user.timeout = LogicalUser::TIMEOUT;
+      }
+      else // Timeout hasn't expired, decrement it and continue
+        prev_user.timeout--;
+      return false;
+    }
+
     //--------------------------------------------------------------------------
     template<AllocationType ALLOC, bool RECORD, bool HAS_SKIP, bool TRACK_DOM>
     /*static*/ FieldMask RegionTreeNode::perform_dependence_checks(
@@ -13382,7 +13515,7 @@ namespace Legion {
       typename LegionList<LogicalUser, ALLOC>::track_aligned &prev_users,
       const FieldMask &check_mask, const FieldMask &open_below,
       bool validates_regions, Operation *to_skip /*= NULL*/, 
-      GenerationID skip_gen /* = 0*/)
+      GenerationID skip_gen /* = 0*/, LogicalUserIndex<ALLOC> *index/*=NULL*/)
     //--------------------------------------------------------------------------
     {
       FieldMask dominator_mask = check_mask;
@@ -13393,116 +13526,50 @@ namespace Legion {
       FieldMask observed_mask; 
       FieldMask user_check_mask = user.field_mask & check_mask;
       const bool tracing = user.op->is_tracing();
-      for (typename LegionList<LogicalUser, ALLOC>::track_aligned::iterator 
-            it = prev_users.begin(); it != prev_users.end(); /*nothing*/)
-      {
-        if (HAS_SKIP && (to_skip == it->op) && (skip_gen == it->gen))
-        {
-          it++;
-          continue;
-        }
-        FieldMask overlap = user_check_mask & it->field_mask;
-        if (!!overlap)
-        {
-          if (TRACK_DOM)
-            observed_mask |= overlap;
-          DependenceType dtype = check_dependence_type(it->usage, user.usage);
-          bool validate = validates_regions;
-          switch (dtype)
-          {
-            case NO_DEPENDENCE:
-              {
-                // No dependence so remove bits from the dominator mask
-                dominator_mask -= it->field_mask;
-                break;
-              }
-            case ANTI_DEPENDENCE:
-            case ATOMIC_DEPENDENCE:
-            case SIMULTANEOUS_DEPENDENCE:
-              {
-                // Mark that these kinds of dependences are not allowed
-                // to validate region inputs
-                validate = false;
-                // No break so we register dependences just like
-                // a true dependence
-              }
-            case TRUE_DEPENDENCE:
-              {
-#ifdef LEGION_SPY
-                LegionSpy::log_mapping_dependence(
-                    user.op->get_context()->get_unique_id(),
-                    it->uid, it->idx, user.uid, user.idx, dtype);
-#endif
-                if (RECORD)
-                  user.op->record_logical_dependence(*it);
-                // Do this after the logging since we might 
-                // update the iterator.
-                // If we can validate a region record which of our
-                // predecessors regions we are validating, otherwise
-                // just register a normal dependence
-                if (user.op->register_region_dependence(user.idx, it->op, 
-                                                        it->gen, it->idx,
-                                                        dtype, validate,
-                                                        overlap))
-                {
-#ifndef LEGION_SPY
-                  // Now we can prune it from the list and continue
-                  it = prev_users.erase(it);
-#else
-                  it++;
-#endif
-                  continue;
-                }
-                else
-                {
-                  // hasn't commited, reset timeout and continue
-                  it->timeout = LogicalUser::TIMEOUT;
-                  it++;
-                  continue;
-                }
-                break;
-              }
-            default:
-              assert(false); // should never get here
-          }
+      // If the users are indexed we only have to visit the ones that
+      // might overlap since the others can't have any dependences
+      std::vector<typename LogicalUserIndex<ALLOC>::IndexedUser> candidates;
+      bool sweep = false;
+      if ((index != NULL) && 
+          index->find_users(prev_users, user_check_mask, candidates, sweep))
+      {
+        for (typename std::vector<typename LogicalUserIndex<ALLOC>::
+              IndexedUser>::const_iterator it = candidates.begin(); 
+              it != candidates.end(); it++)
+        {
+          if (HAS_SKIP && (to_skip == it->user->op) && 
+              (skip_gen == it->user->gen))
+            continue;
+          if (check_logical_user<RECORD,TRACK_DOM>(user, *(it->user), 
+                user_check_mask, validates_regions, tracing, 
+                dominator_mask, observed_mask))
+            index->erase(prev_users, *it);
         }
-        // If we didn't register any kind of dependence, check
-        // to see if the timeout has expired.  Note that it is
-        // unsound to do this if we are tracing so don't perform
-        // the check in that case.
-        if (!tracing)
+      }
+      else
+      {
+        const size_t total_users = prev_users.size();
+        for (typename LegionList<LogicalUser, ALLOC>::track_aligned::iterator 
+              it = prev_users.begin(); it != prev_users.end(); /*nothing*/)
         {
-          if (it->timeout <= 0)
+          if (HAS_SKIP && (to_skip == it->op) && (skip_gen == it->gen))
           {
-            // Timeout has expired.  Check whether the operation
-            // has committed. If it has prune it from the list.
-            // Otherwise reset its timeout and continue.
-            if (it->op->is_operation_committed(it->gen))
-            {
-#ifndef LEGION_SPY
-              it = prev_users.erase(it);
-#else
-              // Can't prune things early for these cases
-              it->timeout = LogicalUser::TIMEOUT;
-              it++;
-#endif
-            }
-            else
-            {
-              // Operation hasn't committed, reset timeout
-              it->timeout = LogicalUser::TIMEOUT;
-              it++;
-            }
+            it++;
+            continue;
           }
+          // The index hasn't been counting down the timeouts of the
+          // users we don't overlap with so check them all now
+          if (sweep && (user_check_mask * it->field_mask))
+            it->timeout = 0;
+          if (check_logical_user<RECORD,TRACK_DOM>(user, *it, 
+                user_check_mask, validates_regions, tracing,
+                dominator_mask, observed_mask))
+            it = prev_users.erase(it);
           else
-          {
-            // Timeout hasn't expired, decrement it and continue
-            it->timeout--;
             it++;
-          }
         }
-        else
-          it++; // Tracing so no timeouts
+        if ((index != NULL) && (prev_users.size() != total_users))
+          index->invalidate();
       }
       // The result of this computation is the dominator mask.
       // It's only sound to say that we dominate fields that
@@ -451,7 +451,7 @@ namespace Legion {
                                 const RegionRequirement &req,
                                 const InstanceSet &targets,
                                 bool postmapping = false);
-    protected: // helper method for the above two methods
+    public: // helper for the above two methods and memoized task mappings
       void perform_missing_acquires(Operation *op,
                  std::map<PhysicalManager*,std::pair<unsigned,bool> > &acquired,
                                const std::vector<PhysicalManager*> &unacquired);
@@ -1535,6 +1535,7 @@ namespace Legion {
       ApEvent create_by_restriction(const void *transform, const void *extent);
     public:
       virtual bool compute_complete(void) = 0;
+      virtual bool find_aliased_children(LegionColor &c1, LegionColor &c2) = 0;
       virtual bool intersects_with(IndexSpaceNode *other, 
                                    bool compute = true) = 0;
       virtual bool intersects_with(IndexPartNode *other,
@@ -1627,6 +1628,7 @@ namespace Legion {
       IndexPartNodeT& operator=(const IndexPartNodeT &rhs);
     public:
       virtual bool compute_complete(void);
+      virtual bool find_aliased_children(LegionColor &c1, LegionColor &c2);
       virtual bool intersects_with(IndexSpaceNode *other, bool compute = true);
       virtual bool intersects_with(IndexPartNode *other, bool compute = true);
       virtual bool dominates(IndexSpaceNode *other);
@@ -2339,8 +2341,13 @@ namespace Legion {
       static FieldMask perform_dependence_checks(const LogicalUser &user, 
           typename LegionList<LogicalUser, ALLOC>::track_aligned &users, 
           const FieldMask &check_mask, const FieldMask &open_below,
-          bool validates_regions, Operation *to_skip = NULL, 
-          GenerationID skip_gen = 0);
+          bool validates_regions, Operation *to_skip = NULL,
+          GenerationID skip_gen = 0, LogicalUserIndex<ALLOC> *index = NULL);
+      template<bool RECORD, bool TRACK_DOM>
+      static inline bool check_logical_user(const LogicalUser &user,
+          LogicalUser &prev_user, const FieldMask &user_check_mask,
+          bool validates_regions, bool tracing,
+          FieldMask &dominator_mask, FieldMask &observed_mask);
       template<AllocationType ALLOC>
       static void perform_closing_checks(LogicalCloser &closer, bool read_only,
           typename LegionList<LogicalUser, ALLOC>::track_aligned &users, 
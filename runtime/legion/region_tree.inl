@@ -2980,6 +2980,68 @@ namespace Legion {
       return complete;
     }
 
+    //--------------------------------------------------------------------------
+    template<int DIM, typename T>
+    bool IndexPartNodeT<DIM,T>::find_aliased_children(LegionColor &c1,
+                                                      LegionColor &c2)
+    //--------------------------------------------------------------------------
+    {
+      // Gather up all the rectangles of all the children, for sparse
+      // children this will be all the rectangles in their sparsity maps
+      std::vector<Realm::Rect<DIM,T> > rects;
+      std::vector<LegionColor> rect_colors;
+      for (LegionColor color = 0; color < max_linearized_color; color++)
+      {
+        if ((total_children != max_linearized_color) &&
+            !color_space->contains_color(color))
+          continue;
+        IndexSpaceNodeT<DIM,T> *child = 
+          static_cast<IndexSpaceNodeT<DIM,T>*>(get_child(color));
+        Realm::IndexSpace<DIM,T> child_space;
+        ApEvent ready = child->get_realm_index_space(child_space,true/*tight*/);
+        if (!ready.has_triggered())
+          ready.wait();
+        for (Realm::IndexSpaceIterator<DIM,T> itr(child_space); 
+              itr.valid; itr.step())
+        {
+          rects.push_back(itr.rect);
+          rect_colors.push_back(color);
+        }
+      }
+      // Sort the rectangles by their lower bound in the first dimension
+      std::vector<std::pair<T,unsigned> > order(rects.size());
+      for (unsigned idx = 0; idx < rects.size(); idx++)
+        order[idx] = std::pair<T,unsigned>(rects[idx].lo[0], idx);
+      std::sort(order.begin(), order.end());
+      // Then sweep along the first dimension keeping track of the active
+      // rectangles ordered by their upper bound so that we only have to
+      // test rectangles that overlap in the first dimension
+      std::multimap<T,unsigned> active;
+      for (typename std::vector<std::pair<T,unsigned> >::const_iterator it =
+            order.begin(); it != order.end(); it++)
+      {
+        // Retire any rectangles that end before this one starts
+        while (!active.empty() && (active.begin()->first < it->first))
+          active.erase(active.begin());
+        const Realm::Rect<DIM,T> &rect = rects[it->second];
+        for (typename std::multimap<T,unsigned>::const_iterator ait = 
+              active.begin(); ait != active.end(); ait++)
+        {
+          // Rectangles from the same child never overlap
+          if (rect_colors[ait->second] == rect_colors[it->second])
+            continue;
+          if (!rect.overlaps(rects[ait->second]))
+            continue;
+          // Found our first overlap so we are done
+          c1 = rect_colors[ait->second];
+          c2 = rect_colors[it->second];
+          return true;
+        }
+        active.insert(std::pair<T,unsigned>(rect.hi[0], it->second));
+      }
+      return false;
+    }
+
     //--------------------------------------------------------------------------
     template<int DIM, typename T>
     bool IndexPartNodeT<DIM,T>::intersects_with(IndexSpaceNode *rhs, 
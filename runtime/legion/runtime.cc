@@ -45,6 +45,7 @@
 #include "mappers/debug_mapper.h"
 
 #include <unistd.h> // sleep for warnings
+#include <algorithm>
 
 #define REPORT_DUMMY_CONTEXT(message)                        \
   REPORT_LEGION_ERROR(ERROR_DUMMY_CONTEXT_OPERATION,  message)
@@ -3209,7 +3210,8 @@ namespace Legion {
     MemoryManager::MemoryManager(Memory m, Runtime *rt)
       : memory(m), owner_space(m.address_space()), 
         is_owner(m.address_space() == rt->address_space),
-        capacity(m.capacity()), remaining_capacity(capacity), runtime(rt)
+        capacity(m.capacity()), remaining_capacity(capacity), runtime(rt),
+        use_clock(0)
     //--------------------------------------------------------------------------
     {
     }
@@ -3277,7 +3279,7 @@ namespace Legion {
         {
           for (std::vector<PhysicalManager*>::const_iterator it = 
                 to_remove.begin(); it != to_remove.end(); it++)
-            current_instances.erase(*it);
+            erase_current_instance(*it);
         }
       }
       for (std::map<PhysicalManager*,RtEvent>::const_iterator it = 
@@ -3318,7 +3320,7 @@ namespace Legion {
 #endif
       // Make it valid to start since we know when we were created
       // that we were made valid to begin with
-      InstanceInfo &info = current_instances[manager];
+      InstanceInfo &info = record_current_instance(manager);
       info.instance_size = inst_size;
     }
 
@@ -3330,7 +3332,7 @@ namespace Legion {
  #ifdef DEBUG_LEGION
       assert(current_instances.find(manager) != current_instances.end());
 #endif     
-      current_instances.erase(manager);
+      erase_current_instance(manager);
     }
 
     //--------------------------------------------------------------------------
@@ -3349,6 +3351,7 @@ namespace Legion {
              (finder->second.current_state == PENDING_ACQUIRE_STATE) ||
              (finder->second.current_state == VALID_STATE));
 #endif
+      record_instance_use(finder->second);
       if (finder->second.current_state == COLLECTABLE_STATE)
         finder->second.current_state = ACTIVE_STATE;
       // Otherwise stay in our current state
@@ -3388,7 +3391,7 @@ namespace Legion {
 #endif
           Runtime::trigger_event(info.deferred_collect);
           // Now we can delete our entry because it has been deleted
-          current_instances.erase(finder);
+          erase_current_instance(manager);
           remove_reference = true;
         }
         else if (finder->second.current_state == PENDING_ACQUIRE_STATE)
@@ -3404,10 +3407,14 @@ namespace Legion {
           // currently allow the mappers to reuse them
           perform_deletion = true;
           remove_reference = true;
-          current_instances.erase(finder);
+          erase_current_instance(manager);
         }
         else // didn't collect it yet
+        {
           info.current_state = COLLECTABLE_STATE;
+          // The last user just finished so that's our recency
+          record_instance_use(info);
+        }
       }
       if (perform_deletion)
         manager->perform_deletion(RtEvent::NO_RT_EVENT);
@@ -3488,6 +3495,7 @@ namespace Legion {
 #endif
       finder->second.current_state = PENDING_ACQUIRE_STATE;
       finder->second.pending_acquires++;
+      record_instance_use(finder->second);
       return true;
     }
 
@@ -3935,7 +3943,7 @@ namespace Legion {
         {
           for (std::vector<PhysicalManager*>::const_iterator it = 
                 to_remove.begin(); it != to_remove.end(); it++)
-            current_instances.erase(*it);
+            erase_current_instance(*it);
         }
       }
       for (std::map<PhysicalManager*,std::pair<RtEvent,bool> >::
@@ -4540,7 +4548,7 @@ namespace Legion {
           std::map<PhysicalManager*,InstanceInfo>::const_iterator finder = 
             current_instances.find(manager);
           if (finder == current_instances.end())
-            current_instances[manager] = InstanceInfo();
+            record_current_instance(manager);
           if (created && min_priority)
           {
             std::pair<MapperID,Processor> key(mapper_id,processor);
@@ -4577,7 +4585,7 @@ namespace Legion {
           std::map<PhysicalManager*,InstanceInfo>::const_iterator finder = 
             current_instances.find(manager);
           if (finder == current_instances.end())
-            current_instances[manager] = InstanceInfo();
+            record_current_instance(manager);
           if (min_priority)
           {
             InstanceInfo &info = current_instances[manager];
@@ -4800,23 +4808,20 @@ namespace Legion {
                                 bool tight_region_bounds, bool remote)
     //--------------------------------------------------------------------------
     {
+      // Only instances made for an ancestor of the regions can satisfy them
+      std::vector<RegionNode*> ancestors;
+      find_region_ancestors(regions, ancestors);
       // Hold the lock while iterating here
       std::deque<PhysicalManager*> candidates;
       {
         AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
+        std::vector<PhysicalManager*> matches;
+        find_region_candidates(ancestors, false/*valid only*/, matches);
+        for (std::vector<PhysicalManager*>::const_iterator it = 
+              matches.begin(); it != matches.end(); it++)
         {
-          // Skip it if has already been collected
-          if (it->second.current_state == PENDING_COLLECTED_STATE)
-            continue;
-          // Skip any unattached external instances too
-          if (it->second.unattached_external)
-            continue;
-          if (!it->first->meets_region_tree(regions))
-            continue;
-          it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
-          candidates.push_back(it->first);
+          (*it)->add_base_resource_ref(MEMORY_MANAGER_REF);
+          candidates.push_back(*it);
         }
       }
       // If we have any candidates check their constraints
@@ -4853,23 +4858,20 @@ namespace Legion {
                                       bool tight_region_bounds, bool remote)
     //--------------------------------------------------------------------------
     {
+      // Only instances made for an ancestor of the regions can satisfy them
+      std::vector<RegionNode*> ancestors;
+      find_region_ancestors(regions, ancestors);
       // Hold the lock while iterating here
       std::deque<PhysicalManager*> candidates;
       {
         AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
+        std::vector<PhysicalManager*> matches;
+        find_region_candidates(ancestors, false/*valid only*/, matches);
+        for (std::vector<PhysicalManager*>::const_iterator it = 
+              matches.begin(); it != matches.end(); it++)
         {
-          // Skip it if has already been collected
-          if (it->second.current_state == PENDING_COLLECTED_STATE)
-            continue;
-          // Skip any unattached external instances too
-          if (it->second.unattached_external)
-            continue;
-          if (!it->first->meets_region_tree(regions))
-            continue;
-          it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
-          candidates.push_back(it->first);
+          (*it)->add_base_resource_ref(MEMORY_MANAGER_REF);
+          candidates.push_back(*it);
         }
       }
       // If we have any candidates check their constraints
@@ -4908,22 +4910,19 @@ namespace Legion {
                                 bool acquire, bool tight_bounds, bool remote)
     //--------------------------------------------------------------------------
     {
+      // Only instances made for an ancestor of the regions can satisfy them
+      std::vector<RegionNode*> ancestors;
+      find_region_ancestors(regions, ancestors);
       // Hold the lock while iterating here
       {
         AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
+        std::vector<PhysicalManager*> matches;
+        find_region_candidates(ancestors, false/*valid only*/, matches);
+        for (std::vector<PhysicalManager*>::const_iterator it = 
+              matches.begin(); it != matches.end(); it++)
         {
-          // Skip it if has already been collected
-          if (it->second.current_state == PENDING_COLLECTED_STATE)
-            continue;
-          // Skip any unattached external instances too
-          if (it->second.unattached_external)
-            continue;
-          if (!it->first->meets_region_tree(regions))
-            continue;
-          it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
-          candidates.insert(it->first);
+          (*it)->add_base_resource_ref(MEMORY_MANAGER_REF);
+          candidates.insert(*it);
         }
       }
       // If we have any candidates check their constraints
@@ -4958,22 +4957,15 @@ namespace Legion {
                                   bool acquire, bool tight_bounds, bool remote)
     //--------------------------------------------------------------------------
     {
+      // Only instances made for an ancestor of the regions can satisfy them
+      std::vector<RegionNode*> ancestors;
+      find_region_ancestors(regions, ancestors);
       // Hold the lock while iterating here
       {
         AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
-        {
-          // Skip it if has already been collected
-          if (it->second.current_state == PENDING_COLLECTED_STATE)
-            continue;
-          // Skip any unattached external instances too
-          if (it->second.unattached_external)
-            continue;
-          if (!it->first->meets_region_tree(regions))
-            continue;
-          candidates.insert(it->first);
-        }
+        std::vector<PhysicalManager*> matches;
+        find_region_candidates(ancestors, false/*valid only*/, matches);
+        candidates.insert(matches.begin(), matches.end());
       }
       // If we have any candidates check their constraints
       if (!candidates.empty())
@@ -5008,21 +5000,20 @@ namespace Legion {
                                      bool tight_region_bounds, bool remote)
     //--------------------------------------------------------------------------
     {
+      // Only instances made for an ancestor of the regions can satisfy them
+      std::vector<RegionNode*> ancestors;
+      find_region_ancestors(regions, ancestors);
       // Hold the lock while iterating here
       std::deque<PhysicalManager*> candidates;
       {
         AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
+        std::vector<PhysicalManager*> matches;
+        find_region_candidates(ancestors, true/*valid only*/, matches);
+        for (std::vector<PhysicalManager*>::const_iterator it = 
+              matches.begin(); it != matches.end(); it++)
         {
-          // Only consider ones that are currently valid
-          if (it->second.current_state != VALID_STATE)
-            continue;
-          // Skip any unattached external instances too
-          if (it->second.unattached_external)
-            continue;
-          it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
-          candidates.push_back(it->first);
+          (*it)->add_base_resource_ref(MEMORY_MANAGER_REF);
+          candidates.push_back(*it);
         }
       }
       // If we have any candidates check their constraints
@@ -5060,21 +5051,20 @@ namespace Legion {
                                      bool tight_region_bounds, bool remote)
     //--------------------------------------------------------------------------
     {
+      // Only instances made for an ancestor of the regions can satisfy them
+      std::vector<RegionNode*> ancestors;
+      find_region_ancestors(regions, ancestors);
       // Hold the lock while iterating here
       std::deque<PhysicalManager*> candidates;
       {
         AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
+        std::vector<PhysicalManager*> matches;
+        find_region_candidates(ancestors, true/*valid only*/, matches);
+        for (std::vector<PhysicalManager*>::const_iterator it = 
+              matches.begin(); it != matches.end(); it++)
         {
-          // Only consider ones that are currently valid
-          if (it->second.current_state != VALID_STATE)
-            continue;
-          // Skip any unattached external instances too
-          if (it->second.unattached_external)
-            continue;
-          it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
-          candidates.push_back(it->first);
+          (*it)->add_base_resource_ref(MEMORY_MANAGER_REF);
+          candidates.push_back(*it);
         }
       }
       // If we have any candidates check their constraints
@@ -5130,6 +5120,100 @@ namespace Legion {
       }
     }
 
+    //--------------------------------------------------------------------------
+    void MemoryManager::find_region_ancestors(
+                                      const std::vector<LogicalRegion> &regions,
+                                      std::vector<RegionNode*> &ancestors) const
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(!regions.empty());
+#endif
+      // Any instance that can satisfy all the regions must have been
+      // made for an ancestor of the first region so walk up from there
+      // Do this before taking the manager lock since getting the node
+      // might require us to wait for it to be made
+      RegionNode *node = runtime->forest->get_node(regions.front());
+      while (node != NULL)
+      {
+        ancestors.push_back(node);
+        if (node->parent == NULL)
+          break;
+        node = node->parent->parent;
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void MemoryManager::find_region_candidates(
+                                   const std::vector<RegionNode*> &ancestors,
+                                   bool valid_only,
+                                   std::vector<PhysicalManager*> &matches) const
+    //--------------------------------------------------------------------------
+    {
+      // Must be holding the manager lock when calling this
+      // Visit the instances from the closest ancestor to the root
+      // so that we find the tightest instances first
+      for (std::vector<RegionNode*>::const_iterator ait = 
+            ancestors.begin(); ait != ancestors.end(); ait++)
+      {
+        std::map<RegionNode*,std::set<PhysicalManager*> >::const_iterator
+          region_finder = region_instances.find(*ait);
+        if (region_finder == region_instances.end())
+          continue;
+        for (std::set<PhysicalManager*>::const_iterator it = 
+              region_finder->second.begin(); it != 
+              region_finder->second.end(); it++)
+        {
+          std::map<PhysicalManager*,InstanceInfo>::const_iterator finder = 
+            current_instances.find(*it);
+#ifdef DEBUG_LEGION
+          assert(finder != current_instances.end());
+#endif
+          if (valid_only)
+          {
+            // Only consider ones that are currently valid
+            if (finder->second.current_state != VALID_STATE)
+              continue;
+          }
+          // Skip it if has already been collected
+          else if (finder->second.current_state == PENDING_COLLECTED_STATE)
+            continue;
+          // Skip any unattached external instances too
+          if (finder->second.unattached_external)
+            continue;
+          matches.push_back(*it);
+        }
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    MemoryManager::InstanceInfo& MemoryManager::record_current_instance(
+                                                      PhysicalManager *manager)
+    //--------------------------------------------------------------------------
+    {
+      // Must be holding the manager lock when calling this
+      region_instances[manager->region_node].insert(manager);
+      InstanceInfo &info = current_instances[manager];
+      record_instance_use(info);
+      return info;
+    }
+
+    //--------------------------------------------------------------------------
+    void MemoryManager::erase_current_instance(PhysicalManager *manager)
+    //--------------------------------------------------------------------------
+    {
+      // Must be holding the manager lock when calling this
+      std::map<RegionNode*,std::set<PhysicalManager*> >::iterator finder = 
+        region_instances.find(manager->region_node);
+#ifdef DEBUG_LEGION
+      assert(finder != region_instances.end());
+#endif
+      finder->second.erase(manager);
+      if (finder->second.empty())
+        region_instances.erase(finder);
+      current_instances.erase(manager);
+    }
+
     //--------------------------------------------------------------------------
     PhysicalManager* MemoryManager::allocate_physical_instance(
                                       const LayoutConstraintSet &constraints,
@@ -5216,9 +5300,12 @@ namespace Legion {
       // to avoid races with deletions
       bool early_valid = acquire || (priority == GC_NEVER_PRIORITY);
       size_t instance_size = manager->get_instance_size();
+      const uintptr_t base_address = find_base_address(manager);
       // Since we're going to put this in the table add a reference
       if (is_owner)
         manager->add_base_resource_ref(MEMORY_MANAGER_REF);
+      std::vector<RegionNode*> ancestors;
+      find_region_ancestors(regions, ancestors);
       PhysicalManager *alternate = NULL;
       do
       {
@@ -5253,25 +5340,18 @@ namespace Legion {
 #endif
         AutoLock m_lock(manager_lock);
         // Find our candidates
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
+        std::vector<PhysicalManager*> matches;
+        find_region_candidates(ancestors, false/*valid only*/, matches);
+        for (std::vector<PhysicalManager*>::const_iterator it = 
+              matches.begin(); it != matches.end(); it++)
         {
-          // Skip it if has already been collected
-          if (it->second.current_state == PENDING_COLLECTED_STATE)
-            continue;
-          // Skip any unattached external instances too
-          if (it->second.unattached_external)
-            continue;
           // If we already considered it we don't have to do it again
-          if (candidates.find(it->first) != candidates.end())
-            continue;
-          // Check if the region trees are the same
-          if (!it->first->meets_region_tree(regions))
+          if (candidates.find(*it) != candidates.end())
             continue;
           // We found an alternate candidate so break out so we can test it
-          it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
-          candidates.insert(it->first);
-          alternate = it->first;
+          (*it)->add_base_resource_ref(MEMORY_MANAGER_REF);
+          candidates.insert(*it);
+          alternate = *it;
           // We found an alternate so we can break out
           break;
         }
@@ -5283,11 +5363,12 @@ namespace Legion {
 #ifdef DEBUG_LEGION
         assert(current_instances.find(manager) == current_instances.end());
 #endif
-        InstanceInfo &info = current_instances[manager];
+        InstanceInfo &info = record_current_instance(manager);
         if (early_valid)
           info.current_state = VALID_STATE;
         info.min_priority = priority;
         info.instance_size = instance_size;
+        info.base_address = base_address;
         info.mapper_priorities[
           std::pair<MapperID,Processor>(mapper_id,proc)] = priority;
         // Break out because we are done
@@ -5327,9 +5408,12 @@ namespace Legion {
       // to avoid races with deletions
       bool early_valid = acquire || (priority == GC_NEVER_PRIORITY);
       size_t instance_size = manager->get_instance_size();
+      const uintptr_t base_address = find_base_address(manager);
       // Since we're going to put this in the table add a reference
       if (is_owner)
         manager->add_base_resource_ref(MEMORY_MANAGER_REF);
+      std::vector<RegionNode*> ancestors;
+      find_region_ancestors(regions, ancestors);
       PhysicalManager *alternate = NULL;
       do
       {
@@ -5364,25 +5448,18 @@ namespace Legion {
 #endif
         AutoLock m_lock(manager_lock);
         // Find our candidates
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
+        std::vector<PhysicalManager*> matches;
+        find_region_candidates(ancestors, false/*valid only*/, matches);
+        for (std::vector<PhysicalManager*>::const_iterator it = 
+              matches.begin(); it != matches.end(); it++)
         {
-          // Skip it if has already been collected
-          if (it->second.current_state == PENDING_COLLECTED_STATE)
-            continue;
-          // Skip any unattached external instances too
-          if (it->second.unattached_external)
-            continue;
           // If we already considered it we don't have to do it again
-          if (candidates.find(it->first) != candidates.end())
-            continue;
-          // Check if the region trees are the same
-          if (!it->first->meets_region_tree(regions))
+          if (candidates.find(*it) != candidates.end())
             continue;
           // We found an alternate candidate so break out so we can test it
-          it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
-          candidates.insert(it->first);
-          alternate = it->first;
+          (*it)->add_base_resource_ref(MEMORY_MANAGER_REF);
+          candidates.insert(*it);
+          alternate = *it;
           // We found an alternate so we can break out
           break;
         }
@@ -5394,11 +5471,12 @@ namespace Legion {
 #ifdef DEBUG_LEGION
         assert(current_instances.find(manager) == current_instances.end());
 #endif
-        InstanceInfo &info = current_instances[manager];
+        InstanceInfo &info = record_current_instance(manager);
         if (early_valid)
           info.current_state = VALID_STATE;
         info.min_priority = priority;
         info.instance_size = instance_size;
+        info.base_address = base_address;
         info.mapper_priorities[
           std::pair<MapperID,Processor>(mapper_id,proc)] = priority;
         // Break out because we are done
@@ -5433,6 +5511,7 @@ namespace Legion {
       // to avoid races with deletions
       bool early_valid = acquire || (priority == GC_NEVER_PRIORITY);
       size_t instance_size = manager->get_instance_size();
+      const uintptr_t base_address = find_base_address(manager);
       // Since we're going to put this in the table add a reference
       manager->add_base_resource_ref(MEMORY_MANAGER_REF);
       {
@@ -5440,11 +5519,12 @@ namespace Legion {
 #ifdef DEBUG_LEGION
         assert(current_instances.find(manager) == current_instances.end());
 #endif
-        InstanceInfo &info = current_instances[manager];
+        InstanceInfo &info = record_current_instance(manager);
         if (early_valid)
           info.current_state = VALID_STATE;
         info.min_priority = priority;
         info.instance_size = instance_size;
+        info.base_address = base_address;
         info.mapper_priorities[
           std::pair<MapperID,Processor>(mapper_id,p)] = priority;
       }
@@ -5479,7 +5559,7 @@ namespace Legion {
 #ifdef DEBUG_LEGION
         assert(current_instances.find(manager) == current_instances.end());
 #endif
-        InstanceInfo &info = current_instances[manager];
+        InstanceInfo &info = record_current_instance(manager);
         info.instance_size = instance_size;
         info.unattached_external = true;
       }
@@ -5509,36 +5589,20 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       bool pass_complete = true;
-      size_t total_deleted = 0;
       std::map<PhysicalManager*,RtEvent> to_delete;
       {
         AutoLock m_lock(manager_lock);
+        std::vector<PhysicalManager*> victims;
+        pass_complete = 
+          select_victims(needed_size, state, larger_only, victims);
         if (state == COLLECTABLE_STATE)
         {
-          for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-                current_instances.begin(); it != current_instances.end(); it++)
-          {
-            if (it->second.current_state != COLLECTABLE_STATE)
-              continue;
-            const size_t inst_size = it->first->get_instance_size();
-            if ((inst_size >= needed_size) || !larger_only)
-            {
-              // Resource references will flow out
-              to_delete[it->first] = RtEvent::NO_RT_EVENT;
-              total_deleted += inst_size;
-              if (total_deleted >= needed_size)
-              {
-                // If we exit early we are not done with this pass
-                pass_complete = false;
-                break;
-              }
-            }
-          }
-          if (!to_delete.empty())
+          for (std::vector<PhysicalManager*>::const_iterator it = 
+                victims.begin(); it != victims.end(); it++)
           {
-            for (std::map<PhysicalManager*,RtEvent>::const_iterator it = 
-                  to_delete.begin(); it != to_delete.end(); it++)
-              current_instances.erase(it->first);
+            // Resource references will flow out
+            to_delete[*it] = RtEvent::NO_RT_EVENT;
+            erase_current_instance(*it);
           }
         }
         else
@@ -5546,29 +5610,21 @@ namespace Legion {
 #ifdef DEBUG_LEGION
           assert(state == ACTIVE_STATE);
 #endif
-          for (std::map<PhysicalManager*,InstanceInfo>::iterator it = 
-                current_instances.begin(); it != current_instances.end(); it++)
+          for (std::vector<PhysicalManager*>::const_iterator it = 
+                victims.begin(); it != victims.end(); it++)
           {
-            if (it->second.current_state != ACTIVE_STATE)
-              continue;
-            const size_t inst_size = it->first->get_instance_size();
-            if ((inst_size >= needed_size) || !larger_only)
-            {
-              RtUserEvent deferred_collect = Runtime::create_rt_user_event();
-              to_delete[it->first] = deferred_collect;
-              // Add our own reference here as this flows out
-              it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
-              // Update the state information
-              it->second.current_state = PENDING_COLLECTED_STATE;
-              it->second.deferred_collect = deferred_collect;
-              total_deleted += inst_size;
-              if (total_deleted >= needed_size)
-              {
-                // If we exit early we are not done with this pass
-                pass_complete = false;
-                break;
-              }
-            }
+            std::map<PhysicalManager*,InstanceInfo>::iterator finder = 
+              current_instances.find(*it);
+#ifdef DEBUG_LEGION
+            assert(finder != current_instances.end());
+#endif
+            RtUserEvent deferred_collect = Runtime::create_rt_user_event();
+            to_delete[*it] = deferred_collect;
+            // Add our own reference here as this flows out
+            (*it)->add_base_resource_ref(MEMORY_MANAGER_REF);
+            // Update the state information
+            finder->second.current_state = PENDING_COLLECTED_STATE;
+            finder->second.deferred_collect = deferred_collect;
           }
         }
       }
@@ -5587,6 +5643,147 @@ namespace Legion {
       return pass_complete;
     }
 
+    //--------------------------------------------------------------------------
+    uintptr_t MemoryManager::find_base_address(PhysicalManager *manager) const
+    //--------------------------------------------------------------------------
+    {
+      // External instances don't come out of the memory's allocator so
+      // deleting them never opens up any space for new instances
+      if (manager->is_external_instance())
+        return 0;
+      // We only ask for instances made on this node so the metadata is
+      // already here, for memories without direct pointers this is NULL
+      return reinterpret_cast<uintptr_t>(
+          manager->get_instance().pointer_untyped(0, 0));
+    }
+
+    //--------------------------------------------------------------------------
+    bool MemoryManager::select_victims(const size_t needed_size,
+                                       InstanceState state, bool larger_only,
+                                  std::vector<PhysicalManager*> &victims) const
+    //--------------------------------------------------------------------------
+    {
+      // Must be holding the manager lock when calling this
+      std::vector<VictimCandidate> candidates;
+      for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
+            current_instances.begin(); it != current_instances.end(); it++)
+      {
+        if (it->second.current_state != state)
+          continue;
+        if (larger_only && (it->first->get_instance_size() < needed_size))
+          continue;
+        candidates.push_back(VictimCandidate(it->first, it->second));
+      }
+      // If there is nothing left to delete then this pass is done
+      if (candidates.empty())
+        return true;
+      std::sort(candidates.begin(), candidates.end());
+      // Any one of the large instances is enough by itself, so take
+      // the one the mappers care about least
+      if (larger_only)
+      {
+        victims.push_back(candidates.front().manager);
+        return false;
+      }
+      // See if we can find a set of instances that sit next to each other
+      // and would leave a big enough hole, otherwise the memory will just
+      // be left fragmented and we'll delete more than we need to
+      if (select_contiguous_victims(needed_size, candidates, victims))
+        return false;
+      // Otherwise delete instances in rank order until we have freed up
+      // enough space in total and then try again
+      size_t total_deleted = 0;
+      for (std::vector<VictimCandidate>::const_iterator it = 
+            candidates.begin(); it != candidates.end(); it++)
+      {
+        victims.push_back(it->manager);
+        total_deleted += it->manager->get_instance_size();
+        // If we exit early we are not done with this pass
+        if (total_deleted >= needed_size)
+          return false;
+      }
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    bool MemoryManager::select_contiguous_victims(const size_t needed_size,
+                                 const std::vector<VictimCandidate> &candidates,
+                                  std::vector<PhysicalManager*> &victims) const
+    //--------------------------------------------------------------------------
+    {
+      // Must be holding the manager lock when calling this
+      std::map<PhysicalManager*,unsigned> ranks;
+      for (unsigned idx = 0; idx < candidates.size(); idx++)
+        ranks[candidates[idx].manager] = idx;
+      // Lay out all the instances we know the location of in address 
+      // order, anything in between two of them is already free
+      std::map<uintptr_t,PhysicalManager*> layout;
+      for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
+            current_instances.begin(); it != current_instances.end(); it++)
+      {
+        if (it->second.base_address == 0)
+          continue;
+        layout[it->second.base_address] = it->first;
+      }
+      if (layout.empty())
+        return false;
+      std::vector<uintptr_t> starts, ends;
+      std::vector<int> order; // rank of each instance or -1 if not a victim
+      starts.reserve(layout.size());
+      ends.reserve(layout.size());
+      order.reserve(layout.size());
+      for (std::map<uintptr_t,PhysicalManager*>::const_iterator it = 
+            layout.begin(); it != layout.end(); it++)
+      {
+        starts.push_back(it->first);
+        ends.push_back(it->first + it->second->get_instance_size());
+        std::map<PhysicalManager*,unsigned>::const_iterator finder = 
+          ranks.find(it->second);
+        order.push_back((finder == ranks.end()) ? -1 : int(finder->second));
+      }
+      // Look for the run of adjacent candidates that makes a big enough
+      // hole with the fewest deletions, breaking ties by preferring the
+      // run whose candidates rank best overall
+      const unsigned total = starts.size();
+      unsigned best_first = 0, best_count = 0, best_score = 0;
+      for (unsigned first = 0; first < total; first++)
+      {
+        if (order[first] < 0)
+          continue;
+        // The hole starts where the previous instance ends
+        const uintptr_t hole_start = (first > 0) ? ends[first-1] : 
+                                                    starts[first];
+        unsigned score = 0;
+        for (unsigned last = first; last < total; last++)
+        {
+          if (order[last] < 0)
+            break;
+          const unsigned count = last - first + 1;
+          if ((best_count > 0) && (count > best_count))
+            break;
+          score += order[last];
+          // The hole ends where the next instance begins
+          const uintptr_t hole_end = ((last+1) < total) ? starts[last+1] :
+                                                           ends[last];
+          if ((hole_end - hole_start) < needed_size)
+            continue;
+          if ((best_count == 0) || (count < best_count) || 
+              (score < best_score))
+          {
+            best_first = first;
+            best_count = count;
+            best_score = score;
+          }
+          break;
+        }
+      }
+      if (best_count == 0)
+        return false;
+      for (unsigned idx = best_first; idx < (best_first + best_count); idx++)
+        victims.push_back(layout[starts[idx]]);
+      return true;
+    }
+
     //--------------------------------------------------------------------------
     RtEvent MemoryManager::detach_external_instance(PhysicalManager *manager)
     //--------------------------------------------------------------------------
@@ -5629,7 +5826,7 @@ namespace Legion {
           manager->add_base_resource_ref(MEMORY_MANAGER_REF);
         }
         else // Reference will flow out
-          current_instances.erase(finder);
+          erase_current_instance(manager);
       }
       // Perform the deletion contingent on references being removed
       manager->perform_deletion(deferred_collect);
@@ -8646,6 +8843,13 @@ namespace Legion {
       return true;
     }
 
+    //--------------------------------------------------------------------------
+    bool IdentityProjectionFunctor::is_functional(void) const
+    //--------------------------------------------------------------------------
+    {
+      return true;
+    }
+
     //--------------------------------------------------------------------------
     unsigned IdentityProjectionFunctor::get_depth(void) const
     //--------------------------------------------------------------------------
@@ -8661,7 +8865,8 @@ namespace Legion {
     ProjectionFunction::ProjectionFunction(ProjectionID pid, 
                                            ProjectionFunctor *func)
       : depth(func->get_depth()), is_exclusive(func->is_exclusive()),
-        projection_id(pid), functor(func)
+        is_functional(func->is_functional()), projection_id(pid), 
+        functor(func), memoized_points(0)
     //--------------------------------------------------------------------------
     {
     }
@@ -8669,7 +8874,8 @@ namespace Legion {
     //--------------------------------------------------------------------------
     ProjectionFunction::ProjectionFunction(const ProjectionFunction &rhs)
       : depth(rhs.depth), is_exclusive(rhs.is_exclusive), 
-        projection_id(rhs.projection_id), functor(rhs.functor)
+        is_functional(rhs.is_functional), projection_id(rhs.projection_id), 
+        functor(rhs.functor), memoized_points(0)
     //--------------------------------------------------------------------------
     {
       // should never be called
@@ -8736,10 +8942,12 @@ namespace Legion {
     }
 
     //--------------------------------------------------------------------------
-    void ProjectionFunction::project_points(const RegionRequirement &req, 
-     unsigned idx, Runtime *runtime, const std::vector<PointTask*> &point_tasks)
+    void ProjectionFunction::project_points(SliceTask *slice, unsigned idx,
+                       Runtime *runtime, const Domain &launch_domain,
+                       const std::vector<PointTask*> &point_tasks)
     //--------------------------------------------------------------------------
     {
+      const RegionRequirement &req = slice->regions[idx];
 #ifdef DEBUG_LEGION
       assert(req.handle_type != SINGULAR);
 #endif
@@ -8757,6 +8965,32 @@ namespace Legion {
         return;
       }
 
+      if (is_functional)
+      {
+        std::vector<LogicalRegion> results;
+        if (!find_memoized_results(req, launch_domain, results))
+        {
+          project_domain(slice, idx, req, launch_domain, results);
+          for (std::vector<LogicalRegion>::const_iterator it = 
+                results.begin(); it != results.end(); it++)
+          {
+            if (req.handle_type == PART_PROJECTION)
+              check_projection_partition_result(req, 
+                  static_cast<Task*>(slice), idx, *it, runtime);
+            else
+              check_projection_region_result(req, 
+                  static_cast<Task*>(slice), idx, *it, runtime);
+          }
+          memoize_results(req, launch_domain, results);
+        }
+#ifdef DEBUG_LEGION
+        assert(results.size() == point_tasks.size());
+#endif
+        for (unsigned pidx = 0; pidx < point_tasks.size(); pidx++)
+          point_tasks[pidx]->set_projection_result(idx, results[pidx]);
+        return;
+      }
+
       if (!is_exclusive)
       {
         AutoLock p_lock(projection_reservation);
@@ -8817,6 +9051,7 @@ namespace Legion {
     //--------------------------------------------------------------------------
     void ProjectionFunction::project_points(Operation *op, unsigned idx,
                          const RegionRequirement &req, Runtime *runtime, 
+                         const Domain &launch_domain,
                          const std::vector<ProjectionPoint*> &points)
     //--------------------------------------------------------------------------
     {
@@ -8839,6 +9074,30 @@ namespace Legion {
         return;
       }
 
+      if (is_functional)
+      {
+        std::vector<LogicalRegion> results;
+        if (!find_memoized_results(req, launch_domain, results))
+        {
+          project_domain(mappable, idx, req, launch_domain, results);
+          for (std::vector<LogicalRegion>::const_iterator it = 
+                results.begin(); it != results.end(); it++)
+          {
+            if (req.handle_type == PART_PROJECTION)
+              check_projection_partition_result(req, op, idx, *it, runtime);
+            else
+              check_projection_region_result(req, op, idx, *it, runtime);
+          }
+          memoize_results(req, launch_domain, results);
+        }
+#ifdef DEBUG_LEGION
+        assert(results.size() == points.size());
+#endif
+        for (unsigned pidx = 0; pidx < points.size(); pidx++)
+          points[pidx]->set_projection_result(idx, results[pidx]);
+        return;
+      }
+
       if (!is_exclusive)
       {
         AutoLock p_lock(projection_reservation);
@@ -8892,6 +9151,98 @@ namespace Legion {
       }
     }
 
+    //--------------------------------------------------------------------------
+    void ProjectionFunction::project_domain(const Mappable *mappable,
+                  unsigned idx, const RegionRequirement &req,
+                  const Domain &launch_domain, 
+                  std::vector<LogicalRegion> &results)
+    //--------------------------------------------------------------------------
+    {
+      if (!is_exclusive)
+      {
+        AutoLock p_lock(projection_reservation);
+        if (req.handle_type == PART_PROJECTION)
+          functor->project_domain(mappable, idx, req.partition, 
+                                  launch_domain, results);
+        else
+          functor->project_domain(mappable, idx, req.region,
+                                  launch_domain, results);
+      }
+      else
+      {
+        if (req.handle_type == PART_PROJECTION)
+          functor->project_domain(mappable, idx, req.partition, 
+                                  launch_domain, results);
+        else
+          functor->project_domain(mappable, idx, req.region,
+                                  launch_domain, results);
+      }
+      if (results.size() != launch_domain.get_volume())
+        REPORT_LEGION_ERROR(ERROR_INVALID_PROJECTION_RESULT,
+            "Projection functor %d produced %zd results for region "
+            "requirement %d of a launch domain with %zd points",
+            projection_id, results.size(), idx, launch_domain.get_volume())
+    }
+
+    //--------------------------------------------------------------------------
+    bool ProjectionFunction::find_memoized_results(
+                   const RegionRequirement &req, const Domain &launch_domain,
+                   std::vector<LogicalRegion> &results)
+    //--------------------------------------------------------------------------
+    {
+      // Sparse domains name a Realm index space that can be destroyed
+      // so only dense launch domains are safe to use as keys
+      if (!launch_domain.dense())
+        return false;
+      const MemoKey key(req, launch_domain);
+      AutoLock m_lock(memo_lock,1,false/*exclusive*/);
+      std::map<MemoKey,std::vector<LogicalRegion> >::const_iterator finder =
+        memoized_results.find(key);
+      if (finder == memoized_results.end())
+        return false;
+      results = finder->second;
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    void ProjectionFunction::memoize_results(const RegionRequirement &req,
+                                             const Domain &launch_domain,
+                                   const std::vector<LogicalRegion> &results)
+    //--------------------------------------------------------------------------
+    {
+      if (!launch_domain.dense() || 
+          (results.size() > DEFAULT_MAX_PROJECTION_MEMO_POINTS))
+        return;
+      const MemoKey key(req, launch_domain);
+      AutoLock m_lock(memo_lock);
+      // Someone else might have beaten us to it
+      if (memoized_results.find(key) != memoized_results.end())
+        return;
+      // Make room by throwing away old results if necessary
+      while (!memoized_results.empty() && ((memoized_points + results.size())
+                > DEFAULT_MAX_PROJECTION_MEMO_POINTS))
+      {
+        std::map<MemoKey,std::vector<LogicalRegion> >::iterator victim = 
+          memoized_results.begin();
+        memoized_points -= victim->second.size();
+        memoized_results.erase(victim);
+      }
+      memoized_results[key] = results;
+      memoized_points += results.size();
+    }
+
+    //--------------------------------------------------------------------------
+    ProjectionFunction::MemoKey::MemoKey(const RegionRequirement &req,
+                                         const Domain &launch_domain)
+      : region((req.handle_type == PART_PROJECTION) ? 
+                LogicalRegion::NO_REGION : req.region),
+        partition((req.handle_type == PART_PROJECTION) ? 
+                req.partition : LogicalPartition::NO_PART),
+        domain(launch_domain)
+    //--------------------------------------------------------------------------
+    {
+    }
+
     //--------------------------------------------------------------------------
     void ProjectionFunction::check_projection_region_result(
         const RegionRequirement &req, const Task *task, unsigned idx,
@@ -9080,6 +9431,7 @@ namespace Legion {
         unsafe_launch(config.unsafe_launch),
         unsafe_mapper(config.unsafe_mapper),
         dynamic_independence_tests(config.dynamic_independence_tests),
+        memoize_traced_mappings(config.memoize_traced_mappings),
 #ifdef LEGION_SPY
         legion_spy_enabled(true),
 #else
@@ -9192,6 +9544,9 @@ namespace Legion {
       // Do some mixing
       for (int i = 0; i < 256; i++)
         nrand48(random_state);
+      // Open the binary Legion Spy log now that we know our node
+      if (legion_spy_enabled && (config.spy_logfile != NULL))
+        LegionSpy::open_binary_log(config.spy_logfile, address_space);
       // Initialize our profiling instance
       if (address_space < num_profiling_nodes)
         initialize_legion_prof(config);
@@ -9213,6 +9568,10 @@ namespace Legion {
 #endif
 #ifdef TRACE_ALLOCATION
       allocation_tracing_count = 0;
+      arena_allocations = 0;
+      arena_heap_blocks = 0;
+      mapped_operations = 0;
+      diff_mapped_operations = 0;
       // Instantiate all the kinds of allocations
       for (unsigned idx = ARGUMENT_MAP_ALLOC; idx < LAST_ALLOC; idx++)
         allocation_manager[((AllocationType)idx)] = AllocationTracker();
@@ -9265,6 +9624,7 @@ namespace Legion {
         unsafe_launch(rhs.unsafe_launch),
         unsafe_mapper(rhs.unsafe_mapper),
         dynamic_independence_tests(rhs.dynamic_independence_tests),
+        memoize_traced_mappings(rhs.memoize_traced_mappings),
         legion_spy_enabled(rhs.legion_spy_enabled),
         enable_test_mapper(rhs.enable_test_mapper),
         legion_ldb_enabled(rhs.legion_ldb_enabled),
@@ -18095,11 +18455,44 @@ namespace Legion {
       finder->second.diff_bytes -= free_size;
     }
 
+    //--------------------------------------------------------------------------
+    void Runtime::trace_arena(size_t allocations, size_t heap_blocks)
+    //--------------------------------------------------------------------------
+    {
+      __sync_fetch_and_add(&arena_allocations, allocations);
+      if (heap_blocks > 0)
+        __sync_fetch_and_add(&arena_heap_blocks, heap_blocks);
+    }
+
+    //--------------------------------------------------------------------------
+    void Runtime::trace_mapped_operation(void)
+    //--------------------------------------------------------------------------
+    {
+      __sync_fetch_and_add(&diff_mapped_operations, 1);
+    }
+
     //--------------------------------------------------------------------------
     void Runtime::dump_allocation_info(void)
     //--------------------------------------------------------------------------
     {
       AutoLock a_lock(allocation_lock);
+      // Report the arena allocations for the operations mapped since the
+      // last time that we dumped the allocation information
+      const unsigned long long new_mapped = 
+        __sync_fetch_and_and(&diff_mapped_operations, 0);
+      const unsigned long long new_allocations = 
+        __sync_fetch_and_and(&arena_allocations, 0);
+      const unsigned long long new_blocks = 
+        __sync_fetch_and_and(&arena_heap_blocks, 0);
+      if (new_mapped > 0)
+      {
+        mapped_operations += new_mapped;
+        log_allocation.info("Analysis Arena on %d: mapped_ops=%lld "
+            "total_mapped_ops=%lld allocations=%lld heap_blocks=%lld "
+            "allocations_per_op=%.1f", address_space, new_mapped,
+            mapped_operations, new_allocations, new_blocks,
+            double(new_allocations) / double(new_mapped));
+      }
       for (std::map<AllocationType,AllocationTracker>::iterator it = 
             allocation_manager.begin(); it != allocation_manager.end(); it++)
       {
@@ -18326,6 +18719,8 @@ namespace Legion {
           return "Variant Implementation";
         case LAYOUT_CONSTRAINTS_ALLOC:
           return "Layout Constraints";
+        case ANALYSIS_ARENA_ALLOC:
+          return "Analysis Arena";
         default:
           assert(false); // should never get here
       }
@@ -18771,6 +19166,9 @@ namespace Legion {
       LEGION_STATIC_ASSERT(MAX_NUM_NODES > 0);
       LEGION_STATIC_ASSERT(MAX_NUM_PROCS > 0);
       LEGION_STATIC_ASSERT(DEFAULT_MAX_TASK_WINDOW > 0);
+      LEGION_STATIC_ASSERT((DEFAULT_CHILD_OPS_RING_SIZE > 0) &&
+          ((DEFAULT_CHILD_OPS_RING_SIZE & 
+            (DEFAULT_CHILD_OPS_RING_SIZE - 1)) == 0));
       LEGION_STATIC_ASSERT(DEFAULT_MIN_TASKS_TO_SCHEDULE > 0);
       LEGION_STATIC_ASSERT(DEFAULT_MAX_MESSAGE_SIZE > 0); 
 
@@ -18817,8 +19215,9 @@ namespace Legion {
       // Check for any slow configurations
       if (!config.slow_config_ok)
         perform_slow_config_checks(config);
-      // Configure legion spy if necessary
-      if (config.legion_spy_enabled)
+      // Configure legion spy if necessary, binary logs get their
+      // configuration when they are opened by the runtime
+      if (config.legion_spy_enabled && (config.spy_logfile == NULL))
         LegionSpy::log_legion_spy_config();
       // Configure MPI Interoperability
       if ((mpi_rank >= 0) || (pending_handshakes != NULL))
@@ -18916,7 +19315,13 @@ namespace Legion {
         INT_ARG("-lg:local", config.max_local_fields);
         if (!strcmp(argv[i],"-lg:no_dyn"))
           config.dynamic_independence_tests = false;
+        BOOL_ARG("-lg:memoize",config.memoize_traced_mappings);
         BOOL_ARG("-lg:spy",config.legion_spy_enabled);
+        if (!strcmp(argv[i],"-lg:spy_logfile"))
+        {
+          config.spy_logfile = argv[++i];
+          continue;
+        }
         BOOL_ARG("-lg:test",config.enable_test_mapper);
         INT_ARG("-lg:delay", config.delay_start);
         if (!strcmp(argv[i],"-lg:replay"))
@@ -19038,6 +19443,9 @@ namespace Legion {
       } 
 #undef INT_ARG
 #undef BOOL_ARG
+      // Asking for a binary Legion Spy log implies Legion Spy logging
+      if (config.spy_logfile != NULL)
+        config.legion_spy_enabled = true;
 #ifdef DEBUG_LEGION
       assert(config.initial_task_window_hysteresis <= 100);
       assert(config.max_local_fields <= MAX_FIELDS);
@@ -20500,6 +20908,16 @@ namespace Legion {
       }
       runtime->trace_free(a, size, elems);
     }
+
+    //--------------------------------------------------------------------------
+    /*static*/ void LegionAllocation::trace_arena(size_t allocations,
+                                                  size_t heap_blocks)
+    //--------------------------------------------------------------------------
+    {
+      Runtime *rt = Runtime::the_runtime;
+      if (rt != NULL)
+        rt->trace_arena(allocations, heap_blocks);
+    }
 #endif
 
 
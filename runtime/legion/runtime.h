@@ -707,7 +707,7 @@ namespace Legion {
           : current_state(COLLECTABLE_STATE), 
             deferred_collect(RtUserEvent::NO_RT_USER_EVENT),
             instance_size(0), pending_acquires(0), min_priority(0),
-            unattached_external(false) { }
+            last_use(0), base_address(0), unattached_external(false) { }
       public:
         InstanceState current_state;
         RtUserEvent deferred_collect;
@@ -715,9 +715,35 @@ namespace Legion {
         unsigned pending_acquires;
         GCPriority min_priority;
         std::map<std::pair<MapperID,Processor>,GCPriority> mapper_priorities;
+        // Logical timestamp of the most recent use for LRU ordering
+        unsigned long long last_use;
+        // Where the instance lives in the memory (zero if unknown) so
+        // that we can tell which deletions produce contiguous space
+        uintptr_t base_address;
         // For tracking external instances and whether they can be used
         bool unattached_external;
       };
+      struct VictimCandidate {
+      public:
+        VictimCandidate(PhysicalManager *m, const InstanceInfo &info)
+          : manager(m), priority(info.min_priority), 
+            last_use(info.last_use) { }
+      public:
+        // Mappers want instances with higher GC priorities collected
+        // first, and within a priority we go least recently used first
+        inline bool operator<(const VictimCandidate &rhs) const
+        {
+          if (priority != rhs.priority)
+            return (priority > rhs.priority);
+          if (last_use != rhs.last_use)
+            return (last_use < rhs.last_use);
+          return (manager < rhs.manager);
+        }
+      public:
+        PhysicalManager *manager;
+        GCPriority priority;
+        unsigned long long last_use;
+      };
     public:
       MemoryManager(Memory mem, Runtime *rt);
       MemoryManager(const MemoryManager &rhs);
@@ -822,6 +848,22 @@ namespace Legion {
                                                         &candidates) const;
       void release_candidate_references(const std::deque<PhysicalManager*>
                                                         &candidates) const;
+      void find_region_ancestors(const std::vector<LogicalRegion> &regions,
+                                 std::vector<RegionNode*> &ancestors) const;
+      void find_region_candidates(const std::vector<RegionNode*> &ancestors,
+                                  bool valid_only,
+                                  std::vector<PhysicalManager*> &matches) const;
+      InstanceInfo& record_current_instance(PhysicalManager *manager);
+      void erase_current_instance(PhysicalManager *manager);
+      inline void record_instance_use(InstanceInfo &info)
+        { info.last_use = ++use_clock; }
+      uintptr_t find_base_address(PhysicalManager *manager) const;
+      bool select_victims(const size_t needed_size, InstanceState state,
+                          bool larger_only, 
+                          std::vector<PhysicalManager*> &victims) const;
+      bool select_contiguous_victims(const size_t needed_size,
+                          const std::vector<VictimCandidate> &candidates,
+                          std::vector<PhysicalManager*> &victims) const;
     protected:
       PhysicalManager* allocate_physical_instance(
                                     const LayoutConstraintSet &constraints,
@@ -868,6 +910,12 @@ namespace Legion {
       // It is only valid on the owner node
       LegionMap<PhysicalManager*,InstanceInfo,
                 MEMORY_INSTANCES_ALLOC>::tracked current_instances;
+      // An index of the instances in current_instances by the logical
+      // region that they were made for so that searches only need to
+      // consider instances for ancestors of the requested regions
+      std::map<RegionNode*,std::set<PhysicalManager*> > region_instances;
+      // Logical clock for recording when instances were last used
+      unsigned long long use_clock;
     };
 
     /**
@@ -1354,6 +1402,7 @@ namespace Legion {
                                     LogicalPartition upper_bound,
                                     const DomainPoint &point);
       virtual bool is_exclusive(void) const;
+      virtual bool is_functional(void) const;
       virtual unsigned get_depth(void) const;
     };
 
@@ -1383,12 +1432,26 @@ namespace Legion {
       // The old path explicitly for tasks
       LogicalRegion project_point(Task *task, unsigned idx, Runtime *runtime,
                                   const DomainPoint &point);
-      void project_points(const RegionRequirement &req, unsigned idx,
-          Runtime *runtime, const std::vector<PointTask*> &point_tasks);
+      void project_points(SliceTask *slice, unsigned idx, Runtime *runtime,
+                          const Domain &launch_domain,
+                          const std::vector<PointTask*> &point_tasks);
       // Generalized and annonymized
       void project_points(Operation *op, unsigned idx, 
                           const RegionRequirement &req, Runtime *runtime,
+                          const Domain &launch_domain,
                           const std::vector<ProjectionPoint*> &points);
+    protected:
+      // Bulk projection of a whole launch domain for functional functors
+      void project_domain(const Mappable *mappable, unsigned idx,
+                          const RegionRequirement &req,
+                          const Domain &launch_domain,
+                          std::vector<LogicalRegion> &results);
+      bool find_memoized_results(const RegionRequirement &req,
+                                 const Domain &launch_domain,
+                                 std::vector<LogicalRegion> &results);
+      void memoize_results(const RegionRequirement &req,
+                           const Domain &launch_domain,
+                           const std::vector<LogicalRegion> &results);
     protected:
       // Old checking code explicitly for tasks
       void check_projection_region_result(const RegionRequirement &req,
@@ -1407,10 +1470,34 @@ namespace Legion {
     public:
       const int depth; 
       const bool is_exclusive;
+      const bool is_functional;
       const ProjectionID projection_id;
       ProjectionFunctor *const functor;
     private:
       mutable LocalLock projection_reservation;
+    private:
+      // Memoized results of functional projection functors keyed
+      // by the upper bound and the launch domain
+      struct MemoKey {
+      public:
+        MemoKey(const RegionRequirement &req, const Domain &launch_domain);
+      public:
+        inline bool operator<(const MemoKey &rhs) const
+        {
+          if (region < rhs.region) return true;
+          if (rhs.region < region) return false;
+          if (partition < rhs.partition) return true;
+          if (rhs.partition < partition) return false;
+          return (domain < rhs.domain);
+        }
+      public:
+        LogicalRegion region;
+        LogicalPartition partition;
+        Domain domain;
+      };
+      mutable LocalLock memo_lock;
+      std::map<MemoKey,std::vector<LogicalRegion> > memoized_results;
+      size_t memoized_points;
     }; 
 
     /**
@@ -1450,7 +1537,9 @@ namespace Legion {
             unsafe_mapper(true),
 #endif
             dynamic_independence_tests(true),
+            memoize_traced_mappings(false),
             legion_spy_enabled(false),
+            spy_logfile(NULL),
             enable_test_mapper(false),
             legion_ldb_enabled(false),
             replay_file(NULL),
@@ -1492,7 +1581,9 @@ namespace Legion {
         bool unsafe_launch;
         bool unsafe_mapper;
         bool dynamic_independence_tests;
+        bool memoize_traced_mappings;
         bool legion_spy_enabled;
+        const char* spy_logfile;
         bool enable_test_mapper;
         bool legion_ldb_enabled;
         const char* replay_file;
@@ -1607,6 +1698,7 @@ namespace Legion {
       const bool unsafe_launch;
       const bool unsafe_mapper;
       const bool dynamic_independence_tests;
+      const bool memoize_traced_mappings;
       const bool legion_spy_enabled;
       const bool enable_test_mapper;
       const bool legion_ldb_enabled;
@@ -2715,6 +2807,8 @@ namespace Legion {
     public:
       void trace_allocation(AllocationType type, size_t size, int elems);
       void trace_free(AllocationType type, size_t size, int elems);
+      void trace_arena(size_t allocations, size_t heap_blocks);
+      void trace_mapped_operation(void);
       void dump_allocation_info(void);
       static const char* get_allocation_name(AllocationType type);
 #endif
@@ -2914,6 +3008,9 @@ namespace Legion {
       mutable LocalLock allocation_lock; // leak this lock intentionally
       std::map<AllocationType,AllocationTracker> allocation_manager;
       unsigned long long allocation_tracing_count;
+      // Analysis arena usage relative to the number of mapped operations
+      unsigned long long arena_allocations, arena_heap_blocks;
+      unsigned long long mapped_operations, diff_mapped_operations;
 #endif
     protected:
       mutable LocalLock individual_task_lock;
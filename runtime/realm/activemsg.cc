@@ -54,6 +54,10 @@ static const void *ignore_gasnet_warning2 __attribute__((unused)) = (void *)_gas
 
 #include "realm/activemsg.h"
 #include "realm/cmdline.h"
+#ifndef USE_GASNET
+#include "realm/shm_network.h"
+#include <sched.h>
+#endif
 
 #include <queue>
 #include <assert.h>
@@ -2906,38 +2910,63 @@ void GASNetCondVar::wait(void)
   pthread_cond_wait(&condvar, &mutex.mutex);
 }
 
+// without GASNet, active messages are only available if the shared-memory
+//  network has been enabled - it copies (or directly writes) the payload
+//  before returning, so payload modes only matter for who frees it
+
 void enqueue_message(NodeID target, int msgid,
 		     const void *args, size_t arg_size,
-		     const void *payload, size_t payload_size,
+		     const SpanList& spans, size_t payload_size,
 		     int payload_mode, void *dstptr)
 {
-  assert(0 && "compiled without USE_GASNET - active messages not available!");
+  assert(Realm::ShmNetwork::enabled() &&
+	 "compiled without USE_GASNET - active messages not available!");
+  Realm::ShmNetwork::send(target, msgid, (payload_mode != PAYLOAD_NONE),
+			  args, arg_size, spans, payload_size, dstptr);
 }
 
 void enqueue_message(NodeID target, int msgid,
 		     const void *args, size_t arg_size,
-		     const void *payload, size_t line_size,
-		     off_t line_stride, size_t line_count,
+		     const void *payload, size_t payload_size,
 		     int payload_mode, void *dstptr)
 {
-  assert(0 && "compiled without USE_GASNET - active messages not available!");
+  SpanList spans;
+  if(payload_size > 0)
+    spans.push_back(SpanListEntry(payload, payload_size));
+  enqueue_message(target, msgid, args, arg_size,
+		  spans, payload_size, payload_mode, dstptr);
+  if(payload_mode == PAYLOAD_FREE)
+    free(const_cast<void *>(payload));
 }
 
 void enqueue_message(NodeID target, int msgid,
 		     const void *args, size_t arg_size,
-		     const SpanList& spans, size_t payload_size,
+		     const void *payload, size_t line_size,
+		     off_t line_stride, size_t line_count,
 		     int payload_mode, void *dstptr)
 {
-  assert(0 && "compiled without USE_GASNET - active messages not available!");
+  SpanList spans;
+  for(size_t i = 0; i < line_count; i++)
+    spans.push_back(SpanListEntry(((const char *)payload) + (i * line_stride),
+				  line_size));
+  enqueue_message(target, msgid, args, arg_size,
+		  spans, line_size * line_count, payload_mode, dstptr);
+  if(payload_mode == PAYLOAD_FREE)
+    free(const_cast<void *>(payload));
 }
 
 void do_some_polling(void)
 {
-  assert(0 && "compiled without USE_GASNET - active messages not available!");
+  // the shm network's polling thread does the real work
+  assert(Realm::ShmNetwork::enabled() &&
+	 "compiled without USE_GASNET - active messages not available!");
+  sched_yield();
 }
 
 size_t get_lmb_size(NodeID target_node)
 {
+  if(Realm::ShmNetwork::enabled())
+    return Realm::ShmNetwork::max_payload_size();
   return 0;
 }
 
@@ -2951,28 +2980,29 @@ void send_srcptr_release(token_t token, uint64_t srcptr)
 
 NodeID get_message_source(token_t token)
 {
-  return 0;
+  return Realm::ShmNetwork::get_message_source(token);
 }
 
 void enqueue_incoming(NodeID sender, IncomingMessage *msg)
 {
-  assert(0 && "compiled without USE_GASNET - active messages not available!");
+  Realm::ShmNetwork::enqueue_incoming(sender, msg);
 }
 
 bool adjust_long_msgsize(NodeID source, void *&ptr, size_t &buffer_size,
 			 int message_id, int chunks)
 {
-  return false;
+  // the shm network never fragments messages
+  return true;
 }
 
 void handle_long_msgptr(NodeID source, const void *ptr)
 {
-  assert(0 && "compiled without USE_GASNET - active messages not available!");
+  Realm::ShmNetwork::release_payload(source, ptr);
 }
 
 void add_handler_entry(int msgid, void (*fnptr)())
 {
-  // ignored
+  Realm::ShmNetwork::add_handler(msgid, fnptr);
 }
 
 void init_endpoints(int gasnet_mem_size_in_mb,
@@ -2981,19 +3011,38 @@ void init_endpoints(int gasnet_mem_size_in_mb,
 		    Realm::CoreReservationSet& crs,
 		    std::vector<std::string>& cmdline)
 {
-  // nothing to do without GASNet
+  if(!Realm::ShmNetwork::enabled())
+    return;
+
+  // the global (striped) memory needs GASNet's segment layout
+  if(gasnet_mem_size_in_mb > 0) {
+    fprintf(stderr, "ERROR: -ll:gsize is not supported by the shm network\n");
+    exit(1);
+  }
+
+  // registered memory lives in the shared segment so that other nodes
+  //  can write to it directly
+  Realm::ShmNetwork::create_segments(((size_t)(registered_mem_size_in_mb +
+					       registered_ib_mem_size_in_mb)) << 20,
+				     crs);
 }
 
-void start_polling_threads(int)
+void start_polling_threads(int count)
 {
+  if(Realm::ShmNetwork::enabled())
+    Realm::ShmNetwork::start_polling_threads(count);
 }
 
-void start_handler_threads(int, Realm::CoreReservationSet&, size_t)
+void start_handler_threads(int count, Realm::CoreReservationSet&, size_t stack_size)
 {
+  if(Realm::ShmNetwork::enabled())
+    Realm::ShmNetwork::start_handler_threads(count, stack_size);
 }
 
 void stop_activemsg_threads(void)
 {
+  if(Realm::ShmNetwork::enabled())
+    Realm::ShmNetwork::stop_threads();
 }
 
 #endif
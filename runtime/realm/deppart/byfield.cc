@@ -107,13 +107,14 @@ namespace Realm {
 
   template <int N, typename T, typename FT>
   template <typename BM>
-  void ByFieldMicroOp<N,T,FT>::populate_bitmasks(std::map<FT, BM *>& bitmasks)
+  void ByFieldMicroOp<N,T,FT>::populate_bitmasks(const IndexSpace<N,T>& space,
+						  std::map<FT, BM *>& bitmasks)
   {
     // for now, one access for the whole instance
     AffineAccessor<FT,N,T> a_data(inst, field_offset);
 
     // double iteration - use the instance's space first, since it's probably smaller
-    for(IndexSpaceIterator<N,T> it(inst_space); it.valid; it.step()) {
+    for(IndexSpaceIterator<N,T> it(space); it.valid; it.step()) {
       for(IndexSpaceIterator<N,T> it2(parent_space, it.rect); it2.valid; it2.step()) {
 	const Rect<N,T>& r = it2.rect;
 	Point<N,T> p = r.lo;
@@ -162,10 +163,19 @@ namespace Realm {
   void ByFieldMicroOp<N,T,FT>::execute(void)
   {
     TimeStamp ts("ByFieldMicroOp::execute", true, &log_uop_timing);
+
+    // large instances are split up so that other workers can help
+    int chunks = split_instance_space(inst_space, chunk_spaces);
+    if(chunks > 1) {
+      chunk_rect_maps.resize(chunks);
+      execute_in_chunks(chunks);
+      return;
+    }
+
 #ifdef DEBUG_PARTITIONING
     std::map<FT, CoverageCounter<N,T> *> values_present;
 
-    populate_bitmasks(values_present);
+    populate_bitmasks(inst_space, values_present);
 
     std::cout << values_present.size() << " values present in instance " << inst << std::endl;
     for(typename std::map<FT, CoverageCounter<N,T> *>::const_iterator it = values_present.begin();
@@ -176,7 +186,7 @@ namespace Realm {
 
     std::map<FT, DenseRectangleList<N,T> *> rect_map;
 
-    populate_bitmasks(rect_map);
+    populate_bitmasks(inst_space, rect_map);
 
 #ifdef DEBUG_PARTITIONING
     std::cout << values_present.size() << " values present in instance " << inst << std::endl;
@@ -186,6 +196,32 @@ namespace Realm {
       std::cout << "  " << it->first << " = " << it->second->rects.size() << " rectangles" << std::endl;
 #endif
 
+    contribute_outputs(rect_map);
+  }
+
+  template <int N, typename T, typename FT>
+  void ByFieldMicroOp<N,T,FT>::execute_chunk(int index)
+  {
+    populate_bitmasks(chunk_spaces[index], chunk_rect_maps[index]);
+  }
+
+  template <int N, typename T, typename FT>
+  void ByFieldMicroOp<N,T,FT>::merge_chunks(int dst_index, int src_index)
+  {
+    merge_rect_list_maps(chunk_rect_maps[dst_index], chunk_rect_maps[src_index]);
+  }
+
+  template <int N, typename T, typename FT>
+  void ByFieldMicroOp<N,T,FT>::finish_chunks(void)
+  {
+    contribute_outputs(chunk_rect_maps[0]);
+    chunk_rect_maps.clear();
+    chunk_spaces.clear();
+  }
+
+  template <int N, typename T, typename FT>
+  void ByFieldMicroOp<N,T,FT>::contribute_outputs(std::map<FT, DenseRectangleList<N,T> *>& rect_map)
+  {
     // iterate over sparsity outputs and contribute to all (even if we didn't have any
     //  points found for it)
     for(typename std::map<FT, SparsityMap<N,T> >::const_iterator it = sparsity_outputs.begin();
@@ -205,7 +241,7 @@ namespace Realm {
   void ByFieldMicroOp<N,T,FT>::dispatch(PartitioningOperation *op, bool inline_ok)
   {
     // a ByFieldMicroOp should always be executed on whichever node the field data lives
-    NodeID exec_node = ID(inst).sparsity.creator_node;
+    NodeID exec_node = ID(inst).instance.owner_node;
 
     if(exec_node != my_node_id) {
       // we're going to ship it elsewhere, which means we always need an AsyncMicroOp to
@@ -291,7 +327,7 @@ namespace Realm {
     subspace.bounds = parent.bounds;
 
     // get a sparsity ID by round-robin'ing across the nodes that have field data
-    int target_node = ID(field_data[colors.size() % field_data.size()].inst).sparsity.creator_node;
+    int target_node = ID(field_data[colors.size() % field_data.size()].inst).instance.owner_node;
     SparsityMap<N,T> sparsity = get_runtime()->get_available_sparsity_impl(target_node)->me.convert<SparsityMap<N,T> >();
     subspace.sparsity = sparsity;
 
@@ -19,6 +19,7 @@
 #define REALM_DEPPART_BYFIELD_H
 
 #include "realm/deppart/partitions.h"
+#include "realm/deppart/rectlist.h"
 
 namespace Realm {
 
@@ -43,6 +44,10 @@ namespace Realm {
 
     virtual void execute(void);
 
+    virtual void execute_chunk(int index);
+    virtual void merge_chunks(int dst_index, int src_index);
+    virtual void finish_chunks(void);
+
     void dispatch(PartitioningOperation *op, bool inline_ok);
 
   protected:
@@ -55,7 +60,9 @@ namespace Realm {
     ByFieldMicroOp(NodeID _requestor, AsyncMicroOp *_async_microop, S& s);
 
     template <typename BM>
-    void populate_bitmasks(std::map<FT, BM *>& bitmasks);
+    void populate_bitmasks(const IndexSpace<N,T>& space, std::map<FT, BM *>& bitmasks);
+
+    void contribute_outputs(std::map<FT, DenseRectangleList<N,T> *>& rect_map);
 
     IndexSpace<N,T> parent_space, inst_space;
     RegionInstance inst;
@@ -64,6 +71,8 @@ namespace Realm {
     FT range_lo, range_hi;
     std::set<FT> value_set;
     std::map<FT, SparsityMap<N,T> > sparsity_outputs;
+    std::vector<IndexSpace<N,T> > chunk_spaces;
+    std::vector<std::map<FT, DenseRectangleList<N,T> *> > chunk_rect_maps;
   };
 
   template <int N, typename T, typename FT>
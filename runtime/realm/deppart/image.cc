@@ -163,13 +163,14 @@ namespace Realm {
 
   template <int N, typename T, int N2, typename T2>
   template <typename BM>
-  void ImageMicroOp<N,T,N2,T2>::populate_bitmasks_ptrs(std::map<int, BM *>& bitmasks)
+  void ImageMicroOp<N,T,N2,T2>::populate_bitmasks_ptrs(const IndexSpace<N2,T2>& space,
+						       std::map<int, BM *>& bitmasks)
   {
     // for now, one access for the whole instance
     AffineAccessor<Point<N,T>,N2,T2> a_data(inst, field_offset);
 
     // double iteration - use the instance's space first, since it's probably smaller
-    for(IndexSpaceIterator<N2,T2> it(inst_space); it.valid; it.step()) {
+    for(IndexSpaceIterator<N2,T2> it(space); it.valid; it.step()) {
       for(size_t i = 0; i < sources.size(); i++) {
 	for(IndexSpaceIterator<N2,T2> it2(sources[i], it.rect); it2.valid; it2.step()) {
 	  BM **bmpp = 0;
@@ -198,13 +199,14 @@ namespace Realm {
 
   template <int N, typename T, int N2, typename T2>
   template <typename BM>
-  void ImageMicroOp<N,T,N2,T2>::populate_bitmasks_ranges(std::map<int, BM *>& bitmasks)
+  void ImageMicroOp<N,T,N2,T2>::populate_bitmasks_ranges(const IndexSpace<N2,T2>& space,
+							 std::map<int, BM *>& bitmasks)
   {
     // for now, one access for the whole instance
     AffineAccessor<Rect<N,T>,N2,T2> a_data(inst, field_offset);
 
     // double iteration - use the instance's space first, since it's probably smaller
-    for(IndexSpaceIterator<N2,T2> it(inst_space); it.valid; it.step()) {
+    for(IndexSpaceIterator<N2,T2> it(space); it.valid; it.step()) {
       for(size_t i = 0; i < sources.size(); i++) {
 	for(IndexSpaceIterator<N2,T2> it2(sources[i], it.rect); it2.valid; it2.step()) {
 	  BM **bmpp = 0;
@@ -274,14 +276,25 @@ namespace Realm {
   {
     TimeStamp ts("ImageMicroOp::execute", true, &log_uop_timing);
 
+    // large instances are split up so that other workers can help (the
+    //  approximate image is small and cheap, so it isn't worth chunking)
+    if(!sparsity_outputs.empty() && (approx_output_index == -1)) {
+      int chunks = split_instance_space(inst_space, chunk_spaces);
+      if(chunks > 1) {
+	chunk_rect_maps.resize(chunks);
+	execute_in_chunks(chunks);
+	return;
+      }
+    }
+
     if(!sparsity_outputs.empty()) {
       //std::map<int, DenseRectangleList<N,T> *> rect_map;
       std::map<int, HybridRectangleList<N,T> *> rect_map;
 
       if(is_ranged)
-	populate_bitmasks_ranges(rect_map);
+	populate_bitmasks_ranges(inst_space, rect_map);
       else
-	populate_bitmasks_ptrs(rect_map);
+	populate_bitmasks_ptrs(inst_space, rect_map);
 
 #ifdef DEBUG_PARTITIONING
       std::cout << rect_map.size() << " non-empty images present in instance " << inst << std::endl;
@@ -291,17 +304,7 @@ namespace Realm {
 	std::cout << "  " << sources[it->first] << " = " << it->second->rects.size() << " rectangles" << std::endl;
 #endif
 
-      // iterate over sparsity outputs and contribute to all (even if we didn't have any
-      //  points found for it)
-      for(size_t i = 0; i < sparsity_outputs.size(); i++) {
-	SparsityMapImpl<N,T> *impl = SparsityMapImpl<N,T>::lookup(sparsity_outputs[i]);
-	typename std::map<int, HybridRectangleList<N,T> *>::const_iterator it2 = rect_map.find(i);
-	if(it2 != rect_map.end()) {
-	  impl->contribute_dense_rect_list(it2->second->convert_to_vector());
-	  delete it2->second;
-	} else
-	  impl->contribute_nothing();
-      }
+      contribute_outputs(rect_map);
     }
 
     if(approx_output_index != -1) {
@@ -322,11 +325,50 @@ namespace Realm {
     }
   }
 
+  template <int N, typename T, int N2, typename T2>
+  void ImageMicroOp<N,T,N2,T2>::execute_chunk(int index)
+  {
+    if(is_ranged)
+      populate_bitmasks_ranges(chunk_spaces[index], chunk_rect_maps[index]);
+    else
+      populate_bitmasks_ptrs(chunk_spaces[index], chunk_rect_maps[index]);
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  void ImageMicroOp<N,T,N2,T2>::merge_chunks(int dst_index, int src_index)
+  {
+    merge_rect_list_maps(chunk_rect_maps[dst_index], chunk_rect_maps[src_index]);
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  void ImageMicroOp<N,T,N2,T2>::finish_chunks(void)
+  {
+    contribute_outputs(chunk_rect_maps[0]);
+    chunk_rect_maps.clear();
+    chunk_spaces.clear();
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  void ImageMicroOp<N,T,N2,T2>::contribute_outputs(std::map<int, HybridRectangleList<N,T> *>& rect_map)
+  {
+    // iterate over sparsity outputs and contribute to all (even if we didn't have any
+    //  points found for it)
+    for(size_t i = 0; i < sparsity_outputs.size(); i++) {
+      SparsityMapImpl<N,T> *impl = SparsityMapImpl<N,T>::lookup(sparsity_outputs[i]);
+      typename std::map<int, HybridRectangleList<N,T> *>::const_iterator it2 = rect_map.find(i);
+      if(it2 != rect_map.end()) {
+	impl->contribute_dense_rect_list(it2->second->convert_to_vector());
+	delete it2->second;
+      } else
+	impl->contribute_nothing();
+    }
+  }
+
   template <int N, typename T, int N2, typename T2>
   void ImageMicroOp<N,T,N2,T2>::dispatch(PartitioningOperation *op, bool inline_ok)
   {
     // an ImageMicroOp should always be executed on whichever node the field data lives
-    NodeID exec_node = ID(inst).sparsity.creator_node;
+    NodeID exec_node = ID(inst).instance.owner_node;
 
     if(exec_node != my_node_id) {
       // we're going to ship it elsewhere, which means we always need an AsyncMicroOp to
@@ -458,9 +500,9 @@ namespace Realm {
       target_node = ID(source.sparsity).sparsity.creator_node;
     else
       if(!ptr_data.empty())
-	target_node = ID(ptr_data[sources.size() % ptr_data.size()].inst).sparsity.creator_node;
+	target_node = ID(ptr_data[sources.size() % ptr_data.size()].inst).instance.owner_node;
       else
-	target_node = ID(range_data[sources.size() % range_data.size()].inst).sparsity.creator_node;
+	target_node = ID(range_data[sources.size() % range_data.size()].inst).instance.owner_node;
     SparsityMap<N,T> sparsity = get_runtime()->get_available_sparsity_impl(target_node)->me.convert<SparsityMap<N,T> >();
     image.sparsity = sparsity;
 
@@ -489,9 +531,9 @@ namespace Realm {
       target_node = ID(source.sparsity).sparsity.creator_node;
     else
       if(!ptr_data.empty())
-	target_node = ID(ptr_data[sources.size() % ptr_data.size()].inst).sparsity.creator_node;
+	target_node = ID(ptr_data[sources.size() % ptr_data.size()].inst).instance.owner_node;
       else
-	target_node = ID(range_data[sources.size() % range_data.size()].inst).sparsity.creator_node;
+	target_node = ID(range_data[sources.size() % range_data.size()].inst).instance.owner_node;
     SparsityMap<N,T> sparsity = get_runtime()->get_available_sparsity_impl(target_node)->me.convert<SparsityMap<N,T> >();
     image.sparsity = sparsity;
 
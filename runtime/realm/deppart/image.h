@@ -19,6 +19,7 @@
 #define REALM_DEPPART_IMAGE_H
 
 #include "realm/deppart/partitions.h"
+#include "realm/deppart/rectlist.h"
 
 namespace Realm {
 
@@ -46,6 +47,10 @@ namespace Realm {
 
     virtual void execute(void);
 
+    virtual void execute_chunk(int index);
+    virtual void merge_chunks(int dst_index, int src_index);
+    virtual void finish_chunks(void);
+
     void dispatch(PartitioningOperation *op, bool inline_ok);
 
   protected:
@@ -58,10 +63,14 @@ namespace Realm {
     ImageMicroOp(NodeID _requestor, AsyncMicroOp *_async_microop, S& s);
 
     template <typename BM>
-    void populate_bitmasks_ptrs(std::map<int, BM *>& bitmasks);
+    void populate_bitmasks_ptrs(const IndexSpace<N2,T2>& space,
+				std::map<int, BM *>& bitmasks);
 
     template <typename BM>
-    void populate_bitmasks_ranges(std::map<int, BM *>& bitmasks);
+    void populate_bitmasks_ranges(const IndexSpace<N2,T2>& space,
+				  std::map<int, BM *>& bitmasks);
+
+    void contribute_outputs(std::map<int, HybridRectangleList<N,T> *>& rect_map);
 
     template <typename BM>
     void populate_approx_bitmask_ptrs(BM& bitmask);
@@ -77,6 +86,8 @@ namespace Realm {
     std::vector<IndexSpace<N2,T2> > sources;
     std::vector<IndexSpace<N,T> > diff_rhss;
     std::vector<SparsityMap<N,T> > sparsity_outputs;
+    std::vector<IndexSpace<N2,T2> > chunk_spaces;
+    std::vector<std::map<int, HybridRectangleList<N,T> *> > chunk_rect_maps;
     int approx_output_index;
     intptr_t approx_output_op;
   };
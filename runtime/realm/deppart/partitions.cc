@@ -48,6 +48,7 @@ namespace Realm {
     int cfg_max_rects_in_approximation = 32;
     size_t cfg_max_bytes_per_packet = 2048;//32768;
     bool cfg_worker_threads_sleep = false;
+    size_t cfg_min_points_per_chunk = 65536;
   };
 
   // TODO: C++11 has type_traits and std::make_unsigned
@@ -383,23 +384,48 @@ namespace Realm {
   //
   // class PartitioningMicroOp
 
+  // a ChunkRunner is what actually goes on the op queue for chunked execution -
+  //  one runner is queued once per extra chunk, and each time a worker runs it,
+  //  it helps with whatever chunks are left
+  class PartitioningMicroOp::ChunkRunner : public PartitioningMicroOp {
+  public:
+    ChunkRunner(PartitioningMicroOp *_parent) : parent(_parent) {}
+
+    virtual void execute(void) { parent->run_chunks(); }
+
+  protected:
+    PartitioningMicroOp *parent;
+  };
+
   PartitioningMicroOp::PartitioningMicroOp(void)
     : wait_count(2), requestor(my_node_id), async_microop(0)
+    , chunk_count(0), next_chunk(0), chunks_remaining(0), chunk_runner(0)
   {}
 
   PartitioningMicroOp::PartitioningMicroOp(NodeID _requestor,
 					   AsyncMicroOp *_async_microop)
     : wait_count(2), requestor(_requestor), async_microop(_async_microop)
+    , chunk_count(0), next_chunk(0), chunks_remaining(0), chunk_runner(0)
   {}
 
   PartitioningMicroOp::~PartitioningMicroOp(void)
-  {}
+  {
+    delete chunk_runner;
+  }
 
   void PartitioningMicroOp::mark_started(void)
   {}
 
   void PartitioningMicroOp::mark_finished(void)
   {
+    // with chunked execution, both the return from execute() and the final
+    //  merge of the chunks come through here - the second one finishes
+    if(chunk_count > 0) {
+      if(__sync_sub_and_fetch(&chunks_remaining, 1) > 0)
+	return;
+      finish_chunks();
+    }
+
     if(async_microop) {
       if(requestor == my_node_id)
 	async_microop->mark_finished(true /*successful*/);
@@ -416,6 +442,117 @@ namespace Realm {
       op_queue->enqueue_partitioning_microop(this);
   }
 
+  void PartitioningMicroOp::execute_chunk(int index)
+  {
+    // only micro-ops that call execute_in_chunks need to implement these
+    assert(0);
+  }
+
+  void PartitioningMicroOp::merge_chunks(int dst_index, int src_index)
+  {
+    assert(0);
+  }
+
+  void PartitioningMicroOp::finish_chunks(void)
+  {
+    assert(0);
+  }
+
+  template <int N, typename T>
+  /*static*/ int PartitioningMicroOp::split_instance_space(const IndexSpace<N,T>& space,
+							   std::vector<IndexSpace<N,T> >& pieces)
+  {
+    // no point in chunks if there's nobody to help
+    if((DeppartConfig::cfg_num_partitioning_workers <= 1) ||
+       (DeppartConfig::cfg_min_points_per_chunk == 0))
+      return 1;
+
+    // the bounding box volume overestimates sparse spaces, but it's cheap
+    size_t volume = space.bounds.volume();
+    size_t count = std::min(volume / DeppartConfig::cfg_min_points_per_chunk,
+			    size_t(DeppartConfig::cfg_num_partitioning_workers));
+    if(count <= 1)
+      return 1;
+
+    // slice along the dimension with the largest extent - the last dimension
+    //  wins ties, which keeps each piece made of whole rows
+    int split_dim = N - 1;
+    for(int i = N - 2; i >= 0; i--)
+      if((space.bounds.hi[i] - space.bounds.lo[i]) >
+	 (space.bounds.hi[split_dim] - space.bounds.lo[split_dim]))
+	split_dim = i;
+    size_t extent = size_t(space.bounds.hi[split_dim] - space.bounds.lo[split_dim]) + 1;
+    if(count > extent)
+      count = extent;
+
+    // pieces share the instance space's sparsity map - only the bounds differ
+    pieces.resize(count);
+    for(size_t i = 0; i < count; i++) {
+      pieces[i] = space;
+      pieces[i].bounds.lo[split_dim] = space.bounds.lo[split_dim] + T((extent * i) / count);
+      pieces[i].bounds.hi[split_dim] = space.bounds.lo[split_dim] + T((extent * (i + 1)) / count) - 1;
+    }
+    return count;
+  }
+
+  void PartitioningMicroOp::execute_in_chunks(int count)
+  {
+    assert((count > 1) && (chunk_count == 0));
+    chunk_count = count;
+    next_chunk = 0;
+    // one for the final merge and one for the return from execute()
+    chunks_remaining = 2;
+    // arrival counters for the nodes of the reduction tree (there are fewer
+    //  than 2*count of them)
+    chunk_merge_arrivals.assign(2 * count, 0);
+
+    // every other worker that might be idle gets a chance to help, and then we
+    //  start in on the chunks ourselves
+    chunk_runner = new ChunkRunner(this);
+    for(int i = 1; i < count; i++)
+      op_queue->enqueue_partitioning_microop(chunk_runner);
+
+    run_chunks();
+  }
+
+  void PartitioningMicroOp::run_chunks(void)
+  {
+    while(true) {
+      int index = __sync_fetch_and_add(&next_chunk, 1);
+      if(index >= chunk_count)
+	break;
+      execute_chunk(index);
+      chunk_done(index);
+    }
+  }
+
+  void PartitioningMicroOp::chunk_done(int index)
+  {
+    // parallel tree reduction - at each level, the subtree rooted at 'index'
+    //  is paired with its sibling, and whichever of the two finishes second
+    //  merges the sibling's results (always higher into lower, so chunk
+    //  results stay in order) and carries on up the tree
+    int node_base = 0;
+    for(int stride = 1; stride < chunk_count; stride <<= 1) {
+      int sibling = index ^ stride;
+      int level_nodes = (chunk_count + (2 * stride) - 1) / (2 * stride);
+      if(sibling < chunk_count) {
+	int node = node_base + (index / (2 * stride));
+	if(__sync_add_and_fetch(&chunk_merge_arrivals[node], 1) == 1)
+	  return;  // sibling isn't done yet - it'll carry on from here
+	int lo = std::min(index, sibling);
+	merge_chunks(lo, std::max(index, sibling));
+	index = lo;
+      } else
+	index &= ~stride;
+      node_base += level_nodes;
+    }
+
+    // everything has been merged into chunk 0
+    assert(index == 0);
+    mark_finished();
+  }
+
   void PartitioningMicroOp::finish_dispatch(PartitioningOperation *op, bool inline_ok)
   {
     // make sure we generate work that other threads can help with
@@ -784,6 +921,7 @@ namespace Realm {
 
     cp.add_option_int("-dp:workers", DeppartConfig::cfg_num_partitioning_workers);
     cp.add_option_bool("-dp:noisectopt", DeppartConfig::cfg_disable_intersection_optimization);
+    cp.add_option_int("-dp:chunk", DeppartConfig::cfg_min_points_per_chunk);
 
     cp.parse_command_line(cmdline);
   }
@@ -897,7 +1035,8 @@ namespace Realm {
   template struct IndexSpace<N,T>; \
   template void PartitioningMicroOp::sparsity_map_ready(SparsityMapImpl<N,T>*, bool); \
   template class OverlapTester<N,T>; \
-  template class ComputeOverlapMicroOp<N,T>;
+  template class ComputeOverlapMicroOp<N,T>; \
+  template int PartitioningMicroOp::split_instance_space(const IndexSpace<N,T>&, std::vector<IndexSpace<N,T> >&);
   FOREACH_NT(DOIT)
 
 #define DOIT2(N1,T1,N2,T2) \
@@ -101,6 +101,16 @@ namespace Realm {
     void mark_started(void);
     void mark_finished(void);
 
+    // a micro-op that covers a large instance can split its work into chunks
+    //  that run on several partitioning workers - execute() calls
+    //  execute_in_chunks(), execute_chunk() is then called (concurrently, in any
+    //  order) for each chunk, pairs of chunk results are merged with
+    //  merge_chunks() as they finish, and finish_chunks() is called exactly once
+    //  with everything merged into chunk 0 - only then is the micro-op finished
+    virtual void execute_chunk(int index);
+    virtual void merge_chunks(int dst_index, int src_index);
+    virtual void finish_chunks(void);
+
     template <int N, typename T>
     void sparsity_map_ready(SparsityMapImpl<N,T> *sparsity, bool precise);
 
@@ -119,9 +129,27 @@ namespace Realm {
 
     void finish_dispatch(PartitioningOperation *op, bool inline_ok);
 
+    // decides how many chunks an instance space should be split into (1 means
+    //  don't bother) and computes the pieces if so
+    template <int N, typename T>
+    static int split_instance_space(const IndexSpace<N,T>& space,
+				    std::vector<IndexSpace<N,T> >& pieces);
+
+    void execute_in_chunks(int count);
+    void run_chunks(void);
+    void chunk_done(int index);
+
+    class ChunkRunner;
+    friend class ChunkRunner;
+
     int wait_count;  // how many sparsity maps are we still waiting for?
     NodeID requestor;
     AsyncMicroOp *async_microop;
+
+    // chunked execution state
+    int chunk_count, next_chunk, chunks_remaining;
+    std::vector<int> chunk_merge_arrivals;
+    ChunkRunner *chunk_runner;
   };
 
   template <int N, typename T>
@@ -118,13 +118,14 @@ namespace Realm {
 
   template <int N, typename T, int N2, typename T2>
   template <typename BM>
-  void PreimageMicroOp<N,T,N2,T2>::populate_bitmasks_ptrs(std::map<int, BM *>& bitmasks)
+  void PreimageMicroOp<N,T,N2,T2>::populate_bitmasks_ptrs(const IndexSpace<N,T>& space,
+							  std::map<int, BM *>& bitmasks)
   {
     // for now, one access for the whole instance
     AffineAccessor<Point<N2,T2>,N,T> a_data(inst, field_offset);
 
     // double iteration - use the instance's space first, since it's probably smaller
-    for(IndexSpaceIterator<N,T> it(inst_space); it.valid; it.step()) {
+    for(IndexSpaceIterator<N,T> it(space); it.valid; it.step()) {
       for(IndexSpaceIterator<N,T> it2(parent_space, it.rect); it2.valid; it2.step()) {
 	// now iterate over each point
 	for(PointInRectIterator<N,T> pir(it2.rect); pir.valid; pir.step()) {
@@ -144,13 +145,14 @@ namespace Realm {
 
   template <int N, typename T, int N2, typename T2>
   template <typename BM>
-  void PreimageMicroOp<N,T,N2,T2>::populate_bitmasks_ranges(std::map<int, BM *>& bitmasks)
+  void PreimageMicroOp<N,T,N2,T2>::populate_bitmasks_ranges(const IndexSpace<N,T>& space,
+							    std::map<int, BM *>& bitmasks)
   {
     // for now, one access for the whole instance
     AffineAccessor<Rect<N2,T2>,N,T> a_data(inst, field_offset);
 
     // double iteration - use the instance's space first, since it's probably smaller
-    for(IndexSpaceIterator<N,T> it(inst_space); it.valid; it.step()) {
+    for(IndexSpaceIterator<N,T> it(space); it.valid; it.step()) {
       for(IndexSpaceIterator<N,T> it2(parent_space, it.rect); it2.valid; it2.step()) {
 	// now iterate over each point
 	for(PointInRectIterator<N,T> pir(it2.rect); pir.valid; pir.step()) {
@@ -172,12 +174,21 @@ namespace Realm {
   void PreimageMicroOp<N,T,N2,T2>::execute(void)
   {
     TimeStamp ts("PreimageMicroOp::execute", true, &log_uop_timing);
+
+    // large instances are split up so that other workers can help
+    int chunks = split_instance_space(inst_space, chunk_spaces);
+    if(chunks > 1) {
+      chunk_rect_maps.resize(chunks);
+      execute_in_chunks(chunks);
+      return;
+    }
+
     std::map<int, DenseRectangleList<N,T> *> rect_map;
 
     if(is_ranged)
-      populate_bitmasks_ranges(rect_map);
+      populate_bitmasks_ranges(inst_space, rect_map);
     else
-      populate_bitmasks_ptrs(rect_map);
+      populate_bitmasks_ptrs(inst_space, rect_map);
 
 #ifdef DEBUG_PARTITIONING
     std::cout << rect_map.size() << " non-empty preimages present in instance " << inst << std::endl;
@@ -187,6 +198,35 @@ namespace Realm {
       std::cout << "  " << targets[it->first] << " = " << it->second->rects.size() << " rectangles" << std::endl;
 #endif
 
+    contribute_outputs(rect_map);
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  void PreimageMicroOp<N,T,N2,T2>::execute_chunk(int index)
+  {
+    if(is_ranged)
+      populate_bitmasks_ranges(chunk_spaces[index], chunk_rect_maps[index]);
+    else
+      populate_bitmasks_ptrs(chunk_spaces[index], chunk_rect_maps[index]);
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  void PreimageMicroOp<N,T,N2,T2>::merge_chunks(int dst_index, int src_index)
+  {
+    merge_rect_list_maps(chunk_rect_maps[dst_index], chunk_rect_maps[src_index]);
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  void PreimageMicroOp<N,T,N2,T2>::finish_chunks(void)
+  {
+    contribute_outputs(chunk_rect_maps[0]);
+    chunk_rect_maps.clear();
+    chunk_spaces.clear();
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  void PreimageMicroOp<N,T,N2,T2>::contribute_outputs(std::map<int, DenseRectangleList<N,T> *>& rect_map)
+  {
     // iterate over sparsity outputs and contribute to all (even if we didn't have any
     //  points found for it)
     int empty_count = 0;
@@ -209,7 +249,7 @@ namespace Realm {
   void PreimageMicroOp<N,T,N2,T2>::dispatch(PartitioningOperation *op, bool inline_ok)
   {
     // a PreimageMicroOp should always be executed on whichever node the field data lives
-    NodeID exec_node = ID(inst).sparsity.creator_node;
+    NodeID exec_node = ID(inst).instance.owner_node;
 
     if(exec_node != my_node_id) {
       // we're going to ship it elsewhere, which means we always need an AsyncMicroOp to
@@ -328,9 +368,9 @@ namespace Realm {
       target_node = ID(target.sparsity).sparsity.creator_node;
     else
       if(!ptr_data.empty())
-	target_node = ID(ptr_data[targets.size() % ptr_data.size()].inst).sparsity.creator_node;
+	target_node = ID(ptr_data[targets.size() % ptr_data.size()].inst).instance.owner_node;
       else
-	target_node = ID(range_data[targets.size() % range_data.size()].inst).sparsity.creator_node;
+	target_node = ID(range_data[targets.size() % range_data.size()].inst).instance.owner_node;
     SparsityMap<N,T> sparsity = get_runtime()->get_available_sparsity_impl(target_node)->me.convert<SparsityMap<N,T> >();
     preimage.sparsity = sparsity;
 
@@ -19,6 +19,7 @@
 #define REALM_DEPPART_PREIMAGE_H
 
 #include "realm/deppart/partitions.h"
+#include "realm/deppart/rectlist.h"
 
 namespace Realm {
 
@@ -42,6 +43,10 @@ namespace Realm {
 
     virtual void execute(void);
 
+    virtual void execute_chunk(int index);
+    virtual void merge_chunks(int dst_index, int src_index);
+    virtual void finish_chunks(void);
+
     void dispatch(PartitioningOperation *op, bool inline_ok);
 
   protected:
@@ -54,10 +59,14 @@ namespace Realm {
     PreimageMicroOp(NodeID _requestor, AsyncMicroOp *_async_microop, S& s);
 
     template <typename BM>
-    void populate_bitmasks_ptrs(std::map<int, BM *>& bitmasks);
+    void populate_bitmasks_ptrs(const IndexSpace<N,T>& space,
+				std::map<int, BM *>& bitmasks);
 
     template <typename BM>
-    void populate_bitmasks_ranges(std::map<int, BM *>& bitmasks);
+    void populate_bitmasks_ranges(const IndexSpace<N,T>& space,
+				  std::map<int, BM *>& bitmasks);
+
+    void contribute_outputs(std::map<int, DenseRectangleList<N,T> *>& rect_map);
 
     IndexSpace<N,T> parent_space, inst_space;
     RegionInstance inst;
@@ -65,6 +74,8 @@ namespace Realm {
     bool is_ranged;
     std::vector<IndexSpace<N2,T2> > targets;
     std::vector<SparsityMap<N,T> > sparsity_outputs;
+    std::vector<IndexSpace<N,T> > chunk_spaces;
+    std::vector<std::map<int, DenseRectangleList<N,T> *> > chunk_rect_maps;
   };
 
   template <int N, typename T, int N2, typename T2>
@@ -20,6 +20,8 @@
 
 #include "realm/indexspace.h"
 
+#include <map>
+
 namespace Realm {
 
   // although partitioning operations eventually generate SparsityMap's, we work with
@@ -82,6 +84,17 @@ namespace Realm {
   template <int N, typename T>
   std::ostream& operator<<(std::ostream& os, const HybridRectangleList<N,T>& hrl);
 
+  // merges per-key rectangle lists built by separate chunks of a micro-op - each
+  //  list in 'src' is either moved into 'dst' or, if 'dst' already has a list for
+  //  that key, added to it and deleted
+  template <typename K, int N, typename T>
+  void merge_rect_list_maps(std::map<K, DenseRectangleList<N,T> *>& dst,
+			    std::map<K, DenseRectangleList<N,T> *>& src);
+
+  template <typename K, int N, typename T>
+  void merge_rect_list_maps(std::map<K, HybridRectangleList<N,T> *>& dst,
+			    std::map<K, HybridRectangleList<N,T> *>& src);
+
 };
 
 #endif // REALM_DEPPART_RECTLIST_H
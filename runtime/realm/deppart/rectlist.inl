@@ -650,6 +650,52 @@ namespace Realm {
     return os;
   }
     
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // merging of chunk results
+
+  template <typename K, int N, typename T>
+  inline void merge_rect_list_maps(std::map<K, DenseRectangleList<N,T> *>& dst,
+				   std::map<K, DenseRectangleList<N,T> *>& src)
+  {
+    for(typename std::map<K, DenseRectangleList<N,T> *>::iterator it = src.begin();
+	it != src.end();
+	++it) {
+      DenseRectangleList<N,T> *&dlist = dst[it->first];
+      if(dlist) {
+	for(typename std::vector<Rect<N,T> >::const_iterator it2 = it->second->rects.begin();
+	    it2 != it->second->rects.end();
+	    ++it2)
+	  dlist->add_rect(*it2);
+	delete it->second;
+      } else
+	dlist = it->second;
+    }
+    src.clear();
+  }
+
+  template <typename K, int N, typename T>
+  inline void merge_rect_list_maps(std::map<K, HybridRectangleList<N,T> *>& dst,
+				   std::map<K, HybridRectangleList<N,T> *>& src)
+  {
+    for(typename std::map<K, HybridRectangleList<N,T> *>::iterator it = src.begin();
+	it != src.end();
+	++it) {
+      HybridRectangleList<N,T> *&dlist = dst[it->first];
+      if(dlist) {
+	const std::vector<Rect<N,T> >& rects = it->second->convert_to_vector();
+	for(typename std::vector<Rect<N,T> >::const_iterator it2 = rects.begin();
+	    it2 != rects.end();
+	    ++it2)
+	  dlist->add_rect(*it2);
+	delete it->second;
+      } else
+	dlist = it->second;
+    }
+    src.clear();
+  }
+
 };
 
 #endif // REALM_DEPPART_RECTLIST_INL
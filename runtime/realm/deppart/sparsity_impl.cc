@@ -154,7 +154,7 @@ namespace Realm {
 
   template <int N, typename T>
   SparsityMapPublicImpl<N,T>::SparsityMapPublicImpl(void)
-    : entries_valid(false), approx_valid(false)
+    : entries_valid(false), approx_valid(false), index_valid(false)
   {}
 
   // call actual implementation - inlining makes this cheaper than a virtual method
@@ -165,6 +165,13 @@ namespace Realm {
     return static_cast<SparsityMapImpl<N,T> *>(this)->make_valid(precise);
   }
 
+  template <int N, typename T>
+  __attribute__ ((noinline))
+  void SparsityMapPublicImpl<N,T>::build_index(void)
+  {
+    static_cast<SparsityMapImpl<N,T> *>(this)->build_index();
+  }
+
 
   ////////////////////////////////////////////////////////////////////////
   //
@@ -244,6 +251,52 @@ namespace Realm {
     return e;
   }
 
+  // actual implementation - SparsityMapPublicImpl's version just calls this one
+  template <int N, typename T>
+  void SparsityMapImpl<N,T>::build_index(void)
+  {
+    // entries are immutable once valid, so the only race is with other
+    //  threads trying to build the same index
+    assert(this->entries_valid);
+    AutoHSLLock al(mutex);
+    if(this->index_valid)
+      return;
+
+    const size_t fanout = SparsityMapPublicImpl<N,T>::INDEX_FANOUT;
+
+    // level 0 summarizes the entries themselves
+    this->index_level_starts.push_back(0);
+    size_t level_size = 0;
+    for(size_t i = 0; i < this->entries.size(); i += fanout) {
+      size_t last = std::min(i + fanout, this->entries.size());
+      Rect<N,T> bbox = this->entries[i].bounds;
+      for(size_t j = i + 1; j < last; j++)
+	bbox = bbox.union_bbox(this->entries[j].bounds);
+      this->index_bounds.push_back(bbox);
+      level_size++;
+    }
+
+    // each higher level summarizes the one below it, until we have a single root
+    while(level_size > 1) {
+      size_t prev_start = this->index_level_starts.back();
+      this->index_level_starts.push_back(this->index_bounds.size());
+      size_t new_size = 0;
+      for(size_t i = 0; i < level_size; i += fanout) {
+	size_t last = std::min(i + fanout, level_size);
+	Rect<N,T> bbox = this->index_bounds[prev_start + i];
+	for(size_t j = i + 1; j < last; j++)
+	  bbox = bbox.union_bbox(this->index_bounds[prev_start + j]);
+	this->index_bounds.push_back(bbox);
+	new_size++;
+      }
+      level_size = new_size;
+    }
+
+    // make sure the index contents are visible before the flag is
+    __sync_synchronize();
+    this->index_valid = true;
+  }
+
 
   // methods used in the population of a sparsity map
 
@@ -619,6 +672,19 @@ namespace Realm {
     return lhs.bounds.lo.x < rhs.bounds.lo.x;
   }
 
+  // orders entries by their low corner, with the last dimension being the most
+  //  significant - this keeps entries that are near each other in space near each
+  //  other in the list, which is what makes the spatial index effective
+  template <int N, typename T>
+  static inline bool entry_lo_comp(const SparsityMapEntry<N,T>& lhs,
+				   const SparsityMapEntry<N,T>& rhs)
+  {
+    for(int i = N - 1; i >= 0; i--)
+      if(lhs.bounds.lo[i] != rhs.bounds.lo[i])
+	return lhs.bounds.lo[i] < rhs.bounds.lo[i];
+    return false;
+  }
+
   template <int N, typename T>
   static void compute_approximation(const std::vector<SparsityMapEntry<N,T> >& entries,
 				    std::vector<Rect<N,T> >& approx_rects,
@@ -714,6 +780,10 @@ namespace Realm {
       std::sort(this->entries.begin(), this->entries.end(), non_overlapping_bounds_1d_comp<N,T>);
       for(size_t i = 1; i < this->entries.size(); i++)
 	assert(this->entries[i-1].bounds.hi.x < (this->entries[i].bounds.lo.x - 1));
+    } else {
+      // for N > 1, the order of contributions is arbitrary - sort so that iteration
+      //  order is deterministic and the spatial index groups nearby entries
+      std::sort(this->entries.begin(), this->entries.end(), entry_lo_comp<N,T>);
     }
 
     // now that we've got our entries nice and tidy, build a bounded approximation of them
@@ -1024,6 +1094,7 @@ namespace Realm {
   void (*dummy)(int, std::vector<void *> *) __attribute__((weak, unused)) = &instantiate_stuff;
 
 #define DOIT(N,T) \
+  template class SparsityMapPublicImpl<N,T>; \
   template class SparsityMapImpl<N,T>;
   FOREACH_NT(DOIT)
 
@@ -37,6 +37,9 @@ namespace Realm {
     // actual implementation - SparsityMapPublicImpl's version just calls this one
     Event make_valid(bool precise = true);
 
+    // same for the spatial index
+    void build_index(void);
+
     static SparsityMapImpl<N,T> *lookup(SparsityMap<N,T> sparsity);
 
     // methods used in the population of a sparsity map
@@ -21,6 +21,9 @@
 #include "realm/threads.h"
 #include "realm/profiling.h"
 
+// for sched_yield
+#include <sched.h>
+
 namespace Realm {
 
   Logger log_event("event");
@@ -550,8 +553,15 @@ namespace Realm {
 	    // already triggered!?
 	    assert(0);
 	  } else if((impl->generation + 1) == id.event.generation) {
-	    // current generation
-	    waiters_copy.assign(impl->current_local_waiters.begin(),
+	    // current generation - the owner keeps some waiters in inline slots
+	    if(impl->owner == my_node_id)
+	      for(unsigned i = 0; i < GenEventImpl::NUM_INLINE_WAITERS; i++) {
+		EventWaiter *w = impl->inline_waiters[i];
+		if(w != 0)
+		  waiters_copy.push_back(w);
+	      }
+	    waiters_copy.insert(waiters_copy.end(),
+				impl->current_local_waiters.begin(),
 				impl->current_local_waiters.end());
 	  } else {
 	    std::map<EventImpl::gen_t, std::vector<EventWaiter *> >::const_iterator it = impl->future_local_waiters.find(id.event.generation);
@@ -641,6 +651,10 @@ namespace Realm {
     num_poisoned_generations = 0;
     poisoned_generations = 0;
     has_local_triggers = false;
+    waiter_state = 0;
+    for(unsigned i = 0; i < NUM_INLINE_WAITERS; i++)
+      inline_waiters[i] = 0;
+    has_locked_waiters = false;
   }
 
   void GenEventImpl::init(ID _me, unsigned _init_owner)
@@ -653,6 +667,10 @@ namespace Realm {
     num_poisoned_generations = 0;
     poisoned_generations = 0;
     has_local_triggers = false;
+    waiter_state = 0;
+    for(unsigned i = 0; i < NUM_INLINE_WAITERS; i++)
+      inline_waiters[i] = 0;
+    has_locked_waiters = false;
   }
 
 
@@ -1064,11 +1082,43 @@ namespace Realm {
       bool trigger_now = false;
       bool trigger_poisoned = false;
 
+      // on the owner, try to claim an inline slot without taking the mutex
+      if(owner == my_node_id) {
+	while(true) {
+	  uint64_t state = waiter_state;
+	  if(needed_gen <= (gen_t)(state >> 32)) {
+	    // already triggered - poison info is valid after a barrier
+	    __sync_synchronize();
+	    trigger_now = true;
+	    trigger_poisoned = is_generation_poisoned(needed_gen);
+	    break;
+	  }
+
+	  // slots all in use (or being emptied by a trigger) - use the mutex
+	  unsigned slot = (unsigned)(state & 0xFFFFFFFFULL);
+	  if(slot >= NUM_INLINE_WAITERS)
+	    break;
+
+	  if(__sync_bool_compare_and_swap(&waiter_state, state, state + 1)) {
+	    // the slot is ours - a concurrent trigger will wait for us to fill it
+	    inline_waiters[slot] = waiter;
+	    return true;
+	  }
+	}
+      }
+
       int subscribe_owner = -1;
       gen_t previous_subscribe_gen = 0;
-      {
+      if(!trigger_now) {
 	AutoHSLLock a(mutex);
 
+	// the owner's trigger only takes the mutex if it sees this flag, and
+	//  it updates the generation before looking, so set it before we check
+	if(owner == my_node_id) {
+	  has_locked_waiters = true;
+	  __sync_synchronize();
+	}
+
 	// three cases below
 
 	if(needed_gen <= generation) {
@@ -1241,6 +1291,11 @@ namespace Realm {
       } else {
 	AutoHSLLock a(impl->mutex);
 
+	// flag the (likely) subscription before looking at the generation - see
+	//  GenEventImpl::add_waiter
+	impl->has_locked_waiters = true;
+	__sync_synchronize();
+
 	// look at the previously-subscribed generation from the requestor - we'll send
 	//  a trigger message if anything newer has triggered
         if(impl->generation > args.previous_subscribe_gen)
@@ -1554,36 +1609,66 @@ namespace Realm {
 	NodeSet to_update;
 	bool free_event = false;
 
-	{
+	// must always be the next generation
+	assert(gen_triggered == (generation + 1));
+
+	// update poisoned generation list - the only part of an owner's trigger
+	//  that always needs the mutex
+	if(poisoned) {
 	  AutoHSLLock a(mutex);
 
-	  // must always be the next generation
-	  assert(gen_triggered == (generation + 1));
+	  if(!poisoned_generations)
+	    poisoned_generations = new gen_t[POISONED_GENERATION_LIMIT];
+	  assert(num_poisoned_generations < POISONED_GENERATION_LIMIT);
+	  poisoned_generations[num_poisoned_generations++] = gen_triggered;
+	}
+
+	// update generation next, with a synchronization to make sure poisoned generation
+	// list is valid to any observer of this update
+	__sync_synchronize();
+	generation = gen_triggered;
+
+	// now publish the generation in the waiter state as well, closing the
+	//  inline slots - anybody who claimed one before this has (or is about
+	//  to) put their waiter in it
+	unsigned claimed;
+	while(true) {
+	  uint64_t state = waiter_state;
+	  claimed = (unsigned)(state & 0xFFFFFFFFULL);
+	  assert(claimed <= NUM_INLINE_WAITERS);
+	  if(__sync_bool_compare_and_swap(&waiter_state, state,
+					  ((((uint64_t)gen_triggered) << 32) |
+					   INLINE_WAITERS_CLOSED)))
+	    break;
+	}
+	EventWaiter *inline_to_wake[NUM_INLINE_WAITERS];
+	for(unsigned i = 0; i < claimed; i++) {
+	  EventWaiter *w;
+	  while((w = inline_waiters[i]) == 0)
+	    sched_yield();
+	  inline_to_wake[i] = w;
+	  inline_waiters[i] = 0;
+	}
+	__sync_synchronize();
+	waiter_state = ((uint64_t)gen_triggered) << 32;
+
+	// overflow waiters and remote subscribers are under the mutex - the CAS
+	//  above orders our check of the flag after the generation update
+	if(has_locked_waiters) {
+	  AutoHSLLock a(mutex);
 
 	  to_wake.swap(current_local_waiters);
 	  assert(future_local_waiters.empty()); // no future waiters here
 
 	  to_update.swap(remote_waiters);
-
-	  // update poisoned generation list
-	  if(poisoned) {
-	    if(!poisoned_generations)
-	      poisoned_generations = new gen_t[POISONED_GENERATION_LIMIT];
-	    assert(num_poisoned_generations < POISONED_GENERATION_LIMIT);
-	    poisoned_generations[num_poisoned_generations++] = gen_triggered;
-	  }
-
-	  // update generation last, with a synchronization to make sure poisoned generation
-	  // list is valid to any observer of this update
-	  __sync_synchronize();
-	  generation = gen_triggered;
-
-	  // we'll free the event unless it's maxed out on poisoned generations
-	  //  or generation count
-	  free_event = ((num_poisoned_generations < POISONED_GENERATION_LIMIT) &&
-			(generation < ((1U << ID::EVENT_GENERATION_WIDTH) - 1)));
+	  has_locked_waiters = false;
 	}
 
+	// we'll free the event unless it's maxed out on poisoned generations
+	//  or generation count
+	free_event = ((num_poisoned_generations < POISONED_GENERATION_LIMIT) &&
+		      (generation < ((1U << ID::EVENT_GENERATION_WIDTH) - 1)));
+
 	// any remote nodes to notify?
 	if(!to_update.empty())
 	  EventUpdateMessage::broadcast_request(to_update, 
@@ -1594,6 +1679,13 @@ namespace Realm {
 	// free event?
 	if(free_event)
 	  get_runtime()->local_event_free_list->free_entry(this);
+
+	// wake the inline waiters here - any others are handled below
+	for(unsigned i = 0; i < claimed; i++) {
+	  bool nuke = inline_to_wake[i]->event_triggered(e, poisoned);
+	  if(nuke)
+	    delete inline_to_wake[i];
+	}
       } else {
 	// we're triggering somebody else's event, so the first thing to do is tell them
 	assert(trigger_node == (int)my_node_id);
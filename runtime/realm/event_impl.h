@@ -134,13 +134,27 @@ namespace Realm {
       // this is only manipulated when the event is "idle"
       GenEventImpl *next_free;
 
+      // on the owner, the first few local waiters for the current generation are
+      //  kept in inline slots that are claimed with a CAS on 'waiter_state' -
+      //  it packs the last triggered generation (upper 32 bits) with the number
+      //  of claimed slots, so adding a waiter and triggering don't need the mutex
+      static const unsigned NUM_INLINE_WAITERS = 8;
+      static const uint64_t INLINE_WAITERS_CLOSED = 1ULL << 31;
+      volatile uint64_t waiter_state;
+      EventWaiter * volatile inline_waiters[NUM_INLINE_WAITERS];
+
+      // set on the owner whenever the mutex-protected waiter lists below might be
+      //  non-empty, so that a trigger can skip the mutex otherwise
+      volatile bool has_locked_waiters;
+
       // everything below here protected by this mutex
       GASNetHSL mutex;
 
       // local waiters are tracked by generation - an easily-accessed list is used
-      //  for the "current" generation, whereas a map-by-generation-id is used for
-      //  "future" generations (i.e. ones ahead of what we've heard about if we're
-      //  not the owner)
+      //  for the "current" generation (on the owner, this only holds waiters that
+      //  didn't fit in the inline slots), whereas a map-by-generation-id is used
+      //  for "future" generations (i.e. ones ahead of what we've heard about if
+      //  we're not the owner)
       std::vector<EventWaiter *> current_local_waiters;
       std::map<gen_t, std::vector<EventWaiter *> > future_local_waiters;
 
@@ -18,6 +18,8 @@
 #include "realm/hdf5/hdf5_access.h"
 #include "realm/deppart/inst_helper.h"
 #include "realm/machine.h"
+#include "realm/runtime_impl.h"
+#include "realm/inst_impl.h"
 
 namespace Realm {
 
@@ -66,7 +68,14 @@ namespace Realm {
     }
 
     // and now create the instance using this layout
-    return create_instance(inst, memory, layout, prs, wait_on);
+    Event e = create_instance(inst, memory, layout, prs, wait_on);
+
+    // remember the filename so that any cached handles for the file can be
+    //  dropped when the instance is detached
+    RegionInstanceImpl *impl = get_runtime()->get_instance_impl(inst);
+    impl->metadata.filename = file_name;
+
+    return e;
   }
 
 #define DOIT(N,T) \
@@ -27,14 +27,22 @@ namespace Realm {
     //
     // class HDF5Memory
 
-    HDF5Memory::HDF5Memory(Memory _me)
+    HDF5Memory::HDF5Memory(Memory _me, size_t _max_unused_files)
       : MemoryImpl(_me, 0 /*HDF doesn't have memory space*/, MKIND_HDF, ALIGNMENT, Memory::HDF_MEM)
+      , max_unused_files(_max_unused_files)
     {
     }
 
     HDF5Memory::~HDF5Memory(void)
     {
       // close all HDF metadata
+      unused_files.clear();
+      while(!open_files.empty()) {
+	OpenFile *file = open_files.begin()->second;
+	if(file->refcount > 0)
+	  log_hdf5.warning() << "file '" << file->filename << "' still in use at shutdown";
+	close_file(file);
+      }
     }
 
     off_t HDF5Memory::alloc_bytes(size_t size)
@@ -112,6 +120,134 @@ namespace Realm {
       return my_node_id;
     }
 
+    void HDF5Memory::release_instance_storage(RegionInstance i,
+					      Event precondition)
+    {
+      // the file may be modified by somebody else once it's detached, so
+      //  don't keep a possibly-stale handle for it around
+      const std::string& filename = get_instance(i)->metadata.filename;
+      if(!filename.empty())
+	invalidate_file(filename);
+
+      MemoryImpl::release_instance_storage(i, precondition);
+    }
+
+    HDF5Memory::OpenFile *HDF5Memory::acquire_file(const std::string& filename,
+						   bool read_only)
+    {
+      AutoHSLLock al(cache_mutex);
+
+      std::map<std::string, OpenFile *>::iterator it = open_files.find(filename);
+      if(it != open_files.end()) {
+	OpenFile *file = it->second;
+	if(!file->stale && (read_only || !file->read_only)) {
+	  if(file->refcount++ == 0)
+	    unused_files.erase(file->lru_pos);
+	  log_hdf5.debug() << "file cache hit: \"" << filename << "\" = " << file->file_id;
+	  return file;
+	}
+
+	// HDF5 won't let us open the same file twice, so we can only upgrade
+	//  to read/write access (or replace a stale handle) if nobody else is
+	//  using the current one
+	if(file->refcount > 0) {
+	  log_hdf5.fatal() << "file '" << filename << "' is in use and cannot be reopened"
+			   << (file->stale ? "" : " for writing");
+	  assert(0);
+	}
+	unused_files.erase(file->lru_pos);
+	close_file(file);
+      }
+
+      OpenFile *file = new OpenFile;
+      file->filename = filename;
+      file->read_only = read_only;
+      file->refcount = 1;
+      file->stale = false;
+      CHECK_HDF5( file->file_id = H5Fopen(filename.c_str(),
+					  (read_only ? H5F_ACC_RDONLY :
+					               H5F_ACC_RDWR),
+					  H5P_DEFAULT) );
+      log_hdf5.info() << "H5Fopen(\"" << filename << "\") = " << file->file_id;
+      open_files[filename] = file;
+      return file;
+    }
+
+    void HDF5Memory::release_file(OpenFile *file)
+    {
+      AutoHSLLock al(cache_mutex);
+
+      assert(file->refcount > 0);
+      if(--file->refcount > 0)
+	return;
+
+      if(file->stale || (max_unused_files == 0)) {
+	close_file(file);
+	return;
+      }
+
+      file->lru_pos = unused_files.insert(unused_files.end(), file);
+      while(unused_files.size() > max_unused_files) {
+	OpenFile *victim = unused_files.front();
+	unused_files.pop_front();
+	close_file(victim);
+      }
+    }
+
+    HDF5Memory::OpenDataset HDF5Memory::get_dataset(OpenFile *file,
+						    const std::string& dsetname)
+    {
+      AutoHSLLock al(cache_mutex);
+
+      assert(file->refcount > 0);
+      std::map<std::string, OpenDataset>::const_iterator it = file->datasets.find(dsetname);
+      if(it != file->datasets.end())
+	return it->second;
+
+      OpenDataset ds;
+      CHECK_HDF5( ds.dset_id = H5Dopen2(file->file_id, dsetname.c_str(),
+					H5P_DEFAULT) );
+      CHECK_HDF5( ds.dtype_id = H5Dget_type(ds.dset_id) );
+      log_hdf5.info() << "H5Dopen2(" << file->file_id << ", \"" << dsetname << "\") = " << ds.dset_id;
+      file->datasets[dsetname] = ds;
+      return ds;
+    }
+
+    void HDF5Memory::invalidate_file(const std::string& filename)
+    {
+      AutoHSLLock al(cache_mutex);
+
+      std::map<std::string, OpenFile *>::iterator it = open_files.find(filename);
+      if(it == open_files.end())
+	return;
+
+      OpenFile *file = it->second;
+      if(file->refcount > 0) {
+	file->stale = true;
+      } else {
+	unused_files.erase(file->lru_pos);
+	close_file(file);
+      }
+    }
+
+    // caller must hold cache_mutex (or be the destructor) and have already
+    //  taken the file out of the LRU list
+    void HDF5Memory::close_file(OpenFile *file)
+    {
+      for(std::map<std::string, OpenDataset>::const_iterator it = file->datasets.begin();
+	  it != file->datasets.end();
+	  ++it) {
+	log_hdf5.info() << "H5Dclose(" << it->second.dset_id << " /* \"" << it->first << "\" */)";
+	CHECK_HDF5( H5Tclose(it->second.dtype_id) );
+	CHECK_HDF5( H5Dclose(it->second.dset_id) );
+      }
+      log_hdf5.info() << "H5Fclose(" << file->file_id << " /* \"" << file->filename << "\" */)";
+      CHECK_HDF5( H5Fclose(file->file_id) );
+
+      open_files.erase(file->filename);
+      delete file;
+    }
+
 
     ////////////////////////////////////////////////////////////////////////
     //
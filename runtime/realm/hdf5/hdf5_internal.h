@@ -22,6 +22,8 @@
 
 #include <hdf5.h>
 
+#include <list>
+
 #define CHECK_HDF5(cmd) \
   do { \
     herr_t res = (cmd); \
@@ -40,7 +42,7 @@ namespace Realm {
     public:
       static const size_t ALIGNMENT = 256;
 
-      HDF5Memory(Memory _me);
+      HDF5Memory(Memory _me, size_t _max_unused_files);
 
       virtual ~HDF5Memory(void);
 
@@ -55,6 +57,50 @@ namespace Realm {
       virtual void *get_direct_ptr(off_t offset, size_t size);
       virtual int get_home_node(off_t offset, size_t size);
 
+      // closes the instance's file once nobody is using it
+      virtual void release_instance_storage(RegionInstance i,
+					    Event precondition);
+
+      // file and dataset handles are cached across transfers so that
+      //  repeated copies to/from the same file don't reopen it (and reread
+      //  its metadata) each time - a file stays open while anybody holds a
+      //  reference to it, and up to 'max_unused_files' unreferenced files
+      //  are kept open, closing the least recently used first
+      struct OpenDataset {
+	hid_t dset_id;
+	hid_t dtype_id;
+      };
+
+      struct OpenFile {
+	std::string filename;
+	hid_t file_id;
+	bool read_only;
+	int refcount;
+	bool stale;  // close as soon as the last reference goes away
+	std::map<std::string, OpenDataset> datasets;
+	std::list<OpenFile *>::iterator lru_pos;  // only valid if refcount == 0
+      };
+
+      // returns a reference to an open handle for 'filename' - a file that
+      //  is already open read-only is reopened if write access is needed
+      OpenFile *acquire_file(const std::string& filename, bool read_only);
+      void release_file(OpenFile *file);
+
+      // caller must hold a reference on 'file'
+      OpenDataset get_dataset(OpenFile *file, const std::string& dsetname);
+
+      // makes sure nothing stale is kept open for a file (e.g. because it
+      //  has been detached and may be modified by somebody else)
+      void invalidate_file(const std::string& filename);
+
+    protected:
+      void close_file(OpenFile *file);
+
+      GASNetHSL cache_mutex;
+      size_t max_unused_files;
+      std::map<std::string, OpenFile *> open_files;
+      std::list<OpenFile *> unused_files;  // least recently used first
+
     public:
       struct HDFMetadata {
         int lo[3];
@@ -40,6 +40,7 @@ namespace Realm {
     HDF5Module::HDF5Module(void)
       : Module("hdf5")
       , cfg_showerrors(true)
+      , cfg_cache_size(16)
       , version_major(0)
       , version_minor(0)
       , version_rel(0)
@@ -63,6 +64,7 @@ namespace Realm {
 	CommandLineParser cp;
 
 	cp.add_option_bool("-hdf5:showerrors", m->cfg_showerrors);
+	cp.add_option_int("-hdf5:cachesize", m->cfg_cache_size);
 	
 	bool ok = cp.parse_command_line(cmdline);
 	if(!ok) {
@@ -136,7 +138,7 @@ namespace Realm {
       Module::create_memories(runtime);
 
       Memory m = runtime->next_local_memory_id();
-      hdf5mem = new HDF5Memory(m);
+      hdf5mem = new HDF5Memory(m, cfg_cache_size);
       runtime->add_memory(hdf5mem);
     }
 
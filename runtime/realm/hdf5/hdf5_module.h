@@ -60,6 +60,7 @@ namespace Realm {
 
     public:
       bool cfg_showerrors;
+      size_t cfg_cache_size;  // unused open files to keep around
 
       unsigned version_major, version_minor, version_rel;
       bool threadsafe;
@@ -895,13 +895,15 @@ namespace Realm {
       }
       return true;
     } else {
-      for(typename std::vector<SparsityMapEntry<N,T> >::const_iterator it = entries.begin();
-	  it != entries.end();
-	  it++) {
-	if(!it->bounds.contains(p)) continue;
-	if(it->sparsity.exists()) {
+      // let the sparsity map's spatial index find candidate entries
+      Rect<N,T> r(p, p);
+      for(size_t idx = impl->find_overlapping_entry(r);
+	  idx < entries.size();
+	  idx = impl->find_overlapping_entry(r, idx + 1)) {
+	const SparsityMapEntry<N,T>& e = entries[idx];
+	if(e.sparsity.exists()) {
 	  assert(0);
-	} else if(it->bitmap != 0) {
+	} else if(e.bitmap != 0) {
 	  assert(0);
 	} else {
 	  return true;
@@ -939,13 +941,13 @@ namespace Realm {
       // test against sparsity map too
       SparsityMapPublicImpl<N,T> *impl = sparsity.impl();
       const std::vector<SparsityMapEntry<N,T> >& entries = impl->get_entries();
-      for(typename std::vector<SparsityMapEntry<N,T> >::const_iterator it = entries.begin();
-	  it != entries.end();
-	  it++) {
-	if(!it->bounds.overlaps(r)) continue;
-	if(it->sparsity.exists()) {
+      for(size_t idx = impl->find_overlapping_entry(r);
+	  idx < entries.size();
+	  idx = impl->find_overlapping_entry(r, idx + 1)) {
+	const SparsityMapEntry<N,T>& e = entries[idx];
+	if(e.sparsity.exists()) {
 	  assert(0);
-	} else if(it->bitmap != 0) {
+	} else if(e.bitmap != 0) {
 	  assert(0);
 	} else {
 	  return true;
@@ -1393,11 +1395,12 @@ namespace Realm {
       s_impl = space.sparsity.impl();
       const std::vector<SparsityMapEntry<N,T> >& entries = s_impl->get_entries();
       // find the first entry that overlaps our restriction - speed this up with a
-      //  binary search on the low end of the restriction if we're 1-D
+      //  binary search on the low end of the restriction if we're 1-D, or the
+      //  sparsity map's spatial index otherwise
       if(N == 1)
 	cur_entry = bsearch_map_entries(entries, restriction.lo);
       else
-	cur_entry = 0;
+	cur_entry = s_impl->find_overlapping_entry(restriction);
 
       while(cur_entry < entries.size()) {
 	const SparsityMapEntry<N,T>& e = entries[cur_entry];
@@ -1433,11 +1436,12 @@ namespace Realm {
       s_impl = space.sparsity.impl();
       const std::vector<SparsityMapEntry<N,T> >& entries = s_impl->get_entries();
       // find the first entry that overlaps our restriction - speed this up with a
-      //  binary search on the low end of the restriction if we're 1-D
+      //  binary search on the low end of the restriction if we're 1-D, or the
+      //  sparsity map's spatial index otherwise
       if(N == 1)
 	cur_entry = bsearch_map_entries(entries, restriction.lo);
       else
-	cur_entry = 0;
+	cur_entry = s_impl->find_overlapping_entry(restriction);
 
       while(cur_entry < entries.size()) {
 	const SparsityMapEntry<N,T>& e = entries[cur_entry];
@@ -1472,6 +1476,12 @@ namespace Realm {
     // move onto the next sparsity entry (that overlaps our restriction)
     const std::vector<SparsityMapEntry<N,T> >& entries = s_impl->get_entries();
     for(cur_entry++; cur_entry < entries.size(); cur_entry++) {
+      // in more than 1-D, skip directly to the next entry that overlaps
+      if(N > 1) {
+	cur_entry = s_impl->find_overlapping_entry(restriction, cur_entry);
+	if(cur_entry >= entries.size())
+	  break;
+      }
       const SparsityMapEntry<N,T>& e = entries[cur_entry];
       rect = restriction.intersection(e.bounds);
       if(rect.empty()) {
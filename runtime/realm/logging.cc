@@ -20,15 +20,20 @@
 #include "realm/activemsg.h"
 
 #include "realm/cmdline.h"
+#include "realm/timers.h"
 
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
 
 #include <set>
 #include <map>
+#include <vector>
 
 namespace Realm {
 
@@ -136,6 +141,376 @@ namespace Realm {
     pthread_mutex_t mutex;
   };
 
+  // asynchronous output - each thread that logs gets its own single-producer/
+  //  single-consumer ring buffer, so writing a message is just a copy with no
+  //  locks or system calls, and a background thread merges the rings (in
+  //  timestamp order) into large writes to the underlying stream
+  //
+  // memory use is bounded by the ring size times the number of threads that
+  //  log concurrently (rings of exited threads are reused) - when a ring fills
+  //  up, the writing thread either waits for the background thread to catch
+  //  up or drops the message (counting how many were lost)
+  class LoggerStreamAsync : public LoggerOutputStream {
+  public:
+    LoggerStreamAsync(LoggerOutputStream *_stream, bool _delete_inner,
+		      size_t _ring_size, bool _drop_when_full);
+    virtual ~LoggerStreamAsync(void);
+
+    virtual void write(const char *buffer, size_t len);
+
+    // writes out everything logged so far (by any thread)
+    virtual void flush(void);
+
+  protected:
+    struct Ring {
+      Ring(size_t _size);
+      ~Ring(void);
+
+      void copy_in(size_t pos, const void *src, size_t bytes);
+      void copy_out(size_t pos, void *dst, size_t bytes) const;
+
+      // head and tail are byte counts that only ever increase - tail is
+      //  written only by the owning thread and head only by the drainer
+      volatile size_t tail __attribute__((aligned(64)));
+      volatile size_t head __attribute__((aligned(64)));
+      char *data;
+      size_t size;  // power of two
+      int in_use;   // non-zero while claimed by a live thread
+      Ring *next;
+    };
+
+    struct RecordHeader {
+      long long timestamp;
+      size_t length;
+    };
+
+    Ring *get_thread_ring(void);
+    static void release_thread_ring(void *ring);
+
+    static void *writer_loop(void *arg);
+    void wake_writer(void);
+
+    // moves everything in the rings out to the underlying stream - caller
+    //  must hold drain_mutex
+    void drain(void);
+    void append_output(const char *data, size_t len);
+
+    LoggerOutputStream *stream;
+    bool delete_inner;
+    size_t ring_size;
+    bool drop_when_full;
+    Ring * volatile rings;  // list is append-only
+    pthread_key_t ring_key;
+    pthread_mutex_t drain_mutex;
+    pthread_mutex_t wake_mutex;
+    pthread_cond_t wake_cond;
+    volatile bool writer_waiting, shutdown_requested;
+    pthread_t writer_thread;
+    size_t dropped_count;
+    std::vector<char> outbuf;
+    size_t outbuf_used;
+    // scratch space used by drain()
+    std::vector<Ring *> drain_rings;
+    std::vector<size_t> drain_tails;
+    std::vector<RecordHeader> drain_headers;
+  };
+
+  LoggerStreamAsync::Ring::Ring(size_t _size)
+    : tail(0), head(0), size(_size), in_use(1), next(0)
+  {
+    data = (char *)malloc(size);
+    assert(data != 0);
+  }
+
+  LoggerStreamAsync::Ring::~Ring(void)
+  {
+    free(data);
+  }
+
+  void LoggerStreamAsync::Ring::copy_in(size_t pos, const void *src, size_t bytes)
+  {
+    size_t ofs = pos & (size - 1);
+    size_t first = size - ofs;
+    if(first >= bytes) {
+      memcpy(data + ofs, src, bytes);
+    } else {
+      memcpy(data + ofs, src, first);
+      memcpy(data, (const char *)src + first, bytes - first);
+    }
+  }
+
+  void LoggerStreamAsync::Ring::copy_out(size_t pos, void *dst, size_t bytes) const
+  {
+    size_t ofs = pos & (size - 1);
+    size_t first = size - ofs;
+    if(first >= bytes) {
+      memcpy(dst, data + ofs, bytes);
+    } else {
+      memcpy(dst, data + ofs, first);
+      memcpy((char *)dst + first, data, bytes - first);
+    }
+  }
+
+  LoggerStreamAsync::LoggerStreamAsync(LoggerOutputStream *_stream, bool _delete_inner,
+				       size_t _ring_size, bool _drop_when_full)
+    : stream(_stream), delete_inner(_delete_inner)
+    , drop_when_full(_drop_when_full), rings(0)
+    , writer_waiting(false), shutdown_requested(false)
+    , dropped_count(0), outbuf_used(0)
+  {
+    // round the ring size up to a power of two
+    ring_size = 4096;
+    while(ring_size < _ring_size)
+      ring_size <<= 1;
+    // most writes will be flushed long before this fills up
+    outbuf.resize(((ring_size < (1 << 20)) ? (1 << 20) : ring_size));
+
+    int ret;
+    ret = pthread_key_create(&ring_key, &LoggerStreamAsync::release_thread_ring);
+    assert(ret == 0);
+    ret = pthread_mutex_init(&drain_mutex, 0);
+    assert(ret == 0);
+    ret = pthread_mutex_init(&wake_mutex, 0);
+    assert(ret == 0);
+    ret = pthread_cond_init(&wake_cond, 0);
+    assert(ret == 0);
+    ret = pthread_create(&writer_thread, 0, &LoggerStreamAsync::writer_loop, this);
+    if(ret != 0) {
+      fprintf(stderr, "could not create logging thread: %s\n", strerror(ret));
+      exit(1);
+    }
+    (void)ret;
+  }
+
+  LoggerStreamAsync::~LoggerStreamAsync(void)
+  {
+    pthread_mutex_lock(&wake_mutex);
+    shutdown_requested = true;
+    pthread_cond_signal(&wake_cond);
+    pthread_mutex_unlock(&wake_mutex);
+    pthread_join(writer_thread, 0);
+
+    // the writer thread did a final drain on the way out
+    pthread_key_delete(ring_key);
+    while(rings) {
+      Ring *r = rings;
+      rings = r->next;
+      delete r;
+    }
+    pthread_cond_destroy(&wake_cond);
+    pthread_mutex_destroy(&wake_mutex);
+    pthread_mutex_destroy(&drain_mutex);
+    if(delete_inner)
+      delete stream;
+  }
+
+  LoggerStreamAsync::Ring *LoggerStreamAsync::get_thread_ring(void)
+  {
+    Ring *r = (Ring *)pthread_getspecific(ring_key);
+    if(r)
+      return r;
+
+    // try to reuse the ring of a thread that has exited
+    for(r = rings; r; r = r->next)
+      if(__sync_bool_compare_and_swap(&(r->in_use), 0, 1))
+	break;
+
+    if(!r) {
+      r = new Ring(ring_size);
+      // push onto the front of the list - the drainer only ever walks it
+      do {
+	r->next = rings;
+      } while(!__sync_bool_compare_and_swap(&rings, r->next, r));
+    }
+
+    pthread_setspecific(ring_key, r);
+    return r;
+  }
+
+  /*static*/ void LoggerStreamAsync::release_thread_ring(void *ring)
+  {
+    // anything left in the ring still gets written out - a new owner just
+    //  appends after it
+    __sync_synchronize();
+    ((Ring *)ring)->in_use = 0;
+  }
+
+  void LoggerStreamAsync::wake_writer(void)
+  {
+    if(writer_waiting) {
+      pthread_mutex_lock(&wake_mutex);
+      pthread_cond_signal(&wake_cond);
+      pthread_mutex_unlock(&wake_mutex);
+    }
+  }
+
+  void LoggerStreamAsync::write(const char *buffer, size_t len)
+  {
+    // take the timestamp before we wait for any space so that a blocked
+    //  message still sorts before anything logged after it started
+    long long timestamp = Clock::current_time_in_nanoseconds();
+
+    Ring *r = get_thread_ring();
+
+    // a message too long to ever fit gets truncated (keeping the newline)
+    if((sizeof(RecordHeader) + len) > r->size) {
+      size_t keep = r->size - sizeof(RecordHeader);
+      std::vector<char> copy(buffer, buffer + keep);
+      copy[keep - 1] = '\n';
+      write(&copy[0], keep);
+      return;
+    }
+
+    size_t needed = sizeof(RecordHeader) + len;
+    size_t tail = r->tail;
+    while((r->size - (tail - r->head)) < needed) {
+      if(drop_when_full) {
+	__sync_fetch_and_add(&dropped_count, 1);
+	return;
+      }
+      wake_writer();
+      sched_yield();
+    }
+
+    RecordHeader hdr;
+    hdr.timestamp = timestamp;
+    hdr.length = len;
+    r->copy_in(tail, &hdr, sizeof(RecordHeader));
+    r->copy_in(tail + sizeof(RecordHeader), buffer, len);
+    // data must be visible before the drainer sees the new tail
+    __sync_synchronize();
+    r->tail = tail + needed;
+
+    // don't wait for the periodic wakeup if the ring is getting full
+    if((tail + needed - r->head) > (r->size >> 1))
+      wake_writer();
+  }
+
+  void LoggerStreamAsync::flush(void)
+  {
+    pthread_mutex_lock(&drain_mutex);
+    drain();
+    pthread_mutex_unlock(&drain_mutex);
+  }
+
+  void LoggerStreamAsync::append_output(const char *data, size_t len)
+  {
+    if((outbuf_used + len) > outbuf.size()) {
+      stream->write(&outbuf[0], outbuf_used);
+      outbuf_used = 0;
+    }
+    memcpy(&outbuf[outbuf_used], data, len);
+    outbuf_used += len;
+  }
+
+  void LoggerStreamAsync::drain(void)
+  {
+    // take a snapshot of what's in each ring right now - anything logged
+    //  after this waits for the next drain
+    drain_rings.clear();
+    drain_tails.clear();
+    drain_headers.clear();
+    for(Ring *r = rings; r; r = r->next) {
+      size_t tail = r->tail;
+      if(tail == r->head)
+	continue;
+      __sync_synchronize();
+      drain_rings.push_back(r);
+      drain_tails.push_back(tail);
+      RecordHeader hdr;
+      r->copy_out(r->head, &hdr, sizeof(RecordHeader));
+      drain_headers.push_back(hdr);
+    }
+
+    // each ring is already in timestamp order, so repeatedly take the
+    //  oldest message at the front of any of them
+    while(!drain_rings.empty()) {
+      size_t best = 0;
+      for(size_t i = 1; i < drain_rings.size(); i++)
+	if(drain_headers[i].timestamp < drain_headers[best].timestamp)
+	  best = i;
+
+      Ring *r = drain_rings[best];
+      size_t head = r->head;
+      size_t len = drain_headers[best].length;
+      size_t pos = head + sizeof(RecordHeader);
+      // the message may wrap around the end of the ring
+      size_t ofs = pos & (r->size - 1);
+      size_t first = r->size - ofs;
+      if(first >= len) {
+	append_output(r->data + ofs, len);
+      } else {
+	append_output(r->data + ofs, first);
+	append_output(r->data, len - first);
+      }
+      head = pos + len;
+      // done reading before the space can be reused
+      __sync_synchronize();
+      r->head = head;
+
+      if(head < drain_tails[best]) {
+	r->copy_out(head, &drain_headers[best], sizeof(RecordHeader));
+      } else {
+	drain_rings[best] = drain_rings.back();
+	drain_rings.pop_back();
+	drain_tails[best] = drain_tails.back();
+	drain_tails.pop_back();
+	drain_headers[best] = drain_headers.back();
+	drain_headers.pop_back();
+      }
+    }
+
+    size_t dropped = __sync_fetch_and_and(&dropped_count, 0);
+    if(dropped > 0) {
+      char msg[128];
+      int len = snprintf(msg, sizeof(msg),
+			 "[%d - logger] %zd log messages dropped (buffers full)\n",
+			 my_node_id, dropped);
+      append_output(msg, len);
+    }
+
+    if(outbuf_used > 0) {
+      stream->write(&outbuf[0], outbuf_used);
+      outbuf_used = 0;
+    }
+    stream->flush();
+  }
+
+  /*static*/ void *LoggerStreamAsync::writer_loop(void *arg)
+  {
+    LoggerStreamAsync *s = (LoggerStreamAsync *)arg;
+
+    while(true) {
+      pthread_mutex_lock(&s->drain_mutex);
+      s->drain();
+      pthread_mutex_unlock(&s->drain_mutex);
+
+      // sleep until somebody's ring is filling up, or for a few milliseconds
+      pthread_mutex_lock(&s->wake_mutex);
+      if(s->shutdown_requested) {
+	pthread_mutex_unlock(&s->wake_mutex);
+	break;
+      }
+      struct timespec ts;
+      clock_gettime(CLOCK_REALTIME, &ts);
+      ts.tv_nsec += 10000000;  // 10 ms
+      if(ts.tv_nsec >= 1000000000) {
+	ts.tv_sec++;
+	ts.tv_nsec -= 1000000000;
+      }
+      s->writer_waiting = true;
+      pthread_cond_timedwait(&s->wake_cond, &s->wake_mutex, &ts);
+      s->writer_waiting = false;
+      pthread_mutex_unlock(&s->wake_mutex);
+    }
+
+    // one last pass for anything logged during shutdown
+    pthread_mutex_lock(&s->drain_mutex);
+    s->drain();
+    pthread_mutex_unlock(&s->drain_mutex);
+    return 0;
+  }
+
   class LoggerConfig {
   protected:
     LoggerConfig(void);
@@ -288,35 +663,45 @@ namespace Realm {
   void LoggerConfig::read_command_line(std::vector<std::string>& cmdline)
   {
     std::string logname;
+    // -logasync <kb> gives each logging thread a ring buffer of that size
+    //  that is written out by a background thread (0 = synchronous), and
+    //  -logfull picks what happens when a ring fills up
+    unsigned async_kb = 0;
+    std::string full_policy = "block";
 
     bool ok = CommandLineParser()
       .add_option_string("-cat", cats_enabled)
       .add_option_string("-logfile", logname)
       .add_option_method("-level", this, &LoggerConfig::parse_level_argument)
       .add_option_int("-errlevel", stderr_level)
+      .add_option_int("-logasync", async_kb)
+      .add_option_string("-logfull", full_policy)
       .parse_command_line(cmdline);
 
+    if(ok && (full_policy != "block") && (full_policy != "drop")) {
+      fprintf(stderr, "ERROR: -logfull must be 'block' or 'drop': '%s'\n", full_policy.c_str());
+      ok = false;
+    }
+
     if(!ok) {
       fprintf(stderr, "couldn't parse logger config options\n");
       exit(1);
     }
 
+    LoggerFileStream *fs = 0;
+
     // lots of choices for log output
     if(logname.empty()) {
       // the gasnet UDP job spawner (amudprun) seems to buffer stdout, so make stderr the default
 #ifdef GASNET_CONDUIT_UDP
-      stream = new LoggerStreamSerialized<LoggerFileStream>(new LoggerFileStream(stderr, false),
-							    true);
+      fs = new LoggerFileStream(stderr, false);
 #else
-      stream = new LoggerStreamSerialized<LoggerFileStream>(new LoggerFileStream(stdout, false),
-							    true);
+      fs = new LoggerFileStream(stdout, false);
 #endif
     } else if(logname == "stdout") {
-      stream = new LoggerStreamSerialized<LoggerFileStream>(new LoggerFileStream(stdout, false),
-							    true);
+      fs = new LoggerFileStream(stdout, false);
     } else if(logname == "stderr") {
-      stream = new LoggerStreamSerialized<LoggerFileStream>(new LoggerFileStream(stderr, false),
-							    true);
+      fs = new LoggerFileStream(stderr, false);
     } else {
       // we're going to open a file, but key off a + for appending and
       //  look for a % for node number insertion
@@ -357,10 +742,10 @@ namespace Realm {
 	  exit(1);
 	}
       }
-      // TODO: consider buffering in some cases?
-      setbuf(f, 0); // disable output buffering
-      stream = new LoggerStreamSerialized<LoggerFileStream>(new LoggerFileStream(f, true),
-							    true);
+      // the async stream already hands over large chunks
+      if(async_kb == 0)
+	setbuf(f, 0); // disable output buffering
+      fs = new LoggerFileStream(f, true);
 
       // when logging to a file, also sent critical-enough messages to stderr
       if(stderr_level < Logger::LEVEL_NONE)
@@ -368,6 +753,12 @@ namespace Realm {
 								     true);
     }
 
+    if(async_kb > 0)
+      stream = new LoggerStreamAsync(fs, true, size_t(async_kb) << 10,
+				     (full_policy == "drop"));
+    else
+      stream = new LoggerStreamSerialized<LoggerFileStream>(fs, true);
+
     atexit(LoggerConfig::flush_all_streams);
 
     cmdline_read = true;
@@ -492,7 +883,7 @@ namespace Realm {
 
           it->s->write(full_buffer, full_len);
 
-          if(it->flush_each_write)
+          if(it->flush_each_write || (level >= LEVEL_ERROR))
             it->s->flush();
         }
         free(full_buffer);
@@ -514,7 +905,9 @@ namespace Realm {
 
       it->s->write(buffer, len);
 
-      if(it->flush_each_write)
+      // errors often precede an abort, so don't leave them sitting in a
+      //  buffer somewhere
+      if(it->flush_each_write || (level >= LEVEL_ERROR))
 	it->s->flush();
     }
   }
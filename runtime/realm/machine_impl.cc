@@ -23,6 +23,8 @@
 #include "realm/activemsg.h"
 #include "realm/transfer/channel.h"
 
+#include <algorithm>
+
 TYPE_IS_SERIALIZABLE(Realm::NodeAnnounceTag);
 TYPE_IS_SERIALIZABLE(Realm::Memory);
 TYPE_IS_SERIALIZABLE(Realm::Memory::Kind);
@@ -53,6 +55,21 @@ namespace Realm {
     return ID(mma.m1).memory.owner_node == ID(mma.m2).memory.owner_node;
   }
 
+  // the order in which queries visit processors and memories
+  static inline bool proc_query_order(Processor a, Processor b)
+  {
+    int na = ID(a).proc.owner_node;
+    int nb = ID(b).proc.owner_node;
+    return ((na < nb) || ((na == nb) && (a < b)));
+  }
+
+  static inline bool memory_query_order(Memory a, Memory b)
+  {
+    int na = ID(a).memory.owner_node;
+    int nb = ID(b).memory.owner_node;
+    return ((na < nb) || ((na == nb) && (a < b)));
+  }
+
 
   ////////////////////////////////////////////////////////////////////////
   //
@@ -353,6 +370,92 @@ namespace Realm {
     }
 
 
+  // predicates are and-ed together, so their (fixed-size) entries in a
+  //  query's cache key are sorted to make the key independent of the order
+  //  they were added in - there are rarely more than one or two, so a simple
+  //  insertion sort in place avoids any extra allocation
+  static void sort_predicate_keys(std::vector<unsigned long long>& key)
+  {
+    const size_t W = QUERY_PREDICATE_KEY_WORDS;
+    const size_t start = QUERY_RESTRICTION_KEY_WORDS;
+    assert(((key.size() - start) % W) == 0);
+    for(size_t i = start + W; i < key.size(); i += W)
+      for(size_t j = i;
+	  (j > start) && std::lexicographical_compare(key.begin() + j, key.begin() + j + W,
+						      key.begin() + j - W, key.begin() + j);
+	  j -= W)
+	std::swap_ranges(key.begin() + j - W, key.begin() + j, key.begin() + j);
+  }
+
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class MachineQueryCache<T>
+  //
+
+  template <typename T>
+  MachineQueryCache<T>::MachineQueryCache(void)
+    : generation(0)
+  {}
+
+  template <typename T>
+  MachineQueryCache<T>::~MachineQueryCache(void)
+  {
+    delete_map_contents(entries);
+    for(typename std::vector<MachineQueryResults<T> *>::const_iterator it = retired.begin();
+	it != retired.end();
+	++it)
+      delete *it;
+  }
+
+  template <typename T>
+  const MachineQueryResults<T> *MachineQueryCache<T>::lookup(const Key& key)
+  {
+    AutoHSLLock al(mutex);
+    typename std::map<Key, MachineQueryResults<T> *>::const_iterator it = entries.find(key);
+    if(it != entries.end())
+      return it->second;
+    else
+      return 0;
+  }
+
+  template <typename T>
+  const MachineQueryResults<T> *MachineQueryCache<T>::insert(const Key& key,
+							     MachineQueryResults<T> *results)
+  {
+    AutoHSLLock al(mutex);
+    // results computed before an invalidation can be used by the caller
+    //  this once, but must not be handed out again
+    if(results->generation != generation) {
+      retired.push_back(results);
+      return results;
+    }
+    MachineQueryResults<T> *& ptr = entries[key];
+    if(ptr) {
+      // somebody else got here first - use theirs
+      delete results;
+      return ptr;
+    }
+    ptr = results;
+    return results;
+  }
+
+  template <typename T>
+  void MachineQueryCache<T>::invalidate(void)
+  {
+    AutoHSLLock al(mutex);
+    __sync_fetch_and_add(&generation, 1);
+    for(typename std::map<Key, MachineQueryResults<T> *>::const_iterator it = entries.begin();
+	it != entries.end();
+	++it)
+      retired.push_back(it->second);
+    entries.clear();
+  }
+
+  template class MachineQueryCache<Processor>;
+  template class MachineQueryCache<Memory>;
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class MachineImpl
@@ -1075,6 +1178,10 @@ namespace Realm {
       ptr->add_proc_mem_affinity(pma);
     }
 
+    // any cached query results may now be wrong
+    proc_query_cache.invalidate();
+    mem_query_cache.invalidate();
+
     if(!lock_held) mutex.unlock();
   }
 
@@ -1102,6 +1209,10 @@ namespace Realm {
       ptr->add_mem_mem_affinity(mma);
     }
 
+    // any cached query results may now be wrong
+    proc_query_cache.invalidate();
+    mem_query_cache.invalidate();
+
     if(!lock_held) mutex.unlock();
   }
 
@@ -1350,6 +1461,14 @@ namespace Realm {
     return new ProcessorHasAffinityPredicate(memory, min_bandwidth, max_latency);
   }
 
+  void ProcessorHasAffinityPredicate::append_key(std::vector<unsigned long long>& key) const
+  {
+    key.push_back(1);  // unique per predicate class
+    key.push_back(memory.id);
+    key.push_back(min_bandwidth);
+    key.push_back(max_latency);
+  }
+
   bool ProcessorHasAffinityPredicate::matches_predicate(MachineImpl *machine, Processor thing,
 							const MachineProcInfo *info) const
   {
@@ -1388,6 +1507,14 @@ namespace Realm {
     return new ProcessorBestAffinityPredicate(memory, bandwidth_weight, latency_weight);
   }
 
+  void ProcessorBestAffinityPredicate::append_key(std::vector<unsigned long long>& key) const
+  {
+    key.push_back(2);  // unique per predicate class
+    key.push_back(memory.id);
+    key.push_back(bandwidth_weight);
+    key.push_back(latency_weight);
+  }
+
   bool ProcessorBestAffinityPredicate::matches_predicate(MachineImpl *machine, Processor thing,
 							 const MachineProcInfo *info) const
   {
@@ -1427,6 +1554,8 @@ namespace Realm {
     , machine((MachineImpl *)_machine.impl)
     , is_restricted_node(false)
     , is_restricted_kind(false)
+    , cached_matches(0)
+    , cached_index(0)
   {}
      
   ProcessorQueryImpl::ProcessorQueryImpl(const ProcessorQueryImpl& copy_from)
@@ -1436,6 +1565,8 @@ namespace Realm {
     , restricted_node_id(copy_from.restricted_node_id)
     , is_restricted_kind(copy_from.is_restricted_kind)
     , restricted_kind(copy_from.restricted_kind)
+    , cached_matches(copy_from.cached_matches)
+    , cached_index(0)
   {
     predicates.reserve(copy_from.predicates.size());
     for(std::vector<ProcQueryPredicate *>::const_iterator it = copy_from.predicates.begin();
@@ -1487,6 +1618,8 @@ namespace Realm {
       is_restricted_node = true;
       restricted_node_id = new_node_id;
     }
+    // any cached results are for the old query
+    cached_matches = 0;
   }
 
   void ProcessorQueryImpl::restrict_to_kind(Processor::Kind new_kind)
@@ -1500,12 +1633,15 @@ namespace Realm {
       is_restricted_kind = true;
       restricted_kind = new_kind;
     }
+    // any cached results are for the old query
+    cached_matches = 0;
   }
 
   void ProcessorQueryImpl::add_predicate(ProcQueryPredicate *pred)
   {
     // a writer is always unique, so no need for mutexes
     predicates.push_back(pred);
+    cached_matches = 0;
   }
 
   Processor ProcessorQueryImpl::first_match(void) const
@@ -1535,45 +1671,8 @@ namespace Realm {
     }
     return lowest;
 #else
-    std::map<int, MachineNodeInfo *>::const_iterator it;
-    if(is_restricted_node)
-      it = machine->nodeinfos.lower_bound(restricted_node_id);
-    else
-      it = machine->nodeinfos.begin();
-    while(it != machine->nodeinfos.end()) {
-      if(is_restricted_node && (it->first != restricted_node_id))
-	break;
-
-      const std::map<Processor, MachineProcInfo *> *plist;
-      if(is_restricted_kind) {
-	std::map<Processor::Kind, std::map<Processor, MachineProcInfo *> >::const_iterator it2 = it->second->proc_by_kind.find(restricted_kind);
-	if(it2 != it->second->proc_by_kind.end())
-	  plist = &(it2->second);
-	else
-	  plist = 0;
-      } else
-	plist = &(it->second->procs);
-
-      if(plist) {
-	std::map<Processor, MachineProcInfo *>::const_iterator it2 = plist->begin();
-	while(it2 != plist->end()) {
-	  bool ok = true;
-	  for(std::vector<ProcQueryPredicate *>::const_iterator it3 = predicates.begin();
-	      ok && (it3 != predicates.end());
-	      it3++)
-	    ok = (*it3)->matches_predicate(machine, it2->first, it2->second);
-	  if(ok)
-	    return it2->first;
-
-	  // try next processor (if it exists)
-	  ++it2;
-	}
-      }
-
-      // try the next node (if it exists)
-      ++it;
-    }
-    return Processor::NO_PROC;
+    const std::vector<Processor>& matches = get_matches()->matches;
+    return (matches.empty() ? Processor::NO_PROC : matches[0]);
 #endif
   }
 
@@ -1606,48 +1705,19 @@ namespace Realm {
     }
     return lowest;
 #else
-    std::map<int, MachineNodeInfo *>::const_iterator it;
-    // start where we left off
-    it = machine->nodeinfos.find(ID(after).proc.owner_node);
-    while(it != machine->nodeinfos.end()) {
-      if(is_restricted_node && (it->first != restricted_node_id))
-	break;
-
-      const std::map<Processor, MachineProcInfo *> *plist;
-      if(is_restricted_kind) {
-	std::map<Processor::Kind, std::map<Processor, MachineProcInfo *> >::const_iterator it2 = it->second->proc_by_kind.find(restricted_kind);
-	if(it2 != it->second->proc_by_kind.end())
-	  plist = &(it2->second);
-	else
-	  plist = 0;
-      } else
-	plist = &(it->second->procs);
-
-      if(plist) {
-        std::map<Processor, MachineProcInfo *>::const_iterator it2;
-	// same node?  if so, skip past ones we've done
-	if(it->first == ID(after).proc.owner_node)
-	  it2 = plist->upper_bound(after);
-	else
-	  it2 = plist->begin();
-	while(it2 != plist->end()) {
-	  bool ok = true;
-	  for(std::vector<ProcQueryPredicate *>::const_iterator it3 = predicates.begin();
-	      ok && (it3 != predicates.end());
-	      it3++)
-	    ok = (*it3)->matches_predicate(machine, it2->first, it2->second);
-	  if(ok)
-	    return it2->first;
-
-	  // try next processor (if it exists)
-	  ++it2;
-	}
-      }
-
-      // try the next node (if it exists)
-      ++it;
-    }
-    return Processor::NO_PROC;
+    const std::vector<Processor>& matches = get_matches()->matches;
+    // the common case is stepping through the matches in order, so check
+    //  where the last call left off before searching
+    size_t idx = cached_index;
+    if((idx < matches.size()) && (matches[idx] == after))
+      idx++;
+    else
+      idx = (std::upper_bound(matches.begin(), matches.end(), after,
+			      proc_query_order) - matches.begin());
+    if(idx >= matches.size())
+      return Processor::NO_PROC;
+    cached_index = idx;
+    return matches[idx];
 #endif
   }
 
@@ -1678,46 +1748,7 @@ namespace Realm {
     }
     return pset.size();
 #else
-    size_t count = 0;
-    std::map<int, MachineNodeInfo *>::const_iterator it;
-    if(is_restricted_node)
-      it = machine->nodeinfos.lower_bound(restricted_node_id);
-    else
-      it = machine->nodeinfos.begin();
-    while(it != machine->nodeinfos.end()) {
-      if(is_restricted_node && (it->first != restricted_node_id))
-	break;
-
-      const std::map<Processor, MachineProcInfo *> *plist;
-      if(is_restricted_kind) {
-	std::map<Processor::Kind, std::map<Processor, MachineProcInfo *> >::const_iterator it2 = it->second->proc_by_kind.find(restricted_kind);
-	if(it2 != it->second->proc_by_kind.end())
-	  plist = &(it2->second);
-	else
-	  plist = 0;
-      } else
-	plist = &(it->second->procs);
-
-      if(plist) {
-	std::map<Processor, MachineProcInfo *>::const_iterator it2 = plist->begin();
-	while(it2 != plist->end()) {
-	  bool ok = true;
-	  for(std::vector<ProcQueryPredicate *>::const_iterator it3 = predicates.begin();
-	      ok && (it3 != predicates.end());
-	      it3++)
-	    ok = (*it3)->matches_predicate(machine, it2->first, it2->second);
-	  if(ok)
-	    count += 1;
-
-	  // continue to next processor (if it exists)
-	  ++it2;
-	}
-      }
-
-      // continue to the next node (if it exists)
-      ++it;
-    }
-    return count;
+    return get_matches()->matches.size();
 #endif
   }
 
@@ -1751,7 +1782,41 @@ namespace Realm {
       }
     }
 #else
-    size_t count = 0;
+    const std::vector<Processor>& matches = get_matches()->matches;
+    if(!matches.empty())
+      chosen = matches[lrand48() % matches.size()];
+#endif
+    return chosen;
+  }
+
+  const MachineQueryResults<Processor> *ProcessorQueryImpl::get_matches(void) const
+  {
+    MachineQueryCache<Processor>& cache = machine->proc_query_cache;
+    const MachineQueryResults<Processor> *results = cached_matches;
+    if(results && (results->generation == cache.current_generation()))
+      return results;
+
+    // look for an identical query that has already been evaluated
+    MachineQueryCache<Processor>::Key key;
+    key.reserve(QUERY_RESTRICTION_KEY_WORDS +
+		(predicates.size() * QUERY_PREDICATE_KEY_WORDS));
+    get_cache_key(key);
+    results = cache.lookup(key);
+    if(!results) {
+      MachineQueryResults<Processor> *new_results = new MachineQueryResults<Processor>;
+      // sample the generation first so that a concurrent change to the
+      //  machine model causes these results to be discarded
+      new_results->generation = cache.current_generation();
+      compute_matches(new_results->matches);
+      results = cache.insert(key, new_results);
+    }
+    cached_matches = results;
+    cached_index = 0;
+    return results;
+  }
+
+  void ProcessorQueryImpl::compute_matches(std::vector<Processor>& matches) const
+  {
     std::map<int, MachineNodeInfo *>::const_iterator it;
     if(is_restricted_node)
       it = machine->nodeinfos.lower_bound(restricted_node_id);
@@ -1779,11 +1844,8 @@ namespace Realm {
 	      ok && (it3 != predicates.end());
 	      it3++)
 	    ok = (*it3)->matches_predicate(machine, it2->first, it2->second);
-	  if(ok) {
-	    count++;
-	    if((count == 1) || ((lrand48() % count) == 0))
-	      chosen = it2->first;
-	  }
+	  if(ok)
+	    matches.push_back(it2->first);
 
 	  // continue to next processor (if it exists)
 	  ++it2;
@@ -1793,8 +1855,17 @@ namespace Realm {
       // continue to the next node (if it exists)
       ++it;
     }
-#endif
-    return chosen;
+  }
+
+  void ProcessorQueryImpl::get_cache_key(std::vector<unsigned long long>& key) const
+  {
+    key.push_back(is_restricted_node);
+    key.push_back(is_restricted_node ? restricted_node_id : 0);
+    key.push_back(is_restricted_kind);
+    key.push_back(is_restricted_kind ? restricted_kind : 0);
+    for(size_t i = 0; i < predicates.size(); i++)
+      predicates[i]->append_key(key);
+    sort_predicate_keys(key);
   }
 
 
@@ -1816,6 +1887,14 @@ namespace Realm {
     return new MemoryHasProcAffinityPredicate(proc, min_bandwidth, max_latency);
   }
 
+  void MemoryHasProcAffinityPredicate::append_key(std::vector<unsigned long long>& key) const
+  {
+    key.push_back(3);  // unique per predicate class
+    key.push_back(proc.id);
+    key.push_back(min_bandwidth);
+    key.push_back(max_latency);
+  }
+
   bool MemoryHasProcAffinityPredicate::matches_predicate(MachineImpl *machine, Memory thing,
 					      const MachineMemInfo *info) const
   {
@@ -1854,6 +1933,14 @@ namespace Realm {
     return new MemoryHasMemAffinityPredicate(memory, min_bandwidth, max_latency);
   }
 
+  void MemoryHasMemAffinityPredicate::append_key(std::vector<unsigned long long>& key) const
+  {
+    key.push_back(4);  // unique per predicate class
+    key.push_back(memory.id);
+    key.push_back(min_bandwidth);
+    key.push_back(max_latency);
+  }
+
   bool MemoryHasMemAffinityPredicate::matches_predicate(MachineImpl *machine, Memory thing,
 							const MachineMemInfo *info) const
   {
@@ -1892,6 +1979,14 @@ namespace Realm {
     return new MemoryBestProcAffinityPredicate(proc, bandwidth_weight, latency_weight);
   }
 
+  void MemoryBestProcAffinityPredicate::append_key(std::vector<unsigned long long>& key) const
+  {
+    key.push_back(5);  // unique per predicate class
+    key.push_back(proc.id);
+    key.push_back(bandwidth_weight);
+    key.push_back(latency_weight);
+  }
+
   bool MemoryBestProcAffinityPredicate::matches_predicate(MachineImpl *machine, Memory thing,
 					      const MachineMemInfo *info) const
   {
@@ -1939,6 +2034,14 @@ namespace Realm {
     return new MemoryBestMemAffinityPredicate(memory, bandwidth_weight, latency_weight);
   }
 
+  void MemoryBestMemAffinityPredicate::append_key(std::vector<unsigned long long>& key) const
+  {
+    key.push_back(6);  // unique per predicate class
+    key.push_back(memory.id);
+    key.push_back(bandwidth_weight);
+    key.push_back(latency_weight);
+  }
+
   bool MemoryBestMemAffinityPredicate::matches_predicate(MachineImpl *machine, Memory thing,
 					      const MachineMemInfo *info) const
   {
@@ -1978,6 +2081,8 @@ namespace Realm {
     , machine((MachineImpl *)_machine.impl)
     , is_restricted_node(false)
     , is_restricted_kind(false)
+    , cached_matches(0)
+    , cached_index(0)
   {}
      
   MemoryQueryImpl::MemoryQueryImpl(const MemoryQueryImpl& copy_from)
@@ -1987,6 +2092,8 @@ namespace Realm {
     , restricted_node_id(copy_from.restricted_node_id)
     , is_restricted_kind(copy_from.is_restricted_kind)
     , restricted_kind(copy_from.restricted_kind)
+    , cached_matches(copy_from.cached_matches)
+    , cached_index(0)
   {
     predicates.reserve(copy_from.predicates.size());
     for(std::vector<MemoryQueryPredicate *>::const_iterator it = copy_from.predicates.begin();
@@ -2038,6 +2145,8 @@ namespace Realm {
       is_restricted_node = true;
       restricted_node_id = new_node_id;
     }
+    // any cached results are for the old query
+    cached_matches = 0;
   }
 
   void MemoryQueryImpl::restrict_to_kind(Memory::Kind new_kind)
@@ -2051,12 +2160,15 @@ namespace Realm {
       is_restricted_kind = true;
       restricted_kind = new_kind;
     }
+    // any cached results are for the old query
+    cached_matches = 0;
   }
 
   void MemoryQueryImpl::add_predicate(MemoryQueryPredicate *pred)
   {
     // a writer is always unique, so no need for mutexes
     predicates.push_back(pred);
+    cached_matches = 0;
   }
 
   Memory MemoryQueryImpl::first_match(void) const
@@ -2086,45 +2198,8 @@ namespace Realm {
     }
     return lowest;
 #else
-    std::map<int, MachineNodeInfo *>::const_iterator it;
-    if(is_restricted_node)
-      it = machine->nodeinfos.lower_bound(restricted_node_id);
-    else
-      it = machine->nodeinfos.begin();
-    while(it != machine->nodeinfos.end()) {
-      if(is_restricted_node && (it->first != restricted_node_id))
-	break;
-
-      const std::map<Memory, MachineMemInfo *> *plist;
-      if(is_restricted_kind) {
-	std::map<Memory::Kind, std::map<Memory, MachineMemInfo *> >::const_iterator it2 = it->second->mem_by_kind.find(restricted_kind);
-	if(it2 != it->second->mem_by_kind.end())
-	  plist = &(it2->second);
-	else
-	  plist = 0;
-      } else
-	plist = &(it->second->mems);
-
-      if(plist) {
-	std::map<Memory, MachineMemInfo *>::const_iterator it2 = plist->begin();
-	while(it2 != plist->end()) {
-	  bool ok = true;
-	  for(std::vector<MemoryQueryPredicate *>::const_iterator it3 = predicates.begin();
-	      ok && (it3 != predicates.end());
-	      it3++)
-	    ok = (*it3)->matches_predicate(machine, it2->first, it2->second);
-	  if(ok)
-	    return it2->first;
-
-	  // try next memory (if it exists)
-	  ++it2;
-	}
-      }
-
-      // try the next node (if it exists)
-      ++it;
-    }
-    return Memory::NO_MEMORY;
+    const std::vector<Memory>& matches = get_matches()->matches;
+    return (matches.empty() ? Memory::NO_MEMORY : matches[0]);
 #endif
   }
 
@@ -2157,48 +2232,19 @@ namespace Realm {
     }
     return lowest;
 #else
-    std::map<int, MachineNodeInfo *>::const_iterator it;
-    // start where we left off
-    it = machine->nodeinfos.find(ID(after).memory.owner_node);
-    while(it != machine->nodeinfos.end()) {
-      if(is_restricted_node && (it->first != restricted_node_id))
-	break;
-
-      const std::map<Memory, MachineMemInfo *> *plist;
-      if(is_restricted_kind) {
-	std::map<Memory::Kind, std::map<Memory, MachineMemInfo *> >::const_iterator it2 = it->second->mem_by_kind.find(restricted_kind);
-	if(it2 != it->second->mem_by_kind.end())
-	  plist = &(it2->second);
-	else
-	  plist = 0;
-      } else
-	plist = &(it->second->mems);
-
-      if(plist) {
-        std::map<Memory, MachineMemInfo *>::const_iterator it2;
-	// same node?  if so, skip past ones we've done
-	if(it->first == ID(after).memory.owner_node)
-	  it2 = plist->upper_bound(after);
-	else
-	  it2 = plist->begin();
-	while(it2 != plist->end()) {
-	  bool ok = true;
-	  for(std::vector<MemoryQueryPredicate *>::const_iterator it3 = predicates.begin();
-	      ok && (it3 != predicates.end());
-	      it3++)
-	    ok = (*it3)->matches_predicate(machine, it2->first, it2->second);
-	  if(ok)
-	    return it2->first;
-
-	  // try next memory (if it exists)
-	  ++it2;
-	}
-      }
-
-      // try the next node (if it exists)
-      ++it;
-    }
-    return Memory::NO_MEMORY;
+    const std::vector<Memory>& matches = get_matches()->matches;
+    // the common case is stepping through the matches in order, so check
+    //  where the last call left off before searching
+    size_t idx = cached_index;
+    if((idx < matches.size()) && (matches[idx] == after))
+      idx++;
+    else
+      idx = (std::upper_bound(matches.begin(), matches.end(), after,
+			      memory_query_order) - matches.begin());
+    if(idx >= matches.size())
+      return Memory::NO_MEMORY;
+    cached_index = idx;
+    return matches[idx];
 #endif
   }
 
@@ -2229,46 +2275,7 @@ namespace Realm {
     }
     return pset.size();
 #else
-    size_t count = 0;
-    std::map<int, MachineNodeInfo *>::const_iterator it;
-    if(is_restricted_node)
-      it = machine->nodeinfos.lower_bound(restricted_node_id);
-    else
-      it = machine->nodeinfos.begin();
-    while(it != machine->nodeinfos.end()) {
-      if(is_restricted_node && (it->first != restricted_node_id))
-	break;
-
-      const std::map<Memory, MachineMemInfo *> *plist;
-      if(is_restricted_kind) {
-	std::map<Memory::Kind, std::map<Memory, MachineMemInfo *> >::const_iterator it2 = it->second->mem_by_kind.find(restricted_kind);
-	if(it2 != it->second->mem_by_kind.end())
-	  plist = &(it2->second);
-	else
-	  plist = 0;
-      } else
-	plist = &(it->second->mems);
-
-      if(plist) {
-	std::map<Memory, MachineMemInfo *>::const_iterator it2 = plist->begin();
-	while(it2 != plist->end()) {
-	  bool ok = true;
-	  for(std::vector<MemoryQueryPredicate *>::const_iterator it3 = predicates.begin();
-	      ok && (it3 != predicates.end());
-	      it3++)
-	    ok = (*it3)->matches_predicate(machine, it2->first, it2->second);
-	  if(ok)
-	    count += 1;
-
-	  // continue to next memory (if it exists)
-	  ++it2;
-	}
-      }
-
-      // continue to the next node (if it exists)
-      ++it;
-    }
-    return count;
+    return get_matches()->matches.size();
 #endif
   }
 
@@ -2302,7 +2309,41 @@ namespace Realm {
       }
     }
 #else
-    size_t count = 0;
+    const std::vector<Memory>& matches = get_matches()->matches;
+    if(!matches.empty())
+      chosen = matches[lrand48() % matches.size()];
+#endif
+    return chosen;
+  }
+
+  const MachineQueryResults<Memory> *MemoryQueryImpl::get_matches(void) const
+  {
+    MachineQueryCache<Memory>& cache = machine->mem_query_cache;
+    const MachineQueryResults<Memory> *results = cached_matches;
+    if(results && (results->generation == cache.current_generation()))
+      return results;
+
+    // look for an identical query that has already been evaluated
+    MachineQueryCache<Memory>::Key key;
+    key.reserve(QUERY_RESTRICTION_KEY_WORDS +
+		(predicates.size() * QUERY_PREDICATE_KEY_WORDS));
+    get_cache_key(key);
+    results = cache.lookup(key);
+    if(!results) {
+      MachineQueryResults<Memory> *new_results = new MachineQueryResults<Memory>;
+      // sample the generation first so that a concurrent change to the
+      //  machine model causes these results to be discarded
+      new_results->generation = cache.current_generation();
+      compute_matches(new_results->matches);
+      results = cache.insert(key, new_results);
+    }
+    cached_matches = results;
+    cached_index = 0;
+    return results;
+  }
+
+  void MemoryQueryImpl::compute_matches(std::vector<Memory>& matches) const
+  {
     std::map<int, MachineNodeInfo *>::const_iterator it;
     if(is_restricted_node)
       it = machine->nodeinfos.lower_bound(restricted_node_id);
@@ -2330,11 +2371,8 @@ namespace Realm {
 	      ok && (it3 != predicates.end());
 	      it3++)
 	    ok = (*it3)->matches_predicate(machine, it2->first, it2->second);
-	  if(ok) {
-	    count++;
-	    if((count == 1) || ((lrand48() % count) == 0))
-	      chosen = it2->first;
-	  }
+	  if(ok)
+	    matches.push_back(it2->first);
 
 	  // continue to next memory (if it exists)
 	  ++it2;
@@ -2344,8 +2382,17 @@ namespace Realm {
       // continue to the next node (if it exists)
       ++it;
     }
-#endif
-    return chosen;
+  }
+
+  void MemoryQueryImpl::get_cache_key(std::vector<unsigned long long>& key) const
+  {
+    key.push_back(is_restricted_node);
+    key.push_back(is_restricted_node ? restricted_node_id : 0);
+    key.push_back(is_restricted_kind);
+    key.push_back(is_restricted_kind ? restricted_kind : 0);
+    for(size_t i = 0; i < predicates.size(); i++)
+      predicates[i]->append_key(key);
+    sort_predicate_keys(key);
   }
 
 
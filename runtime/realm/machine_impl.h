@@ -26,6 +26,7 @@
 
 #include <vector>
 #include <set>
+#include <map>
 
 namespace Realm {
 
@@ -80,6 +81,52 @@ namespace Realm {
     std::map<Memory::Kind, std::map<Memory, MachineMemInfo *> > mem_by_kind;
   };
 
+  // the materialized results of a processor or memory query, in the order
+  //  the query visits them (by node, then by ID within each node)
+  template <typename T>
+  struct MachineQueryResults {
+    unsigned generation;
+    std::vector<T> matches;
+  };
+
+  // results of queries are cached by a canonical description of the query
+  //  so that repeated queries don't re-walk the machine model - everything
+  //  is thrown away when the machine model changes, but the results stay
+  //  allocated (until the machine is destroyed) because query objects may
+  //  still be iterating over them
+  // a query's cache key is its node and kind restrictions followed by a
+  //  fixed-size entry for each of its predicates
+  static const size_t QUERY_RESTRICTION_KEY_WORDS = 4;
+  static const size_t QUERY_PREDICATE_KEY_WORDS = 4;
+
+  template <typename T>
+  class MachineQueryCache {
+  public:
+    typedef std::vector<unsigned long long> Key;
+
+    MachineQueryCache(void);
+    ~MachineQueryCache(void);
+
+    unsigned current_generation(void) const { return generation; }
+
+    // returns cached results for 'key' from the current generation, or 0
+    const MachineQueryResults<T> *lookup(const Key& key);
+
+    // takes ownership of newly computed results and returns the entry to
+    //  use, which will be an existing one if another thread beat us to it
+    const MachineQueryResults<T> *insert(const Key& key,
+					 MachineQueryResults<T> *results);
+
+    // called whenever the machine model changes
+    void invalidate(void);
+
+  protected:
+    GASNetHSL mutex;
+    volatile unsigned generation;
+    std::map<Key, MachineQueryResults<T> *> entries;
+    std::vector<MachineQueryResults<T> *> retired;
+  };
+
     class MachineImpl {
     public:
       MachineImpl(void);
@@ -137,6 +184,9 @@ namespace Realm {
 
       std::map<int, MachineNodeInfo *> nodeinfos;
 
+      MachineQueryCache<Processor> proc_query_cache;
+      MachineQueryCache<Memory> mem_query_cache;
+
     protected:
       MachineNodeInfo *get_nodeinfo(int node) const;
       MachineNodeInfo *get_nodeinfo(Processor p) const;
@@ -152,6 +202,11 @@ namespace Realm {
 
       virtual bool matches_predicate(MachineImpl *machine, T thing,
 				     const T2 *info = 0) const = 0;
+
+      // appends a description of the predicate (QUERY_PREDICATE_KEY_WORDS
+      //  long) that is equal for two predicates exactly when they match
+      //  the same things
+      virtual void append_key(std::vector<unsigned long long>& key) const = 0;
     };
 
     typedef QueryPredicate<Processor,MachineProcInfo> ProcQueryPredicate;
@@ -165,6 +220,8 @@ namespace Realm {
       virtual bool matches_predicate(MachineImpl *machine, Processor thing,
 				     const MachineProcInfo *info = 0) const;
 
+      virtual void append_key(std::vector<unsigned long long>& key) const;
+
     protected:
       Memory memory;
       unsigned min_bandwidth;
@@ -180,6 +237,8 @@ namespace Realm {
       virtual bool matches_predicate(MachineImpl *machine, Processor thing,
 				     const MachineProcInfo *info = 0) const;
 
+      virtual void append_key(std::vector<unsigned long long>& key) const;
+
     protected:
       Memory memory;
       int bandwidth_weight;
@@ -211,6 +270,11 @@ namespace Realm {
       Processor random_match(void) const;
 
     protected:
+      // returns the (possibly cached) results of the query
+      const MachineQueryResults<Processor> *get_matches(void) const;
+      void compute_matches(std::vector<Processor>& matches) const;
+      void get_cache_key(std::vector<unsigned long long>& key) const;
+
       int references;
       MachineImpl *machine;
       bool is_restricted_node;
@@ -218,6 +282,9 @@ namespace Realm {
       bool is_restricted_kind;
       Processor::Kind restricted_kind;
       std::vector<ProcQueryPredicate *> predicates;     
+      mutable const MachineQueryResults<Processor> *cached_matches;
+      // where the last next_match() left off, so that iteration is O(1)
+      mutable size_t cached_index;
     };            
 
     typedef QueryPredicate<Memory, MachineMemInfo> MemoryQueryPredicate;
@@ -231,6 +298,8 @@ namespace Realm {
       virtual bool matches_predicate(MachineImpl *machine, Memory thing,
 				     const MachineMemInfo *info = 0) const;
 
+      virtual void append_key(std::vector<unsigned long long>& key) const;
+
     protected:
       Processor proc;
       unsigned min_bandwidth;
@@ -246,6 +315,8 @@ namespace Realm {
       virtual bool matches_predicate(MachineImpl *machine, Memory thing,
 				     const MachineMemInfo *info = 0) const;
 
+      virtual void append_key(std::vector<unsigned long long>& key) const;
+
     protected:
       Memory memory;
       unsigned min_bandwidth;
@@ -261,6 +332,8 @@ namespace Realm {
       virtual bool matches_predicate(MachineImpl *machine, Memory thing,
 				     const MachineMemInfo *info = 0) const;
 
+      virtual void append_key(std::vector<unsigned long long>& key) const;
+
     protected:
       Processor proc;
       int bandwidth_weight;
@@ -276,6 +349,8 @@ namespace Realm {
       virtual bool matches_predicate(MachineImpl *machine, Memory thing,
 				     const MachineMemInfo *info = 0) const;
 
+      virtual void append_key(std::vector<unsigned long long>& key) const;
+
     protected:
       Memory memory;
       int bandwidth_weight;
@@ -307,6 +382,11 @@ namespace Realm {
       Memory random_match(void) const;
 
     protected:
+      // returns the (possibly cached) results of the query
+      const MachineQueryResults<Memory> *get_matches(void) const;
+      void compute_matches(std::vector<Memory>& matches) const;
+      void get_cache_key(std::vector<unsigned long long>& key) const;
+
       int references;
       MachineImpl *machine;
       bool is_restricted_node;
@@ -314,6 +394,9 @@ namespace Realm {
       bool is_restricted_kind;
       Memory::Kind restricted_kind;
       std::vector<MemoryQueryPredicate *> predicates;     
+      mutable const MachineQueryResults<Memory> *cached_matches;
+      // where the last next_match() left off, so that iteration is O(1)
+      mutable size_t cached_index;
     };            
 
     extern MachineImpl *machine_singleton;
@@ -33,6 +33,8 @@ static const void *ignore_gasnet_warning1 __attribute__((unused)) = (void *)_gas
 #ifdef _INCLUDED_GASNET_TOOLS_H
 static const void *ignore_gasnet_warning2 __attribute__((unused)) = (void *)_gasnett_trace_printf_noop;
 #endif
+#else
+#include "realm/shm_network.h"
 #endif
 
 #define CHECK_GASNET(cmd) do { \
@@ -594,7 +596,9 @@ namespace Realm {
       void *srcptr = ((char *)regbase) + offset;
       gasnet_get(dst, ID(me).memory.owner_node, srcptr, size);
 #else
-      assert(0 && "no remote get_bytes without GASNET");
+      assert(kind == MemoryImpl::MKIND_RDMA);
+      void *srcptr = ((char *)regbase) + offset;
+      ShmNetwork::get(ID(me).memory.owner_node, dst, srcptr, size);
 #endif
     }
 
@@ -39,6 +39,8 @@ namespace Realm {
 
   // manages a basic free list of ranges (using range type RT) and allocated
   //  ranges, which are tagged (tag type TT)
+  // free ranges are kept in size-segregated lists (one per power of two) so
+  //  that an allocation only has to look at ranges that are big enough
   // NOT thread-safe - must be protected from outside
   template <typename RT, typename TT>
   class BasicRangeAllocator {
@@ -48,13 +50,18 @@ namespace Realm {
 
       RT first, last;  // half-open range: [first, last)
       Range *prev, *next;  // double-linked list of all ranges
-      Range *prev_free, *next_free;  // double-linked list of just free ranges
+      Range *prev_free, *next_free;  // double-linked list of free ranges in
+                                     //  the same size class
+      bool is_free;
     };
 
+    // size class N holds free ranges with size in [2^N, 2^(N+1))
+    static const unsigned NUM_SIZE_CLASSES = 8 * sizeof(RT);
+
     std::map<TT, Range *> allocated;  // direct lookup of allocated ranges by tag
     std::map<RT, Range *> by_first;   // direct lookup of all ranges by first
     Range sentinel;
-    // TODO: sized-based lookup of free ranges
+    Range *free_lists[NUM_SIZE_CLASSES];  // heads of the size class lists
 
     BasicRangeAllocator(void);
     ~BasicRangeAllocator(void);
@@ -62,6 +69,11 @@ namespace Realm {
     void add_range(RT first, RT last);
     bool allocate(TT tag, RT size, RT alignment, RT& first);
     void deallocate(TT tag);
+
+  protected:
+    static unsigned size_class(RT size);
+    void add_free_range(Range *r);
+    void remove_free_range(Range *r);
   };
   
     class MemoryImpl {
@@ -221,6 +233,13 @@ namespace Realm {
       //std::map<off_t, off_t> free_blocks;
     };
 
+    namespace Config {
+      // when set (-ll:file_mmap), disk and file memories map their files
+      //  into the address space, so instances in them have direct pointers
+      //  and copies between them and cpu memories are plain memcpys
+      extern bool use_file_mmap;
+    };
+
     class DiskMemory : public MemoryImpl {
     public:
       static const size_t ALIGNMENT = 256;
@@ -246,6 +265,8 @@ namespace Realm {
     public:
       int fd; // file descriptor
       std::string file;  // file name
+      int direct_fd; // same file opened with O_DIRECT (-ll:aio_direct), or -1
+      char *mapped_base; // non-null if the file is mapped
     };
 
     class FileMemory : public MemoryImpl {
@@ -256,6 +277,15 @@ namespace Realm {
 
       virtual ~FileMemory(void);
 
+      // in mmap mode, each instance gets its own slot of this memory's
+      //  offset space so that an offset identifies the file it's in
+      virtual bool allocate_instance_storage(RegionInstance i,
+					     size_t bytes, size_t alignment,
+					     Event precondition,
+					     size_t offset = 0);
+      virtual void release_instance_storage(RegionInstance i,
+					    Event precondition);
+
       virtual off_t alloc_bytes(size_t size);
 
       virtual void free_bytes(off_t offset, size_t size);
@@ -273,11 +303,28 @@ namespace Realm {
       virtual int get_home_node(off_t offset, size_t size);
 
       int get_file_des(ID::IDType inst_id);
+
+    protected:
+      static const off_t MMAP_SLOT_SIZE = off_t(1) << 40;
+
+      struct MappedFile {
+	RegionInstance inst;
+	int fd;      // -1 until the file is first accessed
+	char *base;
+	size_t size;
+      };
+
+      // returns the mapping for the slot containing 'offset', mapping the
+      //  instance's file on first use - caller must hold vector_lock
+      MappedFile *lookup_mapping(off_t offset);
+
     public:
       std::vector<int> file_vec;
       pthread_mutex_t vector_lock;
       off_t next_offset;
       std::map<off_t, int> offset_map;
+      off_t next_slot;
+      std::map<off_t, MappedFile> mapped_files;  // keyed by slot offset
     };
 
     class RemoteMemory : public MemoryImpl {
@@ -33,15 +33,18 @@ namespace Realm {
     : first(_first), last(_last)
     , prev(0), next(0)
     , prev_free(0), next_free(0)
+    , is_free(false)
   {}
 
   template <typename RT, typename TT>
   inline BasicRangeAllocator<RT,TT>::BasicRangeAllocator(void)
     : sentinel((RT)-1,0)
   {
-    // sentinel is the start and end of both dllists
+    // sentinel is the start and end of the all-ranges dllist - it is never
+    //  free, so it also stops merges at either end
     sentinel.prev = sentinel.next = &sentinel;
-    sentinel.prev_free = sentinel.next_free = &sentinel;
+    for(unsigned i = 0; i < NUM_SIZE_CLASSES; i++)
+      free_lists[i] = 0;
   }
 
   template <typename RT, typename TT>
@@ -56,6 +59,43 @@ namespace Realm {
     }
   }
 
+  template <typename RT, typename TT>
+  inline /*static*/ unsigned BasicRangeAllocator<RT,TT>::size_class(RT size)
+  {
+    // floor(log2(size)) - size is never zero here
+    unsigned sc = 0;
+    while(size >>= 1)
+      sc++;
+    return sc;
+  }
+
+  template <typename RT, typename TT>
+  inline void BasicRangeAllocator<RT,TT>::add_free_range(Range *r)
+  {
+    assert(!r->is_free);
+    Range *&head = free_lists[size_class(r->last - r->first)];
+    r->prev_free = 0;
+    r->next_free = head;
+    if(head)
+      head->prev_free = r;
+    head = r;
+    r->is_free = true;
+  }
+
+  template <typename RT, typename TT>
+  inline void BasicRangeAllocator<RT,TT>::remove_free_range(Range *r)
+  {
+    assert(r->is_free);
+    if(r->prev_free)
+      r->prev_free->next_free = r->next_free;
+    else
+      free_lists[size_class(r->last - r->first)] = r->next_free;
+    if(r->next_free)
+      r->next_free->prev_free = r->prev_free;
+    r->prev_free = r->next_free = 0;
+    r->is_free = false;
+  }
+
   template <typename RT, typename TT>
   inline void BasicRangeAllocator<RT,TT>::add_range(RT first, RT last)
   {
@@ -69,13 +109,12 @@ namespace Realm {
     if(sentinel.next == &sentinel) {
       // insert after sentinel
       Range *prev = &sentinel;
-      Range *prev_free = &sentinel;
       // all block list
       newr->prev = prev; newr->next = prev->next;
       prev->next = newr->next->prev = newr;
-      // free block list
-      newr->prev_free = prev_free; newr->next_free = prev_free->next_free;
-      prev_free->next_free = newr->next_free->prev_free = newr;
+      by_first[first] = newr;
+      // free block lists
+      add_free_range(newr);
       return;
     }
 
@@ -91,80 +130,64 @@ namespace Realm {
       return true;
     }
 
-    // walk free ranges and just take the first that fits
-    Range *r = sentinel.next_free;
-    while(r != &sentinel) {
+    // start with the size class that may contain ranges that fit - every
+    //  range in a larger class is big enough unless alignment gets in the
+    //  way, and we never look at classes of ranges that are too small
+    for(unsigned sc = size_class(size); sc < NUM_SIZE_CLASSES; sc++) {
+      // within a class, take the lowest-addressed range that fits - this
+      //  keeps the address-ordered packing of a first-fit allocator, which
+      //  fragments much less than taking whatever was freed most recently
+      Range *r = 0;
       RT ofs = 0;
-      if(alignment) {
-	RT rem = r->first % alignment;
-	if(rem > 0)
-	  ofs = alignment - rem;
+      for(Range *c = free_lists[sc]; c; c = c->next_free) {
+	if(r && (c->first > r->first))
+	  continue;
+	RT c_ofs = 0;
+	if(alignment) {
+	  RT rem = c->first % alignment;
+	  if(rem > 0)
+	    c_ofs = alignment - rem;
+	}
+	// do we have enough space?
+	if((c->last - c->first) >= (size + c_ofs)) {
+	  r = c;
+	  ofs = c_ofs;
+	}
+      }
+      if(!r)
+	continue;
+
+      // yes, but we may need chop things up to make the exact range we want
+      alloc_first = r->first + ofs;
+      RT alloc_last = alloc_first + size;
+      remove_free_range(r);
+
+      // do we need to carve off a new (free) block before us?
+      if(alloc_first != r->first) {
+	Range *new_prev = new Range(r->first, alloc_first);
+	by_first[r->first] = new_prev;
+	by_first[alloc_first] = r;
+	r->first = alloc_first;
+	// new_prev goes before r in all block list
+	new_prev->prev = r->prev; new_prev->prev->next = new_prev;
+	new_prev->next = r;
+	r->prev = new_prev;
+	add_free_range(new_prev);
       }
-      // do we have enough space?
-      if((r->last - r->first) >= (size + ofs)) {
-	// yes, but we may need chop things up to make the exact range we want
-	alloc_first = r->first + ofs;
-	RT alloc_last = alloc_first + size;
-
-        // do we need to carve off a new (free) block before us?
-        if(alloc_first != r->first) {
-          Range *new_prev = new Range(r->first, alloc_first);
-          r->first = alloc_first;
-          new_prev->prev = r->prev; new_prev->prev->next = new_prev;
-          new_prev->next = r;
-          r->prev = new_prev;
-          new_prev->prev_free = r->prev_free;
-          new_prev->prev_free->next_free = new_prev;
-          new_prev->next_free = r;
-          r->prev_free = new_prev;
-        }
-
-	// four cases to deal with
-	if(alloc_last == r->last) {
-	  if(alloc_first == r->first) {
-	    // case 1 - exact fit
-	    //
-	    // all we have to do here is remove this range from the free range dlist
-	    //  and add to the allocated lookup map
-	    r->prev_free->next_free = r->next_free;
-	    r->next_free->prev_free = r->prev_free;
-	    r->prev_free = r->next_free = 0;
-
-	    allocated[tag] = r;
-	    return true;
-	  } else {
-	    // case 2 - leftover at beginning
-	    assert(0);
-	  }
-	} else {
-	  if(alloc_first == r->first) {
-	    // case 3 - leftover at end
-	    Range *r_after = new Range(alloc_last, r->last);
-	    by_first[alloc_last] = r_after;
-	    r->last = alloc_last;
-
-	    // r_after goes after r in all block list
-	    r_after->prev = r; r_after->next = r->next;
-	    r->next->prev = r_after; r->next = r_after;
-
-	    // r_after replaces r in the free block list
-	    r_after->prev_free = r->prev_free;
-	    r_after->next_free = r->next_free;
-	    r->prev_free->next_free = r_after;
-	    r->next_free->prev_free = r_after;
-	    r->prev_free = r->next_free = 0;
 
-	    allocated[tag] = r;
-	    return true;
-	  } else {
-	    // case 4 - leftover on both sides
-	    assert(0);
-	  }
-	}
+      // and a new (free) block after us?
+      if(alloc_last != r->last) {
+	Range *r_after = new Range(alloc_last, r->last);
+	by_first[alloc_last] = r_after;
+	r->last = alloc_last;
+	// r_after goes after r in all block list
+	r_after->prev = r; r_after->next = r->next;
+	r->next->prev = r_after; r->next = r_after;
+	add_free_range(r_after);
       }
 
-      // no, go to next one
-      r = r->next_free;
+      allocated[tag] = r;
+      return true;
     }
     // allocation failed
     return false;
@@ -183,95 +206,39 @@ namespace Realm {
     if(!r)
       return;
 
-    // need to add ourselves back to the free list - find previous and next
-    //  free entries (which have non-null prev_free/next_free pointers)
-    Range *prev_free = r->prev;
-    while(!prev_free->next_free) {
-      prev_free = prev_free->prev;
-      assert(prev_free != r);  // wrapping around would be bad
-    }
-    Range *next_free = r->next;
-    while(!next_free->prev_free) {
-      next_free = next_free->next;
-      assert(next_free != r);
-    }
-
-    // do we need to merge?
-    bool merge_prev = (prev_free == r->prev) && (prev_free != &sentinel);
-    bool merge_next = (next_free == r->next) && (next_free != &sentinel);
-
-    // four cases - ordered to match the allocation cases
-    if(!merge_next) {
-      if(!merge_prev) {
-	// case 1 - no merging (exact match)
-	r->prev_free = prev_free; r->next_free = next_free;
-	prev_free->next_free = next_free->prev_free = r;
-      } else {
-	// case 2 - merge before
-	Range *old_prev = r->prev;
-	assert(r->first == old_prev->last);
-	by_first.erase(r->first);
-	r->first = old_prev->first;
-	by_first[r->first] = r;
-
-	// our prev is the old prev's prev - next doesn't change
-	r->prev = old_prev->prev;
-	r->prev->next = r;
-
-	// take over the free list pointers
-	r->prev_free = old_prev->prev_free;
-	r->prev_free->next_free = r;
-	r->next_free = old_prev->next_free;
-	r->next_free->prev_free = r;
+    // merge with our neighbors if they are free (the sentinel never is)
+    if(r->prev->is_free) {
+      Range *old_prev = r->prev;
+      assert(r->first == old_prev->last);
+      remove_free_range(old_prev);
+      by_first.erase(r->first);
+      r->first = old_prev->first;
+      by_first[r->first] = r;
 
+      // our prev is the old prev's prev - next doesn't change
+      r->prev = old_prev->prev;
+      r->prev->next = r;
 
-	delete old_prev;
-      }
-    } else {
-      if(!merge_prev) {
-	// case 3 - merge after
-	Range *old_next = r->next;
-	assert(r->last == old_next->first);
-	r->last = old_next->last;
-	by_first.erase(old_next->first);
-
-	// our next is the old next's next - prev doesn't change
-	r->next = old_next->next;
-	r->next->prev = r;
-
-	// take over the free list pointers
-	r->prev_free = old_next->prev_free;
-	r->prev_free->next_free = r;
-	r->next_free = old_next->next_free;
-	r->next_free->prev_free = r;
-
-	delete old_next;
-      } else {
-	// case 4 - merge both
-	
-	Range *old_prev = r->prev;
-	assert(r->first == old_prev->last);
-	by_first.erase(r->first);
-	r->first = old_prev->first;
-	by_first[r->first] = r;
-
-	Range *old_next = r->next;
-	assert(r->last == old_next->first);
-	r->last = old_next->last;
-	by_first.erase(old_next->first);
+      delete old_prev;
+    }
 
-	// take prev pointers from old_prev and next from old_next
-	r->prev = old_prev->prev;  r->prev->next = r;
-	r->next = old_next->next;  r->next->prev = r;
+    if(r->next->is_free) {
+      Range *old_next = r->next;
+      assert(r->last == old_next->first);
+      remove_free_range(old_next);
+      by_first.erase(old_next->first);
+      r->last = old_next->last;
 
-	r->prev_free = old_prev->prev_free; r->prev_free->next_free = r;
-	r->next_free = old_next->next_free; r->next_free->prev_free = r;
+      // our next is the old next's next - prev doesn't change
+      r->next = old_next->next;
+      r->next->prev = r;
 
-	delete old_prev;
-	delete old_next;
-      }
+      delete old_next;
     }
-  };
+
+    // the merged range goes into the free list for its (new) size class
+    add_free_range(r);
+  }
   
     
 }; // namespace Realm
@@ -0,0 +1,79 @@
+/* Copyright 2018 Stanford University, NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// bounded lock-free multi-producer/multi-consumer queue
+
+#ifndef REALM_MPMC_QUEUE_H
+#define REALM_MPMC_QUEUE_H
+
+#include <stddef.h>
+
+namespace Realm {
+
+  // a fixed-capacity ring that any number of threads can push to and pop
+  //  from without taking a lock - each slot carries a sequence number that
+  //  tells producers and consumers whose turn it is to use it, so the only
+  //  contended operation is a single compare-and-swap on the head or tail
+  // T should be cheap to copy (e.g. a pointer)
+  template <typename T>
+  class MPMCQueue {
+  public:
+    // capacity is rounded up to the next power of two
+    MPMCQueue(size_t _capacity);
+    ~MPMCQueue(void);
+
+    size_t capacity(void) const;
+
+    // only a hint when other threads are pushing/popping concurrently
+    size_t size_approx(void) const;
+    bool empty_approx(void) const;
+
+    // these fail (rather than block) if the queue is full/empty
+    bool push(const T& val);
+    bool pop(T& val);
+
+    // batched versions claim as many consecutive slots as they can in one
+    //  compare-and-swap and return the number of entries actually moved
+    size_t push_batch(const T *vals, size_t count);
+    size_t pop_batch(T *vals, size_t max_count);
+
+  protected:
+    struct Slot {
+      volatile size_t seq;
+      T val;
+    };
+
+    static const size_t CACHE_LINE = 64;
+
+    Slot *slots;
+    size_t mask;
+    // keep producers and consumers off of each other's cache lines
+    char pad0[CACHE_LINE];
+    volatile size_t enqueue_pos;
+    char pad1[CACHE_LINE - sizeof(size_t)];
+    volatile size_t dequeue_pos;
+    char pad2[CACHE_LINE - sizeof(size_t)];
+
+  private:
+    // not copyable
+    MPMCQueue(const MPMCQueue<T>&);
+    MPMCQueue<T>& operator=(const MPMCQueue<T>&);
+  };
+
+}; // namespace Realm
+
+#include "realm/mpmc_queue.inl"
+
+#endif // ifndef REALM_MPMC_QUEUE_H
@@ -0,0 +1,175 @@
+/* Copyright 2018 Stanford University, NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// bounded lock-free multi-producer/multi-consumer queue
+
+// nop, but helps IDEs
+#include "realm/mpmc_queue.h"
+
+namespace Realm {
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class MPMCQueue<T>
+
+  // slot i is free for the producer holding ticket t when seq == t, and full
+  //  for the consumer holding ticket t when seq == t + 1 - once consumed it is
+  //  handed to the producer one lap later by setting seq = t + capacity
+
+  template <typename T>
+  inline MPMCQueue<T>::MPMCQueue(size_t _capacity)
+    : enqueue_pos(0), dequeue_pos(0)
+  {
+    size_t cap = 2;
+    while(cap < _capacity)
+      cap <<= 1;
+    mask = cap - 1;
+    slots = new Slot[cap];
+    for(size_t i = 0; i < cap; i++)
+      slots[i].seq = i;
+  }
+
+  template <typename T>
+  inline MPMCQueue<T>::~MPMCQueue(void)
+  {
+    delete[] slots;
+  }
+
+  template <typename T>
+  inline size_t MPMCQueue<T>::capacity(void) const
+  {
+    return mask + 1;
+  }
+
+  template <typename T>
+  inline size_t MPMCQueue<T>::size_approx(void) const
+  {
+    size_t head = dequeue_pos;
+    size_t tail = enqueue_pos;
+    return ((tail > head) ? (tail - head) : 0);
+  }
+
+  template <typename T>
+  inline bool MPMCQueue<T>::empty_approx(void) const
+  {
+    return (enqueue_pos == dequeue_pos);
+  }
+
+  template <typename T>
+  inline bool MPMCQueue<T>::push(const T& val)
+  {
+    return (push_batch(&val, 1) == 1);
+  }
+
+  template <typename T>
+  inline bool MPMCQueue<T>::pop(T& val)
+  {
+    return (pop_batch(&val, 1) == 1);
+  }
+
+  template <typename T>
+  inline size_t MPMCQueue<T>::push_batch(const T *vals, size_t count)
+  {
+    if(count == 0)
+      return 0;
+    if(count > (mask + 1))
+      count = mask + 1;
+    size_t pos = enqueue_pos;
+    size_t n;
+    while(true) {
+      // count how many consecutive slots are free for us starting at 'pos'
+      n = 0;
+      while(n < count) {
+	ptrdiff_t diff = ((ptrdiff_t)(slots[(pos + n) & mask].seq) -
+			  (ptrdiff_t)(pos + n));
+	if(diff != 0) {
+	  // a negative difference means the slot hasn't been drained from
+	  //  the previous lap (i.e. the queue is full from here on) - a
+	  //  positive difference means 'pos' is stale
+	  if((diff > 0) && (n == 0))
+	    n = (size_t)-1;
+	  break;
+	}
+	n++;
+      }
+      if(n == (size_t)-1) {
+	pos = enqueue_pos;
+	continue;
+      }
+      if(n == 0)
+	return 0;  // full
+      // try to claim the slots - the CAS is also a full barrier, which
+      //  orders the reads of 'seq' above before our writes below
+      size_t prev = __sync_val_compare_and_swap(&enqueue_pos, pos, pos + n);
+      if(prev == pos)
+	break;
+      pos = prev;
+    }
+
+    for(size_t i = 0; i < n; i++)
+      slots[(pos + i) & mask].val = vals[i];
+    // make the values visible before the sequence numbers that publish them
+    __sync_synchronize();
+    for(size_t i = 0; i < n; i++)
+      slots[(pos + i) & mask].seq = pos + i + 1;
+    return n;
+  }
+
+  template <typename T>
+  inline size_t MPMCQueue<T>::pop_batch(T *vals, size_t max_count)
+  {
+    if(max_count == 0)
+      return 0;
+    if(max_count > (mask + 1))
+      max_count = mask + 1;
+    size_t pos = dequeue_pos;
+    size_t n;
+    while(true) {
+      // count how many consecutive slots are full for us starting at 'pos'
+      n = 0;
+      while(n < max_count) {
+	ptrdiff_t diff = ((ptrdiff_t)(slots[(pos + n) & mask].seq) -
+			  (ptrdiff_t)(pos + n + 1));
+	if(diff != 0) {
+	  // negative means nothing has been published there yet (empty from
+	  //  here on) - positive means 'pos' is stale
+	  if((diff > 0) && (n == 0))
+	    n = (size_t)-1;
+	  break;
+	}
+	n++;
+      }
+      if(n == (size_t)-1) {
+	pos = dequeue_pos;
+	continue;
+      }
+      if(n == 0)
+	return 0;  // empty
+      size_t prev = __sync_val_compare_and_swap(&dequeue_pos, pos, pos + n);
+      if(prev == pos)
+	break;
+      pos = prev;
+    }
+
+    for(size_t i = 0; i < n; i++)
+      vals[i] = slots[(pos + i) & mask].val;
+    // finish reading the values before handing the slots back to producers
+    __sync_synchronize();
+    for(size_t i = 0; i < n; i++)
+      slots[(pos + i) & mask].seq = pos + i + mask + 1;
+    return n;
+  }
+
+}; // namespace Realm
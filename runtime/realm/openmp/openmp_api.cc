@@ -53,6 +53,45 @@ namespace Realm {
     }
   };
 
+  // worksharing loops with dynamic/guided scheduling - outside of a
+  //  parallel region, the calling thread just gets the whole loop
+  static __thread ThreadPool::LoopState serial_loop;
+
+  static ThreadPool::LoopState *start_team_loop(int schedule, int64_t count,
+						int64_t chunk,
+						int64_t start, int64_t incr)
+  {
+    Realm::ThreadPool::WorkerInfo *wi = Realm::ThreadPool::get_worker_info();
+    if(wi && wi->work_item)
+      return wi->start_loop(schedule, count, chunk, start, incr);
+
+    serial_loop.init(ThreadPool::LoopState::SCHED_DYNAMIC, count, count,
+		     start, incr);
+    return &serial_loop;
+  }
+
+  static ThreadPool::LoopState *current_team_loop(int& num_threads)
+  {
+    Realm::ThreadPool::WorkerInfo *wi = Realm::ThreadPool::get_worker_info();
+    if(wi && wi->work_item) {
+      num_threads = wi->num_threads;
+      return wi->current_loop();
+    }
+
+    num_threads = 1;
+    return &serial_loop;
+  }
+
+  static void end_team_loop(bool barrier)
+  {
+    Realm::ThreadPool::WorkerInfo *wi = Realm::ThreadPool::get_worker_info();
+    if(wi && wi->work_item) {
+      wi->end_loop();
+      if(barrier)
+	wi->team_barrier();
+    }
+  }
+
 #ifdef REALM_OPENMP_GOMP_SUPPORT
   extern "C" {
     void GOMP_parallel_start(void (*fnptr)(void *data), void *data, int nthreads)
@@ -110,6 +149,318 @@ namespace Realm {
       fnptr(data);
       GOMP_parallel_end();
     }
+
+    void GOMP_barrier(void)
+    {
+      Realm::ThreadPool::WorkerInfo *wi = Realm::ThreadPool::get_worker_info();
+      if(wi)
+	wi->team_barrier();
+    }
+  };
+
+  static int64_t gomp_loop_count(long start, long end, long incr)
+  {
+    if(incr > 0)
+      return (start < end) ? ((end - start + incr - 1) / incr) : 0;
+    else
+      return (start > end) ? ((start - end - incr - 1) / -incr) : 0;
+  }
+
+  static int64_t gomp_loop_ull_count(bool up, unsigned long long start,
+				     unsigned long long end,
+				     unsigned long long incr)
+  {
+    // for a downward loop, 'incr' is the two's complement of the stride
+    if(up)
+      return (start < end) ? ((end - start + incr - 1) / incr) : 0;
+    else
+      return (start > end) ? ((start - end - incr - 1) / -incr) : 0;
+  }
+
+  static bool gomp_loop_next(long *istart, long *iend)
+  {
+    int num_threads;
+    ThreadPool::LoopState *loop = current_team_loop(num_threads);
+    int64_t lo, hi;
+    if(!loop->next_chunk(num_threads, lo, hi))
+      return false;
+    *istart = loop->start + lo * loop->incr;
+    *iend = loop->start + hi * loop->incr;
+    return true;
+  }
+
+  static bool gomp_loop_ull_next(unsigned long long *istart,
+				 unsigned long long *iend)
+  {
+    int num_threads;
+    ThreadPool::LoopState *loop = current_team_loop(num_threads);
+    int64_t lo, hi;
+    if(!loop->next_chunk(num_threads, lo, hi))
+      return false;
+    *istart = ((unsigned long long)(loop->start) +
+	       (unsigned long long)lo * (unsigned long long)(loop->incr));
+    *iend = ((unsigned long long)(loop->start) +
+	     (unsigned long long)hi * (unsigned long long)(loop->incr));
+    return true;
+  }
+
+  static bool gomp_loop_start(int schedule, long start, long end, long incr,
+			      long chunk, long *istart, long *iend)
+  {
+    start_team_loop(schedule, gomp_loop_count(start, end, incr), chunk,
+		    start, incr);
+    return gomp_loop_next(istart, iend);
+  }
+
+  static bool gomp_loop_ull_start(int schedule, bool up,
+				  unsigned long long start,
+				  unsigned long long end,
+				  unsigned long long incr,
+				  unsigned long long chunk,
+				  unsigned long long *istart,
+				  unsigned long long *iend)
+  {
+    start_team_loop(schedule, gomp_loop_ull_count(up, start, end, incr), chunk,
+		    start, incr);
+    return gomp_loop_ull_next(istart, iend);
+  }
+
+  // the combined 'parallel loop' entry points hand the team a body that
+  //  expects the loop to already have been started
+  struct ParallelLoopArgs {
+    void (*fnptr)(void *data);
+    void *data;
+    int schedule;
+    int64_t count, chunk, start, incr;
+
+    static void invoke(void *data)
+    {
+      const ParallelLoopArgs *args = (const ParallelLoopArgs *)data;
+      start_team_loop(args->schedule, args->count, args->chunk,
+		      args->start, args->incr);
+      (args->fnptr)(args->data);
+    }
+  };
+
+  static void gomp_parallel_loop(void (*fnptr)(void *data), void *data,
+				 unsigned nthreads, int schedule,
+				 long start, long end, long incr, long chunk,
+				 unsigned flags)
+  {
+    ParallelLoopArgs args;
+    args.fnptr = fnptr;
+    args.data = data;
+    args.schedule = schedule;
+    args.count = gomp_loop_count(start, end, incr);
+    args.chunk = chunk;
+    args.start = start;
+    args.incr = incr;
+    GOMP_parallel(&ParallelLoopArgs::invoke, &args, nthreads, flags);
+  }
+
+  // 'runtime' schedules (i.e. OMP_SCHEDULE) are not supported - they get
+  //  dynamic scheduling with a chunk size of 1
+  extern "C" {
+    bool GOMP_loop_dynamic_start(long start, long end, long incr, long chunk,
+				 long *istart, long *iend)
+    {
+      return gomp_loop_start(ThreadPool::LoopState::SCHED_DYNAMIC,
+			     start, end, incr, chunk, istart, iend);
+    }
+
+    bool GOMP_loop_dynamic_next(long *istart, long *iend)
+    {
+      return gomp_loop_next(istart, iend);
+    }
+
+    bool GOMP_loop_guided_start(long start, long end, long incr, long chunk,
+				long *istart, long *iend)
+    {
+      return gomp_loop_start(ThreadPool::LoopState::SCHED_GUIDED,
+			     start, end, incr, chunk, istart, iend);
+    }
+
+    bool GOMP_loop_guided_next(long *istart, long *iend)
+    {
+      return gomp_loop_next(istart, iend);
+    }
+
+    bool GOMP_loop_runtime_start(long start, long end, long incr,
+				 long *istart, long *iend)
+    {
+      return gomp_loop_start(ThreadPool::LoopState::SCHED_DYNAMIC,
+			     start, end, incr, 1, istart, iend);
+    }
+
+    bool GOMP_loop_runtime_next(long *istart, long *iend)
+    {
+      return gomp_loop_next(istart, iend);
+    }
+
+    // newer compilers default to nonmonotonic schedules, which we already
+    //  satisfy
+    bool GOMP_loop_nonmonotonic_dynamic_start(long start, long end, long incr,
+					      long chunk,
+					      long *istart, long *iend)
+    {
+      return GOMP_loop_dynamic_start(start, end, incr, chunk, istart, iend);
+    }
+
+    bool GOMP_loop_nonmonotonic_dynamic_next(long *istart, long *iend)
+    {
+      return gomp_loop_next(istart, iend);
+    }
+
+    bool GOMP_loop_nonmonotonic_guided_start(long start, long end, long incr,
+					     long chunk,
+					     long *istart, long *iend)
+    {
+      return GOMP_loop_guided_start(start, end, incr, chunk, istart, iend);
+    }
+
+    bool GOMP_loop_nonmonotonic_guided_next(long *istart, long *iend)
+    {
+      return gomp_loop_next(istart, iend);
+    }
+
+    bool GOMP_loop_maybe_nonmonotonic_runtime_start(long start, long end,
+						    long incr,
+						    long *istart, long *iend)
+    {
+      return GOMP_loop_runtime_start(start, end, incr, istart, iend);
+    }
+
+    bool GOMP_loop_maybe_nonmonotonic_runtime_next(long *istart, long *iend)
+    {
+      return gomp_loop_next(istart, iend);
+    }
+
+    bool GOMP_loop_ull_dynamic_start(bool up, unsigned long long start,
+				     unsigned long long end,
+				     unsigned long long incr,
+				     unsigned long long chunk,
+				     unsigned long long *istart,
+				     unsigned long long *iend)
+    {
+      return gomp_loop_ull_start(ThreadPool::LoopState::SCHED_DYNAMIC, up,
+				 start, end, incr, chunk, istart, iend);
+    }
+
+    bool GOMP_loop_ull_dynamic_next(unsigned long long *istart,
+				    unsigned long long *iend)
+    {
+      return gomp_loop_ull_next(istart, iend);
+    }
+
+    bool GOMP_loop_ull_guided_start(bool up, unsigned long long start,
+				    unsigned long long end,
+				    unsigned long long incr,
+				    unsigned long long chunk,
+				    unsigned long long *istart,
+				    unsigned long long *iend)
+    {
+      return gomp_loop_ull_start(ThreadPool::LoopState::SCHED_GUIDED, up,
+				 start, end, incr, chunk, istart, iend);
+    }
+
+    bool GOMP_loop_ull_guided_next(unsigned long long *istart,
+				   unsigned long long *iend)
+    {
+      return gomp_loop_ull_next(istart, iend);
+    }
+
+    bool GOMP_loop_ull_nonmonotonic_dynamic_start(bool up,
+						  unsigned long long start,
+						  unsigned long long end,
+						  unsigned long long incr,
+						  unsigned long long chunk,
+						  unsigned long long *istart,
+						  unsigned long long *iend)
+    {
+      return GOMP_loop_ull_dynamic_start(up, start, end, incr, chunk,
+					 istart, iend);
+    }
+
+    bool GOMP_loop_ull_nonmonotonic_dynamic_next(unsigned long long *istart,
+						 unsigned long long *iend)
+    {
+      return gomp_loop_ull_next(istart, iend);
+    }
+
+    bool GOMP_loop_ull_nonmonotonic_guided_start(bool up,
+						 unsigned long long start,
+						 unsigned long long end,
+						 unsigned long long incr,
+						 unsigned long long chunk,
+						 unsigned long long *istart,
+						 unsigned long long *iend)
+    {
+      return GOMP_loop_ull_guided_start(up, start, end, incr, chunk,
+					istart, iend);
+    }
+
+    bool GOMP_loop_ull_nonmonotonic_guided_next(unsigned long long *istart,
+						unsigned long long *iend)
+    {
+      return gomp_loop_ull_next(istart, iend);
+    }
+
+    void GOMP_loop_end(void)
+    {
+      end_team_loop(true /*barrier*/);
+    }
+
+    void GOMP_loop_end_nowait(void)
+    {
+      end_team_loop(false /*!barrier*/);
+    }
+
+    void GOMP_parallel_loop_dynamic(void (*fnptr)(void *data), void *data,
+				    unsigned nthreads, long start, long end,
+				    long incr, long chunk, unsigned flags)
+    {
+      gomp_parallel_loop(fnptr, data, nthreads,
+			 ThreadPool::LoopState::SCHED_DYNAMIC,
+			 start, end, incr, chunk, flags);
+    }
+
+    void GOMP_parallel_loop_guided(void (*fnptr)(void *data), void *data,
+				   unsigned nthreads, long start, long end,
+				   long incr, long chunk, unsigned flags)
+    {
+      gomp_parallel_loop(fnptr, data, nthreads,
+			 ThreadPool::LoopState::SCHED_GUIDED,
+			 start, end, incr, chunk, flags);
+    }
+
+    void GOMP_parallel_loop_runtime(void (*fnptr)(void *data), void *data,
+				    unsigned nthreads, long start, long end,
+				    long incr, unsigned flags)
+    {
+      gomp_parallel_loop(fnptr, data, nthreads,
+			 ThreadPool::LoopState::SCHED_DYNAMIC,
+			 start, end, incr, 1, flags);
+    }
+
+    void GOMP_parallel_loop_nonmonotonic_dynamic(void (*fnptr)(void *data),
+						 void *data, unsigned nthreads,
+						 long start, long end,
+						 long incr, long chunk,
+						 unsigned flags)
+    {
+      GOMP_parallel_loop_dynamic(fnptr, data, nthreads, start, end,
+				 incr, chunk, flags);
+    }
+
+    void GOMP_parallel_loop_nonmonotonic_guided(void (*fnptr)(void *data),
+						void *data, unsigned nthreads,
+						long start, long end,
+						long incr, long chunk,
+						unsigned flags)
+    {
+      GOMP_parallel_loop_guided(fnptr, data, nthreads, start, end,
+				incr, chunk, flags);
+    }
   };
 #endif
 
@@ -165,6 +516,45 @@ namespace Realm {
 
     void __kmpc_serialized_parallel(ident_t *loc, kmp_int32 global_tid);
     void __kmpc_end_serialized_parallel(ident_t *loc, kmp_int32 global_tid);
+
+    void __kmpc_barrier(ident_t *loc, kmp_int32 global_tid);
+
+    void __kmpc_dispatch_init_4(ident_t *loc, kmp_int32 global_tid,
+				kmp_int32 schedtype,
+				kmp_int32 lower, kmp_int32 upper,
+				kmp_int32 stride, kmp_int32 chunk);
+    void __kmpc_dispatch_init_4u(ident_t *loc, kmp_int32 global_tid,
+				 kmp_int32 schedtype,
+				 kmp_uint32 lower, kmp_uint32 upper,
+				 kmp_int32 stride, kmp_int32 chunk);
+    void __kmpc_dispatch_init_8(ident_t *loc, kmp_int32 global_tid,
+				kmp_int32 schedtype,
+				kmp_int64 lower, kmp_int64 upper,
+				kmp_int64 stride, kmp_int64 chunk);
+    void __kmpc_dispatch_init_8u(ident_t *loc, kmp_int32 global_tid,
+				 kmp_int32 schedtype,
+				 kmp_uint64 lower, kmp_uint64 upper,
+				 kmp_int64 stride, kmp_int64 chunk);
+    int __kmpc_dispatch_next_4(ident_t *loc, kmp_int32 global_tid,
+			       kmp_int32 *plastiter,
+			       kmp_int32 *plower, kmp_int32 *pupper,
+			       kmp_int32 *pstride);
+    int __kmpc_dispatch_next_4u(ident_t *loc, kmp_int32 global_tid,
+				kmp_int32 *plastiter,
+				kmp_uint32 *plower, kmp_uint32 *pupper,
+				kmp_int32 *pstride);
+    int __kmpc_dispatch_next_8(ident_t *loc, kmp_int32 global_tid,
+			       kmp_int32 *plastiter,
+			       kmp_int64 *plower, kmp_int64 *pupper,
+			       kmp_int64 *pstride);
+    int __kmpc_dispatch_next_8u(ident_t *loc, kmp_int32 global_tid,
+				kmp_int32 *plastiter,
+				kmp_uint64 *plower, kmp_uint64 *pupper,
+				kmp_int64 *pstride);
+    void __kmpc_dispatch_fini_4(ident_t *loc, kmp_int32 global_tid);
+    void __kmpc_dispatch_fini_4u(ident_t *loc, kmp_int32 global_tid);
+    void __kmpc_dispatch_fini_8(ident_t *loc, kmp_int32 global_tid);
+    void __kmpc_dispatch_fini_8u(ident_t *loc, kmp_int32 global_tid);
   };
 
   struct kmp_thunk {
@@ -540,6 +930,182 @@ namespace Realm {
     assert(work->remaining_workers == 1);
     delete work;
   }
+
+  void __kmpc_barrier(ident_t *loc, kmp_int32 global_tid)
+  {
+    Realm::ThreadPool::WorkerInfo *wi = Realm::ThreadPool::get_worker_info();
+    if(wi)
+      wi->team_barrier();
+  }
+
+  // templated code for __kmpc_dispatch_init_{4,4u,8,8u}
+  template <typename T, typename ST>
+  static inline void kmpc_dispatch_init(ident_t *loc, kmp_int32 global_tid,
+					kmp_int32 schedtype,
+					T lower, T upper, ST stride, ST chunk)
+  {
+    // bounds are inclusive here
+    int64_t count;
+    if(stride > 0)
+      count = (lower <= upper) ? (1 + (upper - lower) / stride) : 0;
+    else
+      count = (lower >= upper) ? (1 + (lower - upper) / -stride) : 0;
+
+    // ignore the monotonic/nonmonotonic modifiers - our dynamic chunks are
+    //  handed out in order anyway
+    schedtype &= ~((1 << 29) /*monotonic*/ | (1 << 30) /*nonmonotonic*/);
+
+    int schedule;
+    int64_t ichunk = chunk;
+    switch(schedtype) {
+    case 33 /* kmp_sch_static_chunked */:
+    case 34 /* kmp_sch_static */:
+      {
+	// dispatched static loops (e.g. 'ordered' ones) are handed out
+	//  dynamically in the static chunk size - the iterations each
+	//  thread gets may differ from a true static schedule
+	schedule = ThreadPool::LoopState::SCHED_DYNAMIC;
+	if(schedtype == 34) {
+	  Realm::ThreadPool::WorkerInfo *wi = Realm::ThreadPool::get_worker_info();
+	  int nthreads = (wi && wi->work_item) ? wi->num_threads : 1;
+	  ichunk = (count + nthreads - 1) / nthreads;
+	}
+	break;
+      }
+
+    case 35 /* kmp_sch_dynamic_chunked */:
+    case 37 /* kmp_sch_runtime */:
+      {
+	schedule = ThreadPool::LoopState::SCHED_DYNAMIC;
+	break;
+      }
+
+    case 36 /* kmp_sch_guided_chunked */:
+    case 38 /* kmp_sch_auto */:
+    case 41 /* kmp_sch_guided_iterative_chunked */:
+    case 42 /* kmp_sch_guided_analytical_chunked */:
+      {
+	schedule = ThreadPool::LoopState::SCHED_GUIDED;
+	break;
+      }
+
+    default: assert(false); return;
+    }
+
+    start_team_loop(schedule, count, ichunk, (int64_t)lower, (int64_t)stride);
+  }
+
+  // templated code for __kmpc_dispatch_next_{4,4u,8,8u}
+  template <typename T, typename ST>
+  static inline int kmpc_dispatch_next(ident_t *loc, kmp_int32 global_tid,
+				       kmp_int32 *plastiter,
+				       T *plower, T *pupper, ST *pstride)
+  {
+    int num_threads;
+    ThreadPool::LoopState *loop = current_team_loop(num_threads);
+    int64_t lo, hi;
+    if(!loop->next_chunk(num_threads, lo, hi)) {
+      // each thread sees the end of the loop exactly once
+      end_team_loop(false /*!barrier*/);
+      return 0;
+    }
+    // do the math unsigned so that wrapping is well-defined
+    *plower = (T)((uint64_t)(loop->start) +
+		  (uint64_t)lo * (uint64_t)(loop->incr));
+    *pupper = (T)((uint64_t)(loop->start) +
+		  (uint64_t)(hi - 1) * (uint64_t)(loop->incr));
+    if(pstride)
+      *pstride = (ST)(loop->incr);
+    if(plastiter)
+      *plastiter = (hi == loop->count);
+    return 1;
+  }
+
+  void __kmpc_dispatch_init_4(ident_t *loc, kmp_int32 global_tid,
+			      kmp_int32 schedtype,
+			      kmp_int32 lower, kmp_int32 upper,
+			      kmp_int32 stride, kmp_int32 chunk)
+  {
+    kmpc_dispatch_init<kmp_int32, kmp_int32>(loc, global_tid, schedtype,
+					     lower, upper, stride, chunk);
+  }
+
+  void __kmpc_dispatch_init_4u(ident_t *loc, kmp_int32 global_tid,
+			       kmp_int32 schedtype,
+			       kmp_uint32 lower, kmp_uint32 upper,
+			       kmp_int32 stride, kmp_int32 chunk)
+  {
+    kmpc_dispatch_init<kmp_uint32, kmp_int32>(loc, global_tid, schedtype,
+					      lower, upper, stride, chunk);
+  }
+
+  void __kmpc_dispatch_init_8(ident_t *loc, kmp_int32 global_tid,
+			      kmp_int32 schedtype,
+			      kmp_int64 lower, kmp_int64 upper,
+			      kmp_int64 stride, kmp_int64 chunk)
+  {
+    kmpc_dispatch_init<kmp_int64, kmp_int64>(loc, global_tid, schedtype,
+					     lower, upper, stride, chunk);
+  }
+
+  void __kmpc_dispatch_init_8u(ident_t *loc, kmp_int32 global_tid,
+			       kmp_int32 schedtype,
+			       kmp_uint64 lower, kmp_uint64 upper,
+			       kmp_int64 stride, kmp_int64 chunk)
+  {
+    kmpc_dispatch_init<kmp_uint64, kmp_int64>(loc, global_tid, schedtype,
+					      lower, upper, stride, chunk);
+  }
+
+  int __kmpc_dispatch_next_4(ident_t *loc, kmp_int32 global_tid,
+			     kmp_int32 *plastiter,
+			     kmp_int32 *plower, kmp_int32 *pupper,
+			     kmp_int32 *pstride)
+  {
+    return kmpc_dispatch_next<kmp_int32, kmp_int32>(loc, global_tid, plastiter,
+						    plower, pupper, pstride);
+  }
+
+  int __kmpc_dispatch_next_4u(ident_t *loc, kmp_int32 global_tid,
+			      kmp_int32 *plastiter,
+			      kmp_uint32 *plower, kmp_uint32 *pupper,
+			      kmp_int32 *pstride)
+  {
+    return kmpc_dispatch_next<kmp_uint32, kmp_int32>(loc, global_tid, plastiter,
+						     plower, pupper, pstride);
+  }
+
+  int __kmpc_dispatch_next_8(ident_t *loc, kmp_int32 global_tid,
+			     kmp_int32 *plastiter,
+			     kmp_int64 *plower, kmp_int64 *pupper,
+			     kmp_int64 *pstride)
+  {
+    return kmpc_dispatch_next<kmp_int64, kmp_int64>(loc, global_tid, plastiter,
+						    plower, pupper, pstride);
+  }
+
+  int __kmpc_dispatch_next_8u(ident_t *loc, kmp_int32 global_tid,
+			      kmp_int32 *plastiter,
+			      kmp_uint64 *plower, kmp_uint64 *pupper,
+			      kmp_int64 *pstride)
+  {
+    return kmpc_dispatch_next<kmp_uint64, kmp_int64>(loc, global_tid, plastiter,
+						     plower, pupper, pstride);
+  }
+
+  // the 'fini' calls are only used for ordered loops, and we finish a loop
+  //  when a thread runs out of chunks
+  void __kmpc_dispatch_fini_4(ident_t *loc, kmp_int32 global_tid)
+  {}
+
+  void __kmpc_dispatch_fini_4u(ident_t *loc, kmp_int32 global_tid)
+  {}
+
+  void __kmpc_dispatch_fini_8(ident_t *loc, kmp_int32 global_tid)
+  {}
+
+  void __kmpc_dispatch_fini_8u(ident_t *loc, kmp_int32 global_tid)
+  {}
 #endif
 
 }; // namespace Realm
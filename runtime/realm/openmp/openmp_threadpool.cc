@@ -26,6 +26,78 @@ namespace Realm {
     __thread ThreadPool::WorkerInfo *threadpool_workerinfo = 0;
   };
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class ThreadPool::LoopState
+
+  void ThreadPool::LoopState::init(int _schedule, int64_t _count,
+				   int64_t _chunk,
+				   int64_t _start, int64_t _incr)
+  {
+    schedule = _schedule;
+    count = (_count > 0) ? _count : 0;
+    chunk = (_chunk > 0) ? _chunk : 1;
+    start = _start;
+    incr = _incr;
+    next = 0;
+  }
+
+  bool ThreadPool::LoopState::next_chunk(int num_threads,
+					 int64_t& lo, int64_t& hi)
+  {
+    switch(schedule) {
+    case SCHED_DYNAMIC:
+      {
+	// overshooting 'count' is harmless - everybody who does just stops
+	lo = __sync_fetch_and_add(&next, chunk);
+	if(lo >= count)
+	  return false;
+	hi = ((count - lo) > chunk) ? (lo + chunk) : count;
+	return true;
+      }
+
+    case SCHED_GUIDED:
+      {
+	// chunks are proportional to the remaining iterations (but never
+	//  smaller than 'chunk')
+	while(true) {
+	  lo = *static_cast<volatile int64_t *>(&next);
+	  if(lo >= count)
+	    return false;
+	  int64_t size = (count - lo + num_threads - 1) / num_threads;
+	  if(size < chunk)
+	    size = chunk;
+	  hi = ((count - lo) > size) ? (lo + size) : count;
+	  if(__sync_bool_compare_and_swap(&next, lo, hi))
+	    return true;
+	}
+      }
+
+    default: assert(0);
+    }
+    return false;
+  }
+
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class ThreadPool::WorkItem
+
+  ThreadPool::WorkItem::WorkItem(void)
+    : prev_thread_id(0), prev_num_threads(1), prev_loop_count(0)
+    , parent_work_item(0), remaining_workers(0)
+    , barrier_count(0), barrier_gen(0)
+  {
+    // slot i is first used by loop i, which must act as if loop
+    //  i - MAX_TEAM_LOOPS has already come and gone
+    for(int i = 0; i < MAX_TEAM_LOOPS; i++) {
+      loops[i].init_id = loops[i].ready_id = loops[i].done_id =
+	i - MAX_TEAM_LOOPS;
+      loops[i].remaining_threads = 0;
+    }
+  }
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class ThreadPool::WorkerInfo
@@ -34,8 +106,10 @@ namespace Realm {
   {
     new_work->prev_thread_id = thread_id;
     new_work->prev_num_threads = num_threads;
+    new_work->prev_loop_count = loop_count;
     new_work->parent_work_item = work_item;
     work_item = new_work;
+    loop_count = 0;
   }
 
   ThreadPool::WorkItem *ThreadPool::WorkerInfo::pop_work_item(void)
@@ -43,10 +117,75 @@ namespace Realm {
     WorkItem *old_item = work_item;
     thread_id = old_item->prev_thread_id;
     num_threads = old_item->prev_num_threads;
+    loop_count = old_item->prev_loop_count;
     work_item = old_item->parent_work_item;
     return old_item;
   }
 
+  void ThreadPool::WorkerInfo::team_barrier(void)
+  {
+    if((num_threads == 1) || !work_item)
+      return;
+
+    // the generation can't change until we've arrived, so it's safe to
+    //  sample it first
+    int gen = *static_cast<volatile int *>(&(work_item->barrier_gen));
+    if(__sync_add_and_fetch(&(work_item->barrier_count), 1) == num_threads) {
+      work_item->barrier_count = 0;
+      __sync_fetch_and_add(&(work_item->barrier_gen), 1);
+    } else {
+      while(*static_cast<volatile int *>(&(work_item->barrier_gen)) == gen)
+	sched_yield();
+    }
+  }
+
+  ThreadPool::LoopState *ThreadPool::WorkerInfo::start_loop(int schedule,
+							    int64_t count,
+							    int64_t chunk,
+							    int64_t start,
+							    int64_t incr)
+  {
+    assert(work_item != 0);
+    int loop_id = loop_count++;
+    LoopSlot& slot = work_item->loops[loop_id % MAX_TEAM_LOOPS];
+    int prev_id = loop_id - MAX_TEAM_LOOPS;
+
+    // wait until the team is done with the slot's previous loop, and then
+    //  race to be the thread that sets it up for this one
+    while(true) {
+      if(*static_cast<volatile int *>(&slot.ready_id) == loop_id)
+	break;
+      if((*static_cast<volatile int *>(&slot.done_id) == prev_id) &&
+	 __sync_bool_compare_and_swap(&slot.init_id, prev_id, loop_id)) {
+	slot.init(schedule, count, chunk, start, incr);
+	slot.remaining_threads = num_threads;
+	__sync_synchronize();
+	slot.ready_id = loop_id;
+	break;
+      }
+      sched_yield();
+    }
+    return &slot;
+  }
+
+  ThreadPool::LoopState *ThreadPool::WorkerInfo::current_loop(void)
+  {
+    assert((work_item != 0) && (loop_count > 0));
+    return &(work_item->loops[(loop_count - 1) % MAX_TEAM_LOOPS]);
+  }
+
+  void ThreadPool::WorkerInfo::end_loop(void)
+  {
+    assert((work_item != 0) && (loop_count > 0));
+    int loop_id = loop_count - 1;
+    LoopSlot& slot = work_item->loops[loop_id % MAX_TEAM_LOOPS];
+    // last one out makes the slot available for reuse
+    if(__sync_sub_and_fetch(&slot.remaining_threads, 1) == 0) {
+      __sync_synchronize();
+      slot.done_id = loop_id;
+    }
+  }
+
 
   ////////////////////////////////////////////////////////////////////////
   //
@@ -68,6 +207,7 @@ namespace Realm {
       wi.fnptr = 0;
       wi.data = 0;
       wi.work_item = 0;
+      wi.loop_count = 0;
     }
 
     log_pool.info() << "pool " << (void *)this << " started - " << num_workers << " workers";
@@ -197,6 +337,7 @@ namespace Realm {
     wi->fnptr = fnptr;
     wi->data = data;
     wi->work_item = work_item;
+    wi->loop_count = 0;
     __sync_bool_compare_and_swap(&(wi->status),
 				 WorkerInfo::WORKER_CLAIMED,
 				 WorkerInfo::WORKER_ACTIVE);
@@ -32,11 +32,51 @@ namespace Realm {
     // entry point for workers - does not return until thread pool is shut down
     void worker_entry(void);
 
+    // a worksharing loop with dynamic or guided scheduling - iterations are
+    //  normalized to [0, count) and handed out in chunks from a shared
+    //  counter, so no locks are needed to dispense work
+    struct LoopState {
+      enum Schedule {
+	SCHED_DYNAMIC,
+	SCHED_GUIDED,
+      };
+      int schedule;
+      int64_t count;
+      int64_t chunk;
+      int64_t start, incr; // original bounds, for the API's convenience
+      int64_t next; // next iteration to hand out - updated atomically
+
+      void init(int _schedule, int64_t _count, int64_t _chunk,
+		int64_t _start, int64_t _incr);
+
+      // grabs the next chunk [lo, hi) of iterations, returns false when
+      //  there are none left
+      bool next_chunk(int num_threads, int64_t& lo, int64_t& hi);
+    };
+
+    // each team keeps a small ring of loops so that threads can run ahead
+    //  into a later 'nowait' loop before everybody is done with an earlier one
+    static const int MAX_TEAM_LOOPS = 4;
+
+    struct LoopSlot : public LoopState {
+      // loop ids whose initialization has been claimed, has completed, and
+      //  that all threads in the team have finished with
+      int init_id, ready_id, done_id;
+      int remaining_threads;
+    };
+
     struct WorkItem {
+      WorkItem(void);
+
       int prev_thread_id;
       int prev_num_threads;
+      int prev_loop_count;
       WorkItem *parent_work_item;
       int remaining_workers;
+      // team barrier
+      int barrier_count;
+      int barrier_gen;
+      LoopSlot loops[MAX_TEAM_LOOPS];
     };
 
     struct WorkerInfo {
@@ -55,9 +95,21 @@ namespace Realm {
       void (*fnptr)(void *data);
       void *data;
       WorkItem *work_item;
+      int loop_count; // worksharing loops started in current team
 
       void push_work_item(WorkItem *new_work);
       WorkItem *pop_work_item(void);
+
+      // waits for every thread in the current team to arrive
+      void team_barrier(void);
+
+      // joins the next worksharing loop of the current team, setting it up
+      //  if this thread is the first to arrive
+      LoopState *start_loop(int schedule, int64_t count, int64_t chunk,
+			    int64_t start, int64_t incr);
+      LoopState *current_loop(void);
+      // called by each thread once it is done with the current loop
+      void end_loop(void);
     };
       
     // returns the WorkerInfo (if any) associated with the caller (which
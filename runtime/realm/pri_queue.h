@@ -18,8 +18,8 @@
 #ifndef REALM_PRI_QUEUE_H
 #define REALM_PRI_QUEUE_H
 
-#include <deque>
 #include <map>
+#include <vector>
 
 #include "realm/sampling.h"
 
@@ -88,15 +88,73 @@ namespace Realm {
     //  consumes the item
     bool perform_notifications(T item, priority_t item_priority);
 
+    // every queued item carries a sequence number that orders it relative to other
+    //  items of the same priority - items added to the back get increasing numbers and
+    //  "ungets" get decreasing ones, so FIFO/LIFO order is kept no matter where in the
+    //  queue's storage an item ends up
+    struct Entry {
+      T item;
+      priority_t priority;
+      long long seq;
+    };
+
+    // true if 'a' should come out of the queue before 'b'
+    static bool comes_before(const Entry& a, const Entry& b);
+
+    // heap ordering for the overflow storage (std::*_heap want a "less than")
+    struct HeapOrder {
+      bool operator()(const Entry& a, const Entry& b) const { return comes_before(b, a); }
+    };
+
+    // a circular buffer holding the items for a single priority - storage is only
+    //  ever grown, so a queue that has reached its steady-state size does not
+    //  allocate (or free) memory on put/get
+    class Bucket {
+    public:
+      Bucket(void);
+      ~Bucket(void);
+
+      bool empty(void) const { return count == 0; }
+      const Entry& front(void) const { return entries[head]; }
+      void push_back(const Entry& e);
+      void push_front(const Entry& e);
+      void pop_front(void);
+
+      priority_t priority;  // only meaningful when !empty()
+
+    protected:
+      void grow(void);
+
+      Entry *entries;
+      size_t capacity, head, count;
+
+    private:
+      // not copyable
+      Bucket(const Bucket&);
+      Bucket& operator=(const Bucket&);
+    };
+
+    // finds the item that the next get() would return - returns a null pointer if
+    //  the queue is empty, and sets 'bucket_idx' to the bucket holding it (or -1 for
+    //  the overflow heap)
+    const Entry *find_front(int& bucket_idx) const;
+
+    // recomputes 'highest_priority' after an item has been removed
+    void update_highest_priority(void);
+
     // 'highest_priority' may be read without the lock held, but only written with the lock
     priority_t highest_priority;
 
     // this lock protects everything else
     mutable LT lock;
 
-    // the actual queue - priorities are negated here to that queue.begin() gives us the
-    //  "highest" priority
-    std::map<priority_t, std::deque<T> > queue;
+    // the actual queue - there are usually only a handful of distinct priorities in
+    //  use at once, so each of those gets a dedicated bucket (a bucket is released
+    //  as soon as it drains) and anything beyond that goes into a binary heap
+    static const int NUM_BUCKETS = 4;
+    Bucket buckets[NUM_BUCKETS];
+    std::vector<Entry> overflow;
+    long long next_back_seq, next_front_seq;
 
     // notification subscriptions
     std::map<NotificationCallback *, priority_t> subscriptions;
@@ -18,8 +18,82 @@
 // nop, but helps IDEs
 #include "realm/pri_queue.h"
 
+#include <algorithm>
+#include <assert.h>
+
 namespace Realm {
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class PriorityQueue<T, LT>::Bucket
+
+  template <typename T, typename LT>
+  inline PriorityQueue<T, LT>::Bucket::Bucket(void)
+    : priority(0)
+    , entries(0)
+    , capacity(0)
+    , head(0)
+    , count(0)
+  {
+  }
+
+  template <typename T, typename LT>
+  inline PriorityQueue<T, LT>::Bucket::~Bucket(void)
+  {
+    delete[] entries;
+  }
+
+  template <typename T, typename LT>
+  inline void PriorityQueue<T, LT>::Bucket::push_back(const Entry& e)
+  {
+    if(count == capacity)
+      grow();
+    size_t idx = head + count;
+    if(idx >= capacity)
+      idx -= capacity;
+    entries[idx] = e;
+    count++;
+  }
+
+  template <typename T, typename LT>
+  inline void PriorityQueue<T, LT>::Bucket::push_front(const Entry& e)
+  {
+    if(count == capacity)
+      grow();
+    head = ((head > 0) ? head : capacity) - 1;
+    entries[head] = e;
+    count++;
+  }
+
+  template <typename T, typename LT>
+  inline void PriorityQueue<T, LT>::Bucket::pop_front(void)
+  {
+    assert(count > 0);
+    head++;
+    if(head == capacity)
+      head = 0;
+    count--;
+  }
+
+  template <typename T, typename LT>
+  inline void PriorityQueue<T, LT>::Bucket::grow(void)
+  {
+    size_t new_capacity = (capacity ? (capacity * 2) : 16);
+    Entry *new_entries = new Entry[new_capacity];
+    // unwrap the existing entries into the start of the new buffer
+    for(size_t i = 0; i < count; i++) {
+      size_t idx = head + i;
+      if(idx >= capacity)
+	idx -= capacity;
+      new_entries[i] = entries[idx];
+    }
+    delete[] entries;
+    entries = new_entries;
+    capacity = new_capacity;
+    head = 0;
+  }
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class PriorityQueue<T, LT>
@@ -27,6 +101,8 @@ namespace Realm {
   template <typename T, typename LT>
   inline PriorityQueue<T, LT>::PriorityQueue(void)
     : highest_priority (PRI_NEG_INF)
+    , next_back_seq (0)
+    , next_front_seq (-1)
     , entries_in_queue (0)
   {
   }
@@ -34,7 +110,46 @@ namespace Realm {
   template <typename T, typename LT>
   inline PriorityQueue<T, LT>::~PriorityQueue(void)
   {
-    // STL cleans everything up
+    // buckets free their own storage
+  }
+
+  template <typename T, typename LT>
+  inline /*static*/ bool PriorityQueue<T, LT>::comes_before(const Entry& a, const Entry& b)
+  {
+    return ((a.priority > b.priority) ||
+	    ((a.priority == b.priority) && (a.seq < b.seq)));
+  }
+
+  template <typename T, typename LT>
+  inline const typename PriorityQueue<T, LT>::Entry *PriorityQueue<T, LT>::find_front(int& bucket_idx) const
+  {
+    // lock already held by caller
+    const Entry *best = 0;
+    bucket_idx = -1;
+    for(int i = 0; i < NUM_BUCKETS; i++)
+      if(!buckets[i].empty() && (!best || comes_before(buckets[i].front(), *best))) {
+	best = &buckets[i].front();
+	bucket_idx = i;
+      }
+    // the front of the overflow heap is its best entry
+    if(!overflow.empty() && (!best || comes_before(overflow.front(), *best))) {
+      best = &overflow.front();
+      bucket_idx = -1;
+    }
+    return best;
+  }
+
+  template <typename T, typename LT>
+  inline void PriorityQueue<T, LT>::update_highest_priority(void)
+  {
+    // lock already held by caller
+    priority_t new_highest = (overflow.empty() ?
+			        PRI_NEG_INF :
+			        overflow.front().priority);
+    for(int i = 0; i < NUM_BUCKETS; i++)
+      if(!buckets[i].empty() && (buckets[i].priority > new_highest))
+	new_highest = buckets[i].priority;
+    highest_priority = new_highest;
   }
 
   // two ways to add an item -
@@ -77,14 +192,37 @@ namespace Realm {
       }
     }
 
-    // get the right deque (this will create one if needed)
-    std::deque<T>& dq = queue[-priority]; // remember negation...
+    Entry e;
+    e.item = item;
+    e.priority = priority;
+    e.seq = (add_to_back ? next_back_seq++ : next_front_seq--);
+
+    // use the bucket that already holds this priority if there is one, otherwise
+    //  claim an empty bucket
+    Bucket *b = 0;
+    for(int i = 0; i < NUM_BUCKETS; i++) {
+      if(buckets[i].empty()) {
+	if(!b) b = &buckets[i];
+      } else {
+	if(buckets[i].priority == priority) {
+	  b = &buckets[i];
+	  break;
+	}
+      }
+    }
 
-    // and add the item
-    if(add_to_back)
-      dq.push_back(item);
-    else
-      dq.push_front(item);
+    if(b) {
+      b->priority = priority;
+      if(add_to_back)
+	b->push_back(e);
+      else
+	b->push_front(e);
+    } else {
+      // all buckets are busy with other priorities - sequence numbers keep the
+      //  order right even if this priority gets a bucket later
+      overflow.push_back(e);
+      std::push_heap(overflow.begin(), overflow.end(), HeapOrder());
+    }
 
     // all done
     lock.unlock();
@@ -100,14 +238,16 @@ namespace Realm {
     // body is protected by lock
     lock.lock();
 
+    int bucket_idx;
+    const Entry *e = find_front(bucket_idx);
+
     // empty queue - early out
-    if(queue.empty()) {
+    if(!e) {
       lock.unlock();
       return 0; // TODO - EMPTY_VAL
     }
 
-    typename std::map<priority_t, std::deque<T> >::iterator it = queue.begin();
-    priority_t priority = -(it->first);
+    priority_t priority = e->priority;
 
     // not interesting enough?
     if(priority <= higher_than) {
@@ -116,15 +256,16 @@ namespace Realm {
     };
 
     // take item off front
-    T item = it->second.front();
-    it->second.pop_front();
-
-    // if list is now empty, remove from the queue and adjust highest_priority
-    if(it->second.empty()) {
-      queue.erase(it);
-      highest_priority = (queue.empty() ?
-			    PRI_NEG_INF :
-			    -(queue.begin()->first));
+    T item = e->item;
+    if(bucket_idx >= 0) {
+      buckets[bucket_idx].pop_front();
+      // a drained bucket may have been holding the highest priority
+      if(buckets[bucket_idx].empty())
+	update_highest_priority();
+    } else {
+      std::pop_heap(overflow.begin(), overflow.end(), HeapOrder());
+      overflow.pop_back();
+      update_highest_priority();
     }
 
     // release lock and then return result
@@ -148,14 +289,16 @@ namespace Realm {
     // body is protected by lock
     lock.lock();
 
+    int bucket_idx;
+    const Entry *e = find_front(bucket_idx);
+
     // empty queue - early out
-    if(queue.empty()) {
+    if(!e) {
       lock.unlock();
       return 0; // TODO - EMPTY_VAL
     }
 
-    typename std::map<priority_t, std::deque<T> >::const_iterator it = queue.begin();
-    priority_t priority = -(it->first);
+    priority_t priority = e->priority;
 
     // not interesting enough?
     if(priority <= higher_than) {
@@ -164,7 +307,7 @@ namespace Realm {
     };
 
     // peek at item on front
-    T item = it->second.front();
+    T item = e->item;
 
     // release lock and then return result
     lock.unlock();
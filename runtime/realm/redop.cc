@@ -0,0 +1,467 @@
+/* Copyright 2018 Stanford University, NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// vectorized kernels for Realm's built-in reduction ops
+
+#include "realm/redop.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define REALM_REDOP_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace Realm {
+
+  namespace ReductionKernels {
+
+    // below this many elements, dispatch costs more than it saves
+    static const size_t MIN_KERNEL_COUNT = 16;
+
+    static ISA max_isa = ISA_AVX512;
+
+#ifdef REALM_REDOP_X86_KERNELS
+    static ISA detect_isa(void)
+    {
+      __builtin_cpu_init();
+      if(__builtin_cpu_supports("avx512f"))
+	return ISA_AVX512;
+      if(__builtin_cpu_supports("avx2"))
+	return ISA_AVX2;
+      // SSE2 is part of the x86_64 baseline
+      return ISA_SSE2;
+    }
+#else
+    static ISA detect_isa(void)
+    {
+      return ISA_SCALAR;
+    }
+#endif
+
+    ISA get_isa(void)
+    {
+      static ISA hw_isa = detect_isa();
+      return ((hw_isa < max_isa) ? hw_isa : max_isa);
+    }
+
+    void set_max_isa(ISA isa)
+    {
+      max_isa = isa;
+    }
+
+#ifdef REALM_REDOP_X86_KERNELS
+    // each vector type below wraps the intrinsics for one element type and
+    //  instruction set - every member has to carry the target attribute so
+    //  that it can be inlined into the loops, which are stamped out by the
+    //  macros here for the same reason
+
+#define REALM_REDOP_TARGET_SSE2
+#define REALM_REDOP_TARGET_AVX2 __attribute__((target("avx2")))
+#define REALM_REDOP_TARGET_AVX512 __attribute__((target("avx512f")))
+
+#define REALM_REDOP_COMBINE(TARGET)					\
+    template <int OP>							\
+    TARGET static inline V combine(V l, V r)				\
+    {									\
+      switch(OP) {							\
+      case KERNEL_SUM: return add(l, r);				\
+      case KERNEL_PROD: return mul(l, r);				\
+      /* argument order matches the scalar (rhs < lhs) ? rhs : lhs */	\
+      case KERNEL_MIN: return min(r, l);				\
+      default: return max(r, l);					\
+      }									\
+    }
+
+#define REALM_REDOP_DENSE_LOOP(TARGET)					\
+    template <int OP>							\
+    TARGET static void dense(T *lhs, const T *rhs, size_t count)	\
+    {									\
+      size_t i = 0;							\
+      for(; (i + 2 * W) <= count; i += 2 * W) {				\
+	V l0 = load(lhs + i);						\
+	V l1 = load(lhs + i + W);					\
+	V r0 = load(rhs + i);						\
+	V r1 = load(rhs + i + W);					\
+	store(lhs + i, combine<OP>(l0, r0));				\
+	store(lhs + i + W, combine<OP>(l1, r1));			\
+      }									\
+      for(; i < count; i++)						\
+	lhs[i] = ReductionKernels::combine<(KernelOp)OP>(lhs[i], rhs[i]); \
+    }
+
+    struct SSE2_F32 {
+      typedef float T;
+      typedef __m128 V;
+      static const size_t W = 4;
+      static bool supports(KernelOp op) { return true; }
+      static V load(const T *p) { return _mm_loadu_ps(p); }
+      static void store(T *p, V v) { _mm_storeu_ps(p, v); }
+      static V add(V a, V b) { return _mm_add_ps(a, b); }
+      static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+      static V min(V a, V b) { return _mm_min_ps(a, b); }
+      static V max(V a, V b) { return _mm_max_ps(a, b); }
+      REALM_REDOP_COMBINE(REALM_REDOP_TARGET_SSE2)
+      REALM_REDOP_DENSE_LOOP(REALM_REDOP_TARGET_SSE2)
+    };
+
+    struct SSE2_F64 {
+      typedef double T;
+      typedef __m128d V;
+      static const size_t W = 2;
+      static bool supports(KernelOp op) { return true; }
+      static V load(const T *p) { return _mm_loadu_pd(p); }
+      static void store(T *p, V v) { _mm_storeu_pd(p, v); }
+      static V add(V a, V b) { return _mm_add_pd(a, b); }
+      static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+      static V min(V a, V b) { return _mm_min_pd(a, b); }
+      static V max(V a, V b) { return _mm_max_pd(a, b); }
+      REALM_REDOP_COMBINE(REALM_REDOP_TARGET_SSE2)
+      REALM_REDOP_DENSE_LOOP(REALM_REDOP_TARGET_SSE2)
+    };
+
+    // SSE2 has no 32-bit multiply or min/max (those came with SSE4.1), and
+    //  nothing but add for 64-bit integers
+    struct SSE2_I32 {
+      typedef int32_t T;
+      typedef __m128i V;
+      static const size_t W = 4;
+      static bool supports(KernelOp op) { return (op == KERNEL_SUM); }
+      static V load(const T *p) { return _mm_loadu_si128((const __m128i *)p); }
+      static void store(T *p, V v) { _mm_storeu_si128((__m128i *)p, v); }
+      static V add(V a, V b) { return _mm_add_epi32(a, b); }
+      static V mul(V a, V b) { return a; }
+      static V min(V a, V b) { return a; }
+      static V max(V a, V b) { return a; }
+      REALM_REDOP_COMBINE(REALM_REDOP_TARGET_SSE2)
+      REALM_REDOP_DENSE_LOOP(REALM_REDOP_TARGET_SSE2)
+    };
+
+    struct SSE2_I64 {
+      typedef int64_t T;
+      typedef __m128i V;
+      static const size_t W = 2;
+      static bool supports(KernelOp op) { return (op == KERNEL_SUM); }
+      static V load(const T *p) { return _mm_loadu_si128((const __m128i *)p); }
+      static void store(T *p, V v) { _mm_storeu_si128((__m128i *)p, v); }
+      static V add(V a, V b) { return _mm_add_epi64(a, b); }
+      static V mul(V a, V b) { return a; }
+      static V min(V a, V b) { return a; }
+      static V max(V a, V b) { return a; }
+      REALM_REDOP_COMBINE(REALM_REDOP_TARGET_SSE2)
+      REALM_REDOP_DENSE_LOOP(REALM_REDOP_TARGET_SSE2)
+    };
+
+#define AVX2 REALM_REDOP_TARGET_AVX2
+    struct AVX2_F32 {
+      typedef float T;
+      typedef __m256 V;
+      static const size_t W = 8;
+      static bool supports(KernelOp op) { return true; }
+      AVX2 static V load(const T *p) { return _mm256_loadu_ps(p); }
+      AVX2 static void store(T *p, V v) { _mm256_storeu_ps(p, v); }
+      AVX2 static V add(V a, V b) { return _mm256_add_ps(a, b); }
+      AVX2 static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+      AVX2 static V min(V a, V b) { return _mm256_min_ps(a, b); }
+      AVX2 static V max(V a, V b) { return _mm256_max_ps(a, b); }
+      REALM_REDOP_COMBINE(AVX2)
+      REALM_REDOP_DENSE_LOOP(AVX2)
+    };
+
+    struct AVX2_F64 {
+      typedef double T;
+      typedef __m256d V;
+      static const size_t W = 4;
+      static bool supports(KernelOp op) { return true; }
+      AVX2 static V load(const T *p) { return _mm256_loadu_pd(p); }
+      AVX2 static void store(T *p, V v) { _mm256_storeu_pd(p, v); }
+      AVX2 static V add(V a, V b) { return _mm256_add_pd(a, b); }
+      AVX2 static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+      AVX2 static V min(V a, V b) { return _mm256_min_pd(a, b); }
+      AVX2 static V max(V a, V b) { return _mm256_max_pd(a, b); }
+      REALM_REDOP_COMBINE(AVX2)
+      REALM_REDOP_DENSE_LOOP(AVX2)
+    };
+
+    struct AVX2_I32 {
+      typedef int32_t T;
+      typedef __m256i V;
+      static const size_t W = 8;
+      static bool supports(KernelOp op) { return true; }
+      AVX2 static V load(const T *p) { return _mm256_loadu_si256((const __m256i *)p); }
+      AVX2 static void store(T *p, V v) { _mm256_storeu_si256((__m256i *)p, v); }
+      AVX2 static V add(V a, V b) { return _mm256_add_epi32(a, b); }
+      AVX2 static V mul(V a, V b) { return _mm256_mullo_epi32(a, b); }
+      AVX2 static V min(V a, V b) { return _mm256_min_epi32(a, b); }
+      AVX2 static V max(V a, V b) { return _mm256_max_epi32(a, b); }
+      REALM_REDOP_COMBINE(AVX2)
+      REALM_REDOP_DENSE_LOOP(AVX2)
+    };
+
+    // AVX2 has no 64-bit integer multiply or min/max
+    struct AVX2_I64 {
+      typedef int64_t T;
+      typedef __m256i V;
+      static const size_t W = 4;
+      static bool supports(KernelOp op) { return (op == KERNEL_SUM); }
+      AVX2 static V load(const T *p) { return _mm256_loadu_si256((const __m256i *)p); }
+      AVX2 static void store(T *p, V v) { _mm256_storeu_si256((__m256i *)p, v); }
+      AVX2 static V add(V a, V b) { return _mm256_add_epi64(a, b); }
+      AVX2 static V mul(V a, V b) { return a; }
+      AVX2 static V min(V a, V b) { return a; }
+      AVX2 static V max(V a, V b) { return a; }
+      REALM_REDOP_COMBINE(AVX2)
+      REALM_REDOP_DENSE_LOOP(AVX2)
+    };
+#undef AVX2
+
+#define AVX512 REALM_REDOP_TARGET_AVX512
+    // the 64-bit AVX-512 types also get a strided loop, using gathers for
+    //  both sides and a scatter for the lhs - 'lhs_stride' must be at least
+    //  an element wide (in magnitude) so that the scattered lanes are distinct
+#define REALM_REDOP_STRIDED_LOOP(GATHER, SCATTER)			\
+    template <int OP>							\
+    AVX512 static void strided(T *lhs, const T *rhs,			\
+			       off_t lhs_stride, off_t rhs_stride,	\
+			       size_t count)				\
+    {									\
+      const __m512i lhs_idx = lane_offsets(lhs_stride);			\
+      const __m512i rhs_idx = lane_offsets(rhs_stride);			\
+      char *lp = reinterpret_cast<char *>(lhs);				\
+      const char *rp = reinterpret_cast<const char *>(rhs);		\
+      size_t i = 0;							\
+      for(; (i + W) <= count; i += W) {					\
+	V l = GATHER(lhs_idx, lp, 1);					\
+	V r = GATHER(rhs_idx, rp, 1);					\
+	SCATTER(lp, lhs_idx, combine<OP>(l, r), 1);			\
+	lp += W * lhs_stride;						\
+	rp += W * rhs_stride;						\
+      }									\
+      for(; i < count; i++) {						\
+	T& l = *reinterpret_cast<T *>(lp);				\
+	l = ReductionKernels::combine<(KernelOp)OP>(l,			\
+				*reinterpret_cast<const T *>(rp));	\
+	lp += lhs_stride;						\
+	rp += rhs_stride;						\
+      }									\
+    }
+
+    // byte offsets of each of the 8 lanes of a strided access
+    AVX512 static inline __m512i lane_offsets(off_t stride)
+    {
+      return _mm512_set_epi64(7 * stride, 6 * stride, 5 * stride, 4 * stride,
+			      3 * stride, 2 * stride, stride, 0);
+    }
+
+    struct AVX512_F32 {
+      typedef float T;
+      typedef __m512 V;
+      static const size_t W = 16;
+      static bool supports(KernelOp op) { return true; }
+      AVX512 static V load(const T *p) { return _mm512_loadu_ps(p); }
+      AVX512 static void store(T *p, V v) { _mm512_storeu_ps(p, v); }
+      AVX512 static V add(V a, V b) { return _mm512_add_ps(a, b); }
+      AVX512 static V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+      AVX512 static V min(V a, V b) { return _mm512_min_ps(a, b); }
+      AVX512 static V max(V a, V b) { return _mm512_max_ps(a, b); }
+      REALM_REDOP_COMBINE(AVX512)
+      REALM_REDOP_DENSE_LOOP(AVX512)
+    };
+
+    struct AVX512_F64 {
+      typedef double T;
+      typedef __m512d V;
+      static const size_t W = 8;
+      static bool supports(KernelOp op) { return true; }
+      AVX512 static V load(const T *p) { return _mm512_loadu_pd(p); }
+      AVX512 static void store(T *p, V v) { _mm512_storeu_pd(p, v); }
+      AVX512 static V add(V a, V b) { return _mm512_add_pd(a, b); }
+      AVX512 static V mul(V a, V b) { return _mm512_mul_pd(a, b); }
+      AVX512 static V min(V a, V b) { return _mm512_min_pd(a, b); }
+      AVX512 static V max(V a, V b) { return _mm512_max_pd(a, b); }
+      REALM_REDOP_COMBINE(AVX512)
+      REALM_REDOP_DENSE_LOOP(AVX512)
+      REALM_REDOP_STRIDED_LOOP(_mm512_i64gather_pd, _mm512_i64scatter_pd)
+    };
+
+    struct AVX512_I32 {
+      typedef int32_t T;
+      typedef __m512i V;
+      static const size_t W = 16;
+      static bool supports(KernelOp op) { return true; }
+      AVX512 static V load(const T *p) { return _mm512_loadu_si512(p); }
+      AVX512 static void store(T *p, V v) { _mm512_storeu_si512(p, v); }
+      AVX512 static V add(V a, V b) { return _mm512_add_epi32(a, b); }
+      AVX512 static V mul(V a, V b) { return _mm512_mullo_epi32(a, b); }
+      AVX512 static V min(V a, V b) { return _mm512_min_epi32(a, b); }
+      AVX512 static V max(V a, V b) { return _mm512_max_epi32(a, b); }
+      REALM_REDOP_COMBINE(AVX512)
+      REALM_REDOP_DENSE_LOOP(AVX512)
+    };
+
+    // no 64-bit multiply without AVX512DQ
+    struct AVX512_I64 {
+      typedef int64_t T;
+      typedef __m512i V;
+      static const size_t W = 8;
+      static bool supports(KernelOp op) { return (op != KERNEL_PROD); }
+      AVX512 static V load(const T *p) { return _mm512_loadu_si512(p); }
+      AVX512 static void store(T *p, V v) { _mm512_storeu_si512(p, v); }
+      AVX512 static V add(V a, V b) { return _mm512_add_epi64(a, b); }
+      AVX512 static V mul(V a, V b) { return a; }
+      AVX512 static V min(V a, V b) { return _mm512_min_epi64(a, b); }
+      AVX512 static V max(V a, V b) { return _mm512_max_epi64(a, b); }
+      REALM_REDOP_COMBINE(AVX512)
+      REALM_REDOP_DENSE_LOOP(AVX512)
+      REALM_REDOP_STRIDED_LOOP(_mm512_i64gather_epi64, _mm512_i64scatter_epi64)
+    };
+#undef AVX512
+
+    template <typename VT>
+    static bool run_dense(KernelOp op, typename VT::T *lhs,
+			  const typename VT::T *rhs, size_t count)
+    {
+      if(!VT::supports(op))
+	return false;
+      switch(op) {
+      case KERNEL_SUM: VT::template dense<KERNEL_SUM>(lhs, rhs, count); break;
+      case KERNEL_PROD: VT::template dense<KERNEL_PROD>(lhs, rhs, count); break;
+      case KERNEL_MIN: VT::template dense<KERNEL_MIN>(lhs, rhs, count); break;
+      case KERNEL_MAX: VT::template dense<KERNEL_MAX>(lhs, rhs, count); break;
+      }
+      return true;
+    }
+
+    template <typename VT>
+    static bool run_strided(KernelOp op, typename VT::T *lhs,
+			    const typename VT::T *rhs,
+			    off_t lhs_stride, off_t rhs_stride, size_t count)
+    {
+      if(!VT::supports(op))
+	return false;
+      // overlapping lhs lanes would lose updates in the scatter
+      if((lhs_stride < (off_t)sizeof(typename VT::T)) &&
+	 (lhs_stride > -(off_t)sizeof(typename VT::T)))
+	return false;
+      switch(op) {
+      case KERNEL_SUM: VT::template strided<KERNEL_SUM>(lhs, rhs, lhs_stride, rhs_stride, count); break;
+      case KERNEL_PROD: VT::template strided<KERNEL_PROD>(lhs, rhs, lhs_stride, rhs_stride, count); break;
+      case KERNEL_MIN: VT::template strided<KERNEL_MIN>(lhs, rhs, lhs_stride, rhs_stride, count); break;
+      case KERNEL_MAX: VT::template strided<KERNEL_MAX>(lhs, rhs, lhs_stride, rhs_stride, count); break;
+      }
+      return true;
+    }
+
+    template <typename T> struct KernelSet;
+    template <> struct KernelSet<float> {
+      typedef SSE2_F32 SSE2; typedef AVX2_F32 AVX2; typedef AVX512_F32 AVX512;
+    };
+    template <> struct KernelSet<double> {
+      typedef SSE2_F64 SSE2; typedef AVX2_F64 AVX2; typedef AVX512_F64 AVX512;
+    };
+    template <> struct KernelSet<int32_t> {
+      typedef SSE2_I32 SSE2; typedef AVX2_I32 AVX2; typedef AVX512_I32 AVX512;
+    };
+    template <> struct KernelSet<int64_t> {
+      typedef SSE2_I64 SSE2; typedef AVX2_I64 AVX2; typedef AVX512_I64 AVX512;
+    };
+
+    template <typename T>
+    bool apply_dense(KernelOp op, T *lhs, const T *rhs, size_t count)
+    {
+      if(count < MIN_KERNEL_COUNT)
+	return false;
+      // fall back to narrower vectors if the widest one doesn't do this op
+      switch(get_isa()) {
+      case ISA_AVX512:
+	if(run_dense<typename KernelSet<T>::AVX512>(op, lhs, rhs, count))
+	  return true;
+	// fall through
+      case ISA_AVX2:
+	if(run_dense<typename KernelSet<T>::AVX2>(op, lhs, rhs, count))
+	  return true;
+	// fall through
+      case ISA_SSE2:
+	return run_dense<typename KernelSet<T>::SSE2>(op, lhs, rhs, count);
+      default:
+	return false;
+      }
+    }
+
+    template <typename T>
+    static bool strided_kernel(KernelOp op, T *lhs, const T *rhs,
+			       off_t lhs_stride, off_t rhs_stride, size_t count)
+    {
+      // only the 64-bit types have gather/scatter kernels
+      return false;
+    }
+
+    template <>
+    bool strided_kernel<double>(KernelOp op, double *lhs, const double *rhs,
+				off_t lhs_stride, off_t rhs_stride, size_t count)
+    {
+      return ((get_isa() >= ISA_AVX512) &&
+	      run_strided<AVX512_F64>(op, lhs, rhs, lhs_stride, rhs_stride, count));
+    }
+
+    template <>
+    bool strided_kernel<int64_t>(KernelOp op, int64_t *lhs, const int64_t *rhs,
+				 off_t lhs_stride, off_t rhs_stride, size_t count)
+    {
+      return ((get_isa() >= ISA_AVX512) &&
+	      run_strided<AVX512_I64>(op, lhs, rhs, lhs_stride, rhs_stride, count));
+    }
+
+    template <typename T>
+    bool apply_strided(KernelOp op, T *lhs, const T *rhs,
+		       off_t lhs_stride, off_t rhs_stride, size_t count)
+    {
+      // unit strides are just dense
+      if((lhs_stride == (off_t)sizeof(T)) && (rhs_stride == (off_t)sizeof(T)))
+	return apply_dense<T>(op, lhs, rhs, count);
+      if(count < MIN_KERNEL_COUNT)
+	return false;
+      return strided_kernel<T>(op, lhs, rhs, lhs_stride, rhs_stride, count);
+    }
+#else
+    template <typename T>
+    bool apply_dense(KernelOp op, T *lhs, const T *rhs, size_t count)
+    {
+      return false;
+    }
+
+    template <typename T>
+    bool apply_strided(KernelOp op, T *lhs, const T *rhs,
+		       off_t lhs_stride, off_t rhs_stride, size_t count)
+    {
+      return false;
+    }
+#endif
+
+    template bool apply_dense<float>(KernelOp, float *, const float *, size_t);
+    template bool apply_dense<double>(KernelOp, double *, const double *, size_t);
+    template bool apply_dense<int32_t>(KernelOp, int32_t *, const int32_t *, size_t);
+    template bool apply_dense<int64_t>(KernelOp, int64_t *, const int64_t *, size_t);
+
+    template bool apply_strided<float>(KernelOp, float *, const float *,
+				       off_t, off_t, size_t);
+    template bool apply_strided<double>(KernelOp, double *, const double *,
+					off_t, off_t, size_t);
+    template bool apply_strided<int32_t>(KernelOp, int32_t *, const int32_t *,
+					 off_t, off_t, size_t);
+    template bool apply_strided<int64_t>(KernelOp, int64_t *, const int64_t *,
+					 off_t, off_t, size_t);
+
+  }; // namespace ReductionKernels
+
+}; // namespace Realm
@@ -19,6 +19,8 @@
 #define REALM_REDOP_H
 
 #include <sys/types.h>
+#include <stdint.h>
+#include <limits>
 
 namespace Realm {
 
@@ -89,6 +91,54 @@ namespace Realm {
     };
 #endif
 
+    // vectorized kernels for the built-in reduction ops (see SumReduction and
+    //  friends below) - the instruction set is picked at runtime based on what
+    //  the CPU supports, and only exclusive reductions use them (non-exclusive
+    //  ones need an atomic update per element)
+    namespace ReductionKernels {
+      enum KernelOp { KERNEL_SUM, KERNEL_PROD, KERNEL_MIN, KERNEL_MAX };
+      enum ISA { ISA_SCALAR, ISA_SSE2, ISA_AVX2, ISA_AVX512 };
+
+      // the best instruction set the kernels will use - this defaults to the
+      //  best one the CPU supports, but can be lowered (e.g. ISA_SCALAR turns
+      //  the kernels off entirely)
+      ISA get_isa(void);
+      void set_max_isa(ISA isa);
+
+      // element types that have kernels
+      template <typename T> struct IsKernelType { static const bool value = false; };
+      template <> struct IsKernelType<float> { static const bool value = true; };
+      template <> struct IsKernelType<double> { static const bool value = true; };
+      template <> struct IsKernelType<int32_t> { static const bool value = true; };
+      template <> struct IsKernelType<int64_t> { static const bool value = true; };
+
+      // these return false if no kernel applies, in which case the caller
+      //  must do the reduction itself
+      template <typename T>
+      bool apply_dense(KernelOp op, T *lhs, const T *rhs, size_t count);
+      template <typename T>
+      bool apply_strided(KernelOp op, T *lhs, const T *rhs,
+			 off_t lhs_stride, off_t rhs_stride, size_t count);
+    };
+
+    // maps a reduction op to its vectorized kernel, if it has one - the
+    //  default is to not have one
+    template <class REDOP>
+    struct ReductionKernelDispatch {
+      static bool apply(typename REDOP::LHS *lhs, const typename REDOP::RHS *rhs,
+			size_t count)
+      { return false; }
+      static bool fold(typename REDOP::RHS *rhs1, const typename REDOP::RHS *rhs2,
+		       size_t count)
+      { return false; }
+      static bool apply_strided(void *lhs_ptr, const void *rhs_ptr,
+				off_t lhs_stride, off_t rhs_stride, size_t count)
+      { return false; }
+      static bool fold_strided(void *lhs_ptr, const void *rhs_ptr,
+			       off_t lhs_stride, off_t rhs_stride, size_t count)
+      { return false; }
+    };
+
     template <class REDOP>
     class ReductionOp : public ReductionOpUntyped {
     public:
@@ -114,6 +164,8 @@ namespace Realm {
 	typename REDOP::LHS *lhs = static_cast<typename REDOP::LHS *>(lhs_ptr);
 	const typename REDOP::RHS *rhs = static_cast<const typename REDOP::RHS *>(rhs_ptr);
 	if(exclusive) {
+	  if(ReductionKernelDispatch<REDOP>::apply(lhs, rhs, count))
+	    return;
 	  for(size_t i = 0; i < count; i++)
 	    REDOP::template apply<true>(lhs[i], rhs[i]);
 	} else {
@@ -127,6 +179,10 @@ namespace Realm {
 				 bool exclusive = false) const
       {
 	if(exclusive) {
+	  if(ReductionKernelDispatch<REDOP>::apply_strided(lhs_ptr, rhs_ptr,
+							   lhs_stride, rhs_stride,
+							   count))
+	    return;
 	  for(size_t i = 0; i < count; i++) {
 	    REDOP::template apply<true>(*static_cast<typename REDOP::LHS *>(lhs_ptr),
 					*static_cast<const typename REDOP::RHS *>(rhs_ptr));
@@ -149,6 +205,8 @@ namespace Realm {
 	typename REDOP::RHS *rhs1 = static_cast<typename REDOP::RHS *>(rhs1_ptr);
 	const typename REDOP::RHS *rhs2 = static_cast<const typename REDOP::RHS *>(rhs2_ptr);
 	if(exclusive) {
+	  if(ReductionKernelDispatch<REDOP>::fold(rhs1, rhs2, count))
+	    return;
 	  for(size_t i = 0; i < count; i++)
 	    REDOP::template fold<true>(rhs1[i], rhs2[i]);
 	} else {
@@ -162,6 +220,10 @@ namespace Realm {
 				bool exclusive = false) const
       {
 	if(exclusive) {
+	  if(ReductionKernelDispatch<REDOP>::fold_strided(lhs_ptr, rhs_ptr,
+							  lhs_stride, rhs_stride,
+							  count))
+	    return;
 	  for(size_t i = 0; i < count; i++) {
 	    REDOP::template fold<true>(*static_cast<typename REDOP::RHS *>(lhs_ptr),
 				       *static_cast<const typename REDOP::RHS *>(rhs_ptr));
@@ -235,6 +297,139 @@ namespace Realm {
       return redop;
     }
 
+    // built-in reduction ops for arithmetic types - exclusive reductions on
+    //  float, double, int32_t and int64_t use the vectorized kernels above,
+    //  everything else (and non-exclusive reductions) is done one element
+    //  at a time
+    namespace ReductionKernels {
+      // non-exclusive reductions are done with a compare-and-swap on the
+      //  bits of the value
+      template <size_t BYTES> struct BitsOfSize;
+      template <> struct BitsOfSize<1> { typedef uint8_t T; };
+      template <> struct BitsOfSize<2> { typedef uint16_t T; };
+      template <> struct BitsOfSize<4> { typedef uint32_t T; };
+      template <> struct BitsOfSize<8> { typedef uint64_t T; };
+
+      template <KernelOp OP, typename T>
+      inline T combine(T lhs, T rhs)
+      {
+	switch(OP) {
+	case KERNEL_SUM: return lhs + rhs;
+	case KERNEL_PROD: return lhs * rhs;
+	case KERNEL_MIN: return ((rhs < lhs) ? rhs : lhs);
+	default: return ((rhs > lhs) ? rhs : lhs);
+	}
+      }
+
+      template <KernelOp OP, bool EXCL, typename T>
+      inline void update(T& lhs, T rhs)
+      {
+	if(EXCL) {
+	  lhs = combine<OP>(lhs, rhs);
+	  return;
+	}
+	typedef typename BitsOfSize<sizeof(T)>::T BITS;
+	union { T val; BITS bits; } oldval, newval;
+	volatile BITS *target = reinterpret_cast<volatile BITS *>(&lhs);
+	oldval.bits = *target;
+	while(true) {
+	  newval.val = combine<OP>(oldval.val, rhs);
+	  BITS prev = __sync_val_compare_and_swap(target, oldval.bits,
+						  newval.bits);
+	  if(prev == oldval.bits)
+	    break;
+	  oldval.bits = prev;
+	}
+      }
+
+      template <typename T, KernelOp OP>
+      struct BuiltinReduction {
+	typedef T LHS;
+	typedef T RHS;
+
+	template <bool EXCL>
+	static void apply(LHS& lhs, RHS rhs) { update<OP,EXCL>(lhs, rhs); }
+
+	template <bool EXCL>
+	static void fold(RHS& rhs1, RHS rhs2) { update<OP,EXCL>(rhs1, rhs2); }
+      };
+    };
+
+    template <typename T>
+    struct SumReduction
+      : public ReductionKernels::BuiltinReduction<T, ReductionKernels::KERNEL_SUM> {
+      static const T identity;
+    };
+
+    template <typename T>
+    struct ProdReduction
+      : public ReductionKernels::BuiltinReduction<T, ReductionKernels::KERNEL_PROD> {
+      static const T identity;
+    };
+
+    template <typename T>
+    struct MinReduction
+      : public ReductionKernels::BuiltinReduction<T, ReductionKernels::KERNEL_MIN> {
+      static const T identity;
+    };
+
+    template <typename T>
+    struct MaxReduction
+      : public ReductionKernels::BuiltinReduction<T, ReductionKernels::KERNEL_MAX> {
+      static const T identity;
+    };
+
+    template <typename T>
+    /*static*/ const T SumReduction<T>::identity = T(0);
+    template <typename T>
+    /*static*/ const T ProdReduction<T>::identity = T(1);
+    template <typename T>
+    /*static*/ const T MinReduction<T>::identity =
+      (std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() :
+                                              std::numeric_limits<T>::max());
+    template <typename T>
+    /*static*/ const T MaxReduction<T>::identity =
+      (std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() :
+                                              std::numeric_limits<T>::min());
+
+    namespace ReductionKernels {
+      template <typename T, KernelOp OP,
+		bool HAS_KERNEL = IsKernelType<T>::value>
+      struct BuiltinDispatch {
+	static bool apply(T *lhs, const T *rhs, size_t count)
+	{ return apply_dense<T>(OP, lhs, rhs, count); }
+	static bool fold(T *rhs1, const T *rhs2, size_t count)
+	{ return apply_dense<T>(OP, rhs1, rhs2, count); }
+	static bool apply_strided(void *lhs_ptr, const void *rhs_ptr,
+				  off_t lhs_stride, off_t rhs_stride, size_t count)
+	{
+	  return ReductionKernels::apply_strided<T>(OP, static_cast<T *>(lhs_ptr),
+						    static_cast<const T *>(rhs_ptr),
+						    lhs_stride, rhs_stride, count);
+	}
+	static bool fold_strided(void *lhs_ptr, const void *rhs_ptr,
+				 off_t lhs_stride, off_t rhs_stride, size_t count)
+	{ return apply_strided(lhs_ptr, rhs_ptr, lhs_stride, rhs_stride, count); }
+      };
+
+      template <typename T, KernelOp OP>
+      struct BuiltinDispatch<T, OP, false>
+	: public ReductionKernelDispatch<BuiltinReduction<T, OP> > {};
+    };
+
+    template <typename T>
+    struct ReductionKernelDispatch<SumReduction<T> >
+      : public ReductionKernels::BuiltinDispatch<T, ReductionKernels::KERNEL_SUM> {};
+    template <typename T>
+    struct ReductionKernelDispatch<ProdReduction<T> >
+      : public ReductionKernels::BuiltinDispatch<T, ReductionKernels::KERNEL_PROD> {};
+    template <typename T>
+    struct ReductionKernelDispatch<MinReduction<T> >
+      : public ReductionKernels::BuiltinDispatch<T, ReductionKernels::KERNEL_MIN> {};
+    template <typename T>
+    struct ReductionKernelDispatch<MaxReduction<T> >
+      : public ReductionKernels::BuiltinDispatch<T, ReductionKernels::KERNEL_MAX> {};
+
 }; // namespace Realm
 
 //include "redop.inl"
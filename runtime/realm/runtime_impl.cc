@@ -50,6 +50,8 @@ static const void *ignore_gasnet_warning2 __attribute__((unused)) = (void *)_gas
 #ifndef USE_GASNET
 /*extern*/ void *fake_gasnet_mem_base = 0;
 /*extern*/ size_t fake_gasnet_mem_size = 0;
+
+#include "realm/shm_network.h"
 #endif
 
 // remote copy active messages from from lowlevel_dma.h for now
@@ -143,20 +145,31 @@ namespace Realm {
 	  continue;
 	GenEventImpl *e = n->events.lookup_entry(j, i/*node*/);
 	AutoHSLLock a2(e->mutex);
+
+	// the owner keeps its first few local waiters outside the mutex
+	std::vector<EventWaiter *> current_waiters;
+	for(unsigned k = 0; k < GenEventImpl::NUM_INLINE_WAITERS; k++) {
+	  EventWaiter *w = e->inline_waiters[k];
+	  if(w != 0)
+	    current_waiters.push_back(w);
+	}
+	current_waiters.insert(current_waiters.end(),
+			       e->current_local_waiters.begin(),
+			       e->current_local_waiters.end());
 	
 	// print anything with either local or remote waiters
-	if(e->current_local_waiters.empty() &&
+	if(current_waiters.empty() &&
 	   e->future_local_waiters.empty() &&
 	   e->remote_waiters.empty())
 	  continue;
 
 	os << "Event " << e->me <<": gen=" << e->generation
 	   << " subscr=" << e->gen_subscribed
-	   << " local=" << e->current_local_waiters.size()
+	   << " local=" << current_waiters.size()
 	   << "+" << e->future_local_waiters.size()
 	   << " remote=" << e->remote_waiters.size() << "\n";
-	for(std::vector<EventWaiter *>::const_iterator it = e->current_local_waiters.begin();
-	    it != e->current_local_waiters.end();
+	for(std::vector<EventWaiter *>::const_iterator it = current_waiters.begin();
+	    it != current_waiters.end();
 	    it++) {
 	  os << "  [" << (e->generation+1) << "] L:" << (*it) << " - ";
 	  (*it)->print(os);
@@ -1026,6 +1039,10 @@ namespace Realm {
         fflush(stdout);
       }
 #endif
+#else
+      // without GASNet, we can still run multiple nodes on a single host
+      //  over shared memory (this forks if REALM_SHM_RANKS is set)
+      ShmNetwork::init(argc, argv);
 #endif
 
       // TODO: this is here to match old behavior, but it'd probably be
@@ -1122,6 +1139,7 @@ namespace Realm {
       stack_size_in_mb = 2;
       //unsigned cpu_worker_threads = 1;
       unsigned dma_worker_threads = 1;
+      unsigned dma_memcpy_threads = 0;
       unsigned active_msg_worker_threads = 1;
       unsigned active_msg_handler_threads = 1;
 #ifdef EVENT_TRACING
@@ -1146,6 +1164,7 @@ namespace Realm {
 	.add_option_int("-ll:dsize", disk_mem_size_in_mb)
 	.add_option_int("-ll:stacksize", stack_size_in_mb)
 	.add_option_int("-ll:dma", dma_worker_threads)
+	.add_option_int("-ll:dma_memcpy", dma_memcpy_threads)
         .add_option_bool("-ll:pin_dma", pin_dma_threads)
 	.add_option_int("-ll:amsg", active_msg_worker_threads)
 	.add_option_int("-ll:ahandlers", active_msg_handler_threads)
@@ -1168,6 +1187,11 @@ namespace Realm {
       cp.add_option_int("-realm:eventloopcheck", Config::event_loop_detection_limit);
       cp.add_option_bool("-ll:force_kthreads", Config::force_kernel_threads);
       cp.add_option_bool("-ll:frsrv_fallback", Config::use_fast_reservation_fallback);
+      cp.add_option_int("-ll:steal", Config::task_steal_batch);
+      cp.add_option_bool("-ll:file_mmap", Config::use_file_mmap);
+      cp.add_option_int("-ll:aio_depth", Config::aio_queue_depth);
+      cp.add_option_bool("-ll:aio_direct", Config::aio_direct_io);
+      cp.add_option_int("-ll:aio_bounce", Config::aio_bounce_size_in_kb);
 
       bool cmdline_ok = cp.parse_command_line(cmdline);
 
@@ -1330,7 +1354,9 @@ namespace Realm {
 
 #ifndef USE_GASNET
       // network initialization is also responsible for setting the "zero_time"
-      //  for relative timing - no synchronization necessary in non-gasnet case
+      //  for relative timing - line up the shm network's ranks first
+      if(ShmNetwork::enabled())
+	ShmNetwork::barrier();
       Realm::Clock::set_zero_time();
 #endif
 
@@ -1441,9 +1467,16 @@ namespace Realm {
 	char *regmem_base = ((char *)(seginfos[my_node_id].addr)) + (gasnet_mem_size_in_mb << 20);
 	delete[] seginfos;
 #else
-	nongasnet_regmem_base = malloc(reg_mem_size_in_mb << 20);
-	assert(nongasnet_regmem_base != 0);
-	char *regmem_base = static_cast<char *>(nongasnet_regmem_base);
+	char *regmem_base;
+	if(ShmNetwork::enabled()) {
+	  // other nodes write directly into this, so it lives in our shared
+	  //  segment (laid out like GASNet's, minus the global memory)
+	  regmem_base = static_cast<char *>(ShmNetwork::local_segment_base());
+	} else {
+	  nongasnet_regmem_base = malloc(reg_mem_size_in_mb << 20);
+	  assert(nongasnet_regmem_base != 0);
+	  regmem_base = static_cast<char *>(nongasnet_regmem_base);
+	}
 #endif
 	Memory m = get_runtime()->next_local_memory_id();
 	regmem = new LocalCPUMemory(m,
@@ -1468,9 +1501,15 @@ namespace Realm {
                                 + (reg_mem_size_in_mb << 20);
 	delete[] seginfos;
 #else
-	nongasnet_reg_ib_mem_base = malloc(reg_ib_mem_size_in_mb << 20);
-	assert(nongasnet_reg_ib_mem_base != 0);
-	char *reg_ib_mem_base = static_cast<char *>(nongasnet_reg_ib_mem_base);
+	char *reg_ib_mem_base;
+	if(ShmNetwork::enabled()) {
+	  reg_ib_mem_base = (static_cast<char *>(ShmNetwork::local_segment_base()) +
+			     (reg_mem_size_in_mb << 20));
+	} else {
+	  nongasnet_reg_ib_mem_base = malloc(reg_ib_mem_size_in_mb << 20);
+	  assert(nongasnet_reg_ib_mem_base != 0);
+	  reg_ib_mem_base = static_cast<char *>(nongasnet_reg_ib_mem_base);
+	}
 #endif
 	Memory m = get_runtime()->next_local_ib_memory_id();
 	reg_ib_mem = new LocalCPUMemory(m,
@@ -1510,7 +1549,7 @@ namespace Realm {
       
       // start dma system at the very ending of initialization
       // since we need list of local gpus to create channels
-      start_dma_system(dma_worker_threads,
+      start_dma_system(dma_worker_threads, dma_memcpy_threads,
 		       pin_dma_threads, 100
 		       ,*core_reservations);
 
@@ -1830,14 +1869,36 @@ namespace Realm {
 
 #define DEBUG_COLLECTIVES
 
-#if defined(USE_GASNET) && defined(DEBUG_COLLECTIVES)
+  // collectives use GASNet's implementation if we have it, and the shm
+  //  network's otherwise - either way, they're only needed with >1 node
+#ifdef USE_GASNET
   static const int GASNET_COLL_FLAGS = GASNET_COLL_IN_MYSYNC | GASNET_COLL_OUT_MYSYNC | GASNET_COLL_LOCAL;
-  
+#endif
+
+  static void collective_gather(NodeID root, void *dst, const void *src, size_t bytes)
+  {
+#ifdef USE_GASNET
+    gasnet_coll_gather(GASNET_TEAM_ALL, root, dst, const_cast<void *>(src), bytes, GASNET_COLL_FLAGS);
+#else
+    ShmNetwork::gather(root, dst, src, bytes);
+#endif
+  }
+
+  static void collective_broadcast(NodeID root, void *dst, const void *src, size_t bytes)
+  {
+#ifdef USE_GASNET
+    gasnet_coll_broadcast(GASNET_TEAM_ALL, dst, root, const_cast<void *>(src), bytes, GASNET_COLL_FLAGS);
+#else
+    ShmNetwork::broadcast(root, dst, src, bytes);
+#endif
+  }
+
+#ifdef DEBUG_COLLECTIVES
   template <typename T>
   static void broadcast_check(const T& val, const char *name)
   {
     T bval;
-    gasnet_coll_broadcast(GASNET_TEAM_ALL, &bval, 0, const_cast<T *>(&val), sizeof(T), GASNET_COLL_FLAGS);
+    collective_broadcast(0, &bval, &val, sizeof(T));
     if(val != bval) {
       log_collective.fatal() << "collective mismatch on node " << my_node_id << " for " << name << ": " << val << " != " << bval;
       assert(false);
@@ -1851,69 +1912,69 @@ namespace Realm {
     {
       log_collective.info() << "collective spawn: proc=" << target_proc << " func=" << task_id << " priority=" << priority << " before=" << wait_on;
 
-#ifdef USE_GASNET
+      if(max_node_id > 0) {
 #ifdef DEBUG_COLLECTIVES
-      broadcast_check(target_proc, "target_proc");
-      broadcast_check(task_id, "task_id");
-      broadcast_check(priority, "priority");
+	broadcast_check(target_proc, "target_proc");
+	broadcast_check(task_id, "task_id");
+	broadcast_check(priority, "priority");
 #endif
 
-      // root node will be whoever owns the target proc
-      int root = ID(target_proc).proc.owner_node;
+	// root node will be whoever owns the target proc
+	int root = ID(target_proc).proc.owner_node;
 
-      if((int)my_node_id == root) {
-	// ROOT NODE
+	if((int)my_node_id == root) {
+	  // ROOT NODE
 
-	// step 1: receive wait_on from every node
-	Event *all_events = 0;
-	all_events = new Event[max_node_id + 1];
-	gasnet_coll_gather(GASNET_TEAM_ALL, root, all_events, &wait_on, sizeof(Event), GASNET_COLL_FLAGS);
+	  // step 1: receive wait_on from every node
+	  Event *all_events = 0;
+	  all_events = new Event[max_node_id + 1];
+	  collective_gather(root, all_events, &wait_on, sizeof(Event));
 
-	// step 2: merge all the events
-	std::set<Event> event_set;
-	for(NodeID i = 0; i <= max_node_id; i++) {
-	  //log_collective.info() << "ev " << i << ": " << all_events[i];
-	  if(all_events[i].exists())
-	    event_set.insert(all_events[i]);
-	}
-	delete[] all_events;
+	  // step 2: merge all the events
+	  std::set<Event> event_set;
+	  for(NodeID i = 0; i <= max_node_id; i++) {
+	    //log_collective.info() << "ev " << i << ": " << all_events[i];
+	    if(all_events[i].exists())
+	      event_set.insert(all_events[i]);
+	  }
+	  delete[] all_events;
 
-	Event merged_event = Event::merge_events(event_set);
-	log_collective.info() << "merged precondition: proc=" << target_proc << " func=" << task_id << " priority=" << priority << " before=" << merged_event;
+	  Event merged_event = Event::merge_events(event_set);
+	  log_collective.info() << "merged precondition: proc=" << target_proc << " func=" << task_id << " priority=" << priority << " before=" << merged_event;
 
-	// step 3: run the task
-	Event finish_event = target_proc.spawn(task_id, args, arglen, merged_event, priority);
+	  // step 3: run the task
+	  Event finish_event = target_proc.spawn(task_id, args, arglen, merged_event, priority);
 
-	// step 4: broadcast the finish event to everyone
-	gasnet_coll_broadcast(GASNET_TEAM_ALL, &finish_event, root, &finish_event, sizeof(Event), GASNET_COLL_FLAGS);
+	  // step 4: broadcast the finish event to everyone
+	  collective_broadcast(root, &finish_event, &finish_event, sizeof(Event));
 
-	log_collective.info() << "collective spawn: proc=" << target_proc << " func=" << task_id << " priority=" << priority << " after=" << finish_event;
+	  log_collective.info() << "collective spawn: proc=" << target_proc << " func=" << task_id << " priority=" << priority << " after=" << finish_event;
 
-	return finish_event;
-      } else {
-	// NON-ROOT NODE
+	  return finish_event;
+	} else {
+	  // NON-ROOT NODE
 
-	// step 1: send our wait_on to the root for merging
-	gasnet_coll_gather(GASNET_TEAM_ALL, root, 0, &wait_on, sizeof(Event), GASNET_COLL_FLAGS);
+	  // step 1: send our wait_on to the root for merging
+	  collective_gather(root, 0, &wait_on, sizeof(Event));
 
-	// steps 2 and 3: twiddle thumbs
+	  // steps 2 and 3: twiddle thumbs
 
-	// step 4: receive finish event
-	Event finish_event;
-	gasnet_coll_broadcast(GASNET_TEAM_ALL, &finish_event, root, 0, sizeof(Event), GASNET_COLL_FLAGS);
+	  // step 4: receive finish event
+	  Event finish_event;
+	  collective_broadcast(root, &finish_event, 0, sizeof(Event));
+
+	  log_collective.info() << "collective spawn: proc=" << target_proc << " func=" << task_id << " priority=" << priority << " after=" << finish_event;
+
+	  return finish_event;
+	}
+      } else {
+	// single node, so a collective spawn is the same as a regular spawn
+	Event finish_event = target_proc.spawn(task_id, args, arglen, wait_on, priority);
 
 	log_collective.info() << "collective spawn: proc=" << target_proc << " func=" << task_id << " priority=" << priority << " after=" << finish_event;
 
 	return finish_event;
       }
-#else
-      // no GASNet, so a collective spawn is the same as a regular spawn
-      Event finish_event = target_proc.spawn(task_id, args, arglen, wait_on, priority);
-
-      log_collective.info() << "collective spawn: proc=" << target_proc << " func=" << task_id << " priority=" << priority << " after=" << finish_event;
-
-      return finish_event;
-#endif
     }
 
     Event RuntimeImpl::collective_spawn_by_kind(Processor::Kind target_kind, Processor::TaskFuncID task_id, 
@@ -1923,54 +1984,52 @@ namespace Realm {
     {
       log_collective.info() << "collective spawn: kind=" << target_kind << " func=" << task_id << " priority=" << priority << " before=" << wait_on;
 
-#ifdef USE_GASNET
+      // with a single node, our precondition is the only one
+      Event merged_event = wait_on;
+
+      if(max_node_id > 0) {
 #ifdef DEBUG_COLLECTIVES
-      broadcast_check(target_kind, "target_kind");
-      broadcast_check(task_id, "task_id");
-      broadcast_check(one_per_node, "one_per_node");
-      broadcast_check(priority, "priority");
+	broadcast_check(target_kind, "target_kind");
+	broadcast_check(task_id, "task_id");
+	broadcast_check(one_per_node, "one_per_node");
+	broadcast_check(priority, "priority");
 #endif
 
-      // every node is involved in this one, so the root is arbitrary - we'll pick node 0
-
-      Event merged_event;
-
-      if(my_node_id == 0) {
-	// ROOT NODE
-
-	// step 1: receive wait_on from every node
-	Event *all_events = 0;
-	all_events = new Event[max_node_id + 1];
-	gasnet_coll_gather(GASNET_TEAM_ALL, 0, all_events, &wait_on, sizeof(Event), GASNET_COLL_FLAGS);
+	// every node is involved in this one, so the root is arbitrary - we'll pick node 0
 
-	// step 2: merge all the events
-	std::set<Event> event_set;
-	for(NodeID i = 0; i <= max_node_id; i++) {
-	  //log_collective.info() << "ev " << i << ": " << all_events[i];
-	  if(all_events[i].exists())
-	    event_set.insert(all_events[i]);
-	}
-	delete[] all_events;
+	if(my_node_id == 0) {
+	  // ROOT NODE
+
+	  // step 1: receive wait_on from every node
+	  Event *all_events = 0;
+	  all_events = new Event[max_node_id + 1];
+	  collective_gather(0, all_events, &wait_on, sizeof(Event));
+
+	  // step 2: merge all the events
+	  std::set<Event> event_set;
+	  for(NodeID i = 0; i <= max_node_id; i++) {
+	    //log_collective.info() << "ev " << i << ": " << all_events[i];
+	    if(all_events[i].exists())
+	      event_set.insert(all_events[i]);
+	  }
+	  delete[] all_events;
 
-	merged_event = Event::merge_events(event_set);
+	  merged_event = Event::merge_events(event_set);
 
-	// step 3: broadcast the merged event back to everyone
-	gasnet_coll_broadcast(GASNET_TEAM_ALL, &merged_event, 0, &merged_event, sizeof(Event), GASNET_COLL_FLAGS);
-      } else {
-	// NON-ROOT NODE
+	  // step 3: broadcast the merged event back to everyone
+	  collective_broadcast(0, &merged_event, &merged_event, sizeof(Event));
+	} else {
+	  // NON-ROOT NODE
 
-	// step 1: send our wait_on to the root for merging
-	gasnet_coll_gather(GASNET_TEAM_ALL, 0, 0, &wait_on, sizeof(Event), GASNET_COLL_FLAGS);
+	  // step 1: send our wait_on to the root for merging
+	  collective_gather(0, 0, &wait_on, sizeof(Event));
 
-	// step 2: twiddle thumbs
+	  // step 2: twiddle thumbs
 
-	// step 3: receive merged wait_on event
-	gasnet_coll_broadcast(GASNET_TEAM_ALL, &merged_event, 0, 0, sizeof(Event), GASNET_COLL_FLAGS);
+	  // step 3: receive merged wait_on event
+	  collective_broadcast(0, &merged_event, 0, sizeof(Event));
+	}
       }
-#else
-      // no GASNet, so our precondition is the only one
-      Event merged_event = wait_on;
-#endif
 
       // now spawn 0 or more local tasks
       std::set<Event> event_set;
@@ -1994,54 +2053,54 @@ namespace Realm {
       // local merge
       Event my_finish = Event::merge_events(event_set);
 
-#ifdef USE_GASNET
-      if(my_node_id == 0) {
-	// ROOT NODE
+      if(max_node_id > 0) {
+	if(my_node_id == 0) {
+	  // ROOT NODE
+
+	  // step 1: receive wait_on from every node
+	  Event *all_events = 0;
+	  all_events = new Event[max_node_id + 1];
+	  collective_gather(0, all_events, &my_finish, sizeof(Event));
+
+	  // step 2: merge all the events
+	  std::set<Event> event_set;
+	  for(NodeID i = 0; i <= max_node_id; i++) {
+	    //log_collective.info() << "ev " << i << ": " << all_events[i];
+	    if(all_events[i].exists())
+	      event_set.insert(all_events[i]);
+	  }
+	  delete[] all_events;
 
-	// step 1: receive wait_on from every node
-	Event *all_events = 0;
-	all_events = new Event[max_node_id + 1];
-	gasnet_coll_gather(GASNET_TEAM_ALL, 0, all_events, &my_finish, sizeof(Event), GASNET_COLL_FLAGS);
+	  Event merged_finish = Event::merge_events(event_set);
 
-	// step 2: merge all the events
-	std::set<Event> event_set;
-	for(NodeID i = 0; i <= max_node_id; i++) {
-	  //log_collective.info() << "ev " << i << ": " << all_events[i];
-	  if(all_events[i].exists())
-	    event_set.insert(all_events[i]);
-	}
-	delete[] all_events;
-
-	Event merged_finish = Event::merge_events(event_set);
+	  // step 3: broadcast the merged event back to everyone
+	  collective_broadcast(0, &merged_finish, &merged_finish, sizeof(Event));
 
-	// step 3: broadcast the merged event back to everyone
-	gasnet_coll_broadcast(GASNET_TEAM_ALL, &merged_finish, 0, &merged_finish, sizeof(Event), GASNET_COLL_FLAGS);
+	  log_collective.info() << "collective spawn: kind=" << target_kind << " func=" << task_id << " priority=" << priority << " after=" << merged_finish;
 
-	log_collective.info() << "collective spawn: kind=" << target_kind << " func=" << task_id << " priority=" << priority << " after=" << merged_finish;
+	  return merged_finish;
+	} else {
+	  // NON-ROOT NODE
 
-	return merged_finish;
-      } else {
-	// NON-ROOT NODE
+	  // step 1: send our wait_on to the root for merging
+	  collective_gather(0, 0, &my_finish, sizeof(Event));
 
-	// step 1: send our wait_on to the root for merging
-	gasnet_coll_gather(GASNET_TEAM_ALL, 0, 0, &my_finish, sizeof(Event), GASNET_COLL_FLAGS);
+	  // step 2: twiddle thumbs
 
-	// step 2: twiddle thumbs
+	  // step 3: receive merged wait_on event
+	  Event merged_finish;
+	  collective_broadcast(0, &merged_finish, 0, sizeof(Event));
 
-	// step 3: receive merged wait_on event
-	Event merged_finish;
-	gasnet_coll_broadcast(GASNET_TEAM_ALL, &merged_finish, 0, 0, sizeof(Event), GASNET_COLL_FLAGS);
+	  log_collective.info() << "collective spawn: kind=" << target_kind << " func=" << task_id << " priority=" << priority << " after=" << merged_finish;
 
-	log_collective.info() << "collective spawn: kind=" << target_kind << " func=" << task_id << " priority=" << priority << " after=" << merged_finish;
+	  return merged_finish;
+	}
+      } else {
+	// single node, so just return our locally merged event
+	log_collective.info() << "collective spawn: kind=" << target_kind << " func=" << task_id << " priority=" << priority << " after=" << my_finish;
 
-	return merged_finish;
+	return my_finish;
       }
-#else
-      // no GASNet, so just return our locally merged event
-      log_collective.info() << "collective spawn: kind=" << target_kind << " func=" << task_id << " priority=" << priority << " after=" << my_finish;
-
-      return my_finish;
-#endif
     }
 
 #if 0
@@ -2201,6 +2260,9 @@ namespace Realm {
       // don't start tearing things down until all processes agree
       gasnet_barrier_notify(0, GASNET_BARRIERFLAG_ANONYMOUS);
       gasnet_barrier_wait(0, GASNET_BARRIERFLAG_ANONYMOUS);
+#else
+      if(ShmNetwork::enabled())
+	ShmNetwork::barrier();
 #endif
 
       // Shutdown all the threads
@@ -2295,6 +2357,13 @@ namespace Realm {
 	free(nongasnet_regmem_base);
       if(nongasnet_reg_ib_mem_base != 0)
 	free(nongasnet_reg_ib_mem_base);
+
+      // rank 0 of a shm network reports failures of the other ranks
+      {
+	int shm_result = ShmNetwork::finalize();
+	if((shm_result != 0) && (shutdown_result_code == 0))
+	  shutdown_result_code = shm_result;
+      }
 #endif
 
       if(!Threading::cleanup()) exit(1);
@@ -0,0 +1,843 @@
+/* Copyright 2018 Stanford University, NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// shared-memory network for Realm builds without GASNet
+
+#include "realm/shm_network.h"
+
+#include "realm/threads.h"
+#include "realm/logging.h"
+
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#ifdef __linux__
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+namespace Realm {
+
+  Logger log_shm("shm");
+
+  namespace ShmNetwork {
+
+    static const int MAX_RANKS = 64;
+    static const size_t COLL_SLOT_SIZE = 256;
+
+    // per-rank state visible to every rank
+    struct RankInfo {
+      volatile int doorbell;          // bumped by senders to wake the poller
+      volatile int sleeping;          // set by the poller before it waits
+      volatile uintptr_t segment_base;
+      volatile size_t segment_size;
+      char coll_slot[COLL_SLOT_SIZE];
+    };
+
+    struct SharedHeader {
+      int num_ranks;
+      pid_t root_pid;
+      size_t ring_size;
+      volatile int barrier_count;
+      volatile int barrier_generation;
+      RankInfo ranks[MAX_RANKS];
+    };
+
+    // there is a ring for every (sender, receiver) pair - the sender owns
+    //  the tail and the receiver owns the head, so the only cross-process
+    //  synchronization is the ordering of data writes before tail updates
+    struct RingHeader {
+      volatile uint64_t tail;
+      char pad1[64 - sizeof(uint64_t)];
+      volatile uint64_t head;
+      char pad2[64 - sizeof(uint64_t)];
+    };
+
+    struct MessageHeader {
+      uint32_t record_size;  // 0 means skip to the start of the ring
+      uint16_t msgid;
+      uint8_t arg_bytes;
+      uint8_t has_payload;
+      uint64_t payload_size;
+      uint64_t dstptr;       // non-zero if the payload was written directly
+    };
+
+    struct ShmToken {
+      NodeID source;
+    };
+
+    static inline size_t round_up(size_t v, size_t align)
+    {
+      return ((v + align - 1) / align) * align;
+    }
+
+#ifdef __linux__
+    static void futex_wait(volatile int *addr, int val, long timeout_ns)
+    {
+      struct timespec ts;
+      ts.tv_sec = timeout_ns / 1000000000;
+      ts.tv_nsec = timeout_ns % 1000000000;
+      syscall(SYS_futex, addr, FUTEX_WAIT, val, &ts, 0, 0);
+    }
+
+    static void futex_wake(volatile int *addr)
+    {
+      syscall(SYS_futex, addr, FUTEX_WAKE, INT_MAX, 0, 0, 0);
+    }
+#else
+    static void futex_wait(volatile int *addr, int val, long timeout_ns)
+    {
+      if(*addr == val)
+	usleep(timeout_ns / 1000);
+    }
+
+    static void futex_wake(volatile int *addr)
+    {
+      // waiters poll
+    }
+#endif
+
+    // handler threads - messages from a given sender always go to the same
+    //  thread so that they are handled in the order they were sent
+    class HandlerQueue {
+    public:
+      HandlerQueue(void)
+	: condvar(mutex), head(0), tail(&head), shutdown_flag(false), thread(0)
+      {}
+
+      void add(IncomingMessage *msg)
+      {
+	AutoHSLLock al(mutex);
+	bool was_empty = (head == 0);
+	*tail = msg;
+	tail = &(msg->next_msg);
+	if(was_empty)
+	  condvar.signal();
+      }
+
+      void shutdown(void)
+      {
+	{
+	  AutoHSLLock al(mutex);
+	  shutdown_flag = true;
+	  condvar.signal();
+	}
+	thread->join();
+	delete thread;
+	thread = 0;
+      }
+
+      void handler_loop(void)
+      {
+	while(true) {
+	  IncomingMessage *msgs;
+	  {
+	    AutoHSLLock al(mutex);
+	    while(!head && !shutdown_flag)
+	      condvar.wait();
+	    if(!head)
+	      break;  // shutdown and nothing left to do
+	    msgs = head;
+	    head = 0;
+	    tail = &head;
+	  }
+	  while(msgs) {
+	    IncomingMessage *next = msgs->next_msg;
+	    msgs->run_handler();
+	    delete msgs;
+	    msgs = next;
+	  }
+	}
+      }
+
+      GASNetHSL mutex;
+      GASNetCondVar condvar;
+      IncomingMessage *head;
+      IncomingMessage **tail;
+      bool shutdown_flag;
+      Thread *thread;
+    };
+
+    class ShmNetworkImpl {
+    public:
+      ShmNetworkImpl(void *_mapping, size_t _mapping_size);
+
+      RingHeader *ring(NodeID sender, NodeID receiver) const
+      {
+	size_t block = sizeof(RingHeader) + header->ring_size;
+	return reinterpret_cast<RingHeader *>(ring_base +
+					      (((sender * header->num_ranks) +
+						receiver) * block));
+      }
+
+      char *ring_data(RingHeader *r) const
+      {
+	return reinterpret_cast<char *>(r + 1);
+      }
+
+      // converts an address in 'node's segment to our alias of it
+      char *translate(NodeID node, const void *remote_ptr, size_t bytes) const;
+
+      void send(NodeID target, int msgid, bool has_payload,
+		const void *args, size_t arg_size,
+		const SpanList& spans, size_t payload_size,
+		void *dstptr);
+
+      bool poll_rings(void);
+      void deliver(NodeID sender, const MessageHeader *hdr);
+      void polling_loop(void);
+
+      void barrier(void);
+
+      void *mapping;
+      size_t mapping_size;
+      SharedHeader *header;
+      char *ring_base;
+      std::vector<pid_t> child_pids;
+      std::vector<char *> segment_aliases;
+      std::vector<GASNetHSL *> send_locks;
+      void (*handlers[256])();
+      CoreReservation *core_rsrv;
+      std::vector<Thread *> polling_threads;
+      std::vector<HandlerQueue *> handler_queues;
+      volatile bool shutdown_flag;
+    };
+
+    static ShmNetworkImpl *impl = 0;
+
+    ShmNetworkImpl::ShmNetworkImpl(void *_mapping, size_t _mapping_size)
+      : mapping(_mapping), mapping_size(_mapping_size)
+      , header(static_cast<SharedHeader *>(_mapping))
+      , core_rsrv(0), shutdown_flag(false)
+    {
+      ring_base = static_cast<char *>(mapping) + round_up(sizeof(SharedHeader), 4096);
+      for(int i = 0; i < 256; i++)
+	handlers[i] = 0;
+    }
+
+    char *ShmNetworkImpl::translate(NodeID node, const void *remote_ptr,
+				    size_t bytes) const
+    {
+      const RankInfo& ri = header->ranks[node];
+      size_t offset = static_cast<const char *>(remote_ptr) - reinterpret_cast<const char *>(ri.segment_base);
+      if((segment_aliases[node] == 0) || ((offset + bytes) > ri.segment_size)) {
+	log_shm.fatal() << "address outside of shared segment: node=" << node
+			<< " ptr=" << remote_ptr << " bytes=" << bytes;
+	assert(0);
+      }
+      return segment_aliases[node] + offset;
+    }
+
+    void ShmNetworkImpl::send(NodeID target, int msgid, bool has_payload,
+			      const void *args, size_t arg_size,
+			      const SpanList& spans, size_t payload_size,
+			      void *dstptr)
+    {
+      assert(arg_size <= 64);
+
+      // "RDMA" payloads go straight to their destination
+      if(dstptr && (payload_size > 0)) {
+	char *dst = translate(target, dstptr, payload_size);
+	for(SpanList::const_iterator it = spans.begin(); it != spans.end(); ++it) {
+	  memcpy(dst, it->first, it->second);
+	  dst += it->second;
+	}
+      }
+
+      size_t args_end = round_up(sizeof(MessageHeader) + arg_size, 8);
+      size_t ring_payload = (dstptr ? 0 : payload_size);
+      size_t record_size = args_end + round_up(ring_payload, 8);
+      size_t ring_size = header->ring_size;
+      if(record_size > (ring_size / 2)) {
+	log_shm.fatal() << "message too large for ring: msgid=" << msgid
+			<< " payload=" << payload_size << " ring=" << ring_size;
+	assert(0);
+      }
+
+      RingHeader *r = ring(my_node_id, target);
+      char *data = ring_data(r);
+
+      {
+	AutoHSLLock al(*send_locks[target]);
+
+	uint64_t tail = r->tail;  // only we write this
+	size_t offset = tail % ring_size;
+	size_t contig = ring_size - offset;
+	size_t needed = record_size;
+	if(record_size > contig)
+	  needed += contig;  // we'll skip the end of the ring
+
+	// wait for the receiver to make room
+	while((tail + needed - r->head) > ring_size)
+	  sched_yield();
+
+	if(record_size > contig) {
+	  reinterpret_cast<MessageHeader *>(data + offset)->record_size = 0;
+	  tail += contig;
+	  offset = 0;
+	}
+
+	MessageHeader *hdr = reinterpret_cast<MessageHeader *>(data + offset);
+	hdr->record_size = record_size;
+	hdr->msgid = msgid;
+	hdr->arg_bytes = arg_size;
+	hdr->has_payload = has_payload;
+	hdr->payload_size = payload_size;
+	hdr->dstptr = reinterpret_cast<uintptr_t>(dstptr);
+	memcpy(hdr + 1, args, arg_size);
+	if(ring_payload > 0) {
+	  char *pos = data + offset + args_end;
+	  for(SpanList::const_iterator it = spans.begin(); it != spans.end(); ++it) {
+	    memcpy(pos, it->first, it->second);
+	    pos += it->second;
+	  }
+	}
+
+	// data (including any direct payload) must be visible before the tail
+	__sync_synchronize();
+	r->tail = tail + record_size;
+      }
+
+      // ring the doorbell if the receiver might be asleep
+      __sync_synchronize();
+      RankInfo& ri = header->ranks[target];
+      if(ri.sleeping) {
+	__sync_fetch_and_add(&ri.doorbell, 1);
+	futex_wake(&ri.doorbell);
+      }
+    }
+
+#define SHM_ARGS_2                a[0], a[1]
+#define SHM_ARGS_3   SHM_ARGS_2,  a[2]
+#define SHM_ARGS_4   SHM_ARGS_3,  a[3]
+#define SHM_ARGS_5   SHM_ARGS_4,  a[4]
+#define SHM_ARGS_6   SHM_ARGS_5,  a[5]
+#define SHM_ARGS_7   SHM_ARGS_6,  a[6]
+#define SHM_ARGS_8   SHM_ARGS_7,  a[7]
+#define SHM_ARGS_9   SHM_ARGS_8,  a[8]
+#define SHM_ARGS_10  SHM_ARGS_9,  a[9]
+#define SHM_ARGS_11  SHM_ARGS_10, a[10]
+#define SHM_ARGS_12  SHM_ARGS_11, a[11]
+#define SHM_ARGS_13  SHM_ARGS_12, a[12]
+#define SHM_ARGS_14  SHM_ARGS_13, a[13]
+#define SHM_ARGS_15  SHM_ARGS_14, a[14]
+#define SHM_ARGS_16  SHM_ARGS_15, a[15]
+
+#define SHM_SHORT_CASE(n) \
+    case n: \
+      (reinterpret_cast<void (*)(token_t, HANDLERARG_PARAMS_ ## n)>(fnptr))(token, SHM_ARGS_ ## n); \
+      break
+
+#define SHM_MEDIUM_CASE(n) \
+    case n: \
+      (reinterpret_cast<void (*)(token_t, void *, size_t, HANDLERARG_PARAMS_ ## n)>(fnptr))(token, buf, nbytes, SHM_ARGS_ ## n); \
+      break
+
+    static void call_short_handler(void (*fnptr)(), token_t token,
+				   int nargs, const handlerarg_t *a)
+    {
+      switch(nargs) {
+	SHM_SHORT_CASE(2);  SHM_SHORT_CASE(3);  SHM_SHORT_CASE(4);
+	SHM_SHORT_CASE(5);  SHM_SHORT_CASE(6);  SHM_SHORT_CASE(7);
+	SHM_SHORT_CASE(8);  SHM_SHORT_CASE(9);  SHM_SHORT_CASE(10);
+	SHM_SHORT_CASE(11); SHM_SHORT_CASE(12); SHM_SHORT_CASE(13);
+	SHM_SHORT_CASE(14); SHM_SHORT_CASE(15); SHM_SHORT_CASE(16);
+      default: assert(0);
+      }
+    }
+
+    static void call_medium_handler(void (*fnptr)(), token_t token,
+				    void *buf, size_t nbytes,
+				    int nargs, const handlerarg_t *a)
+    {
+      switch(nargs) {
+	SHM_MEDIUM_CASE(2);  SHM_MEDIUM_CASE(3);  SHM_MEDIUM_CASE(4);
+	SHM_MEDIUM_CASE(5);  SHM_MEDIUM_CASE(6);  SHM_MEDIUM_CASE(7);
+	SHM_MEDIUM_CASE(8);  SHM_MEDIUM_CASE(9);  SHM_MEDIUM_CASE(10);
+	SHM_MEDIUM_CASE(11); SHM_MEDIUM_CASE(12); SHM_MEDIUM_CASE(13);
+	SHM_MEDIUM_CASE(14); SHM_MEDIUM_CASE(15); SHM_MEDIUM_CASE(16);
+      default: assert(0);
+      }
+    }
+
+#undef SHM_SHORT_CASE
+#undef SHM_MEDIUM_CASE
+
+    void ShmNetworkImpl::deliver(NodeID sender, const MessageHeader *hdr)
+    {
+      void (*fnptr)() = handlers[hdr->msgid];
+      if(!fnptr) {
+	log_shm.fatal() << "no handler for message: msgid=" << hdr->msgid
+			<< " sender=" << sender;
+	assert(0);
+      }
+
+      // the generated handlers read whole 4-byte args, and always at least two
+      handlerarg_t a[16];
+      memset(a, 0, sizeof(a));
+      memcpy(a, hdr + 1, hdr->arg_bytes);
+      int nargs = (((hdr->arg_bytes < 8) ? 8 : hdr->arg_bytes) + 3) / 4;
+
+      ShmToken token;
+      token.source = sender;
+
+      if(!hdr->has_payload) {
+	call_short_handler(fnptr, &token, nargs, a);
+	return;
+      }
+
+      // handlers run later on a handler thread, so payloads in the ring have
+      //  to be copied out - direct payloads are already where they belong
+      void *buf;
+      size_t nbytes = hdr->payload_size;
+      if(hdr->dstptr) {
+	buf = reinterpret_cast<void *>(hdr->dstptr);
+      } else if(nbytes > 0) {
+	buf = malloc(nbytes);
+	assert(buf != 0);
+	memcpy(buf,
+	       reinterpret_cast<const char *>(hdr) + round_up(sizeof(MessageHeader) + hdr->arg_bytes, 8),
+	       nbytes);
+      } else
+	buf = 0;
+      call_medium_handler(fnptr, &token, buf, nbytes, nargs, a);
+    }
+
+    bool ShmNetworkImpl::poll_rings(void)
+    {
+      bool any = false;
+      size_t ring_size = header->ring_size;
+      for(NodeID sender = 0; sender < header->num_ranks; sender++) {
+	RingHeader *r = ring(sender, my_node_id);
+	uint64_t head = r->head;  // only we write this
+	uint64_t tail = r->tail;
+	if(head == tail) continue;
+
+	// don't read message data until we've seen the tail that covers it
+	__sync_synchronize();
+
+	char *data = ring_data(r);
+	while(head != tail) {
+	  size_t offset = head % ring_size;
+	  const MessageHeader *hdr = reinterpret_cast<const MessageHeader *>(data + offset);
+	  if(hdr->record_size == 0) {
+	    head += ring_size - offset;
+	    continue;
+	  }
+	  deliver(sender, hdr);
+	  head += hdr->record_size;
+	}
+
+	// and finish with the data before giving the space back
+	__sync_synchronize();
+	r->head = head;
+	any = true;
+      }
+      return any;
+    }
+
+    void ShmNetworkImpl::polling_loop(void)
+    {
+      RankInfo& me = header->ranks[my_node_id];
+      int idle_count = 0;
+      while(!shutdown_flag) {
+	if(poll_rings()) {
+	  idle_count = 0;
+	  continue;
+	}
+
+	// spin politely for a little while before going to sleep
+	if(++idle_count < 100) {
+	  sched_yield();
+	  continue;
+	}
+
+	// tell senders we want a doorbell, then check once more before
+	//  waiting (the timeout lets us notice shutdown)
+	int bell = me.doorbell;
+	me.sleeping = 1;
+	__sync_synchronize();
+	if(!poll_rings())
+	  futex_wait(&me.doorbell, bell, 10000000 /*10ms*/);
+	me.sleeping = 0;
+	idle_count = 0;
+      }
+
+      // pick up anything that snuck in before shutdown
+      while(poll_rings()) {}
+    }
+
+    void ShmNetworkImpl::barrier(void)
+    {
+      int gen = header->barrier_generation;
+      __sync_synchronize();
+      int arrived = __sync_add_and_fetch(&header->barrier_count, 1);
+      if(arrived == header->num_ranks) {
+	header->barrier_count = 0;
+	__sync_synchronize();
+	__sync_fetch_and_add(&header->barrier_generation, 1);
+	futex_wake(&header->barrier_generation);
+      } else {
+	while(header->barrier_generation == gen)
+	  futex_wait(&header->barrier_generation, gen, 1000000 /*1ms*/);
+      }
+      __sync_synchronize();
+    }
+
+    ////////////////////////////////////////////////////////////////////////
+    //
+    // entry points
+    //
+
+    bool init(int *argc, char ***argv)
+    {
+      const char *e = getenv("REALM_SHM_RANKS");
+      if(!e) return false;
+      int num_ranks = atoi(e);
+      if(num_ranks <= 1) return false;
+      if(num_ranks > MAX_RANKS) {
+	fprintf(stderr, "ERROR: REALM_SHM_RANKS=%d exceeds maximum of %d\n",
+		num_ranks, MAX_RANKS);
+	exit(1);
+      }
+
+      size_t ring_size = 4 << 20;
+      e = getenv("REALM_SHM_RING_MB");
+      if(e)
+	ring_size = ((size_t)atoi(e)) << 20;
+      assert(ring_size > 0);
+
+      // the rings live in an anonymous shared mapping created before the
+      //  fork, so every rank sees it and it disappears with the last of them
+      size_t mapping_size = (round_up(sizeof(SharedHeader), 4096) +
+			     ((num_ranks * num_ranks) *
+			      (sizeof(RingHeader) + ring_size)));
+      void *mapping = mmap(0, mapping_size, PROT_READ | PROT_WRITE,
+			   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+      if(mapping == MAP_FAILED) {
+	fprintf(stderr, "ERROR: could not map %zd bytes of shared memory: %s\n",
+		mapping_size, strerror(errno));
+	exit(1);
+      }
+
+      impl = new ShmNetworkImpl(mapping, mapping_size);
+      impl->header->num_ranks = num_ranks;
+      impl->header->root_pid = getpid();
+      impl->header->ring_size = ring_size;
+
+      // don't let buffered output get duplicated in the children
+      fflush(stdout);
+      fflush(stderr);
+
+      NodeID rank = 0;
+      for(NodeID i = 1; i < num_ranks; i++) {
+	pid_t pid = fork();
+	if(pid < 0) {
+	  fprintf(stderr, "ERROR: fork failed: %s\n", strerror(errno));
+	  exit(1);
+	}
+	if(pid == 0) {
+	  rank = i;
+	  impl->child_pids.clear();
+#ifdef __linux__
+	  // don't outlive rank 0 if it goes down
+	  prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+	  break;
+	}
+	impl->child_pids.push_back(pid);
+      }
+
+      my_node_id = rank;
+      max_node_id = num_ranks - 1;
+
+      impl->send_locks.resize(num_ranks);
+      for(NodeID i = 0; i < num_ranks; i++)
+	impl->send_locks[i] = new GASNetHSL;
+
+      return true;
+    }
+
+    bool enabled(void)
+    {
+      return (impl != 0);
+    }
+
+    void create_segments(size_t local_segment_size, CoreReservationSet& crs)
+    {
+      assert(impl != 0);
+      SharedHeader *header = impl->header;
+      int num_ranks = header->num_ranks;
+
+      impl->core_rsrv = new CoreReservation("shm network", crs,
+					    CoreReservationParameters());
+
+      // each rank puts its registered memory in a named POSIX shm object
+      //  that the others map once everybody has created theirs
+      char name[64];
+      snprintf(name, sizeof(name), "/realm_shm.%d.%d",
+	       (int)(header->root_pid), my_node_id);
+      size_t seg_size = round_up(local_segment_size, 4096);
+      char *seg_base = 0;
+      if(seg_size > 0) {
+	int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+	if(fd < 0) {
+	  log_shm.fatal() << "shm_open(" << name << ") failed: " << strerror(errno);
+	  assert(0);
+	}
+	int ret = ftruncate(fd, seg_size);
+	if(ret < 0) {
+	  log_shm.fatal() << "ftruncate(" << name << ", " << seg_size << ") failed: " << strerror(errno);
+	  assert(0);
+	}
+	void *ptr = mmap(0, seg_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	assert(ptr != MAP_FAILED);
+	close(fd);
+	seg_base = static_cast<char *>(ptr);
+      }
+      header->ranks[my_node_id].segment_base = reinterpret_cast<uintptr_t>(seg_base);
+      header->ranks[my_node_id].segment_size = seg_size;
+
+      impl->barrier();
+
+      impl->segment_aliases.resize(num_ranks, 0);
+      for(NodeID i = 0; i < num_ranks; i++) {
+	if(i == my_node_id) {
+	  impl->segment_aliases[i] = seg_base;
+	  continue;
+	}
+	size_t size = header->ranks[i].segment_size;
+	if(size == 0) continue;
+	char peer_name[64];
+	snprintf(peer_name, sizeof(peer_name), "/realm_shm.%d.%d",
+		 (int)(header->root_pid), i);
+	int fd = shm_open(peer_name, O_RDWR, 0600);
+	if(fd < 0) {
+	  log_shm.fatal() << "shm_open(" << peer_name << ") failed: " << strerror(errno);
+	  assert(0);
+	}
+	void *ptr = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	assert(ptr != MAP_FAILED);
+	close(fd);
+	impl->segment_aliases[i] = static_cast<char *>(ptr);
+      }
+
+      // once everybody has mapped everything, the names can go away
+      impl->barrier();
+      if(seg_size > 0)
+	shm_unlink(name);
+
+      log_shm.info() << "shm network ready: rank=" << my_node_id << "/" << num_ranks
+		     << " segment=" << seg_size << " ring=" << header->ring_size;
+    }
+
+    void *local_segment_base(void)
+    {
+      assert(impl != 0);
+      return impl->segment_aliases[my_node_id];
+    }
+
+    void start_polling_threads(int count)
+    {
+      // the rings are single-consumer, so one poller is all we can use, and
+      //  it can't start until there are handler threads to hand messages
+      //  to - see start_handler_threads
+      assert(impl != 0);
+    }
+
+    void start_handler_threads(int count, size_t stack_size)
+    {
+      assert(impl != 0);
+      if(count < 1) count = 1;
+
+      ThreadLaunchParameters tlp;
+      tlp.set_stack_size(stack_size);
+
+      for(int i = 0; i < count; i++) {
+	HandlerQueue *hq = new HandlerQueue;
+	hq->thread = Thread::create_kernel_thread<HandlerQueue,
+						  &HandlerQueue::handler_loop>(hq,
+									       tlp,
+									       *(impl->core_rsrv));
+	impl->handler_queues.push_back(hq);
+      }
+
+      impl->polling_threads.push_back(Thread::create_kernel_thread<ShmNetworkImpl,
+				                                   &ShmNetworkImpl::polling_loop>(impl,
+												  ThreadLaunchParameters(),
+												  *(impl->core_rsrv)));
+    }
+
+    void stop_threads(void)
+    {
+      assert(impl != 0);
+
+      impl->shutdown_flag = true;
+      RankInfo& me = impl->header->ranks[my_node_id];
+      __sync_fetch_and_add(&me.doorbell, 1);
+      futex_wake(&me.doorbell);
+      for(std::vector<Thread *>::iterator it = impl->polling_threads.begin();
+	  it != impl->polling_threads.end();
+	  ++it) {
+	(*it)->join();
+	delete (*it);
+      }
+      impl->polling_threads.clear();
+
+      for(std::vector<HandlerQueue *>::iterator it = impl->handler_queues.begin();
+	  it != impl->handler_queues.end();
+	  ++it) {
+	(*it)->shutdown();
+	delete (*it);
+      }
+      impl->handler_queues.clear();
+    }
+
+    size_t max_payload_size(void)
+    {
+      assert(impl != 0);
+      // leave room for the header and args
+      return (impl->header->ring_size / 2) - 128;
+    }
+
+    void send(NodeID target, int msgid, bool has_payload,
+	      const void *args, size_t arg_size,
+	      const SpanList& spans, size_t payload_size,
+	      void *dstptr)
+    {
+      assert(impl != 0);
+      impl->send(target, msgid, has_payload, args, arg_size,
+		 spans, payload_size, dstptr);
+    }
+
+    void add_handler(int msgid, void (*fnptr)())
+    {
+      // handlers are registered after init, and only matter if we're enabled
+      assert((msgid >= 0) && (msgid < 256));
+      if(impl)
+	impl->handlers[msgid] = fnptr;
+    }
+
+    NodeID get_message_source(token_t token)
+    {
+      return static_cast<ShmToken *>(token)->source;
+    }
+
+    void enqueue_incoming(NodeID sender, IncomingMessage *msg)
+    {
+      assert(impl != 0);
+      assert(!impl->handler_queues.empty());
+      impl->handler_queues[sender % impl->handler_queues.size()]->add(msg);
+    }
+
+    void release_payload(NodeID sender, const void *ptr)
+    {
+      assert(impl != 0);
+      // direct payloads live in our segment and are not ours to free
+      const char *seg_base = impl->segment_aliases[my_node_id];
+      if(seg_base &&
+	 (static_cast<const char *>(ptr) >= seg_base) &&
+	 (static_cast<const char *>(ptr) < (seg_base + impl->header->ranks[my_node_id].segment_size)))
+	return;
+      free(const_cast<void *>(ptr));
+    }
+
+    void get(NodeID node, void *dst, const void *remote_src, size_t bytes)
+    {
+      assert(impl != 0);
+      memcpy(dst, impl->translate(node, remote_src, bytes), bytes);
+    }
+
+    void barrier(void)
+    {
+      assert(impl != 0);
+      impl->barrier();
+    }
+
+    void gather(NodeID root, void *dst, const void *src, size_t bytes)
+    {
+      assert(impl != 0);
+      assert(bytes <= COLL_SLOT_SIZE);
+      SharedHeader *header = impl->header;
+      memcpy(header->ranks[my_node_id].coll_slot, src, bytes);
+      impl->barrier();
+      if(my_node_id == root)
+	for(NodeID i = 0; i < header->num_ranks; i++)
+	  memcpy(static_cast<char *>(dst) + (i * bytes),
+		 header->ranks[i].coll_slot, bytes);
+      // nobody can reuse the slots until the root has read them
+      impl->barrier();
+    }
+
+    void broadcast(NodeID root, void *dst, const void *src, size_t bytes)
+    {
+      assert(impl != 0);
+      assert(bytes <= COLL_SLOT_SIZE);
+      SharedHeader *header = impl->header;
+      if(my_node_id == root)
+	memcpy(header->ranks[root].coll_slot, src, bytes);
+      impl->barrier();
+      memmove(dst, header->ranks[root].coll_slot, bytes);
+      impl->barrier();
+    }
+
+    int finalize(void)
+    {
+      if(!impl) return 0;
+
+      for(size_t i = 0; i < impl->segment_aliases.size(); i++)
+	if(impl->segment_aliases[i])
+	  munmap(impl->segment_aliases[i], impl->header->ranks[i].segment_size);
+
+      // rank 0 doesn't exit until everybody else has
+      int result = 0;
+      for(std::vector<pid_t>::const_iterator it = impl->child_pids.begin();
+	  it != impl->child_pids.end();
+	  ++it) {
+	int status;
+	pid_t ret;
+	do {
+	  ret = waitpid(*it, &status, 0);
+	} while((ret < 0) && (errno == EINTR));
+	if(ret < 0) continue;
+	int code = (WIFEXITED(status) ? WEXITSTATUS(status) :
+		                         (128 + WTERMSIG(status)));
+	if(code != 0) {
+	  log_shm.error() << "rank process " << *it << " exited with code " << code;
+	  if(result == 0)
+	    result = code;
+	}
+      }
+
+      for(size_t i = 0; i < impl->send_locks.size(); i++)
+	delete impl->send_locks[i];
+      munmap(impl->mapping, impl->mapping_size);
+      delete impl;
+      impl = 0;
+
+      return result;
+    }
+
+  }; // namespace ShmNetwork
+
+}; // namespace Realm
@@ -0,0 +1,94 @@
+/* Copyright 2018 Stanford University, NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// shared-memory network for Realm builds without GASNet
+//
+// setting REALM_SHM_RANKS=<n> (n > 1) in the environment makes Realm fork
+//  itself into n processes on the same host during network initialization,
+//  each of which acts as a separate node - active messages travel through
+//  lock-free single-producer/single-consumer rings in a shared mapping, and
+//  registered memory lives in per-node POSIX shared memory segments so that
+//  "RDMA" puts and gets are just memcpy's
+//
+// other environment knobs:
+//   REALM_SHM_RING_MB - size of each (sender, receiver) ring (default 4)
+
+#ifndef REALM_SHM_NETWORK_H
+#define REALM_SHM_NETWORK_H
+
+#include "realm/activemsg.h"
+
+namespace Realm {
+
+  class CoreReservationSet;
+
+  namespace ShmNetwork {
+
+    // called at the very start of network initialization (before any
+    //  threads exist) - forks the requested number of ranks and sets
+    //  my_node_id/max_node_id, returning true if the shm network is in use
+    bool init(int *argc, char ***argv);
+
+    bool enabled(void);
+
+    // called from init_endpoints - creates this node's shared segment
+    //  (which may be empty), maps everybody else's, and reserves cores for
+    //  the network's threads
+    void create_segments(size_t local_segment_size, CoreReservationSet& crs);
+
+    // base of this node's segment (null if it was empty)
+    void *local_segment_base(void);
+
+    // the (single) polling thread isn't actually started until the handler
+    //  threads exist, since it has nowhere to put messages before that
+    void start_polling_threads(int count);
+    void start_handler_threads(int count, size_t stack_size);
+    void stop_threads(void);
+
+    // largest payload that can go through a ring (payloads bound for a
+    //  registered destination pointer are not limited)
+    size_t max_payload_size(void);
+
+    // sends an active message - the payload is gathered from 'spans' and
+    //  either copied into the ring or, if 'dstptr' is non-null, written
+    //  directly to that address in the target's segment
+    void send(NodeID target, int msgid, bool has_payload,
+	      const void *args, size_t arg_size,
+	      const SpanList& spans, size_t payload_size,
+	      void *dstptr);
+
+    // handler-side hooks for activemsg.cc
+    void add_handler(int msgid, void (*fnptr)());
+    NodeID get_message_source(token_t token);
+    void enqueue_incoming(NodeID sender, IncomingMessage *msg);
+    void release_payload(NodeID sender, const void *ptr);
+
+    // reads from another node's segment
+    void get(NodeID node, void *dst, const void *remote_src, size_t bytes);
+
+    // collectives - every rank must call these in the same order
+    void barrier(void);
+    void gather(NodeID root, void *dst, const void *src, size_t bytes);
+    void broadcast(NodeID root, void *dst, const void *src, size_t bytes);
+
+    // called at the end of shutdown - rank 0 waits for the other ranks
+    //  and returns the first non-zero exit code it sees
+    int finalize(void);
+
+  }; // namespace ShmNetwork
+
+}; // namespace Realm
+
+#endif
@@ -112,10 +112,30 @@ namespace Realm {
 
     const std::vector<Rect<N,T> >& get_approx_rects(void);
 
+    // returns the index of the first entry at or after 'start' whose bounds overlap
+    //  'r', or entries.size() if there is no such entry - for multi-dimensional maps
+    //  with many entries, this uses a spatial index that is built on first use
+    size_t find_overlapping_entry(const Rect<N,T>& r, size_t start = 0);
+
   protected:
+    // builds the spatial index (if it hasn't been already) - the index is a packed
+    //  bounding volume hierarchy over the entries in their stored order: level 0
+    //  holds the bounds of each group of INDEX_FANOUT consecutive entries, level 1
+    //  the bounds of each group of INDEX_FANOUT level 0 nodes, and so on
+    void build_index(void);
+
+    static const size_t INDEX_FANOUT = 16;
+    // maps with fewer entries than this are just scanned
+    static const size_t INDEX_MIN_ENTRIES = 64;
+
     bool entries_valid, approx_valid;
     std::vector<SparsityMapEntry<N,T> > entries;
     std::vector<Rect<N,T> > approx_rects;
+
+    // set (after a memory barrier) once the index below is complete and immutable
+    volatile bool index_valid;
+    std::vector<Rect<N,T> > index_bounds;    // all levels, lowest level first
+    std::vector<size_t> index_level_starts;  // offset of each level in index_bounds
   };
 
 }; // namespace Realm
@@ -83,6 +83,51 @@ namespace Realm {
     return approx_rects;
   }
 
+  template <int N, typename T>
+  inline size_t SparsityMapPublicImpl<N,T>::find_overlapping_entry(const Rect<N,T>& r,
+								    size_t start /*= 0*/)
+  {
+    const std::vector<SparsityMapEntry<N,T> >& entries = get_entries();
+    size_t count = entries.size();
+
+    if((N > 1) && (count >= INDEX_MIN_ENTRIES)) {
+      if(!index_valid)
+	build_index();
+
+      size_t idx = start;
+      while(idx < count) {
+	// work down from the top of the hierarchy (the single root node is skipped),
+	//  looking for the largest node containing 'idx' that does not overlap 'r' -
+	//  if there is one, none of the entries it covers can match
+	int levels = index_level_starts.size();
+	size_t span = INDEX_FANOUT;  // number of entries covered by a node
+	for(int level = 1; level < (levels - 1); level++)
+	  span *= INDEX_FANOUT;
+	size_t skip_to = idx;
+	for(int level = levels - 2; level >= 0; level--, span /= INDEX_FANOUT) {
+	  size_t node = idx / span;
+	  if(!index_bounds[index_level_starts[level] + node].overlaps(r)) {
+	    skip_to = (node + 1) * span;
+	    break;
+	  }
+	}
+	if(skip_to > idx) {
+	  idx = skip_to;
+	  continue;
+	}
+	if(entries[idx].bounds.overlaps(r))
+	  return idx;
+	idx++;
+      }
+      return count;
+    }
+
+    for(size_t idx = start; idx < count; idx++)
+      if(entries[idx].bounds.overlaps(r))
+	return idx;
+    return count;
+  }
+
 
 }; // namespace Realm
 
@@ -19,11 +19,17 @@
 
 #include "realm/runtime_impl.h"
 
+#include <algorithm>
+
 namespace Realm {
 
   Logger log_task("task");
   Logger log_sched("sched");
 
+  namespace Config {
+    int task_steal_batch = 0;
+  };
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class Task
@@ -321,6 +327,7 @@ namespace Realm {
     , cfg_max_idle_workers(1)
     , cfg_min_active_workers(1)
     , cfg_max_active_workers(1)
+    , cfg_steal_batch(Config::task_steal_batch)
   {
     // hook up the work counter updates for the resumable worker queue
     resumable_workers.add_subscription(&wcu_resume_queue);
@@ -332,6 +339,7 @@ namespace Realm {
     assert(active_worker_count == 0);
     assert(unassigned_worker_count == 0);
     assert(idle_workers.empty());
+    assert(worker_deques.empty());
   }
 
   void ThreadedTaskScheduler::add_task_queue(TaskQueue *queue)
@@ -531,6 +539,11 @@ namespace Realm {
 
       // we're a new, and initially unassigned, worker - counters have already been updated
 
+      // in work-stealing mode, we get our own deque of ready tasks
+      WorkerDeque *my_deque = ((cfg_steal_batch > 0) ?
+			         create_worker_deque() :
+			         0);
+
       while(true) {
 	// remember the work counter value before we start so that we don't iterate
 	//   unnecessarily
@@ -551,6 +564,13 @@ namespace Realm {
 	Task *task = 0;
 	TaskQueue *task_source = 0;
 	int task_priority = resumable_priority;
+
+	// anything left in our own deque is the first candidate (a null
+	//  task_source means that's where it came from)
+	if(my_deque && (my_deque->priority > resumable_priority))
+	  if(my_deque->deque.pop(task))
+	    task_priority = my_deque->priority;
+
 	for(std::vector<TaskQueue *>::const_iterator it = task_queues.begin();
 	    it != task_queues.end();
 	    it++) {
@@ -558,8 +578,18 @@ namespace Realm {
 	  Task *new_task = (*it)->get(&new_priority, task_priority);
 	  if(new_task) {
 	    // if we got something better, put back the old thing (if any)
-	    if(task)
-	      task_source->put(task, task_priority, false); // back on front of list
+	    if(task) {
+	      if(task_source)
+		task_source->put(task, task_priority, false); // back on front of list
+	      else {
+		// we just popped it, so there's room for it
+#ifndef NDEBUG
+		bool ok =
+#endif
+		  my_deque->deque.push(task);
+		assert(ok);
+	      }
+	    }
 	  
 	    task = new_task;
 	    task_source = *it;
@@ -567,6 +597,24 @@ namespace Realm {
 	  }
 	}
 
+	if(my_deque) {
+	  if(task) {
+	    // grab a batch of similar tasks from our own processor's queue
+	    //  so that we can run them without coming back here
+	    if(task_source == task_queues[0]) {
+	      fill_worker_deque(my_deque, task_source, task_priority);
+	      // filling may have nudged the work counter for the benefit of
+	      //  other workers - that's not a reason for us to come back
+	      old_work_counter = work_counter.read_counter();
+	    }
+	  } else {
+	    // nothing in the queues - see if another worker has something
+	    //  we can take off their hands
+	    task_priority = resumable_priority;
+	    task = steal_from_worker_deques(my_deque, task_priority);
+	  }
+	}
+
 	// did we find work to do?
 	if(task) {
 	  // we've now got some assigned work, so fire up a new idle worker if we were the last
@@ -593,6 +641,20 @@ namespace Realm {
 	    execute_task(task);
 	  assert(ok);  // no fault recovery yet
 
+	  // in work-stealing mode, keep running tasks from our deque without
+	  //  the lock for as long as nothing has shown up that might be
+	  //  more important (any such arrival bumps the work counter)
+	  if(my_deque && cfg_reuse_workers)
+	    while((my_deque->priority == task_priority) &&
+		  (work_counter.read_counter() == old_work_counter) &&
+		  my_deque->deque.pop(task)) {
+#ifndef NDEBUG
+	      bool ok =
+#endif
+		execute_task(task);
+	      assert(ok);  // no fault recovery yet
+	    }
+
 	  lock.lock();
 
 	  worker_priorities.erase(Thread::self());
@@ -604,6 +666,8 @@ namespace Realm {
 	  if(cfg_reuse_workers) continue;
 
 	  // if not, terminate
+	  if(my_deque)
+	    destroy_worker_deque(my_deque);
 	  break;
 	}
 
@@ -635,11 +699,15 @@ namespace Realm {
 	      Thread *to_wake = idle_workers.back();
 	      idle_workers.pop_back();
 	      // no net change in worker counts
+	      if(my_deque)
+	        destroy_worker_deque(my_deque);
 	      worker_terminate(to_wake);
 	      break;
 	    } else {
 	      // nobody to wake, so -1 active/unassigned worker
 	      update_worker_count(-1, -1, false); // ok to drop below mins
+	      if(my_deque)
+	        destroy_worker_deque(my_deque);
 	      worker_terminate(0);
 	      break;
 	    }
@@ -656,6 +724,8 @@ namespace Realm {
 	      assert(to_wake != Thread::self());
 	      idle_workers.pop_back();
 	      // no net change in worker counts
+	      if(my_deque)
+	        destroy_worker_deque(my_deque);
 	      worker_terminate(to_wake);
 	      break;
 	    } else {
@@ -664,6 +734,8 @@ namespace Realm {
 	      if((unassigned_worker_count > 1) &&
 		 (active_worker_count > cfg_min_active_workers)) {
 		update_worker_count(-1, -1, false);
+		if(my_deque)
+		  destroy_worker_deque(my_deque);
 		worker_terminate(0);
 		break;
 	      } else {
@@ -697,6 +769,112 @@ namespace Realm {
     scheduler_loop();
   }
 
+  ThreadedTaskScheduler::WorkerDeque *ThreadedTaskScheduler::create_worker_deque(void)
+  {
+    // caller holds lock
+    WorkerDeque *wd = new WorkerDeque(cfg_steal_batch);
+    worker_deques.push_back(wd);
+    return wd;
+  }
+
+  void ThreadedTaskScheduler::destroy_worker_deque(WorkerDeque *wd)
+  {
+    // caller holds lock
+    std::vector<WorkerDeque *>::iterator it = std::find(worker_deques.begin(),
+							 worker_deques.end(),
+							 wd);
+    assert(it != worker_deques.end());
+    worker_deques.erase(it);
+
+    // a worker only gives up its deque once it's found it empty, but be
+    //  safe and return anything that's left to the processor's queue
+    Task *task;
+    while(wd->deque.pop(task))
+      task_queues[0]->put(task, wd->priority, false);
+
+    delete wd;
+  }
+
+  void ThreadedTaskScheduler::fill_worker_deque(WorkerDeque *wd,
+						TaskQueue *source,
+						int priority)
+  {
+    // caller holds lock
+
+    // only an empty deque can change priority - any stragglers being
+    //  stolen right now were taken before the last priority change
+    if(!wd->deque.empty_approx())
+      return;
+    wd->priority = priority;
+
+    // pull up to (batch - 1) more tasks of exactly this priority - the task
+    //  we're about to run counts as the first of the batch
+    std::vector<Task *> batch;
+    while((int)batch.size() < (cfg_steal_batch - 1)) {
+      int new_priority;
+      Task *task = source->get(&new_priority, priority - 1);
+      if(!task) break;
+      if(new_priority != priority) {
+	// something more important showed up - leave it (and everything
+	//  after it) for the regular scan
+	source->put(task, new_priority, false);
+	break;
+      }
+      batch.push_back(task);
+    }
+    if(batch.empty())
+      return;
+
+    // push in reverse so that the owner's pops (from the bottom) see them
+    //  in their original order
+    for(std::vector<Task *>::reverse_iterator it = batch.rbegin();
+	it != batch.rend();
+	++it) {
+#ifndef NDEBUG
+      bool ok =
+#endif
+	wd->deque.push(*it);
+      assert(ok);
+    }
+
+    log_sched.debug() << "worker deque filled: deque=" << (void *)wd
+		      << " count=" << batch.size() << " priority=" << priority;
+
+    // the tasks we just took are invisible to workers waiting on the task
+    //  queues, so give them a reason to look again and steal some
+    if(cfg_max_active_workers > 1)
+      work_counter.increment_counter();
+  }
+
+  Task *ThreadedTaskScheduler::steal_from_worker_deques(WorkerDeque *self,
+							int& priority)
+  {
+    // caller holds lock, so deque priorities are stable - try victims in
+    //  priority order, but only ones that beat the priority we were given
+    while(true) {
+      WorkerDeque *victim = 0;
+      for(std::vector<WorkerDeque *>::const_iterator it = worker_deques.begin();
+	  it != worker_deques.end();
+	  ++it)
+	if((*it != self) && ((*it)->priority > priority) &&
+	   !(*it)->deque.empty_approx() &&
+	   (!victim || ((*it)->priority > victim->priority)))
+	  victim = *it;
+      if(!victim)
+	return 0;
+
+      // the owner may beat us to the last entry, in which case we look
+      //  for another victim
+      Task *task;
+      if(victim->deque.steal(task)) {
+	log_sched.debug() << "task stolen: task=" << (void *)task
+			  << " from=" << (void *)victim << " to=" << (void *)self;
+	priority = victim->priority;
+	return task;
+      }
+    }
+  }
+
   void ThreadedTaskScheduler::wait_for_work(long long old_work_counter)
   {
     // try a check without letting go of our lock first
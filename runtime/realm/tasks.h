@@ -26,10 +26,17 @@
 
 #include "realm/threads.h"
 #include "realm/pri_queue.h"
+#include "realm/ws_deque.h"
 #include "realm/bytearray.h"
 
 namespace Realm {
 
+    namespace Config {
+      // if non-zero, task schedulers give each worker a work-stealing deque
+      //  and move up to this many same-priority ready tasks into it at a time
+      extern int task_steal_batch;
+    };
+
     // information for a task launch
     class Task : public Operation {
     public:
@@ -180,12 +187,31 @@ namespace Realm {
       WorkCounterUpdater<TaskQueue> wcu_task_queues;
       WorkCounterUpdater<ResumableQueue> wcu_resume_queue;
 
+      // in work-stealing mode, each worker has a deque of ready tasks (all of
+      //  the same priority) taken from the processor's own queue in one go -
+      //  the worker runs them without retaking the scheduler lock unless new
+      //  work shows up, and other workers (e.g. the one that takes over when
+      //  this one blocks) steal from the top
+      struct WorkerDeque {
+	WorkerDeque(size_t _capacity) : deque(_capacity), priority(0) {}
+	WorkStealingDeque<Task *> deque;
+	int priority;  // written only by the owner
+      };
+      std::vector<WorkerDeque *> worker_deques;
+
+      // helpers for the above - all called with the scheduler lock held
+      WorkerDeque *create_worker_deque(void);
+      void destroy_worker_deque(WorkerDeque *wd);
+      void fill_worker_deque(WorkerDeque *wd, TaskQueue *source, int priority);
+      Task *steal_from_worker_deques(WorkerDeque *self, int& priority);
+
     public:
       // various configurable settings
       bool cfg_reuse_workers;
       int cfg_max_idle_workers;
       int cfg_min_active_workers;
       int cfg_max_active_workers;
+      int cfg_steal_batch;  // 0 disables work stealing
     };
 
     inline long long ThreadedTaskScheduler::WorkCounter::read_counter(void) const
@@ -18,6 +18,9 @@
 #include "realm/transfer/channel_disk.h"
 #include "realm/transfer/transfer.h"
 
+#include <algorithm>
+#include <sched.h>
+
 TYPE_IS_SERIALIZABLE(Realm::XferOrder::Type);
 TYPE_IS_SERIALIZABLE(Realm::XferDes::XferKind);
 
@@ -1679,6 +1682,7 @@ namespace Realm {
 #ifdef USE_HDF_OLD
             hdf_mem = (HDF5Memory*) src_mem;
 #endif
+	    hdf5_mem = static_cast<HDF5::HDF5Memory *>(src_mem);
             //pthread_rwlock_rdlock(&hdf_mem->rwlock);
             // std::map<RegionInstance, HDFMetadata*>::iterator it;
             // it = hdf_mem->hdf_metadata.find(inst);
@@ -1697,6 +1701,7 @@ namespace Realm {
 #ifdef USE_HDF_OLD
             hdf_mem = (HDF5Memory*) dst_mem;
 #endif
+	    hdf5_mem = static_cast<HDF5::HDF5Memory *>(dst_mem);
             //pthread_rwlock_rdlock(&hdf_mem->rwlock);
             // std::map<RegionInstance, HDFMetadata*>::iterator it;
             // it = hdf_mem->hdf_metadata.find(inst);
@@ -1836,42 +1841,24 @@ namespace Realm {
 	  CHECK_HDF5( new_req->file_space_id = H5Screate_simple(hdf5_info.dset_bounds.size(), hdf5_info.dset_bounds.data(), 0) );
 	  CHECK_HDF5( H5Sselect_hyperslab(new_req->file_space_id, H5S_SELECT_SET, hdf5_info.offset.data(), 0, hdf5_info.extent.data(), 0) );
 #else
-	  HDFFileInfo *info;
-	  {
-	    std::map<std::string, HDFFileInfo *>::const_iterator it = file_infos.find(*hdf5_info.filename);
-	    if(it != file_infos.end()) {
-	      info = it->second;
-	    } else {
-	      info = new HDFFileInfo;
-	      // have to open the file
-	      CHECK_HDF5( info->file_id = H5Fopen(hdf5_info.filename->c_str(),
-						  ((kind == XferDes::XFER_HDF_READ) ?
-					             H5F_ACC_RDONLY :
-					             H5F_ACC_RDWR),
-						  H5P_DEFAULT) );
-	      log_hdf5.info() << "H5Fopen(\"" << *hdf5_info.filename << "\") = " << info->file_id;
-	      file_infos[*hdf5_info.filename] = info;
-	    }
-	  }
-	  hid_t dset_id;
+	  // files stay open (in the memory's cache) until the transfer is
+	  //  flushed, and datasets until the file is closed
+	  HDF5::HDF5Memory::OpenFile *file;
 	  {
-	    std::map<std::string, hid_t>::const_iterator it = info->dset_ids.find(*hdf5_info.dsetname);
-	    if(it != info->dset_ids.end()) {
-	      dset_id = it->second;
+	    std::map<std::string, HDF5::HDF5Memory::OpenFile *>::const_iterator it = open_files.find(*hdf5_info.filename);
+	    if(it != open_files.end()) {
+	      file = it->second;
 	    } else {
-	      // have to open the dataset
-	      CHECK_HDF5( dset_id = H5Dopen2(info->file_id,
-					     hdf5_info.dsetname->c_str(),
-					     H5P_DEFAULT) );
-	      log_hdf5.info() << "H5Dopen2(" << info->file_id << ", \"" << *hdf5_info.dsetname << "\") = " << dset_id;
-	      info->dset_ids[*hdf5_info.dsetname] = dset_id;
+	      file = hdf5_mem->acquire_file(*hdf5_info.filename,
+					    (kind == XferDes::XFER_HDF_READ));
+	      open_files[*hdf5_info.filename] = file;
 	    }
 	  }
-	  hid_t dtype_id;
-	  CHECK_HDF5( dtype_id = H5Dget_type(dset_id) );
+	  HDF5::HDF5Memory::OpenDataset dset = hdf5_mem->get_dataset(file,
+								     *hdf5_info.dsetname);
 
-	  new_req->dataset_id = dset_id;
-	  new_req->datatype_id = dtype_id;
+	  new_req->dataset_id = dset.dset_id;
+	  new_req->datatype_id = dset.dtype_id;
 
 	  std::vector<hsize_t> mem_dims = hdf5_info.extent;
 	  CHECK_HDF5( new_req->mem_space_id = H5Screate_simple(mem_dims.size(), mem_dims.data(), NULL) );
@@ -2033,19 +2020,16 @@ namespace Realm {
           // }
         }
 
-	for(std::map<std::string, HDFFileInfo *>::const_iterator it = file_infos.begin();
-	    it != file_infos.end();
+	for(std::map<std::string, HDF5::HDF5Memory::OpenFile *>::const_iterator it = open_files.begin();
+	    it != open_files.end();
 	    ++it) {
-	  for(std::map<std::string, hid_t>::const_iterator it2 = it->second->dset_ids.begin();
-	      it2 != it->second->dset_ids.end();
-	      ++it2) {
-	    log_hdf5.info() << "H5Dclose(" << it2->second << " /* \"" << it2->first << "\" */)";
-	    CHECK_HDF5( H5Dclose(it2->second) );
-	  }
-	  log_hdf5.info() << "H5Fclose(" << it->second->file_id << " /* \"" << it->first << "\" */)";
-	  CHECK_HDF5( H5Fclose(it->second->file_id) );
-	  delete it->second;
+	  // the handle may stay open in the cache, so make sure anything we
+	  //  wrote actually makes it to the file
+	  if(kind == XferDes::XFER_HDF_WRITE)
+	    CHECK_HDF5( H5Fflush(it->second->file_id, H5F_SCOPE_LOCAL) );
+	  hdf5_mem->release_file(it->second);
 	}
+	open_files.clear();
       }
 #endif
 
@@ -2229,31 +2213,30 @@ namespace Realm {
 
       void MemcpyThread::thread_loop()
       {
-        while (!channel->is_stopped) {
-          channel->get_request(thread_queue);
-          if (channel->is_stopped)
-            break;
-          std::deque<MemcpyRequest*>::const_iterator it;
-          for (it = thread_queue.begin(); it != thread_queue.end(); it++) {
-            MemcpyRequest* req = *it;
-            //double starttime = Realm::Clock::current_time_in_microseconds();
-            if (req->dim == Request::DIM_1D) {
-              memcpy(req->dst_base, req->src_base, req->nbytes);
-            } else {
-              assert(req->dim == Request::DIM_2D);
-              const char *src = (const char *)(req->src_base);
-	      char *dst = (char *)(req->dst_base);
+        MemcpyRequest* reqs[MAX_BATCH];
+        while (true) {
+          size_t nr = channel->get_requests(reqs, MAX_BATCH);
+          if (nr == 0)
+            break;  // channel was stopped
+          for (size_t r = 0; r < nr; r++) {
+            MemcpyRequest* req = reqs[r];
+            // only plain copies are given to memcpy threads, so we just
+            //  need to walk the planes and lines
+            const char *src_p = (const char *)(req->src_base);
+            char *dst_p = (char *)(req->dst_base);
+            for (size_t j = 0; j < req->nplanes; j++) {
+              const char *src = src_p;
+              char *dst = dst_p;
               for (size_t i = 0; i < req->nlines; i++) {
                 memcpy(dst, src, req->nbytes);
                 src += req->src_str;
                 dst += req->dst_str;
               }
+              src_p += req->src_pstr;
+              dst_p += req->dst_pstr;
             }
-            //double stoptime = Realm::Clock::current_time_in_microseconds();
-            //fprintf(stderr, "t = %.2lfus, tp = %.2lfMB/s\n", stoptime - starttime, (req->nbytes / (stoptime - starttime)));
           }
-          channel->return_request(thread_queue);
-          thread_queue.clear();
+          channel->return_requests(reqs, nr);
         }
       }
 
@@ -2269,14 +2252,15 @@ namespace Realm {
 
       MemcpyChannel::MemcpyChannel(long max_nr)
 	: Channel(XferDes::XFER_MEM_CPY)
+	, pending_queue(max_nr), finished_queue(max_nr)
       {
         capacity = max_nr;
         is_stopped = false;
-        sleep_threads = false;
-        pthread_mutex_init(&pending_lock, NULL);
-        pthread_mutex_init(&finished_lock, NULL);
-        pthread_cond_init(&pending_cond, NULL);
-        //cbs = (MemcpyRequest**) calloc(max_nr, sizeof(MemcpyRequest*));
+        num_threads = 0;
+        sleeping_threads = 0;
+        in_flight = 0;
+        pthread_mutex_init(&sleep_lock, NULL);
+        pthread_cond_init(&sleep_cond, NULL);
 	unsigned bw = 0; // TODO
 	unsigned latency = 0;
 	// any combination of SYSTEM/REGDMA/Z_COPY_MEM
@@ -2285,14 +2269,25 @@ namespace Realm {
 	    add_path(cpu_mem_kinds[i], false,
 		     cpu_mem_kinds[j], false,
 		     bw, latency, true, true);
+	// mapped disk/file memories can be copied to/from directly (this
+	//  channel is checked before the disk and file channels)
+	if(Config::use_file_mmap)
+	  for(size_t i = 0; i < num_cpu_mem_kinds; i++) {
+	    add_path(Memory::DISK_MEM, false, cpu_mem_kinds[i], false,
+		     bw, latency, false, false);
+	    add_path(cpu_mem_kinds[i], false, Memory::DISK_MEM, false,
+		     bw, latency, false, false);
+	    add_path(Memory::FILE_MEM, false, cpu_mem_kinds[i], false,
+		     bw, latency, false, false);
+	    add_path(cpu_mem_kinds[i], false, Memory::FILE_MEM, false,
+		     bw, latency, false, false);
+	  }
       }
 
       MemcpyChannel::~MemcpyChannel()
       {
-        pthread_mutex_destroy(&pending_lock);
-        pthread_mutex_destroy(&finished_lock);
-        pthread_cond_destroy(&pending_cond);
-        //free(cbs);
+        pthread_mutex_destroy(&sleep_lock);
+        pthread_cond_destroy(&sleep_cond);
       }
 
       bool MemcpyChannel::supports_path(Memory src_mem, Memory dst_mem,
@@ -2316,42 +2311,95 @@ namespace Realm {
 
       void MemcpyChannel::stop()
       {
-        pthread_mutex_lock(&pending_lock);
+        pthread_mutex_lock(&sleep_lock);
         if (!is_stopped)
-          pthread_cond_broadcast(&pending_cond);
+          pthread_cond_broadcast(&sleep_cond);
         is_stopped = true;
-        pthread_mutex_unlock(&pending_lock);
+        pthread_mutex_unlock(&sleep_lock);
       }
 
-      void MemcpyChannel::get_request(std::deque<MemcpyRequest*>& thread_queue)
+      size_t MemcpyChannel::get_requests(MemcpyRequest** reqs, size_t max_reqs)
       {
-        pthread_mutex_lock(&pending_lock);
-        while (pending_queue.empty() && !is_stopped) {
-          sleep_threads = true;
-          pthread_cond_wait(&pending_cond, &pending_lock);
+        // spin for a while first - under load, more work usually shows up
+        //  sooner than it would take to sleep and be woken up again
+        const int SPIN_ITERS = 1000;
+        const int YIELD_ITERS = 16;
+        while (true) {
+          for (int i = 0; i < SPIN_ITERS + YIELD_ITERS; i++) {
+            if (is_stopped)
+              return 0;
+            size_t nr = pending_queue.pop_batch(reqs, max_reqs);
+            if (nr > 0)
+              return nr;
+            if (i >= SPIN_ITERS)
+              sched_yield();
+          }
+          // still nothing - go to sleep, after registering ourselves as a
+          //  sleeper and checking one more time (submit() checks for sleepers
+          //  after pushing, so one of us will see the other)
+          pthread_mutex_lock(&sleep_lock);
+          __sync_fetch_and_add(&sleeping_threads, 1);
+          size_t nr = pending_queue.pop_batch(reqs, max_reqs);
+          if ((nr == 0) && !is_stopped)
+            pthread_cond_wait(&sleep_cond, &sleep_lock);
+          __sync_fetch_and_sub(&sleeping_threads, 1);
+          pthread_mutex_unlock(&sleep_lock);
+          if (nr > 0)
+            return nr;
         }
-        if (!is_stopped) {
-          // TODO: enable the following optimization
-          //thread_queue.insert(thread_queue.end(), pending_queue.begin(), pending_queue.end());
-          thread_queue.push_back(pending_queue.front());
-          pending_queue.pop_front();
-          //fprintf(stderr, "[%d] thread_queue.size = %lu\n", gettid(), thread_queue.size());
-          //pending_queue.clear();
+      }
+
+      void MemcpyChannel::return_requests(MemcpyRequest** reqs, size_t nr)
+      {
+        // the finished queue can hold every in-flight request, so this can
+        //  only come up short if pull() is racing with us on a full queue
+        while (nr > 0) {
+          size_t pushed = finished_queue.push_batch(reqs, nr);
+          reqs += pushed;
+          nr -= pushed;
+          if (nr > 0)
+            sched_yield();
         }
-        pthread_mutex_unlock(&pending_lock);
       }
 
-      void MemcpyChannel::return_request(std::deque<MemcpyRequest*>& thread_queue)
+      static bool is_plain_memcpy_request(const MemcpyRequest* req)
       {
-        pthread_mutex_lock(&finished_lock);
-        finished_queue.insert(finished_queue.end(), thread_queue.begin(), thread_queue.end());
-        pthread_mutex_unlock(&finished_lock);
+        return (!req->xd->src_serdez_op && !req->xd->dst_serdez_op);
+      }
+
+      long MemcpyChannel::enqueue_requests(MemcpyRequest** reqs, long nr)
+      {
+        // serdez copies have to be done in order by the DMA thread, so move
+        //  the plain copies to the front and hand those off
+        MemcpyRequest** plain_end = std::partition(reqs, reqs + nr,
+                                                   is_plain_memcpy_request);
+        long nr_plain = plain_end - reqs;
+        if (nr_plain == 0)
+          return 0;
+        long queued = pending_queue.push_batch(reqs, nr_plain);
+        if (queued == 0)
+          return 0;
+        __sync_fetch_and_add(&in_flight, queued);
+        // push_batch ends with a barrier, so if a memcpy thread is about to
+        //  sleep, either it sees our requests or we see it
+        __sync_synchronize();
+        if (sleeping_threads > 0) {
+          pthread_mutex_lock(&sleep_lock);
+          pthread_cond_broadcast(&sleep_cond);
+          pthread_mutex_unlock(&sleep_lock);
+        }
+        return queued;
       }
 
       long MemcpyChannel::submit(Request** requests, long nr)
       {
         MemcpyRequest** mem_cpy_reqs = (MemcpyRequest**) requests;
-        for (long i = 0; i < nr; i++) {
+        // if we have memcpy threads, they get whatever they can take and
+        //  we do the rest here
+        long first_inline = 0;
+        if (num_threads > 0)
+          first_inline = enqueue_requests(mem_cpy_reqs, nr);
+        for (long i = first_inline; i < nr; i++) {
           MemcpyRequest* req = mem_cpy_reqs[i];
 	  // handle 1-D, 2-D, and 3-D in a single loop
 	  switch(req->dim) {
@@ -2777,57 +2825,30 @@ namespace Realm {
           req->xd->notify_request_write_done(req);
         }
         return nr;
-        /*
-        pthread_mutex_lock(&pending_lock);
-        //if (nr > 0)
-          //printf("MemcpyChannel::submit[nr = %ld]\n", nr);
-        for (long i = 0; i < nr; i++) {
-          pending_queue.push_back(mem_cpy_reqs[i]);
-        }
-        if (sleep_threads) {
-          pthread_cond_broadcast(&pending_cond);
-          sleep_threads = false;
-        }
-        pthread_mutex_unlock(&pending_lock);
-        return nr;
-        */
-        /*
-        for (int i = 0; i < nr; i++) {
-          push_request(mem_cpy_reqs[i]);
-          memcpy(mem_cpy_reqs[i]->dst_buf, mem_cpy_reqs[i]->src_buf, mem_cpy_reqs[i]->nbytes);
-          mem_cpy_reqs[i]->xd->notify_request_read_done(mem_cpy_reqs[i]);
-          mem_cpy_reqs[i]->xd->notify_request_write_done(mem_cpy_reqs[i]);
-        }
-        return nr;
-        */
       }
 
       void MemcpyChannel::pull()
       {
-        pthread_mutex_lock(&finished_lock);
-        while (!finished_queue.empty()) {
-          MemcpyRequest* req = finished_queue.front();
-          finished_queue.pop_front();
-          req->xd->notify_request_read_done(req);
-          req->xd->notify_request_write_done(req);
-        }
-        pthread_mutex_unlock(&finished_lock);
-        /*
+        if (num_threads == 0)
+          return;
+        MemcpyRequest* reqs[MemcpyThread::MAX_BATCH];
         while (true) {
-          long np = worker->pull(cbs, capacity);
-          for (int i = 0; i < np; i++) {
-            cbs[i]->xd->notify_request_read_done(cbs[i]);
-            cbs[i]->xd->notify_request_write_done(cbs[i]);
-          }
-          if (np != capacity)
+          size_t nr = finished_queue.pop_batch(reqs, MemcpyThread::MAX_BATCH);
+          if (nr == 0)
             break;
+          for (size_t i = 0; i < nr; i++) {
+            reqs[i]->xd->notify_request_read_done(reqs[i]);
+            reqs[i]->xd->notify_request_write_done(reqs[i]);
+          }
+          __sync_fetch_and_sub(&in_flight, (long)nr);
         }
-        */
       }
 
       long MemcpyChannel::available()
       {
-        return capacity;
+        // requests done inline are finished by the time submit returns, so
+        //  only the ones handed to memcpy threads count against us
+        return capacity - in_flight;
       }
 
       GASNetChannel::GASNetChannel(long max_nr, XferDes::XferKind _kind)
@@ -3577,12 +3598,12 @@ namespace Realm {
         dma_all_gpus.push_back(gpu);
       }
 #endif
-      void start_channel_manager(int count, bool pinned, int max_nr,
+      void start_channel_manager(int count, int memcpy_count, bool pinned, int max_nr,
                                  Realm::CoreReservationSet& crs)
       {
         xferDes_queue = new XferDesQueue(count, pinned, crs);
         channel_manager = new ChannelManager;
-        xferDes_queue->start_worker(count, max_nr, channel_manager);
+        xferDes_queue->start_worker(count, memcpy_count, max_nr, channel_manager);
       }
       FileChannel* ChannelManager::create_file_read_channel(long max_nr) {
         assert(file_read_channel == NULL);
@@ -3605,10 +3626,11 @@ namespace Realm {
         return disk_write_channel;
       }
 
-      void XferDesQueue::start_worker(int count, int max_nr, ChannelManager* channel_manager) 
+      void XferDesQueue::start_worker(int count, int memcpy_count, int max_nr,
+                                      ChannelManager* channel_manager) 
       {
         log_new_dma.info("XferDesQueue: start_workers");
-        // num_memcpy_threads = 0;
+        num_memcpy_threads = memcpy_count;
 #ifdef USE_HDF
         // Need a dedicated thread for handling HDF requests
         // num_threads ++;
@@ -3702,10 +3724,11 @@ namespace Realm {
           worker_threads.push_back(t);
         }
 
-#ifdef USE_DEDICATED_MEMCPY_THREADS
-        // Next we create memcpy threads
+        // Next we create memcpy threads, which take plain copies off of the
+        //  memcpy channel so that the DMA thread can keep issuing
         memcpy_threads =(MemcpyThread**) calloc(num_memcpy_threads, sizeof(MemcpyThread*));
         for (int i = 0; i < num_memcpy_threads; i++) {
+          log_new_dma.info("Create a memcpy worker thread");
           memcpy_threads[i] = new MemcpyThread(memcpy_channel);
           Realm::Thread *t = Realm::Thread::create_kernel_thread<MemcpyThread,
                                             &MemcpyThread::thread_loop>(memcpy_threads[i],
@@ -3714,8 +3737,8 @@ namespace Realm {
                                                                         0 /*default scheduler*/);
           worker_threads.push_back(t);
         }
-#endif
-        assert(worker_threads.size() == (size_t)(num_threads));
+        memcpy_channel->num_threads = num_memcpy_threads;
+        assert(worker_threads.size() == (size_t)(num_threads + num_memcpy_threads));
       }
 
       void stop_channel_manager()
@@ -3743,9 +3766,7 @@ namespace Realm {
         for (int i = 0; i < num_memcpy_threads; i++)
           delete memcpy_threads[i];
         free(dma_threads);
-#ifdef USE_DEDICATED_MEMCPY_THREADS
         free(memcpy_threads);
-#endif
       }
 
       class DeferredXDEnqueue : public Realm::EventWaiter {
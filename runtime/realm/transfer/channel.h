@@ -33,6 +33,7 @@
 #include "realm/id.h"
 #include "realm/runtime_impl.h"
 #include "realm/mem_impl.h"
+#include "realm/mpmc_queue.h"
 #include "realm/inst_impl.h"
 
 #ifdef USE_CUDA
@@ -560,14 +561,11 @@ namespace Realm {
       void notify_request_write_done(Request* req);
       void flush();
 
-      struct HDFFileInfo {
-	hid_t file_id;
-	std::map<std::string, hid_t> dset_ids;
-      };
-
     private:
       HDFRequest* hdf_reqs;
-      std::map<std::string, HDFFileInfo *> file_infos;
+      // file handles come from (and go back to) the HDF5 memory's cache
+      HDF5::HDF5Memory *hdf5_mem;
+      std::map<std::string, HDF5::HDF5Memory::OpenFile *> open_files;
       //char *buf_base;
       //const HDF5Memory::HDFMetadata *hdf_metadata;
       //std::vector<OffsetsAndSize>::iterator fit;
@@ -726,9 +724,10 @@ namespace Realm {
       void thread_loop();
       static void* start(void* arg);
       void stop();
+      // maximum number of requests a thread takes from the channel at once
+      static const size_t MAX_BATCH = 16;
     private:
       MemcpyChannel* channel;
-      std::deque<MemcpyRequest*> thread_queue;
     };
 
     class MemcpyChannel : public Channel {
@@ -736,8 +735,11 @@ namespace Realm {
       MemcpyChannel(long max_nr);
       ~MemcpyChannel();
       void stop();
-      void get_request(std::deque<MemcpyRequest*>& thread_queue);
-      void return_request(std::deque<MemcpyRequest*>& thread_queue);
+      // called by dedicated memcpy threads - get_requests spins for a while
+      //  and then sleeps until there is work, returning 0 only once the
+      //  channel is stopped
+      size_t get_requests(MemcpyRequest** reqs, size_t max_reqs);
+      void return_requests(MemcpyRequest** reqs, size_t nr);
       long submit(Request** requests, long nr);
       void pull();
       long available();
@@ -750,14 +752,21 @@ namespace Realm {
 				 unsigned *lat_ret = 0);
 
       bool is_stopped;
+      // number of dedicated memcpy threads - if zero, all copies are
+      //  performed by the DMA thread that calls submit()
+      int num_threads;
     private:
-      std::deque<MemcpyRequest*> pending_queue, finished_queue;
-      pthread_mutex_t pending_lock, finished_lock;
-      pthread_cond_t pending_cond;
+      long enqueue_requests(MemcpyRequest** reqs, long nr);
+      // requests move from the pending queue to a memcpy thread and then
+      //  to the finished queue, without any locks on the common path
+      MPMCQueue<MemcpyRequest*> pending_queue, finished_queue;
+      // only used by memcpy threads that have run out of work to sleep
+      pthread_mutex_t sleep_lock;
+      pthread_cond_t sleep_cond;
+      volatile int sleeping_threads;
+      // requests handed to memcpy threads that haven't been pulled yet
+      volatile long in_flight;
       long capacity;
-      bool sleep_threads;
-      //std::vector<MemcpyRequest*> available_cb;
-      //MemcpyRequest** cbs;
     };
 
     class GASNetChannel : public Channel {
@@ -1416,7 +1425,8 @@ namespace Realm {
         return true;
       }
 
-      void start_worker(int count, int max_nr, ChannelManager* channel_manager);
+      void start_worker(int count, int memcpy_count, int max_nr,
+                        ChannelManager* channel_manager);
 
       void stop_worker();
 
@@ -1439,7 +1449,8 @@ namespace Realm {
 #ifdef USE_CUDA
     void register_gpu_in_dma_systems(Cuda::GPU* gpu);
 #endif
-    void start_channel_manager(int count, bool pinned, int max_nr, CoreReservationSet& crs);
+    void start_channel_manager(int count, int memcpy_count, bool pinned, int max_nr,
+                               CoreReservationSet& crs);
     void stop_channel_manager();
 
     void create_xfer_des(DmaRequest* _dma_request,
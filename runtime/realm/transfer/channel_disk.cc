@@ -16,8 +16,12 @@
 
 #include "realm/transfer/channel_disk.h"
 
+#include <errno.h>
+
 namespace Realm {
 
+    extern Logger log_aio;
+
     FileXferDes::FileXferDes(DmaRequest* _dma_request,
 			     NodeID _launch_node,
 			     XferDesID _guid,
@@ -46,6 +50,7 @@ namespace Realm {
 		_max_req_size, _priority,
                 _order, _kind, _complete_fence)
       , fd(-1) // defer file open
+      , direct_fd(-1)
     {
       // grab the file's name from the instance metadata
       RegionInstanceImpl *impl = get_runtime()->get_instance_impl(inst);
@@ -99,17 +104,10 @@ namespace Realm {
 	    assert(reqs[i]->mem_base != 0);
 
 	    // have we opened the file yet?
-	    if(fd == -1) {
-#ifdef REALM_USE_KERNEL_AIO
-	      int direct_flag = O_DIRECT;
-#else
-	      int direct_flag = 0;
-#endif
-	      fd = open(filename.c_str(),
-			O_RDONLY | direct_flag, 0777);
-	      assert(fd >= 0);
-	    }
+	    if(fd == -1)
+	      open_file(O_RDONLY);
 	    reqs[i]->fd = fd;
+	    reqs[i]->direct_fd = direct_fd;
           }
           break;
         }
@@ -123,17 +121,10 @@ namespace Realm {
             reqs[i]->file_off = reqs[i]->dst_off;
 
 	    // have we opened the file yet?
-	    if(fd == -1) {
-#ifdef REALM_USE_KERNEL_AIO
-	      int direct_flag = O_DIRECT;
-#else
-	      int direct_flag = 0;
-#endif
-	      fd = open(filename.c_str(),
-			O_RDWR | direct_flag, 0777);
-	      assert(fd >= 0);
-	    }
+	    if(fd == -1)
+	      open_file(O_RDWR);
 	    reqs[i]->fd = fd;
+	    reqs[i]->direct_fd = direct_fd;
           }
           break;
         }
@@ -143,6 +134,19 @@ namespace Realm {
       return new_nr;
     }
 
+    void FileXferDes::open_file(int flags)
+    {
+      fd = open(filename.c_str(), flags, 0777);
+      assert(fd >= 0);
+      if(Config::aio_direct_io) {
+	// not every filesystem supports O_DIRECT - those just use the page cache
+	direct_fd = open(filename.c_str(), flags | O_DIRECT, 0777);
+	if(direct_fd < 0)
+	  log_aio.info() << "O_DIRECT open failed for '" << filename
+			 << "': " << strerror(errno);
+      }
+    }
+
     void FileXferDes::notify_request_read_done(Request* req)
     {
       default_notify_request_read_done(req);
@@ -159,6 +163,10 @@ namespace Realm {
 	close(fd);
 	fd = -1;
       }
+      if(direct_fd >= 0) {
+	close(direct_fd);
+	direct_fd = -1;
+      }
     }
 
     DiskXferDes::DiskXferDes(DmaRequest* _dma_request,
@@ -195,6 +203,7 @@ namespace Realm {
         {
           channel = get_channel_manager()->get_disk_read_channel();
           fd = ((Realm::DiskMemory*)src_mem)->fd;
+          direct_fd = ((Realm::DiskMemory*)src_mem)->direct_fd;
           //buf_base = (const char*) dst_mem_impl->get_direct_ptr(_dst_buf.alloc_offset, 0);
           assert(src_mem->kind == MemoryImpl::MKIND_DISK);
           break;
@@ -203,6 +212,7 @@ namespace Realm {
         {
           channel = get_channel_manager()->get_disk_write_channel();
           fd = ((Realm::DiskMemory*)dst_mem)->fd;
+          direct_fd = ((Realm::DiskMemory*)dst_mem)->direct_fd;
           //buf_base = (const char*) src_mem_impl->get_direct_ptr(_src_buf.alloc_offset, 0);
           assert(dst_mem->kind == MemoryImpl::MKIND_DISK);
           break;
@@ -214,6 +224,7 @@ namespace Realm {
       for (int i = 0; i < max_nr; i++) {
         disk_reqs[i].xd = this;
         disk_reqs[i].fd = fd;
+        disk_reqs[i].direct_fd = direct_fd;
         enqueue_request(&disk_reqs[i]);
       }
     }
@@ -273,6 +284,7 @@ namespace Realm {
 
     FileChannel::FileChannel(long max_nr, XferDes::XferKind _kind)
       : Channel(_kind)
+      , aio_ctx(Config::aio_queue_depth)
     {
       unsigned bw = 0; // TODO
       unsigned latency = 0;
@@ -294,38 +306,42 @@ namespace Realm {
 
     long FileChannel::submit(Request** requests, long nr)
     {
-      AsyncFileIOContext* aio_ctx = AsyncFileIOContext::get_singleton();
+      // queue everything up first so that it can be submitted as a batch
       for (long i = 0; i < nr; i++) {
         FileRequest* req = (FileRequest*) requests[i];
 	assert(!req->xd->src_serdez_op && !req->xd->dst_serdez_op); // no serdez support
         switch (kind) {
           case XferDes::XFER_FILE_READ:
-            aio_ctx->enqueue_read(req->fd, req->file_off,
-                                  req->nbytes, req->mem_base, req);
+            aio_ctx.enqueue_read(req->fd, req->file_off,
+                                 req->nbytes, req->mem_base, req,
+                                 req->direct_fd, false /*!launch_now*/);
             break;
           case XferDes::XFER_FILE_WRITE:
-            aio_ctx->enqueue_write(req->fd, req->file_off,
-                                   req->nbytes, req->mem_base, req);
+            aio_ctx.enqueue_write(req->fd, req->file_off,
+                                  req->nbytes, req->mem_base, req,
+                                  req->direct_fd, false /*!launch_now*/);
             break;
           default:
             assert(0);
         }
       }
+      aio_ctx.launch_pending();
       return nr;
     }
 
     void FileChannel::pull()
     {
-      AsyncFileIOContext::get_singleton()->make_progress();
+      aio_ctx.make_progress();
     }
 
     long FileChannel::available()
     {
-      return AsyncFileIOContext::get_singleton()->available();
+      return aio_ctx.available();
     }
 
     DiskChannel::DiskChannel(long max_nr, XferDes::XferKind _kind)
       : Channel(_kind)
+      , aio_ctx(Config::aio_queue_depth)
     {
       unsigned bw = 0; // TODO
       unsigned latency = 0;
@@ -347,34 +363,37 @@ namespace Realm {
 
     long DiskChannel::submit(Request** requests, long nr)
     {
-      AsyncFileIOContext* aio_ctx = AsyncFileIOContext::get_singleton();
+      // queue everything up first so that it can be submitted as a batch
       for (long i = 0; i < nr; i++) {
         DiskRequest* req = (DiskRequest*) requests[i];
 	assert(!req->xd->src_serdez_op && !req->xd->dst_serdez_op); // no serdez support
         switch (kind) {
           case XferDes::XFER_DISK_READ:
-            aio_ctx->enqueue_read(req->fd, req->disk_off,
-                                  req->nbytes, req->mem_base, req);
+            aio_ctx.enqueue_read(req->fd, req->disk_off,
+                                 req->nbytes, req->mem_base, req,
+                                 req->direct_fd, false /*!launch_now*/);
             break;
           case XferDes::XFER_DISK_WRITE:
-            aio_ctx->enqueue_write(req->fd, req->disk_off,
-                                   req->nbytes, req->mem_base, req);
+            aio_ctx.enqueue_write(req->fd, req->disk_off,
+                                  req->nbytes, req->mem_base, req,
+                                  req->direct_fd, false /*!launch_now*/);
             break;
           default:
             assert(0);
         }
       }
+      aio_ctx.launch_pending();
       return nr;
     }
 
     void DiskChannel::pull()
     {
-      AsyncFileIOContext::get_singleton()->make_progress();
+      aio_ctx.make_progress();
     }
 
     long DiskChannel::available()
     {
-      return AsyncFileIOContext::get_singleton()->available();
+      return aio_ctx.available();
     }
 
 }; // namespace Realm
@@ -23,12 +23,14 @@ namespace Realm {
     class FileRequest : public Request {
     public:
       int fd;
+      int direct_fd; // O_DIRECT descriptor for the same file, or -1
       void *mem_base; // could be source or dest
       off_t file_off;
     };
     class DiskRequest : public Request {
     public:
       int fd;
+      int direct_fd; // O_DIRECT descriptor for the same file, or -1
       void *mem_base; // could be source or dest
       off_t disk_off;
     };
@@ -57,9 +59,12 @@ namespace Realm {
       void notify_request_write_done(Request* req);
       void flush();
     private:
+      void open_file(int flags);
+
       FileRequest* file_reqs;
       std::string filename;
       int fd; // The file that stores the physical instance
+      int direct_fd; // the same file opened with O_DIRECT (if enabled)
       //const char *buf_base;
     };
 
@@ -86,7 +91,7 @@ namespace Realm {
       void flush();
 
     private:
-      int fd;
+      int fd, direct_fd;
       DiskRequest* disk_reqs;
       //const char *buf_base;
     };
@@ -98,6 +103,9 @@ namespace Realm {
       long submit(Request** requests, long nr);
       void pull();
       long available();
+
+    protected:
+      AsyncFileIOContext aio_ctx;
     };
 
     class DiskChannel : public Channel {
@@ -107,6 +115,9 @@ namespace Realm {
       long submit(Request** requests, long nr);
       void pull();
       long available();
+
+    protected:
+      AsyncFileIOContext aio_ctx;
     };
 
 }; // namespace Realm
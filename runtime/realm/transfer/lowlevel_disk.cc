@@ -19,17 +19,46 @@
 #include "realm/deppart/inst_helper.h"
 #include "realm/mem_impl.h"
 #include "realm/inst_impl.h"
+#include "realm/transfer/lowlevel_dma.h"
 
 #include <sys/types.h>
 #include <time.h>
 #include <unistd.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string.h>
 
 namespace Realm {
-  
+
+    Logger log_disk("disk");
+
+    namespace Config {
+      bool use_file_mmap = false;
+    };
+
+    // requests for at least this much of a mapped file get a prefetch hint
+    static const size_t MMAP_PREFETCH_MIN = 1 << 20;
+
+    // tells the kernel we're about to touch [ptr, ptr+size)
+    static void prefetch_mapped_range(char *map_base, char *ptr, size_t size)
+    {
+      if(size < MMAP_PREFETCH_MIN)
+	return;
+      // madvise wants a page-aligned start
+      static const size_t page_size = sysconf(_SC_PAGESIZE);
+      size_t skew = (ptr - map_base) % page_size;
+      madvise(ptr - skew, size + skew, MADV_WILLNEED);
+    }
+
     DiskMemory::DiskMemory(Memory _me, size_t _size, std::string _file)
-      : MemoryImpl(_me, _size, MKIND_DISK, ALIGNMENT, Memory::DISK_MEM), file(_file)
+      : MemoryImpl(_me, _size, MKIND_DISK,
+		   // instances have to be block-aligned to be eligible for O_DIRECT
+		   (Config::aio_direct_io ? AsyncFileIOContext::DIRECT_IO_ALIGNMENT :
+		                            ALIGNMENT),
+		   Memory::DISK_MEM), file(_file)
+      , direct_fd(-1), mapped_base(0)
     {
       printf("file = %s\n", _file.c_str());
       // do not overwrite an existing file
@@ -43,10 +72,32 @@ namespace Realm {
       assert(ret == 0);
 #endif
       free_blocks[0] = _size;
+
+      if(Config::aio_direct_io) {
+	direct_fd = open(_file.c_str(), O_RDWR | O_DIRECT);
+	if(direct_fd < 0)
+	  log_disk.warning() << "disk memory file '" << _file
+			     << "' does not support O_DIRECT: " << strerror(errno);
+      }
+
+      if(Config::use_file_mmap && (_size > 0)) {
+	void *base = mmap(0, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if(base == MAP_FAILED) {
+	  log_disk.fatal() << "could not map disk memory file '" << _file
+			   << "': " << strerror(errno);
+	  assert(0);
+	}
+	mapped_base = (char *)base;
+      }
     }
 
     DiskMemory::~DiskMemory(void)
     {
+      // the file is deleted below, so there's no need to msync
+      if(mapped_base)
+	munmap(mapped_base, size);
+      if(direct_fd >= 0)
+	close(direct_fd);
       close(fd);
       // attempt to delete the file
       unlink(file.c_str());
@@ -64,6 +115,10 @@ namespace Realm {
 
     void DiskMemory::get_bytes(off_t offset, void *dst, size_t size)
     {
+      if(mapped_base) {
+	memcpy(dst, mapped_base + offset, size);
+	return;
+      }
       // this is a blocking operation
       ssize_t amt = pread(fd, dst, size, offset);
 #ifdef NDEBUG
@@ -75,6 +130,10 @@ namespace Realm {
 
     void DiskMemory::put_bytes(off_t offset, const void *src, size_t size)
     {
+      if(mapped_base) {
+	memcpy(mapped_base + offset, src, size);
+	return;
+      }
       // this is a blocking operation
       ssize_t amt = pwrite(fd, src, size, offset);
 #ifdef NDEBUG
@@ -91,7 +150,10 @@ namespace Realm {
 
     void *DiskMemory::get_direct_ptr(off_t offset, size_t size)
     {
-      return 0; // cannot provide a pointer for it.
+      if(!mapped_base)
+	return 0; // cannot provide a pointer for it.
+      prefetch_mapped_range(mapped_base, mapped_base + offset, size);
+      return mapped_base + offset;
     }
 
     int DiskMemory::get_home_node(off_t offset, size_t size)
@@ -102,15 +164,121 @@ namespace Realm {
     FileMemory::FileMemory(Memory _me)
       : MemoryImpl(_me, 0 /*no memory space*/, MKIND_FILE, ALIGNMENT, Memory::FILE_MEM)
       , next_offset(0x12340000LL)  // something not zero for debugging
+      , next_slot(MMAP_SLOT_SIZE)  // slot 0 is what non-mmap instances use
     {
       pthread_mutex_init(&vector_lock, NULL);
     }
 
     FileMemory::~FileMemory(void)
     {
+      // unmap anything that was never destroyed
+      for(std::map<off_t, MappedFile>::iterator it = mapped_files.begin();
+	  it != mapped_files.end();
+	  ++it)
+	if(it->second.fd != -1) {
+	  if(it->second.base) {
+	    msync(it->second.base, it->second.size, MS_SYNC);
+	    munmap(it->second.base, it->second.size);
+	  }
+	  close(it->second.fd);
+	}
       pthread_mutex_destroy(&vector_lock);
     }
 
+    bool FileMemory::allocate_instance_storage(RegionInstance i,
+					       size_t bytes, size_t alignment,
+					       Event precondition,
+					       size_t offset /*= 0*/)
+    {
+      if(Config::use_file_mmap) {
+	// file layouts don't use any bytes of the memory, so the slot is
+	//  just passed through the (zero-size) allocation as the offset
+	pthread_mutex_lock(&vector_lock);
+	offset = next_slot;
+	next_slot += MMAP_SLOT_SIZE;
+	MappedFile& mf = mapped_files[offset];
+	mf.inst = i;
+	mf.fd = -1;
+	mf.base = 0;
+	mf.size = 0;
+	pthread_mutex_unlock(&vector_lock);
+      }
+      return MemoryImpl::allocate_instance_storage(i, bytes, alignment,
+						   precondition, offset);
+    }
+
+    void FileMemory::release_instance_storage(RegionInstance i,
+					      Event precondition)
+    {
+      if(Config::use_file_mmap) {
+	// write back and unmap the file (i.e. the instance is detached)
+	off_t slot = get_instance(i)->metadata.inst_offset;
+	pthread_mutex_lock(&vector_lock);
+	std::map<off_t, MappedFile>::iterator it = mapped_files.find(slot);
+	if(it != mapped_files.end()) {
+	  if(it->second.fd != -1) {
+	    if(it->second.base) {
+	      int ret = msync(it->second.base, it->second.size, MS_SYNC);
+	      if(ret != 0)
+		log_disk.warning() << "msync failed for instance " << i
+				   << ": " << strerror(errno);
+	      munmap(it->second.base, it->second.size);
+	    }
+	    close(it->second.fd);
+	  }
+	  mapped_files.erase(it);
+	}
+	pthread_mutex_unlock(&vector_lock);
+      }
+      MemoryImpl::release_instance_storage(i, precondition);
+    }
+
+    FileMemory::MappedFile *FileMemory::lookup_mapping(off_t offset)
+    {
+      off_t slot = offset - (offset % MMAP_SLOT_SIZE);
+      std::map<off_t, MappedFile>::iterator it = mapped_files.find(slot);
+      if(it == mapped_files.end())
+	return 0;
+      MappedFile& mf = it->second;
+      if(mf.fd != -1)
+	return &mf;
+
+      // first access - the filename is in the instance's metadata by now
+      const std::string& filename = get_instance(mf.inst)->metadata.filename;
+      int prot = PROT_READ | PROT_WRITE;
+      int fd = open(filename.c_str(), O_RDWR);
+      if((fd == -1) && ((errno == EACCES) || (errno == EROFS))) {
+	// read-only files get a read-only mapping
+	prot = PROT_READ;
+	fd = open(filename.c_str(), O_RDONLY);
+      }
+      if(fd == -1) {
+	log_disk.fatal() << "could not open file '" << filename << "' for instance "
+			 << mf.inst << ": " << strerror(errno);
+	assert(0);
+      }
+      struct stat st;
+      int ret = fstat(fd, &st);
+      assert(ret == 0);
+      (void)ret;
+      mf.fd = fd;
+      mf.size = st.st_size;
+      if(mf.size > 0) {
+	void *base = mmap(0, mf.size, prot, MAP_SHARED, fd, 0);
+	if(base == MAP_FAILED) {
+	  log_disk.fatal() << "could not map file '" << filename << "': " << strerror(errno);
+	  assert(0);
+	}
+	mf.base = (char *)base;
+	// file layouts are linearized field by field, and both copies and
+	//  tasks generally sweep through them in order
+	madvise(mf.base, mf.size, MADV_SEQUENTIAL);
+      }
+      log_disk.debug() << "mapped file: inst=" << mf.inst << " file='" << filename
+		       << "' size=" << mf.size;
+      return &mf;
+    }
+
     off_t FileMemory::alloc_bytes(size_t size)
     {
       // hand out incrementing offsets and never reuse them
@@ -127,6 +295,12 @@ namespace Realm {
 
     void FileMemory::get_bytes(off_t offset, void *dst, size_t size)
     {
+      if(Config::use_file_mmap) {
+	void *src = get_direct_ptr(offset, size);
+	assert(src != 0);
+	memcpy(dst, src, size);
+	return;
+      }
       // map from the offset back to the instance index
       assert(offset < next_offset);
       pthread_mutex_lock(&vector_lock);
@@ -154,8 +328,14 @@ namespace Realm {
 #endif
     }
 
-    void FileMemory::put_bytes(off_t offset, const void *src, size_t)
+    void FileMemory::put_bytes(off_t offset, const void *src, size_t size)
     {
+      if(Config::use_file_mmap) {
+	void *dst = get_direct_ptr(offset, size);
+	assert(dst != 0);
+	memcpy(dst, src, size);
+	return;
+      }
       // map from the offset back to the instance index
       assert(offset < next_offset);
       pthread_mutex_lock(&vector_lock);
@@ -188,7 +368,20 @@ namespace Realm {
 
     void *FileMemory::get_direct_ptr(off_t offset, size_t size)
     {
-      return 0; // cannot provide a pointer for it;
+      if(!Config::use_file_mmap)
+	return 0; // cannot provide a pointer for it;
+
+      pthread_mutex_lock(&vector_lock);
+      MappedFile *mf = lookup_mapping(offset);
+      char *base = mf ? mf->base : 0;
+      size_t map_size = mf ? mf->size : 0;
+      pthread_mutex_unlock(&vector_lock);
+
+      size_t rel_offset = offset % MMAP_SLOT_SIZE;
+      if(!base || ((rel_offset + size) > map_size))
+	return 0;
+      prefetch_mapped_range(base, base + rel_offset, size);
+      return base + rel_offset;
     }
 
     int FileMemory::get_home_node(off_t offset, size_t size)
@@ -875,6 +875,12 @@ namespace Realm {
 
     static AsyncFileIOContext *aio_context = 0;
 
+    namespace Config {
+      int aio_queue_depth = 256;
+      bool aio_direct_io = false;
+      size_t aio_bounce_size_in_kb = 4096;
+    };
+
 #ifdef REALM_USE_KERNEL_AIO
     inline int io_setup(unsigned nr, aio_context_t *ctxp)
     {
@@ -904,6 +910,8 @@ namespace Realm {
 		     const void *buffer, Request* request = NULL);
       virtual void launch(void);
       virtual bool check_completion(void);
+      virtual void set_io_buffer(void *buffer);
+      virtual struct iocb *get_iocb(void);
 
     public:
       aio_context_t ctx;
@@ -930,7 +938,7 @@ namespace Realm {
     {
       struct iocb *cbs[1];
       cbs[0] = &cb;
-      log_aio.debug("write issued: op=%p cb=%p", this, &cb);
+      log_aio.debug("write issued: op=%p cb=%p fd=%d", this, &cb, (int)cb.aio_fildes);
 #ifndef NDEBUG
       int ret =
 #endif
@@ -943,6 +951,16 @@ namespace Realm {
       return completed;
     }
 
+    void KernelAIOWrite::set_io_buffer(void *buffer)
+    {
+      cb.aio_buf = (uint64_t)buffer;
+    }
+
+    struct iocb *KernelAIOWrite::get_iocb(void)
+    {
+      return &cb;
+    }
+
     class KernelAIORead : public AsyncFileIOContext::AIOOperation {
     public:
       KernelAIORead(aio_context_t aio_ctx,
@@ -950,6 +968,8 @@ namespace Realm {
 		     void *buffer, Request* request = NULL);
       virtual void launch(void);
       virtual bool check_completion(void);
+      virtual void set_io_buffer(void *buffer);
+      virtual struct iocb *get_iocb(void);
 
     public:
       aio_context_t ctx;
@@ -976,7 +996,7 @@ namespace Realm {
     {
       struct iocb *cbs[1];
       cbs[0] = &cb;
-      log_aio.debug("read issued: op=%p cb=%p", this, &cb);
+      log_aio.debug("read issued: op=%p cb=%p fd=%d", this, &cb, (int)cb.aio_fildes);
 #ifndef NDEBUG
       int ret =
 #endif
@@ -988,6 +1008,16 @@ namespace Realm {
     {
       return completed;
     }
+
+    void KernelAIORead::set_io_buffer(void *buffer)
+    {
+      cb.aio_buf = (uint64_t)buffer;
+    }
+
+    struct iocb *KernelAIORead::get_iocb(void)
+    {
+      return &cb;
+    }
 #else
     class PosixAIOWrite : public AsyncFileIOContext::AIOOperation {
     public:
@@ -995,6 +1025,7 @@ namespace Realm {
 		    const void *buffer, Request* request = NULL);
       virtual void launch(void);
       virtual bool check_completion(void);
+      virtual void set_io_buffer(void *buffer);
 
     public:
       struct aiocb cb;
@@ -1014,7 +1045,7 @@ namespace Realm {
 
     void PosixAIOWrite::launch(void)
     {
-      log_aio.debug("write issued: op=%p cb=%p", this, &cb);
+      log_aio.debug("write issued: op=%p cb=%p fd=%d", this, &cb, (int)cb.aio_fildes);
 #ifndef NDEBUG
       int ret =
 #endif
@@ -1031,12 +1062,18 @@ namespace Realm {
       return true;
     }
 
+    void PosixAIOWrite::set_io_buffer(void *buffer)
+    {
+      cb.aio_buf = buffer;
+    }
+
     class PosixAIORead : public AsyncFileIOContext::AIOOperation {
     public:
       PosixAIORead(int fd, size_t offset, size_t bytes,
 		   void *buffer, Request* request = NULL);
       virtual void launch(void);
       virtual bool check_completion(void);
+      virtual void set_io_buffer(void *buffer);
 
     public:
       struct aiocb cb;
@@ -1056,7 +1093,7 @@ namespace Realm {
 
     void PosixAIORead::launch(void)
     {
-      log_aio.debug("read issued: op=%p cb=%p", this, &cb);
+      log_aio.debug("read issued: op=%p cb=%p fd=%d", this, &cb, (int)cb.aio_fildes);
 #ifndef NDEBUG
       int ret =
 #endif
@@ -1072,6 +1109,11 @@ namespace Realm {
       assert(ret == 0);
       return true;
     }
+
+    void PosixAIORead::set_io_buffer(void *buffer)
+    {
+      cb.aio_buf = buffer;
+    }
 #endif
 
     class AIOFence : public Operation::AsyncWorkItem {
@@ -1116,6 +1158,7 @@ namespace Realm {
 
     AsyncFileIOContext::AsyncFileIOContext(int _max_depth)
       : max_depth(_max_depth)
+      , bounce_allocated(0)
     {
 #ifdef REALM_USE_KERNEL_AIO
       aio_ctx = 0;
@@ -1125,6 +1168,11 @@ namespace Realm {
 	io_setup(max_depth, &aio_ctx);
       assert(ret == 0);
 #endif
+      // bounce buffers hold whole O_DIRECT blocks
+      bounce_size = Config::aio_bounce_size_in_kb << 10;
+      bounce_size -= bounce_size % DIRECT_IO_ALIGNMENT;
+      if(bounce_size == 0)
+	bounce_size = DIRECT_IO_ALIGNMENT;
     }
 
     AsyncFileIOContext::~AsyncFileIOContext(void)
@@ -1138,48 +1186,91 @@ namespace Realm {
 	io_destroy(aio_ctx);
       assert(ret == 0);
 #endif
+      assert(free_bounce_buffers.size() == bounce_allocated);
+      for(std::vector<void *>::iterator it = free_bounce_buffers.begin();
+	  it != free_bounce_buffers.end();
+	  ++it)
+	free(*it);
     }
 
-    void AsyncFileIOContext::enqueue_write(int fd, size_t offset, 
-					   size_t bytes, const void *buffer,
-                                           Request* req)
+    AsyncFileIOContext::AIOOperation *AsyncFileIOContext::create_operation(bool is_write,
+									   int fd,
+									   size_t offset, size_t bytes,
+									   void *buffer, Request *req)
     {
 #ifdef REALM_USE_KERNEL_AIO
-      KernelAIOWrite *op = new KernelAIOWrite(aio_ctx,
-					      fd, offset, bytes, buffer, req);
+      if(is_write)
+	return new KernelAIOWrite(aio_ctx, fd, offset, bytes, buffer, req);
+      else
+	return new KernelAIORead(aio_ctx, fd, offset, bytes, buffer, req);
 #else
-      PosixAIOWrite *op = new PosixAIOWrite(fd, offset, bytes, buffer, req);
+      if(is_write)
+	return new PosixAIOWrite(fd, offset, bytes, buffer, req);
+      else
+	return new PosixAIORead(fd, offset, bytes, buffer, req);
 #endif
-      {
-	AutoHSLLock al(mutex);
-	if(launched_operations.size() < (size_t)max_depth) {
-	  op->launch();
-	  launched_operations.push_back(op);
+    }
+
+    void AsyncFileIOContext::enqueue_io(bool is_write, int fd, int direct_fd,
+					size_t offset, size_t bytes, void *buffer,
+					Request *req, bool launch_now)
+    {
+      AutoHSLLock al(mutex);
+
+      // O_DIRECT can only be used if the file side is aligned, and the
+      //  memory side has to go through bounce buffers if it isn't, which
+      //  means splitting the request into bounce-buffer-sized pieces - the
+      //  request is only notified by the last piece, which works because
+      //  operations are retired in order
+      if((direct_fd >= 0) &&
+	 ((offset % DIRECT_IO_ALIGNMENT) == 0) &&
+	 ((bytes % DIRECT_IO_ALIGNMENT) == 0)) {
+	if((reinterpret_cast<uintptr_t>(buffer) % DIRECT_IO_ALIGNMENT) == 0) {
+	  pending_operations.push_back(create_operation(is_write, direct_fd,
+							offset, bytes,
+							buffer, req));
 	} else {
-	  pending_operations.push_back(op);
+	  size_t done = 0;
+	  while(done < bytes) {
+	    size_t chunk = std::min(bytes - done, bounce_size);
+	    bool last = ((done + chunk) == bytes);
+	    AIOOperation *op = create_operation(is_write, direct_fd,
+						offset + done, chunk,
+						0 /*assigned at launch*/,
+						last ? req : 0);
+	    op->needs_bounce = true;
+	    op->is_write = is_write;
+	    op->user_buffer = static_cast<char *>(buffer) + done;
+	    op->bounce_bytes = chunk;
+	    pending_operations.push_back(op);
+	    done += chunk;
+	  }
 	}
-      }
+      } else
+	pending_operations.push_back(create_operation(is_write, fd,
+						      offset, bytes,
+						      buffer, req));
+
+      if(launch_now)
+	launch_pending_locked();
+    }
+
+    void AsyncFileIOContext::enqueue_write(int fd, size_t offset, 
+					   size_t bytes, const void *buffer,
+                                           Request* req,
+					   int direct_fd, bool launch_now)
+    {
+      enqueue_io(true /*write*/, fd, direct_fd, offset, bytes,
+		 const_cast<void *>(buffer), req, launch_now);
     }
 
     void AsyncFileIOContext::enqueue_read(int fd, size_t offset, 
 					  size_t bytes, void *buffer,
-                                          Request* req)
+                                          Request* req,
+					  int direct_fd, bool launch_now)
     {
-#ifdef REALM_USE_KERNEL_AIO
-      KernelAIORead *op = new KernelAIORead(aio_ctx,
-					    fd, offset, bytes, buffer, req);
-#else
-      PosixAIORead *op = new PosixAIORead(fd, offset, bytes, buffer, req);
-#endif
-      {
-	AutoHSLLock al(mutex);
-	if(launched_operations.size() < (size_t)max_depth) {
-	  op->launch();
-	  launched_operations.push_back(op);
-	} else {
-	  pending_operations.push_back(op);
-	}
-      }
+      enqueue_io(false /*!write*/, fd, direct_fd, offset, bytes,
+		 buffer, req, launch_now);
     }
 
     void AsyncFileIOContext::enqueue_fence(DmaRequest *req)
@@ -1187,25 +1278,102 @@ namespace Realm {
       AIOFenceOp *op = new AIOFenceOp(req);
       {
 	AutoHSLLock al(mutex);
-	if(launched_operations.size() < (size_t)max_depth) {
-	  op->launch();
-	  launched_operations.push_back(op);
-	} else {
-	  pending_operations.push_back(op);
+	pending_operations.push_back(op);
+	launch_pending_locked();
+      }
+    }
+
+    void AsyncFileIOContext::launch_pending(void)
+    {
+      AutoHSLLock al(mutex);
+      launch_pending_locked();
+    }
+
+    // gives an operation its bounce buffer (if it needs one), returning
+    //  false if none are available right now
+    bool AsyncFileIOContext::prepare_launch(AIOOperation *op)
+    {
+      if(!op->needs_bounce || op->bounce_buffer)
+	return true;
+
+      void *buffer = 0;
+      if(!free_bounce_buffers.empty()) {
+	buffer = free_bounce_buffers.back();
+	free_bounce_buffers.pop_back();
+      } else {
+	if(bounce_allocated >= MAX_BOUNCE_BUFFERS)
+	  return false;
+	if(posix_memalign(&buffer, DIRECT_IO_ALIGNMENT, bounce_size) != 0) {
+	  // we can wait for a buffer to be returned if we have any at all
+	  if(bounce_allocated > 0)
+	    return false;
+	  log_aio.fatal() << "could not allocate " << bounce_size
+			  << " byte bounce buffer";
+	  assert(0);
+	}
+	bounce_allocated++;
+      }
+
+      op->bounce_buffer = buffer;
+      op->set_io_buffer(buffer);
+      if(op->is_write)
+	memcpy(buffer, op->user_buffer, op->bounce_bytes);
+      return true;
+    }
+
+    void AsyncFileIOContext::launch_pending_locked(void)
+    {
+      while(!pending_operations.empty() &&
+	    (launched_operations.size() < (size_t)max_depth)) {
+#ifdef REALM_USE_KERNEL_AIO
+	// hand the kernel as many consecutive reads/writes as we can at once
+	static const size_t MAX_SUBMIT_BATCH = 64;
+	struct iocb *cbs[MAX_SUBMIT_BATCH];
+	size_t room = max_depth - launched_operations.size();
+	size_t count = 0;
+	while((count < room) && (count < MAX_SUBMIT_BATCH) &&
+	      (count < pending_operations.size())) {
+	  AIOOperation *op = pending_operations[count];
+	  struct iocb *cb = op->get_iocb();
+	  if(!cb || !prepare_launch(op)) break;
+	  cbs[count++] = cb;
 	}
+	if(count > 0) {
+	  int ret = io_submit(aio_ctx, count, cbs);
+	  log_aio.debug("io_submit: %zd operations, ret=%d", count, ret);
+	  if(ret < 0) {
+	    // the kernel is out of resources - try again on the next poll
+	    if(errno == EAGAIN) break;
+	    log_aio.fatal() << "io_submit failed: " << strerror(errno);
+	    assert(0);
+	  }
+	  for(int i = 0; i < ret; i++) {
+	    launched_operations.push_back(pending_operations.front());
+	    pending_operations.pop_front();
+	  }
+	  if((size_t)ret < count) break;
+	  continue;
+	}
+#endif
+	AIOOperation *op = pending_operations.front();
+	if(!prepare_launch(op)) break;
+	pending_operations.pop_front();
+	op->launch();
+	launched_operations.push_back(op);
       }
     }
 
     bool AsyncFileIOContext::empty(void)
     {
       AutoHSLLock al(mutex);
-      return launched_operations.empty();
+      return launched_operations.empty() && pending_operations.empty();
     }
 
     long AsyncFileIOContext::available(void)
     {
       AutoHSLLock al(mutex);
-      return (max_depth - launched_operations.size());
+      long in_use = launched_operations.size() + pending_operations.size();
+      return ((in_use < max_depth) ? (max_depth - in_use) : 0);
     }
 
     void AsyncFileIOContext::make_progress(void)
@@ -1215,16 +1383,21 @@ namespace Realm {
       // first, reap as many events as we can - oldest first
 #ifdef REALM_USE_KERNEL_AIO
       while(true) {
-	struct io_event events[8];
+	struct io_event events[32];
 	struct timespec ts;
 	ts.tv_sec = 0;
 	ts.tv_nsec = 0;  // no delay
-	int ret = io_getevents(aio_ctx, 1, 8, events, &ts);
-	if(ret == 0) break;
+	int ret = io_getevents(aio_ctx, 1, 32, events, &ts);
+	if(ret <= 0) break;
 	log_aio.debug("io_getevents returned %d events", ret);
 	for(int i = 0; i < ret; i++) {
 	  AIOOperation *op = (AIOOperation *)(events[i].data);
 	  log_aio.debug("io_getevents: event[%d] = %p", i, op);
+	  if(events[i].res < 0) {
+	    log_aio.fatal() << "aio operation failed: op=" << op
+			    << " error=" << strerror(-events[i].res);
+	    assert(0);
+	  }
 	  op->completed = true;
 	}
       }
@@ -1235,6 +1408,11 @@ namespace Realm {
 	AIOOperation *op = launched_operations.front();
 	if(!op->check_completion()) break;
 	log_aio.debug("aio op completed: op=%p", op);
+	if(op->bounce_buffer) {
+	  if(!op->is_write)
+	    memcpy(op->user_buffer, op->bounce_buffer, op->bounce_bytes);
+	  free_bounce_buffers.push_back(op->bounce_buffer);
+	}
         // <NEW_DMA>
         if (op->req != NULL) {
           Request* request = (Request*)(op->req);
@@ -1247,13 +1425,7 @@ namespace Realm {
       }
 
       // finally, if there are any pending ops, and room for them, launch them
-      while((launched_operations.size() < (size_t)max_depth) &&
-	    !pending_operations.empty()) {
-	AIOOperation *op = pending_operations.front();
-	pending_operations.pop_front();
-	op->launch();
-	launched_operations.push_back(op);
-      }
+      launch_pending_locked();
     }
 
     /*static*/
@@ -1367,7 +1539,8 @@ namespace Realm {
 	    // no serdez support
 	    if((src_serdez_id != 0) || (dst_serdez_id != 0))
 	      return XferDes::XFER_NONE;
-            return XferDes::XFER_DISK_WRITE;
+            return (Config::use_file_mmap ? XferDes::XFER_MEM_CPY :
+		    XferDes::XFER_DISK_WRITE);
 	  }
           else if (dst_ll_kind == Memory::HDF_MEM) {
 	    // no serdez support
@@ -1379,7 +1552,8 @@ namespace Realm {
 	    // no serdez support
 	    if((src_serdez_id != 0) || (dst_serdez_id != 0))
 	      return XferDes::XFER_NONE;
-            return XferDes::XFER_FILE_WRITE;
+            return (Config::use_file_mmap ? XferDes::XFER_MEM_CPY :
+		    XferDes::XFER_FILE_WRITE);
 	  }
           assert(0);
           break;
@@ -1416,7 +1590,8 @@ namespace Realm {
 	  if((src_serdez_id != 0) || (dst_serdez_id != 0))
 	    return XferDes::XFER_NONE;
           if (is_cpu_mem(dst_ll_kind))
-            return XferDes::XFER_DISK_READ;
+            return (Config::use_file_mmap ? XferDes::XFER_MEM_CPY :
+		    XferDes::XFER_DISK_READ);
           else
             return XferDes::XFER_NONE;
         case Memory::FILE_MEM:
@@ -1424,7 +1599,8 @@ namespace Realm {
 	  if((src_serdez_id != 0) || (dst_serdez_id != 0))
 	    return XferDes::XFER_NONE;
           if (is_cpu_mem(dst_ll_kind))
-            return XferDes::XFER_FILE_READ;
+            return (Config::use_file_mmap ? XferDes::XFER_MEM_CPY :
+		    XferDes::XFER_FILE_READ);
           else
             return XferDes::XFER_NONE;
         case Memory::HDF_MEM:
@@ -2523,7 +2699,8 @@ namespace Realm {
 #ifdef USE_HDF
       // fills of an HDF5 instance are also handled specially
       if (mem_impl->lowlevel_kind == Memory::HDF_MEM) {
-	hid_t file_id = -1;
+	HDF5::HDF5Memory *hdf5_mem = static_cast<HDF5::HDF5Memory *>(mem_impl);
+	HDF5::HDF5Memory::OpenFile *file = 0;
 	hid_t dset_id = -1;
 	hid_t dtype_id = -1;
 	const std::string *prev_filename = 0;
@@ -2536,28 +2713,22 @@ namespace Realm {
 
 	  // compare the pointers, not the string contents...
 	  if(info.filename != prev_filename) {
-	    // close dataset too
-	    if(dset_id != -1) {
-	      CHECK_HDF5( H5Tclose(dtype_id) );
-	      CHECK_HDF5( H5Dclose(dset_id) );
-	      prev_dsetname = 0;
+	    // file and dataset handles are owned by the memory's cache - just
+	    //  flush what we wrote before giving the file back
+	    if(file) {
+	      CHECK_HDF5( H5Fflush(file->file_id, H5F_SCOPE_LOCAL) );
+	      hdf5_mem->release_file(file);
 	    }
-	    if(file_id != -1)
-	      CHECK_HDF5( H5Fclose(file_id) );
-
-	    CHECK_HDF5( file_id = H5Fopen(info.filename->c_str(),
-					  H5F_ACC_RDWR, H5P_DEFAULT) );
+	    file = hdf5_mem->acquire_file(*info.filename, false /*!read_only*/);
 	    prev_filename = info.filename;
+	    prev_dsetname = 0;
 	  }
 
 	  if(info.dsetname != prev_dsetname) {
-	    if(dset_id != -1) {
-	      CHECK_HDF5( H5Tclose(dtype_id) );
-	      CHECK_HDF5( H5Dclose(dset_id) );
-	    }
-	    CHECK_HDF5( dset_id = H5Dopen2(file_id, info.dsetname->c_str(),
-					   H5P_DEFAULT) );
-	    CHECK_HDF5( dtype_id = H5Dget_type(dset_id) );
+	    HDF5::HDF5Memory::OpenDataset dset = hdf5_mem->get_dataset(file,
+								       *info.dsetname);
+	    dset_id = dset.dset_id;
+	    dtype_id = dset.dtype_id;
 	    size_t dtype_size = H5Tget_size(dtype_id);
 	    assert(dtype_size == fill_size);
 	    prev_dsetname = info.dsetname;
@@ -2597,13 +2768,11 @@ namespace Realm {
 	  CHECK_HDF5( H5Sclose(file_space_id) );
 	}
 
-	// close the last dset and file we touched
-	if(dset_id != -1) {
-	  CHECK_HDF5( H5Tclose(dtype_id) );
-	  CHECK_HDF5( H5Dclose(dset_id) );
+	// give back the last file we touched
+	if(file) {
+	  CHECK_HDF5( H5Fflush(file->file_id, H5F_SCOPE_LOCAL) );
+	  hdf5_mem->release_file(file);
 	}
-	if(file_id != -1)
-	  CHECK_HDF5( H5Fclose(file_id) );
       }
 #endif
 
@@ -2783,12 +2952,12 @@ namespace Realm {
       dma_queue = 0;
     }
 
-    void start_dma_system(int count, bool pinned, int max_nr,
+    void start_dma_system(int count, int memcpy_count, bool pinned, int max_nr,
                           CoreReservationSet& crs)
     {
       //log_dma.add_stream(&std::cerr, Logger::LEVEL_DEBUG, false, false);
-      aio_context = new AsyncFileIOContext(256);
-      start_channel_manager(count, pinned, max_nr, crs);
+      aio_context = new AsyncFileIOContext(Config::aio_queue_depth);
+      start_channel_manager(count, memcpy_count, pinned, max_nr, crs);
       ib_req_queue = new PendingIBQueue();
     }
 
@@ -16,6 +16,7 @@
 #ifndef LOWLEVEL_DMA_H
 #define LOWLEVEL_DMA_H
 
+#include "realm/realm_config.h"
 #include "realm/activemsg.h"
 #include "realm/id.h"
 #include "realm/memory.h"
@@ -25,6 +26,10 @@
 #include "realm/runtime_impl.h"
 #include "realm/inst_impl.h"
 
+#ifdef REALM_USE_KERNEL_AIO
+#include <linux/aio_abi.h>
+#endif
+
 namespace Realm {
   class CoreReservationSet;
 
@@ -119,7 +124,8 @@ namespace Realm {
     extern void start_dma_worker_threads(int count, Realm::CoreReservationSet& crs);
     extern void stop_dma_worker_threads(void);
 
-    extern void start_dma_system(int count, bool pinned, int max_nr, Realm::CoreReservationSet& crs);
+    extern void start_dma_system(int count, int memcpy_count, bool pinned, int max_nr,
+                                 Realm::CoreReservationSet& crs);
 
     extern void stop_dma_system(void);
 
@@ -453,15 +459,41 @@ namespace Realm {
 
     class Request;
 
+    namespace Config {
+      // number of operations each file I/O queue keeps in flight (-ll:aio_depth)
+      extern int aio_queue_depth;
+      // when set (-ll:aio_direct), disk and file memories also open their
+      //  files with O_DIRECT, which is used for suitably aligned requests
+      extern bool aio_direct_io;
+      // size of the aligned bounce buffers used to stage O_DIRECT requests
+      //  whose memory side isn't aligned (-ll:aio_bounce, in KB)
+      extern size_t aio_bounce_size_in_kb;
+    };
+
+    // each of the disk and file channels has its own context, so they don't
+    //  contend with each other for a single submission queue
     class AsyncFileIOContext {
     public:
       AsyncFileIOContext(int _max_depth);
       ~AsyncFileIOContext(void);
 
-      void enqueue_write(int fd, size_t offset, size_t bytes, const void *buffer, Request* req = NULL);
-      void enqueue_read(int fd, size_t offset, size_t bytes, void *buffer, Request* req = NULL);
+      // O_DIRECT requires the file offset, size and memory address to all
+      //  be multiples of this
+      static const size_t DIRECT_IO_ALIGNMENT = 4096;
+
+      // if 'direct_fd' is valid, it is used instead of 'fd' for requests with
+      //  aligned file offsets and sizes - operations are not launched until
+      //  the next call to launch_pending() unless 'launch_now' is set
+      void enqueue_write(int fd, size_t offset, size_t bytes, const void *buffer, Request* req = NULL,
+			 int direct_fd = -1, bool launch_now = true);
+      void enqueue_read(int fd, size_t offset, size_t bytes, void *buffer, Request* req = NULL,
+			int direct_fd = -1, bool launch_now = true);
       void enqueue_fence(DmaRequest *req);
 
+      // launches as many queued operations as the depth allows (with kernel
+      //  AIO, these are handed to a single io_submit call)
+      void launch_pending(void);
+
       bool empty(void);
       long available(void);
       void make_progress(void);
@@ -470,19 +502,51 @@ namespace Realm {
 
       class AIOOperation {
       public:
+        AIOOperation(void)
+	  : completed(false), req(0)
+	  , needs_bounce(false), is_write(false)
+	  , bounce_buffer(0), user_buffer(0), bounce_bytes(0) {}
 	virtual ~AIOOperation(void) {}
 	virtual void launch(void) = 0;
 	virtual bool check_completion(void) = 0;
+	// redirects a read/write to a bounce buffer
+	virtual void set_io_buffer(void *buffer) { assert(0); }
+#ifdef REALM_USE_KERNEL_AIO
+	// operations that go through io_submit expose their control block
+	//  so that they can be submitted in batches
+	virtual struct iocb *get_iocb(void) { return 0; }
+#endif
 	bool completed;
         void* req;
+	// O_DIRECT operations on unaligned memory are staged through a bounce
+	//  buffer, which is assigned when the operation is launched
+	bool needs_bounce, is_write;
+	void *bounce_buffer, *user_buffer;
+	size_t bounce_bytes;
       };
 
+    protected:
+      void enqueue_io(bool is_write, int fd, int direct_fd,
+		      size_t offset, size_t bytes, void *buffer,
+		      Request *req, bool launch_now);
+      AIOOperation *create_operation(bool is_write, int fd,
+				     size_t offset, size_t bytes,
+				     void *buffer, Request *req);
+      bool prepare_launch(AIOOperation *op);
+      void launch_pending_locked(void);
+
+    public:
       int max_depth;
       std::deque<AIOOperation *> launched_operations, pending_operations;
       GASNetHSL mutex;
 #ifdef REALM_USE_KERNEL_AIO
       aio_context_t aio_ctx;
 #endif
+      // bounce buffers are allocated on demand, up to a small limit, and
+      //  are only touched while holding 'mutex'
+      static const size_t MAX_BOUNCE_BUFFERS = 8;
+      size_t bounce_size, bounce_allocated;
+      std::vector<void *> free_bounce_buffers;
     };
 };
 
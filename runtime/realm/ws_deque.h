@@ -0,0 +1,73 @@
+/* Copyright 2018 Stanford University, NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// bounded Chase-Lev work-stealing deque
+
+#ifndef REALM_WS_DEQUE_H
+#define REALM_WS_DEQUE_H
+
+#include <stddef.h>
+
+namespace Realm {
+
+  // a fixed-capacity deque with a single owner and any number of thieves -
+  //  the owner pushes and pops at the bottom (LIFO) without any atomic
+  //  read-modify-write except when racing a thief for the last entry, while
+  //  thieves take from the top (FIFO) with a compare-and-swap
+  // T should be cheap to copy (e.g. a pointer)
+  template <typename T>
+  class WorkStealingDeque {
+  public:
+    // capacity is rounded up to the next power of two
+    WorkStealingDeque(size_t _capacity);
+    ~WorkStealingDeque(void);
+
+    size_t capacity(void) const;
+
+    // only a hint when other threads are stealing concurrently
+    size_t size_approx(void) const;
+    bool empty_approx(void) const;
+
+    // owner only - push fails (rather than growing) if the deque is full
+    bool push(const T& val);
+    bool pop(T& val);
+
+    // any thread - fails if the deque is empty or another thread won the
+    //  race for the top entry
+    bool steal(T& val);
+
+  protected:
+    static const size_t CACHE_LINE = 64;
+
+    T *entries;
+    size_t mask;
+    // thieves hammer 'top', the owner 'bottom' - keep them apart
+    char pad0[CACHE_LINE];
+    volatile long long top;
+    char pad1[CACHE_LINE - sizeof(long long)];
+    volatile long long bottom;
+    char pad2[CACHE_LINE - sizeof(long long)];
+
+  private:
+    // not copyable
+    WorkStealingDeque(const WorkStealingDeque<T>&);
+    WorkStealingDeque<T>& operator=(const WorkStealingDeque<T>&);
+  };
+
+}; // namespace Realm
+
+#include "realm/ws_deque.inl"
+
+#endif // ifndef REALM_WS_DEQUE_H
@@ -0,0 +1,123 @@
+/* Copyright 2018 Stanford University, NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// bounded Chase-Lev work-stealing deque
+
+// nop, but helps IDEs
+#include "realm/ws_deque.h"
+
+namespace Realm {
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class WorkStealingDeque<T>
+
+  // entries [top, bottom) are valid - the owner moves bottom, thieves
+  //  (and the owner, for the last entry) move top with a CAS
+
+  template <typename T>
+  inline WorkStealingDeque<T>::WorkStealingDeque(size_t _capacity)
+    : top(0), bottom(0)
+  {
+    size_t cap = 2;
+    while(cap < _capacity)
+      cap <<= 1;
+    mask = cap - 1;
+    entries = new T[cap];
+  }
+
+  template <typename T>
+  inline WorkStealingDeque<T>::~WorkStealingDeque(void)
+  {
+    delete[] entries;
+  }
+
+  template <typename T>
+  inline size_t WorkStealingDeque<T>::capacity(void) const
+  {
+    return mask + 1;
+  }
+
+  template <typename T>
+  inline size_t WorkStealingDeque<T>::size_approx(void) const
+  {
+    long long t = top;
+    long long b = bottom;
+    return ((b > t) ? (size_t)(b - t) : 0);
+  }
+
+  template <typename T>
+  inline bool WorkStealingDeque<T>::empty_approx(void) const
+  {
+    return (size_approx() == 0);
+  }
+
+  template <typename T>
+  inline bool WorkStealingDeque<T>::push(const T& val)
+  {
+    long long b = bottom;
+    long long t = top;
+    if((size_t)(b - t) > mask)
+      return false;  // full
+
+    entries[b & mask] = val;
+    // entry must be visible before a thief can see the new bottom
+    __sync_synchronize();
+    bottom = b + 1;
+    return true;
+  }
+
+  template <typename T>
+  inline bool WorkStealingDeque<T>::pop(T& val)
+  {
+    long long b = bottom - 1;
+    bottom = b;
+    // the store to bottom has to be ordered before the load of top, or a
+    //  thief and the owner could both take the last entry
+    __sync_synchronize();
+    long long t = top;
+
+    if(t > b) {
+      // empty - put bottom back where it was
+      bottom = b + 1;
+      return false;
+    }
+
+    val = entries[b & mask];
+    if(t == b) {
+      // last entry - race any thieves for it
+      bool won = __sync_bool_compare_and_swap(&top, t, t + 1);
+      bottom = b + 1;
+      return won;
+    }
+    return true;
+  }
+
+  template <typename T>
+  inline bool WorkStealingDeque<T>::steal(T& val)
+  {
+    long long t = top;
+    __sync_synchronize();
+    long long b = bottom;
+    if(t >= b)
+      return false;
+
+    // read the entry before claiming it - once top moves, the owner may
+    //  reuse the slot
+    val = entries[t & mask];
+    return __sync_bool_compare_and_swap(&top, t, t + 1);
+  }
+
+}; // namespace Realm
@@ -521,13 +521,15 @@ REALM_SRC 	+= $(LG_RT_DIR)/realm/hdf5/hdf5_module.cc \
 		   $(LG_RT_DIR)/realm/hdf5/hdf5_internal.cc \
 		   $(LG_RT_DIR)/realm/hdf5/hdf5_access.cc
 endif
-REALM_SRC 	+= $(LG_RT_DIR)/realm/activemsg.cc
+REALM_SRC 	+= $(LG_RT_DIR)/realm/activemsg.cc \
+		   $(LG_RT_DIR)/realm/shm_network.cc
 GPU_RUNTIME_SRC +=
 
 REALM_SRC 	+= $(LG_RT_DIR)/realm/logging.cc \
 	           $(LG_RT_DIR)/realm/cmdline.cc \
 		   $(LG_RT_DIR)/realm/profiling.cc \
 	           $(LG_RT_DIR)/realm/codedesc.cc \
+		   $(LG_RT_DIR)/realm/redop.cc \
 		   $(LG_RT_DIR)/realm/timers.cc
 
 MAPPER_SRC	+= $(LG_RT_DIR)/mappers/default_mapper.cc \
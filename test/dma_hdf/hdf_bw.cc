@@ -0,0 +1,240 @@
+// Copyright 2018 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// repeated-copy test for HDF5 instances, modelled on checkpointing every
+//  time step to the same attached file
+//
+// usage: hdf_bw [-n <elements>] [-f <fields>] [-t <steps>] [-o <file>]
+//
+// each step writes every field out to the attached file and reads it back
+//  in - run with -hdf5:cachesize 0 to see the cost of reopening the file and
+//  its datasets for every copy (build with 'make OUTFILE=hdf_bw')
+
+#include "realm.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstring>
+#include <map>
+
+#include <unistd.h>
+#include <hdf5.h>
+
+using namespace Realm;
+
+Logger log_app("app");
+
+enum {
+  TOP_LEVEL_TASK = Processor::TASK_ID_FIRST_AVAILABLE+0,
+};
+
+static int num_elements = 4096;
+static int num_fields = 4;
+static int num_steps = 100;
+static std::string file_name = "hdf_bw.h5";
+static int errors = 0;
+
+static void create_hdf5_file(const std::vector<std::string>& dset_names)
+{
+  hid_t file_id = H5Fcreate(file_name.c_str(), H5F_ACC_TRUNC,
+			    H5P_DEFAULT, H5P_DEFAULT);
+  assert(file_id >= 0);
+  hsize_t dims[1];
+  dims[0] = num_elements;
+  hid_t space_id = H5Screate_simple(1, dims, NULL);
+  for(size_t i = 0; i < dset_names.size(); i++) {
+    hid_t dset_id = H5Dcreate2(file_id, dset_names[i].c_str(),
+			       H5T_NATIVE_INT, space_id,
+			       H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    assert(dset_id >= 0);
+    H5Dclose(dset_id);
+  }
+  H5Sclose(space_id);
+  H5Fclose(file_id);
+}
+
+static double do_copy(const IndexSpace<1>& is,
+		      RegionInstance src, RegionInstance dst)
+{
+  std::vector<CopySrcDstField> srcs(num_fields), dsts(num_fields);
+  for(int i = 0; i < num_fields; i++) {
+    srcs[i].inst = src;
+    srcs[i].field_id = i;
+    srcs[i].size = sizeof(int);
+    dsts[i].inst = dst;
+    dsts[i].field_id = i;
+    dsts[i].size = sizeof(int);
+  }
+
+  long long t1 = Clock::current_time_in_nanoseconds();
+  is.copy(srcs, dsts, ProfilingRequestSet()).wait();
+  long long t2 = Clock::current_time_in_nanoseconds();
+  return (t2 - t1) * 1e-9;
+}
+
+static void check_data(const char *what, RegionInstance inst, int step)
+{
+  for(int f = 0; f < num_fields; f++) {
+    AffineAccessor<int, 1> acc(inst, f);
+    for(int i = 0; i < num_elements; i++)
+      if(acc[i] != (i * num_fields + f + step)) {
+	log_app.error() << what << ": step=" << step << " field=" << f
+			<< " mismatch at " << i << ": " << acc[i] << " != "
+			<< (i * num_fields + f + step);
+	errors++;
+	return;
+      }
+  }
+}
+
+void top_level_task(const void *args, size_t arglen,
+		    const void *userdata, size_t userlen, Processor p)
+{
+  IndexSpace<1> is(Rect<1>(0, num_elements - 1));
+  std::vector<FieldID> field_ids;
+  std::vector<size_t> field_sizes(num_fields, sizeof(int));
+  std::map<FieldID, size_t> sys_field_sizes;
+  std::vector<std::string> dset_names;
+  std::vector<const char *> field_files;
+  for(int i = 0; i < num_fields; i++) {
+    char name[32];
+    sprintf(name, "/field%d", i);
+    field_ids.push_back(i);
+    sys_field_sizes[i] = sizeof(int);
+    dset_names.push_back(name);
+  }
+  for(int i = 0; i < num_fields; i++)
+    field_files.push_back(dset_names[i].c_str());
+
+  create_hdf5_file(dset_names);
+
+  Memory sysmem = Machine::MemoryQuery(Machine::get_machine())
+    .only_kind(Memory::SYSTEM_MEM)
+    .has_affinity_to(p)
+    .first();
+  assert(sysmem.exists());
+
+  RegionInstance sysinst, checkinst;
+  RegionInstance::create_instance(sysinst, sysmem, is, sys_field_sizes,
+				  0 /*SOA*/, ProfilingRequestSet()).wait();
+  RegionInstance::create_instance(checkinst, sysmem, is, sys_field_sizes,
+				  0 /*SOA*/, ProfilingRequestSet()).wait();
+
+  RegionInstance hdfinst;
+  RegionInstance::create_hdf5_instance(hdfinst, file_name.c_str(), is,
+				       field_ids, field_sizes, field_files,
+				       false /*!read_only*/,
+				       ProfilingRequestSet()).wait();
+
+  double wr_total = 0, rd_total = 0;
+  for(int step = 0; step < num_steps; step++) {
+    for(int f = 0; f < num_fields; f++) {
+      AffineAccessor<int, 1> acc(sysinst, f);
+      for(int i = 0; i < num_elements; i++)
+	acc[i] = i * num_fields + f + step;
+    }
+
+    wr_total += do_copy(is, sysinst, hdfinst);
+    rd_total += do_copy(is, hdfinst, checkinst);
+    check_data("readback", checkinst, step);
+  }
+
+  log_app.print() << "steps=" << num_steps << " fields=" << num_fields
+		  << " elements=" << num_elements
+		  << " write=" << (wr_total * 1e6 / num_steps) << " us/step"
+		  << " read=" << (rd_total * 1e6 / num_steps) << " us/step";
+
+  // detaching must leave the last step's data in the file, and a fresh
+  //  attach must see it
+  hdfinst.destroy();
+  {
+    hid_t file_id = H5Fopen(file_name.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    assert(file_id >= 0);
+    hid_t dset_id = H5Dopen2(file_id, dset_names[num_fields - 1].c_str(),
+			     H5P_DEFAULT);
+    assert(dset_id >= 0);
+    std::vector<int> data(num_elements);
+    H5Dread(dset_id, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT,
+	    data.data());
+    H5Dclose(dset_id);
+    H5Fclose(file_id);
+    int last = num_elements - 1;
+    int expected = last * num_fields + (num_fields - 1) + (num_steps - 1);
+    if(data[last] != expected) {
+      log_app.error() << "file contents after detach: " << data[last]
+		      << " != " << expected;
+      errors++;
+    }
+  }
+
+  RegionInstance::create_hdf5_instance(hdfinst, file_name.c_str(), is,
+				       field_ids, field_sizes, field_files,
+				       true /*read_only*/,
+				       ProfilingRequestSet()).wait();
+  do_copy(is, hdfinst, checkinst);
+  check_data("reattach", checkinst, num_steps - 1);
+  hdfinst.destroy();
+
+  sysinst.destroy();
+  checkinst.destroy();
+  unlink(file_name.c_str());
+
+  if(errors > 0)
+    log_app.error() << errors << " errors seen";
+  else
+    log_app.print() << "all checks passed";
+
+  Runtime::get_runtime().shutdown(Event::NO_EVENT, (errors > 0) ? 1 : 0);
+}
+
+int main(int argc, char **argv)
+{
+  Runtime rt;
+
+  rt.init(&argc, &argv);
+
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "-n")) {
+      num_elements = atoi(argv[++i]);
+      continue;
+    }
+    if(!strcmp(argv[i], "-f")) {
+      num_fields = atoi(argv[++i]);
+      continue;
+    }
+    if(!strcmp(argv[i], "-t")) {
+      num_steps = atoi(argv[++i]);
+      continue;
+    }
+    if(!strcmp(argv[i], "-o")) {
+      file_name = argv[++i];
+      continue;
+    }
+  }
+
+  rt.register_task(TOP_LEVEL_TASK, top_level_task);
+
+  Processor p = Machine::ProcessorQuery(Machine::get_machine())
+    .only_kind(Processor::LOC_PROC)
+    .first();
+  assert(p.exists());
+
+  // the top level task requests shutdown itself, with an error code if
+  //  anything went wrong
+  rt.collective_spawn(p, TOP_LEVEL_TASK, 0, 0);
+
+  return rt.wait_for_shutdown();
+}
@@ -0,0 +1,215 @@
+// Copyright 2018 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// bandwidth test for copies between system memory and file/disk memories
+//
+// usage: file_bw [-s <MB>] [-r <reps>] [-d <dir>] -ll:csize <MB> [-ll:dsize <MB>]
+//
+// each rep writes a GB-scale instance out to a file instance (and a disk
+//  memory instance, if the disk memory is big enough) and reads it back in,
+//  checking the data - try it with -ll:aio_direct and different -ll:aio_depth
+//  values
+
+#include "realm.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+
+using namespace Realm;
+
+Logger log_app("app");
+
+enum {
+  TOP_LEVEL_TASK = Processor::TASK_ID_FIRST_AVAILABLE+0,
+};
+
+static size_t size_in_mb = 1024;
+static int num_reps = 3;
+static std::string file_dir = ".";
+static int errors = 0;
+
+typedef long long ElemType;
+
+static double do_copy(const IndexSpace<1>& is,
+		      RegionInstance src, RegionInstance dst)
+{
+  std::vector<CopySrcDstField> srcs(1), dsts(1);
+  srcs[0].inst = src;
+  srcs[0].field_id = 0;
+  srcs[0].size = sizeof(ElemType);
+  dsts[0].inst = dst;
+  dsts[0].field_id = 0;
+  dsts[0].size = sizeof(ElemType);
+
+  long long t1 = Clock::current_time_in_nanoseconds();
+  is.copy(srcs, dsts, ProfilingRequestSet()).wait();
+  long long t2 = Clock::current_time_in_nanoseconds();
+  return (t2 - t1) * 1e-9;
+}
+
+// writes 'sysinst' out to 'inst' and reads it back into 'checkinst'
+static void test_instance(const char *name, const IndexSpace<1>& is,
+			  RegionInstance inst, RegionInstance sysinst,
+			  RegionInstance checkinst)
+{
+  size_t bytes = is.bounds.volume() * sizeof(ElemType);
+  AffineAccessor<ElemType, 1> ca(checkinst, 0);
+
+  for(int rep = 0; rep < num_reps; rep++) {
+    double wr_time = do_copy(is, sysinst, inst);
+
+    // clear out the destination so that a read that does nothing is caught
+    for(int i = is.bounds.lo[0]; i <= is.bounds.hi[0]; i += 4096)
+      ca[i] = -1;
+
+    double rd_time = do_copy(is, inst, checkinst);
+
+    log_app.print() << name << ": rep=" << rep
+		    << " write=" << (bytes / wr_time * 1e-9) << " GB/s"
+		    << " read=" << (bytes / rd_time * 1e-9) << " GB/s";
+
+    // spot check every 4096th element (and the last one)
+    for(int i = is.bounds.lo[0]; i <= is.bounds.hi[0]; i += 4096)
+      if(ca[i] != (ElemType)(i * 3 + rep)) {
+	log_app.error() << name << ": mismatch at " << i << ": "
+			<< ca[i] << " != " << (i * 3 + rep);
+	errors++;
+	break;
+      }
+    if(ca[is.bounds.hi[0]] != (ElemType)(is.bounds.hi[0] * 3 + rep)) {
+      log_app.error() << name << ": mismatch at last element";
+      errors++;
+    }
+
+    // change the data for the next rep
+    AffineAccessor<ElemType, 1> sa(sysinst, 0);
+    for(int i = is.bounds.lo[0]; i <= is.bounds.hi[0]; i++)
+      sa[i] = i * 3 + rep + 1;
+  }
+}
+
+void top_level_task(const void *args, size_t arglen,
+		    const void *userdata, size_t userlen, Processor p)
+{
+  size_t elements = (size_in_mb << 20) / sizeof(ElemType);
+  IndexSpace<1> is(Rect<1>(0, elements - 1));
+  std::vector<size_t> field_sizes(1, sizeof(ElemType));
+
+  Memory sysmem = Machine::MemoryQuery(Machine::get_machine())
+    .only_kind(Memory::SYSTEM_MEM)
+    .has_affinity_to(p)
+    .first();
+  assert(sysmem.exists());
+
+  RegionInstance sysinst, checkinst;
+  RegionInstance::create_instance(sysinst, sysmem, is, field_sizes,
+				  0 /*SOA*/, ProfilingRequestSet()).wait();
+  RegionInstance::create_instance(checkinst, sysmem, is, field_sizes,
+				  0 /*SOA*/, ProfilingRequestSet()).wait();
+  {
+    AffineAccessor<ElemType, 1> sa(sysinst, 0);
+    for(size_t i = 0; i < elements; i++)
+      sa[i] = i * 3;
+  }
+
+  // file memory - the file has to exist and be big enough
+  {
+    std::string filename = file_dir + "/file_bw.dat";
+    int fd = open(filename.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0666);
+    assert(fd >= 0);
+    int ret = ftruncate(fd, elements * sizeof(ElemType));
+    assert(ret == 0);
+    close(fd);
+
+    std::vector<FieldID> field_ids(1, 0);
+    RegionInstance fileinst;
+    RegionInstance::create_file_instance(fileinst, filename.c_str(), is,
+					 field_ids, field_sizes,
+					 LEGION_FILE_READ_WRITE,
+					 ProfilingRequestSet()).wait();
+    test_instance("file", is, fileinst, sysinst, checkinst);
+    fileinst.destroy();
+    unlink(filename.c_str());
+  }
+
+  // disk memory, if it's big enough
+  Memory diskmem = Machine::MemoryQuery(Machine::get_machine())
+    .only_kind(Memory::DISK_MEM)
+    .first();
+  if(diskmem.exists() &&
+     (diskmem.capacity() >= (elements * sizeof(ElemType)))) {
+    // reset the source data
+    AffineAccessor<ElemType, 1> sa(sysinst, 0);
+    for(size_t i = 0; i < elements; i++)
+      sa[i] = i * 3;
+
+    RegionInstance diskinst;
+    RegionInstance::create_instance(diskinst, diskmem, is, field_sizes,
+				    0 /*SOA*/, ProfilingRequestSet()).wait();
+    test_instance("disk", is, diskinst, sysinst, checkinst);
+    diskinst.destroy();
+  } else
+    log_app.info() << "skipping disk memory test - use -ll:dsize " << size_in_mb;
+
+  sysinst.destroy();
+  checkinst.destroy();
+
+  if(errors > 0)
+    log_app.error() << errors << " errors seen";
+  else
+    log_app.print() << "all checks passed";
+
+  Runtime::get_runtime().shutdown(Event::NO_EVENT, (errors > 0) ? 1 : 0);
+}
+
+int main(int argc, char **argv)
+{
+  Runtime rt;
+
+  rt.init(&argc, &argv);
+
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "-s")) {
+      size_in_mb = strtoll(argv[++i], 0, 10);
+      continue;
+    }
+    if(!strcmp(argv[i], "-r")) {
+      num_reps = atoi(argv[++i]);
+      continue;
+    }
+    if(!strcmp(argv[i], "-d")) {
+      file_dir = argv[++i];
+      continue;
+    }
+  }
+
+  rt.register_task(TOP_LEVEL_TASK, top_level_task);
+
+  Processor p = Machine::ProcessorQuery(Machine::get_machine())
+    .only_kind(Processor::LOC_PROC)
+    .first();
+  assert(p.exists());
+
+  // the top level task requests shutdown itself, with an error code if
+  //  anything went wrong
+  rt.collective_spawn(p, TOP_LEVEL_TASK, 0, 0);
+
+  return rt.wait_for_shutdown();
+}
@@ -0,0 +1,193 @@
+/* Copyright 2018 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Times repeated index space launches over the same partition and launch
+// domain with a projection functor that is either declared functional
+// (so the runtime can reuse its results from the previous launch) or not,
+// and checks that every point task got the subregion the functor computes
+// and that the functional functor was only invoked for the first launch
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+
+#include "legion.h"
+#include "realm/timers.h"
+
+using namespace Legion;
+
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+  CHECK_TASK_ID,
+};
+
+enum FieldIDs {
+  FID_VAL,
+};
+
+enum ProjectionIDs {
+  SHIFT_PROJ_ID = 1,
+  SHIFT_FUNCTIONAL_PROJ_ID = 2,
+};
+
+static int num_points = 1000;
+static int num_reps = 10;
+static int errors = 0;
+
+static void parse_args(void)
+{
+  const InputArgs &args = Runtime::get_input_args();
+  for (int i = 1; i < args.argc; i++)
+  {
+    if (!strcmp(args.argv[i], "-n"))
+      num_points = atoi(args.argv[++i]);
+    else if (!strcmp(args.argv[i], "-r"))
+      num_reps = atoi(args.argv[++i]);
+  }
+  assert(num_points > 0);
+  assert(num_reps > 0);
+}
+
+// Each point uses its right neighbor's subregion (wrapping around)
+class ShiftProjectionFunctor : public ProjectionFunctor {
+public:
+  ShiftProjectionFunctor(bool func)
+    : functional(func), calls(0) { }
+public:
+  virtual LogicalRegion project(const Mappable *mappable, unsigned index,
+                                LogicalRegion upper_bound,
+                                const DomainPoint &point)
+  {
+    assert(false);
+    return LogicalRegion::NO_REGION;
+  }
+  virtual LogicalRegion project(const Mappable *mappable, unsigned index,
+                                LogicalPartition upper_bound,
+                                const DomainPoint &point)
+  {
+    __sync_fetch_and_add(&calls, 1);
+    const DomainPoint next(Point<1>((point[0] + 1) % num_points));
+    return runtime->get_logical_subregion_by_color(upper_bound, next);
+  }
+  virtual bool is_exclusive(void) const { return true; }
+  virtual bool is_functional(void) const { return functional; }
+  virtual unsigned get_depth(void) const { return 0; }
+public:
+  const bool functional;
+  int calls;
+};
+
+static ShiftProjectionFunctor *plain_functor = NULL;
+static ShiftProjectionFunctor *functional_functor = NULL;
+
+void check_task(const Task *task,
+                const std::vector<PhysicalRegion> &regions,
+                Context ctx, Runtime *runtime)
+{
+  const LogicalPartition lp = *(const LogicalPartition*)task->args;
+  const DomainPoint next(Point<1>((task->index_point[0] + 1) % num_points));
+  if (task->regions[0].region !=
+      runtime->get_logical_subregion_by_color(lp, next))
+    __sync_fetch_and_add(&errors, 1);
+}
+
+static double time_launches(Context ctx, Runtime *runtime, ProjectionID pid,
+                            LogicalRegion lr, LogicalPartition lp,
+                            IndexSpace color_space)
+{
+  IndexTaskLauncher launcher(CHECK_TASK_ID, color_space,
+                             TaskArgument(&lp, sizeof(lp)), ArgumentMap());
+  launcher.add_region_requirement(
+      RegionRequirement(lp, pid, READ_ONLY, EXCLUSIVE, lr));
+  launcher.add_field(0, FID_VAL);
+  // Warm up the mapper's instances before timing
+  runtime->execute_index_space(ctx, launcher).wait_all_results();
+  long long start = Realm::Clock::current_time_in_nanoseconds();
+  for (int rep = 0; rep < num_reps; rep++)
+    runtime->execute_index_space(ctx, launcher);
+  runtime->issue_execution_fence(ctx);
+  runtime->execute_index_space(ctx, launcher).wait_all_results();
+  long long stop = Realm::Clock::current_time_in_nanoseconds();
+  return (stop - start) * 1e-9 / (num_reps + 1);
+}
+
+void top_level_task(const Task *task,
+                    const std::vector<PhysicalRegion> &regions,
+                    Context ctx, Runtime *runtime)
+{
+  parse_args();
+  printf("Index launch throughput (%d points, %d reps)\n",
+         num_points, num_reps);
+  IndexSpace is = runtime->create_index_space(ctx,
+                        Rect<1>(0, 4 * num_points - 1));
+  IndexSpace color_space = runtime->create_index_space(ctx,
+                        Rect<1>(0, num_points - 1));
+  FieldSpace fs = runtime->create_field_space(ctx);
+  {
+    FieldAllocator allocator = runtime->create_field_allocator(ctx, fs);
+    allocator.allocate_field(sizeof(int), FID_VAL);
+  }
+  LogicalRegion lr = runtime->create_logical_region(ctx, is, fs);
+  IndexPartition ip = runtime->create_equal_partition(ctx, is, color_space);
+  LogicalPartition lp = runtime->get_logical_partition(ctx, lr, ip);
+  const int zero = 0;
+  runtime->fill_field(ctx, lr, lr, FID_VAL, &zero, sizeof(zero));
+
+  double plain = time_launches(ctx, runtime, SHIFT_PROJ_ID,
+                               lr, lp, color_space);
+  double functional = time_launches(ctx, runtime, SHIFT_FUNCTIONAL_PROJ_ID,
+                                    lr, lp, color_space);
+  printf("  plain functor:      %8.3f ms per launch, %d projections\n",
+         plain * 1e3, plain_functor->calls);
+  printf("  functional functor: %8.3f ms per launch, %d projections\n",
+         functional * 1e3, functional_functor->calls);
+  // Every launch after the first one should reuse the memoized results
+  if (functional_functor->calls != num_points)
+    errors++;
+
+  runtime->destroy_logical_region(ctx, lr);
+  runtime->destroy_field_space(ctx, fs);
+  runtime->destroy_index_space(ctx, color_space);
+  runtime->destroy_index_space(ctx, is);
+
+  if (errors > 0)
+  {
+    printf("%d errors\n", errors);
+    assert(false);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    Runtime::preregister_task_variant<top_level_task>(registrar, "top_level");
+  }
+  {
+    TaskVariantRegistrar registrar(CHECK_TASK_ID, "check");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<check_task>(registrar, "check");
+  }
+  plain_functor = new ShiftProjectionFunctor(false/*functional*/);
+  functional_functor = new ShiftProjectionFunctor(true/*functional*/);
+  Runtime::preregister_projection_functor(SHIFT_PROJ_ID, plain_functor);
+  Runtime::preregister_projection_functor(SHIFT_FUNCTIONAL_PROJ_ID,
+                                          functional_functor);
+  return Runtime::start(argc, argv);
+}
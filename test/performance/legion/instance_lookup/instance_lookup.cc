@@ -0,0 +1,164 @@
+/* Copyright 2018 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the latency of MemoryManager instance lookups (as seen by
+// a mapper calling find_physical_instance) as the number of instances
+// resident in the target memory grows
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <vector>
+
+#include "legion.h"
+#include "default_mapper.h"
+#include "realm/timers.h"
+
+using namespace Legion;
+using namespace Legion::Mapping;
+
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+};
+
+enum FieldIDs {
+  FID_VAL,
+};
+
+enum MappingTags {
+  PROBE_TAG = 1,
+};
+
+static int num_instances = 4096;
+static int num_lookups = 1000;
+static int current_instances = 0;
+
+static void parse_args(void)
+{
+  const InputArgs &args = Runtime::get_input_args();
+  for (int i = 1; i < args.argc; i++)
+  {
+    if (!strcmp(args.argv[i], "-n"))
+      num_instances = atoi(args.argv[++i]);
+    else if (!strcmp(args.argv[i], "-l"))
+      num_lookups = atoi(args.argv[++i]);
+  }
+  assert(num_instances > 0);
+  assert(num_lookups > 0);
+}
+
+class InstanceLookupMapper : public DefaultMapper {
+public:
+  InstanceLookupMapper(MapperRuntime *rt, Machine machine, Processor local)
+    : DefaultMapper(rt, machine, local, "instance_lookup_mapper") { }
+public:
+  virtual void map_inline(const MapperContext ctx,
+                          const InlineMapping &inline_op,
+                          const MapInlineInput &input,
+                                MapInlineOutput &output)
+  {
+    if (inline_op.requirement.tag == PROBE_TAG)
+    {
+      Memory target = default_policy_select_target_memory(ctx,
+                                inline_op.parent_task->current_proc,
+                                inline_op.requirement);
+      LayoutConstraintSet constraints;
+      constraints.add_constraint(FieldConstraint(
+            inline_op.requirement.privilege_fields, false/*contiguous*/));
+      std::vector<LogicalRegion> regions(1, inline_op.requirement.region);
+      PhysicalInstance result;
+      int found = 0;
+      long long start = Realm::Clock::current_time_in_nanoseconds();
+      for (int i = 0; i < num_lookups; i++)
+        if (runtime->find_physical_instance(ctx, target, constraints,
+                              regions, result, false/*acquire*/))
+          found++;
+      long long stop = Realm::Clock::current_time_in_nanoseconds();
+      assert(found == num_lookups);
+      printf("  %8d instances: %10.1f ns/lookup\n", current_instances,
+             double(stop - start) / num_lookups);
+    }
+    DefaultMapper::map_inline(ctx, inline_op, input, output);
+  }
+};
+
+static void map_region_once(Context ctx, Runtime *runtime, LogicalRegion lr,
+                            MappingTagID tag = 0)
+{
+  InlineLauncher launcher(RegionRequirement(lr, READ_WRITE, EXCLUSIVE, lr, tag)
+                            .add_field(FID_VAL));
+  PhysicalRegion pr = runtime->map_region(ctx, launcher);
+  pr.wait_until_valid();
+  runtime->unmap_region(ctx, pr);
+}
+
+void top_level_task(const Task *task,
+                    const std::vector<PhysicalRegion> &regions,
+                    Context ctx, Runtime *runtime)
+{
+  parse_args();
+  printf("Instance lookup latency (%d lookups per sample)\n", num_lookups);
+  IndexSpace is = runtime->create_index_space(ctx, Rect<1>(0, 15));
+  FieldSpace fs = runtime->create_field_space(ctx);
+  {
+    FieldAllocator allocator = runtime->create_field_allocator(ctx, fs);
+    allocator.allocate_field(sizeof(double), FID_VAL);
+  }
+  // Every logical region gets its own tree and its own instance
+  std::vector<LogicalRegion> trees;
+  int next_sample = 1;
+  for (int i = 0; i < num_instances; i++)
+  {
+    LogicalRegion lr = runtime->create_logical_region(ctx, is, fs);
+    trees.push_back(lr);
+    map_region_once(ctx, runtime, lr);
+    if ((i+1) == next_sample)
+    {
+      current_instances = i+1;
+      // Probe a region from the middle of the pack so it is not always
+      // the first or the last instance that the memory manager sees
+      map_region_once(ctx, runtime, trees[i/2], PROBE_TAG);
+      next_sample *= 2;
+    }
+  }
+  for (std::vector<LogicalRegion>::const_iterator it =
+        trees.begin(); it != trees.end(); it++)
+    runtime->destroy_logical_region(ctx, *it);
+  runtime->destroy_field_space(ctx, fs);
+  runtime->destroy_index_space(ctx, is);
+}
+
+static void create_mappers(Machine machine, Runtime *runtime,
+                           const std::set<Processor> &local_procs)
+{
+  for (std::set<Processor>::const_iterator it = local_procs.begin();
+        it != local_procs.end(); it++)
+    runtime->replace_default_mapper(
+        new InstanceLookupMapper(runtime->get_mapper_runtime(), machine, *it),
+        *it);
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    Runtime::preregister_task_variant<top_level_task>(registrar, "top_level");
+  }
+  Runtime::add_registration_callback(create_mappers);
+  return Runtime::start(argc, argv);
+}
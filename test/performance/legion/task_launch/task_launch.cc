@@ -0,0 +1,97 @@
+/* Copyright 2018 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures how many empty leaf tasks a parent task can launch per second,
+// which is dominated by the runtime's per-child-operation overheads in
+// the parent's context rather than by the tasks themselves
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+
+#include "legion.h"
+#include "realm/timers.h"
+
+using namespace Legion;
+
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+  EMPTY_TASK_ID,
+};
+
+static int num_tasks = 100000;
+static int num_reps = 3;
+
+static void parse_args(void)
+{
+  const InputArgs &args = Runtime::get_input_args();
+  for (int i = 1; i < args.argc; i++)
+  {
+    if (!strcmp(args.argv[i], "-n"))
+      num_tasks = atoi(args.argv[++i]);
+    else if (!strcmp(args.argv[i], "-r"))
+      num_reps = atoi(args.argv[++i]);
+  }
+  assert(num_tasks > 0);
+  assert(num_reps > 0);
+}
+
+void empty_task(const Task *task,
+                const std::vector<PhysicalRegion> &regions,
+                Context ctx, Runtime *runtime)
+{
+}
+
+void top_level_task(const Task *task,
+                    const std::vector<PhysicalRegion> &regions,
+                    Context ctx, Runtime *runtime)
+{
+  parse_args();
+  printf("Task launch throughput (%d empty tasks per rep)\n", num_tasks);
+  TaskLauncher launcher(EMPTY_TASK_ID, TaskArgument(NULL, 0));
+  for (int rep = 0; rep < num_reps; rep++)
+  {
+    long long start = Realm::Clock::current_time_in_nanoseconds();
+    for (int i = 0; i < num_tasks; i++)
+      runtime->execute_task(ctx, launcher);
+    long long launched = Realm::Clock::current_time_in_nanoseconds();
+    // Wait for all the children to finish before stopping the clock by
+    // waiting on one more task launched after an execution fence
+    runtime->issue_execution_fence(ctx);
+    runtime->execute_task(ctx, launcher).get_void_result();
+    long long stop = Realm::Clock::current_time_in_nanoseconds();
+    printf("  rep %d: %10.0f launches/s issued, %10.0f tasks/s completed\n",
+           rep, num_tasks * 1e9 / double(launched - start),
+           num_tasks * 1e9 / double(stop - start));
+  }
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    Runtime::preregister_task_variant<top_level_task>(registrar, "top_level");
+  }
+  {
+    TaskVariantRegistrar registrar(EMPTY_TASK_ID, "empty");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<empty_task>(registrar, "empty");
+  }
+  return Runtime::start(argc, argv);
+}
@@ -0,0 +1,184 @@
+/* Copyright 2018 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the cost of mapping tasks onto a single instance with many
+// fields as the number of outstanding users of that instance grows.
+// Each task reads a small group of the fields and waits on a phase
+// barrier that is only arrived at once every task has been mapped,
+// so none of the users can be pruned from the instance's view. Run it
+// with a task window and scheduling window (-lg:window, -lg:sched)
+// larger than the number of tasks, since none of them can finish.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <unistd.h>
+#include <vector>
+
+#include "legion.h"
+#include "default_mapper.h"
+#include "realm/timers.h"
+
+using namespace Legion;
+using namespace Legion::Mapping;
+
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+  READER_TASK_ID,
+};
+
+static int num_fields = 256;
+static int fields_per_task = 2;
+static int num_tasks = 4096;
+static int tasks_mapped = 0;
+static int tasks_run = 0;
+
+static void parse_args(void)
+{
+  const InputArgs &args = Runtime::get_input_args();
+  for (int i = 1; i < args.argc; i++)
+  {
+    if (!strcmp(args.argv[i], "-f"))
+      num_fields = atoi(args.argv[++i]);
+    else if (!strcmp(args.argv[i], "-g"))
+      fields_per_task = atoi(args.argv[++i]);
+    else if (!strcmp(args.argv[i], "-t"))
+      num_tasks = atoi(args.argv[++i]);
+  }
+  assert((num_fields > 0) && (num_fields <= MAX_FIELDS));
+  assert((fields_per_task > 0) && (fields_per_task <= num_fields));
+  assert(num_tasks > 0);
+}
+
+void reader_task(const Task *task,
+                 const std::vector<PhysicalRegion> &regions,
+                 Context ctx, Runtime *runtime)
+{
+  __sync_fetch_and_add(&tasks_run, 1);
+}
+
+// Counts the reader tasks that have been mapped, since a mapping fence
+// would also wait for the gated readers to run
+class ViewUsersMapper : public DefaultMapper {
+public:
+  ViewUsersMapper(MapperRuntime *rt, Machine machine, Processor local)
+    : DefaultMapper(rt, machine, local, "view_users_mapper") { }
+public:
+  virtual void map_task(const MapperContext ctx,
+                        const Task &task,
+                        const MapTaskInput &input,
+                              MapTaskOutput &output)
+  {
+    DefaultMapper::map_task(ctx, task, input, output);
+    if (task.task_id == READER_TASK_ID)
+      __sync_fetch_and_add(&tasks_mapped, 1);
+  }
+};
+
+void top_level_task(const Task *task,
+                    const std::vector<PhysicalRegion> &regions,
+                    Context ctx, Runtime *runtime)
+{
+  parse_args();
+  printf("View user scaling (%d fields, %d fields per task)\n",
+         num_fields, fields_per_task);
+  IndexSpace is = runtime->create_index_space(ctx, Rect<1>(0, 63));
+  FieldSpace fs = runtime->create_field_space(ctx);
+  {
+    FieldAllocator allocator = runtime->create_field_allocator(ctx, fs);
+    for (int fid = 0; fid < num_fields; fid++)
+      allocator.allocate_field(sizeof(int), fid);
+  }
+  LogicalRegion lr = runtime->create_logical_region(ctx, is, fs);
+  // Make a single instance with all the fields for the readers to share
+  {
+    RegionRequirement req(lr, WRITE_DISCARD, EXCLUSIVE, lr);
+    for (int fid = 0; fid < num_fields; fid++)
+      req.add_field(fid);
+    PhysicalRegion pr = runtime->map_region(ctx, InlineLauncher(req));
+    pr.wait_until_valid();
+    runtime->unmap_region(ctx, pr);
+  }
+  PhaseBarrier gate = runtime->create_phase_barrier(ctx, 1);
+  // Waiting on a phase barrier means waiting for the previous generation
+  const PhaseBarrier opened = runtime->advance_phase_barrier(ctx, gate);
+  const int num_groups = num_fields / fields_per_task;
+  std::vector<Future> futures;
+  int launched = 0;
+  for (int batch = 256; launched < num_tasks; batch *= 2)
+  {
+    if (batch > (num_tasks - launched))
+      batch = num_tasks - launched;
+    long long start = Realm::Clock::current_time_in_nanoseconds();
+    for (int i = 0; i < batch; i++, launched++)
+    {
+      TaskLauncher launcher(READER_TASK_ID, TaskArgument());
+      RegionRequirement req(lr, READ_ONLY, EXCLUSIVE, lr);
+      const int first = (launched % num_groups) * fields_per_task;
+      for (int fid = first; fid < (first + fields_per_task); fid++)
+        req.add_field(fid);
+      launcher.add_region_requirement(req);
+      launcher.add_wait_barrier(opened);
+      futures.push_back(runtime->execute_task(ctx, launcher));
+    }
+    while (*(volatile int*)&tasks_mapped < launched)
+      usleep(100);
+    long long stop = Realm::Clock::current_time_in_nanoseconds();
+    printf("  %8d users: %10.1f us/task\n", launched,
+           double(stop - start) * 1e-3 / batch);
+  }
+  gate.arrive();
+  for (std::vector<Future>::const_iterator it =
+        futures.begin(); it != futures.end(); it++)
+    it->get_void_result();
+
+  runtime->destroy_phase_barrier(ctx, gate);
+  runtime->destroy_logical_region(ctx, lr);
+  runtime->destroy_field_space(ctx, fs);
+  runtime->destroy_index_space(ctx, is);
+  if (tasks_run != num_tasks)
+  {
+    printf("only %d of %d tasks ran\n", tasks_run, num_tasks);
+    assert(false);
+  }
+}
+
+static void create_mappers(Machine machine, Runtime *runtime,
+                           const std::set<Processor> &local_procs)
+{
+  for (std::set<Processor>::const_iterator it = local_procs.begin();
+        it != local_procs.end(); it++)
+    runtime->replace_default_mapper(
+        new ViewUsersMapper(runtime->get_mapper_runtime(), machine, *it), *it);
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    Runtime::preregister_task_variant<top_level_task>(registrar, "top_level");
+  }
+  {
+    TaskVariantRegistrar registrar(READER_TASK_ID, "reader");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<reader_task>(registrar, "reader");
+  }
+  Runtime::add_registration_callback(create_mappers);
+  return Runtime::start(argc, argv);
+}
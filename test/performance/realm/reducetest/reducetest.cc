@@ -19,6 +19,7 @@
 #include <cassert>
 #include <cstring>
 #include <set>
+#include <vector>
 #include <time.h>
 
 #include <realm.h>
@@ -215,6 +216,70 @@ static void run_case(const char *name, int task_id,
   printf("ELAPSED(%s) = %f\n", name, (end_time - start_time)*1e-6);
 }		     
 
+// compares the scalar and vectorized paths of a built-in reduction op by
+//  applying/folding 'elems' elements 'reps' times (with the given element
+//  stride, in units of elements) and checking that both give the same answer
+template <class REDOP>
+static void run_kernel_case(const char *name, int elems, int reps, int stride)
+{
+  typedef typename REDOP::RHS T;
+  ReductionOpUntyped *redop = ReductionOpUntyped::create_reduction_op<REDOP>();
+  std::vector<T> rhs(elems * stride), lhs_scalar(elems * stride), lhs_vector(elems * stride);
+  srand48(12345);
+  for(size_t i = 0; i < rhs.size(); i++) {
+    // keep products and sums from blowing up (or rounding differently)
+    rhs[i] = (T)(1 + (lrand48() & 1));
+    lhs_scalar[i] = lhs_vector[i] = (T)(lrand48() & 255);
+  }
+  off_t bytes = stride * sizeof(T);
+
+  double elapsed[2];
+  for(int pass = 0; pass < 2; pass++) {
+    T *lhs = (pass == 0) ? &lhs_scalar[0] : &lhs_vector[0];
+    ReductionKernels::set_max_isa((pass == 0) ? ReductionKernels::ISA_SCALAR :
+				                ReductionKernels::ISA_AVX512);
+    double start_time = Realm::Clock::current_time_in_microseconds();
+    for(int r = 0; r < reps; r++) {
+      if(stride == 1) {
+	if(r & 1)
+	  redop->fold(lhs, &rhs[0], elems, true /*exclusive*/);
+	else
+	  redop->apply(lhs, &rhs[0], elems, true /*exclusive*/);
+      } else {
+	if(r & 1)
+	  redop->fold_strided(lhs, &rhs[0], bytes, bytes, elems, true /*exclusive*/);
+	else
+	  redop->apply_strided(lhs, &rhs[0], bytes, bytes, elems, true /*exclusive*/);
+      }
+    }
+    double end_time = Realm::Clock::current_time_in_microseconds();
+    elapsed[pass] = (end_time - start_time) * 1e-6;
+  }
+  ReductionKernels::set_max_isa(ReductionKernels::ISA_AVX512);
+
+  bool match = (lhs_scalar == lhs_vector);
+  printf("KERNEL(%s, stride=%d): scalar=%f vector=%f speedup=%.2f%s\n",
+	 name, stride, elapsed[0], elapsed[1], elapsed[0] / elapsed[1],
+	 match ? "" : " MISMATCH");
+  assert(match);
+  delete redop;
+}
+
+static void run_kernel_cases(int elems, int reps)
+{
+  static const char *isa_names[] = { "scalar", "sse2", "avx2", "avx512" };
+  printf("reduction kernels using %s\n", isa_names[ReductionKernels::get_isa()]);
+  for(int stride = 1; stride <= 4; stride += 3) {
+    run_kernel_case<SumReduction<double> >("sum<double>", elems, reps, stride);
+    run_kernel_case<ProdReduction<double> >("prod<double>", elems, reps, stride);
+    run_kernel_case<MinReduction<double> >("min<double>", elems, reps, stride);
+    run_kernel_case<MaxReduction<double> >("max<double>", elems, reps, stride);
+    run_kernel_case<SumReduction<float> >("sum<float>", elems, reps, stride);
+    run_kernel_case<SumReduction<int32_t> >("sum<int32_t>", elems, reps, stride);
+    run_kernel_case<MaxReduction<int64_t> >("max<int64_t>", elems, reps, stride);
+  }
+}
+
 void top_level_task(const void *args, size_t arglen, 
                     const void *userdata, size_t userlen, Processor p)
 {
@@ -224,6 +289,8 @@ void top_level_task(const void *args, size_t arglen,
   int seed1 = 12345;
   int seed2 = 54321;
   int do_slow = 0;
+  int kernel_elems = 1 << 20;
+  int kernel_reps = 20;
 
   // Parse the input arguments
 #define INT_ARG(argname, varname) do { \
@@ -246,6 +313,8 @@ void top_level_task(const void *args, size_t arglen,
       INT_ARG("-buckets", buckets);
       INT_ARG("-batches", num_batches);
       INT_ARG("-bsize", batch_size);
+      INT_ARG("-kelems", kernel_elems);
+      INT_ARG("-kreps", kernel_reps);
     }
   }
 #undef INT_ARG
@@ -283,6 +352,9 @@ void top_level_task(const void *args, size_t arglen,
   if(do_slow)
     run_case("redsingle", HIST_BATCH_REDSINGLE_TASK, hbargs, num_batches, false);
 
+  if(kernel_elems > 0)
+    run_kernel_cases(kernel_elems, kernel_reps);
+
 #if 0
   {
     RegionInstanceAccessor<BucketType,AccessorGeneric> ria = hist_inst.get_accessor();
@@ -0,0 +1,211 @@
+// Copyright 2018 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// test for Machine::ProcessorQuery and Machine::MemoryQuery - results are
+//  checked against a brute force search of the machine's affinities, and
+//  the cost of repeatedly issuing the same query is reported
+//
+// usage: machine_queries [-r <repetitions>]
+
+#include "realm.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <set>
+#include <vector>
+
+using namespace Realm;
+
+Logger log_app("app");
+
+enum {
+  TOP_LEVEL_TASK = Processor::TASK_ID_FIRST_AVAILABLE+0,
+};
+
+static int num_reps = 10000;
+static int errors = 0;
+
+// iterates a query and checks it against the expected results
+template <typename QT, typename T>
+static void check_query(const char *name, const QT& query,
+			const std::set<T>& expected)
+{
+  std::set<T> seen;
+  size_t count = 0;
+  for(T t = query.first(); t.exists(); t = query.next(t)) {
+    if(seen.count(t)) {
+      log_app.error() << name << ": " << t << " returned twice";
+      errors++;
+      return;
+    }
+    seen.insert(t);
+    count++;
+  }
+  if(seen != expected) {
+    log_app.error() << name << ": got " << seen.size() << " results, expected "
+		    << expected.size();
+    errors++;
+  }
+  if(query.count() != count) {
+    log_app.error() << name << ": count() = " << query.count()
+		    << ", iteration saw " << count;
+    errors++;
+  }
+  T r = query.random();
+  if(expected.empty() ? r.exists() : (expected.count(r) == 0)) {
+    log_app.error() << name << ": random() returned " << r;
+    errors++;
+  }
+}
+
+void top_level_task(const void *args, size_t arglen,
+		    const void *userdata, size_t userlen, Processor p)
+{
+  Machine machine = Machine::get_machine();
+  std::vector<Machine::ProcessorMemoryAffinity> pmas;
+  machine.get_proc_mem_affinity(pmas, Processor::NO_PROC, Memory::NO_MEMORY,
+				false /*!local_only*/);
+  std::vector<Machine::MemoryMemoryAffinity> mmas;
+  machine.get_mem_mem_affinity(mmas, Memory::NO_MEMORY, Memory::NO_MEMORY,
+			       false /*!local_only*/);
+
+  std::set<Processor> all_procs;
+  std::set<Memory> all_mems;
+  for(size_t i = 0; i < pmas.size(); i++) {
+    all_procs.insert(pmas[i].p);
+    all_mems.insert(pmas[i].m);
+  }
+  for(size_t i = 0; i < mmas.size(); i++) {
+    all_mems.insert(mmas[i].m1);
+    all_mems.insert(mmas[i].m2);
+  }
+
+  check_query("all procs", Machine::ProcessorQuery(machine), all_procs);
+  check_query("all mems", Machine::MemoryQuery(machine), all_mems);
+
+  // kind restrictions, including contradictory ones
+  {
+    std::set<Processor> cpus, local_cpus;
+    for(std::set<Processor>::const_iterator it = all_procs.begin();
+	it != all_procs.end();
+	++it)
+      if(it->kind() == Processor::LOC_PROC) {
+	cpus.insert(*it);
+	if(it->address_space() == p.address_space())
+	  local_cpus.insert(*it);
+      }
+    check_query("cpus", Machine::ProcessorQuery(machine)
+		.only_kind(Processor::LOC_PROC), cpus);
+    check_query("cpus and utils", Machine::ProcessorQuery(machine)
+		.only_kind(Processor::LOC_PROC)
+		.only_kind(Processor::UTIL_PROC), std::set<Processor>());
+    check_query("local cpus", Machine::ProcessorQuery(machine)
+		.only_kind(Processor::LOC_PROC)
+		.local_address_space(), local_cpus);
+  }
+
+  // affinity predicates, in both orders
+  for(std::set<Memory>::const_iterator it = all_mems.begin();
+      it != all_mems.end();
+      ++it) {
+    std::set<Processor> expected;
+    for(size_t i = 0; i < pmas.size(); i++)
+      if((pmas[i].m == *it) && (pmas[i].p.kind() == Processor::LOC_PROC))
+	expected.insert(pmas[i].p);
+    check_query("cpus with affinity", Machine::ProcessorQuery(machine)
+		.only_kind(Processor::LOC_PROC)
+		.has_affinity_to(*it), expected);
+    check_query("cpus with affinity (reordered)", Machine::ProcessorQuery(machine)
+		.has_affinity_to(*it)
+		.only_kind(Processor::LOC_PROC), expected);
+  }
+  for(std::set<Processor>::const_iterator it = all_procs.begin();
+      it != all_procs.end();
+      ++it) {
+    std::set<Memory> expected;
+    for(size_t i = 0; i < pmas.size(); i++)
+      if(pmas[i].p == *it)
+	expected.insert(pmas[i].m);
+    check_query("mems with affinity", Machine::MemoryQuery(machine)
+		.has_affinity_to(*it), expected);
+  }
+
+  // modifying a copy of an evaluated query must not change the original
+  {
+    Machine::MemoryQuery q1(machine);
+    size_t total = q1.count();
+    Machine::MemoryQuery q2(q1);
+    q2.only_kind(Memory::SYSTEM_MEM).only_kind(Memory::GLOBAL_MEM);
+    if((q1.count() != total) || (q2.count() != 0)) {
+      log_app.error() << "copied query: " << q1.count() << " != " << total
+		      << " or " << q2.count() << " != 0";
+      errors++;
+    }
+  }
+
+  // the way a mapper typically asks - a new query object every time
+  double t1 = Clock::current_time();
+  size_t total = 0;
+  for(int i = 0; i < num_reps; i++) {
+    Machine::MemoryQuery mq(machine);
+    mq.only_kind(Memory::SYSTEM_MEM).has_affinity_to(p);
+    for(Machine::MemoryQuery::iterator it = mq.begin(); it != mq.end(); ++it)
+      total++;
+    Machine::ProcessorQuery pq(machine);
+    pq.only_kind(Processor::LOC_PROC);
+    for(Machine::ProcessorQuery::iterator it = pq.begin(); it != pq.end(); ++it)
+      total++;
+  }
+  double t2 = Clock::current_time();
+  log_app.print() << "procs=" << all_procs.size() << " mems=" << all_mems.size()
+		  << " repeated queries: " << ((t2 - t1) * 1e6 / num_reps)
+		  << " us/rep (" << total << " results)";
+
+  if(errors > 0)
+    log_app.error() << errors << " errors seen";
+  else
+    log_app.print() << "all checks passed";
+
+  Runtime::get_runtime().shutdown(Event::NO_EVENT, (errors > 0) ? 1 : 0);
+}
+
+int main(int argc, char **argv)
+{
+  Runtime rt;
+
+  rt.init(&argc, &argv);
+
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "-r")) {
+      num_reps = atoi(argv[++i]);
+      continue;
+    }
+  }
+
+  rt.register_task(TOP_LEVEL_TASK, top_level_task);
+
+  Processor p = Machine::ProcessorQuery(Machine::get_machine())
+    .only_kind(Processor::LOC_PROC)
+    .first();
+  assert(p.exists());
+
+  // the top level task requests shutdown itself, with an error code if
+  //  anything went wrong
+  rt.collective_spawn(p, TOP_LEVEL_TASK, 0, 0);
+
+  return rt.wait_for_shutdown();
+}
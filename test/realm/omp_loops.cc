@@ -0,0 +1,265 @@
+// tests the worksharing loop support of Realm's OpenMP runtime - every
+//  schedule must run every iteration exactly once, and dynamic/guided
+//  schedules should balance a triangular loop better than a static one
+//
+// usage: omp_loops [-n <iterations>] [-w <work per iteration>]
+//
+// needs an OpenMP processor (e.g. -ll:ocpu 1 -ll:othr 4) and must be built
+//  with -fopenmp and linked against Realm (not the compiler's OpenMP
+//  runtime)
+
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+#include <omp.h>
+
+#include "realm.h"
+
+using namespace Realm;
+
+// Task IDs, some IDs are reserved so start at first available number
+enum {
+  TOP_LEVEL_TASK = Processor::TASK_ID_FIRST_AVAILABLE+0,
+  OMP_TASK       = Processor::TASK_ID_FIRST_AVAILABLE+1,
+};
+
+static int num_iterations = 10000;
+static int work_per_iteration = 200;
+
+static std::vector<int> hits;
+
+static void clear_hits(void)
+{
+  hits.assign(num_iterations, 0);
+}
+
+static int check_hits(const char *name)
+{
+  int errors = 0;
+  for(int i = 0; i < num_iterations; i++)
+    if(hits[i] != 1) {
+      if(errors < 10)
+	printf("ERROR: %s: iteration %d executed %d times\n", name, i, hits[i]);
+      errors++;
+    }
+  if(!errors)
+    printf("%s: ok\n", name);
+  return errors;
+}
+
+static inline void hit(long i)
+{
+  __sync_fetch_and_add(&hits[i], 1);
+}
+
+// iteration i costs O(i) so that equal-sized blocks are badly unbalanced
+static double triangular_work(long i)
+{
+  volatile double x = 0;
+  for(long j = 0; j < (i * work_per_iteration) / num_iterations; j++)
+    x += 1.0 / (j + 1);
+  return x;
+}
+
+static int test_schedules(void)
+{
+  int errors = 0;
+  const int n = num_iterations;
+
+  clear_hits();
+#pragma omp parallel for schedule(dynamic)
+  for(int i = 0; i < n; i++)
+    hit(i);
+  errors += check_hits("dynamic");
+
+  clear_hits();
+#pragma omp parallel for schedule(dynamic, 7)
+  for(int i = 0; i < n; i++)
+    hit(i);
+  errors += check_hits("dynamic,7");
+
+  clear_hits();
+#pragma omp parallel for schedule(guided, 3)
+  for(int i = 0; i < n; i++)
+    hit(i);
+  errors += check_hits("guided,3");
+
+  clear_hits();
+#pragma omp parallel for schedule(runtime)
+  for(int i = 0; i < n; i++)
+    hit(i);
+  errors += check_hits("runtime");
+
+  // negative strides
+  clear_hits();
+#pragma omp parallel for schedule(dynamic, 5)
+  for(int i = n - 1; i >= 0; i -= 2)
+    hit(i);
+#pragma omp parallel for schedule(guided)
+  for(int i = n - 2; i >= 0; i -= 2)
+    hit(i);
+  errors += check_hits("negative stride");
+
+  // unsigned long long induction variables
+  clear_hits();
+#pragma omp parallel for schedule(dynamic, 4)
+  for(unsigned long long i = 0; i < (unsigned long long)n; i++)
+    hit(i);
+  errors += check_hits("dynamic ull");
+
+  // several worksharing loops in one parallel region, most without a
+  //  barrier between them so that threads run ahead into later loops
+  {
+    const int loops = 10;
+    std::vector<int> counts(loops * n, 0);
+    int after_barrier = 0;
+    int barrier_errors = 0;
+#pragma omp parallel
+    {
+      for(int l = 0; l < loops; l++) {
+#pragma omp for schedule(dynamic, 16) nowait
+	for(int i = 0; i < n; i++)
+	  __sync_fetch_and_add(&counts[l * n + i], 1);
+      }
+#pragma omp for schedule(guided)
+      for(int i = 0; i < n; i++)
+	__sync_fetch_and_add(&counts[i], 1);
+      // the guided loop above ends with a barrier
+      __sync_fetch_and_add(&after_barrier, 1);
+#pragma omp barrier
+      if(after_barrier != omp_get_num_threads())
+	__sync_fetch_and_add(&barrier_errors, 1);
+    }
+    int bad = 0;
+    for(int l = 0; l < loops; l++)
+      for(int i = 0; i < n; i++)
+	if(counts[l * n + i] != ((l == 0) ? 2 : 1))
+	  bad++;
+    if(bad || barrier_errors) {
+      printf("ERROR: nowait loops: %d bad iterations, %d barrier errors\n",
+	     bad, barrier_errors);
+      errors += bad + barrier_errors;
+    } else
+      printf("nowait loops: ok\n");
+  }
+
+  // an orphaned loop outside of any parallel region runs serially
+  clear_hits();
+#pragma omp for schedule(dynamic, 3)
+  for(int i = 0; i < n; i++)
+    hit(i);
+  errors += check_hits("orphaned");
+
+  return errors;
+}
+
+static double time_triangular(const char *name, int sched)
+{
+  const int n = num_iterations;
+  double total = 0;
+  double t1 = Clock::current_time();
+  switch(sched) {
+  case 0:
+    {
+#pragma omp parallel for schedule(static) reduction(+:total)
+      for(int i = 0; i < n; i++)
+	total += triangular_work(i);
+      break;
+    }
+  case 1:
+    {
+#pragma omp parallel for schedule(dynamic, 16) reduction(+:total)
+      for(int i = 0; i < n; i++)
+	total += triangular_work(i);
+      break;
+    }
+  case 2:
+    {
+#pragma omp parallel for schedule(guided) reduction(+:total)
+      for(int i = 0; i < n; i++)
+	total += triangular_work(i);
+      break;
+    }
+  }
+  double t2 = Clock::current_time();
+  printf("%s: %.3f ms (checksum %g)\n", name, (t2 - t1) * 1e3, total);
+  return t2 - t1;
+}
+
+void omp_task(const void *args, size_t arglen,
+	      const void *userdata, size_t userlen, Processor p)
+{
+  printf("running on %d OpenMP threads\n", omp_get_max_threads());
+
+  int errors = test_schedules();
+
+  // timings are informational only - the machine may have fewer cores
+  //  than the processor has threads
+  double t_static = time_triangular("triangular static", 0);
+  double t_dynamic = time_triangular("triangular dynamic", 1);
+  double t_guided = time_triangular("triangular guided", 2);
+  printf("speedup over static: dynamic=%.2f guided=%.2f\n",
+	 t_static / t_dynamic, t_static / t_guided);
+
+  if(errors) {
+    printf("Exiting with errors.\n");
+    exit(1);
+  }
+}
+
+void top_level_task(const void *args, size_t arglen,
+		    const void *userdata, size_t userlen, Processor p)
+{
+  Processor omp_proc = Machine::ProcessorQuery(Machine::get_machine())
+    .only_kind(Processor::OMP_PROC)
+    .first();
+  if(!omp_proc.exists()) {
+    printf("no OpenMP processors - use -ll:ocpu 1 -ll:othr <N>\n");
+    exit(1);
+  }
+
+  omp_proc.spawn(OMP_TASK, 0, 0).wait();
+
+  printf("done!\n");
+}
+
+int main(int argc, char **argv)
+{
+  Runtime rt;
+
+  rt.init(&argc, &argv);
+
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "-n")) {
+      num_iterations = atoi(argv[++i]);
+      continue;
+    }
+    if(!strcmp(argv[i], "-w")) {
+      work_per_iteration = atoi(argv[++i]);
+      continue;
+    }
+  }
+
+  rt.register_task(TOP_LEVEL_TASK, top_level_task);
+  rt.register_task(OMP_TASK, omp_task);
+
+  // select a processor to run the top level task on
+  Processor p = Machine::ProcessorQuery(Machine::get_machine())
+    .only_kind(Processor::LOC_PROC)
+    .first();
+  assert(p.exists());
+
+  // collective launch of a single task - everybody gets the same finish event
+  Event e = rt.collective_spawn(p, TOP_LEVEL_TASK, 0, 0);
+
+  // request shutdown once that task is complete
+  rt.shutdown(e);
+
+  // now sleep this thread until that shutdown actually happens
+  rt.wait_for_shutdown();
+
+  return 0;
+}
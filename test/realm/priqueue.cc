@@ -0,0 +1,190 @@
+// Copyright 2018 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// ordering and throughput test for Realm's PriorityQueue, which is what the
+//  task schedulers use for their ready and resumable-worker queues
+
+#include "realm/pri_queue.h"
+#include "realm/activemsg.h"
+#include "realm/timers.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include <iostream>
+#include <iomanip>
+#include <deque>
+#include <map>
+
+typedef Realm::PriorityQueue<void *, GASNetHSL> Queue;
+
+static int num_threads = 4;
+static int num_ops = 1000000;
+static int num_priorities = 3;
+static int check_ops = 200000;
+static unsigned seed = 12345;
+static int error_count = 0;
+
+static void parse_args(int argc, const char *argv[])
+{
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "-t")) {
+      num_threads = atoi(argv[++i]);
+      continue;
+    }
+    if(!strcmp(argv[i], "-n")) {
+      num_ops = atoi(argv[++i]);
+      continue;
+    }
+    if(!strcmp(argv[i], "-p")) {
+      num_priorities = atoi(argv[++i]);
+      continue;
+    }
+    if(!strcmp(argv[i], "-s")) {
+      seed = atoi(argv[++i]);
+      continue;
+    }
+  }
+}
+
+// compares the queue against a simple reference model through a random mix
+//  of puts, ungets, filtered gets and peeks - uses more distinct priorities
+//  than the queue has buckets so that the overflow path gets exercised too
+static void check_ordering(void)
+{
+  Queue q;
+  std::map<int, std::deque<size_t> > ref;  // keyed by negated priority
+  size_t next_item = 1;
+
+  for(int i = 0; i < check_ops; i++) {
+    int r = rand() % 100;
+    if(r < 55) {
+      int pri = (rand() % 12) - 4;
+      bool to_back = (rand() % 4) != 0;
+      q.put((void *)next_item, pri, to_back);
+      if(to_back)
+	ref[-pri].push_back(next_item);
+      else
+	ref[-pri].push_front(next_item);
+      next_item++;
+    } else {
+      int higher_than = ((rand() % 4) == 0) ? ((rand() % 12) - 5) : Queue::PRI_NEG_INF;
+      size_t expected = 0;
+      int expected_pri = 0;
+      if(!ref.empty() && (-(ref.begin()->first) > higher_than)) {
+	expected = ref.begin()->second.front();
+	expected_pri = -(ref.begin()->first);
+      }
+      if(q.empty(higher_than) != (expected == 0)) {
+	std::cout << "ERROR: empty(" << higher_than << ") mismatch at op " << i << std::endl;
+	error_count++;
+      }
+      int actual_pri = 0;
+      size_t actual;
+      if(r < 60) {
+	actual = (size_t)q.peek(&actual_pri, higher_than);
+      } else {
+	actual = (size_t)q.get(&actual_pri, higher_than);
+	if(expected != 0) {
+	  ref.begin()->second.pop_front();
+	  if(ref.begin()->second.empty())
+	    ref.erase(ref.begin());
+	}
+      }
+      if((actual != expected) || (expected && (actual_pri != expected_pri))) {
+	std::cout << "ERROR: op " << i << ": expected " << expected << "@" << expected_pri
+		  << ", got " << actual << "@" << actual_pri << std::endl;
+	error_count++;
+	if(error_count > 10) return;
+      }
+    }
+  }
+}
+
+struct ThreadArgs {
+  Queue *queue;
+  int thread_id;
+  int ops;
+  long long gets;
+};
+
+// each thread puts an item and then takes one back out, keeping the queue
+//  shallow like a processor's ready queue under a steady stream of launches
+static void *contention_thread(void *arg)
+{
+  ThreadArgs *ta = (ThreadArgs *)arg;
+  unsigned state = seed + ta->thread_id;
+  ta->gets = 0;
+  for(int i = 0; i < ta->ops; i++) {
+    state = state * 1103515245 + 12345;
+    int pri = (state >> 16) % num_priorities;
+    ta->queue->put((void *)(size_t)(i + 1), pri);
+    int got_pri;
+    if(ta->queue->get(&got_pri) != 0)
+      ta->gets++;
+  }
+  return 0;
+}
+
+int main(int argc, const char *argv[])
+{
+  parse_args(argc, argv);
+  srand(seed);
+
+  check_ordering();
+
+  Queue q;
+  std::vector<ThreadArgs> args(num_threads);
+  std::vector<pthread_t> threads(num_threads);
+
+  long long start = Realm::Clock::current_time_in_nanoseconds();
+  for(int i = 0; i < num_threads; i++) {
+    args[i].queue = &q;
+    args[i].thread_id = i;
+    args[i].ops = num_ops / num_threads;
+    int ret = pthread_create(&threads[i], 0, contention_thread, &args[i]);
+    assert(ret == 0);
+  }
+  long long total_puts = 0, total_gets = 0;
+  for(int i = 0; i < num_threads; i++) {
+    pthread_join(threads[i], 0);
+    total_puts += args[i].ops;
+    total_gets += args[i].gets;
+  }
+  long long stop = Realm::Clock::current_time_in_nanoseconds();
+
+  // drain whatever is left - every put must come back out exactly once
+  int pri;
+  while(q.get(&pri) != 0)
+    total_gets++;
+  if(total_gets != total_puts) {
+    std::cout << "ERROR: " << total_puts << " puts but " << total_gets << " gets" << std::endl;
+    error_count++;
+  }
+
+  double elapsed = (stop - start) * 1e-9;
+  std::cout << "threads=" << num_threads << " priorities=" << num_priorities
+	    << " ops=" << (total_puts * 2) << std::endl;
+  std::cout << "throughput: " << std::fixed << std::setprecision(1)
+	    << ((total_puts * 2) / elapsed / 1e6) << " Mops/s" << std::endl;
+
+  if(error_count > 0) {
+    std::cout << "ERRORS SEEN" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,225 @@
+// Copyright 2018 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// throughput and fragmentation test for Realm's BasicRangeAllocator, which
+//  is what LocalCPUMemory (and friends) use to place instances
+
+#include "realm/mem_impl.h"
+#include "realm/timers.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <map>
+
+typedef Realm::BasicRangeAllocator<size_t, unsigned> Allocator;
+
+static size_t mem_size = 512 << 20;
+static size_t live_target = 256 << 20;
+static int num_ops = 200000;
+static unsigned seed = 12345;
+static bool verbose = false;
+static int error_count = 0;
+
+static void parse_args(int argc, const char *argv[])
+{
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "-v")) {
+      verbose = true;
+      continue;
+    }
+    if(!strcmp(argv[i], "-m")) {
+      mem_size = ((size_t)atoi(argv[++i])) << 20;
+      continue;
+    }
+    if(!strcmp(argv[i], "-l")) {
+      live_target = ((size_t)atoi(argv[++i])) << 20;
+      continue;
+    }
+    if(!strcmp(argv[i], "-n")) {
+      num_ops = atoi(argv[++i]);
+      continue;
+    }
+    if(!strcmp(argv[i], "-s")) {
+      seed = atoi(argv[++i]);
+      continue;
+    }
+  }
+}
+
+// instance sizes seen in a typical time step - lots of small instances
+//  (scalars, ghost cells), fewer medium ones (subregion fields) and the
+//  occasional large one (whole-region fields)
+static size_t random_size(void)
+{
+  int r = rand() % 100;
+  if(r < 60)
+    return 64 + (rand() % 4096);
+  if(r < 90)
+    return 65536 + (rand() % (1 << 20));
+  if(r < 99)
+    return (4 << 20) + (rand() % (4 << 20));
+  return (16 << 20) + (rand() % (16 << 20));
+}
+
+static size_t random_alignment(void)
+{
+  static const size_t aligns[] = { 0, 16, 64, 128, 4096 };
+  return aligns[rand() % 5];
+}
+
+struct Stats {
+  size_t free_bytes, largest_free, free_ranges;
+};
+
+static Stats compute_stats(const Allocator& alloc)
+{
+  Stats s;
+  s.free_bytes = s.largest_free = s.free_ranges = 0;
+  for(Allocator::Range *r = alloc.sentinel.next;
+      r != &alloc.sentinel;
+      r = r->next) {
+    if(!r->is_free) continue;
+    size_t size = r->last - r->first;
+    s.free_bytes += size;
+    s.free_ranges++;
+    if(size > s.largest_free)
+      s.largest_free = size;
+  }
+  return s;
+}
+
+// makes sure the live allocations don't overlap and stay inside the memory
+static void check_allocations(const std::map<unsigned, std::pair<size_t, size_t> >& live)
+{
+  size_t prev_end = 0;
+  std::map<size_t, size_t> by_offset;
+  for(std::map<unsigned, std::pair<size_t, size_t> >::const_iterator it = live.begin();
+      it != live.end();
+      ++it)
+    by_offset[it->second.first] = it->second.second;
+  for(std::map<size_t, size_t>::const_iterator it = by_offset.begin();
+      it != by_offset.end();
+      ++it) {
+    if((it->first < prev_end) || ((it->first + it->second) > mem_size)) {
+      std::cout << "ERROR: bad allocation [" << it->first << ", "
+		<< (it->first + it->second) << ")" << std::endl;
+      error_count++;
+    }
+    prev_end = it->first + it->second;
+  }
+}
+
+int main(int argc, const char *argv[])
+{
+  parse_args(argc, argv);
+  srand(seed);
+
+  Allocator alloc;
+  alloc.add_range(0, mem_size);
+
+  std::map<unsigned, std::pair<size_t, size_t> > live;  // tag -> (offset, size)
+  std::vector<unsigned> live_tags;
+  size_t live_bytes = 0;
+  unsigned next_tag = 1;
+  int allocs = 0, frees = 0, failures = 0;
+
+  long long start = Realm::Clock::current_time_in_nanoseconds();
+  for(int i = 0; i < num_ops; i++) {
+    // grow toward the target live size, then churn around it
+    bool do_alloc = live_tags.empty() || (live_bytes < live_target);
+    if(!do_alloc && ((rand() % 2) == 0))
+      do_alloc = true;
+
+    if(do_alloc) {
+      size_t size = random_size();
+      size_t alignment = random_alignment();
+      size_t offset;
+      if(alloc.allocate(next_tag, size, alignment, offset)) {
+	if(alignment && ((offset % alignment) != 0)) {
+	  std::cout << "ERROR: misaligned allocation at " << offset << std::endl;
+	  error_count++;
+	}
+	live[next_tag] = std::make_pair(offset, size);
+	live_tags.push_back(next_tag);
+	live_bytes += size;
+	next_tag++;
+	allocs++;
+      } else
+	failures++;
+    }
+
+    // free a random live allocation if we're over target (or we failed)
+    if(!live_tags.empty() && (live_bytes > live_target)) {
+      size_t idx = rand() % live_tags.size();
+      unsigned tag = live_tags[idx];
+      live_tags[idx] = live_tags.back();
+      live_tags.pop_back();
+      alloc.deallocate(tag);
+      live_bytes -= live[tag].second;
+      live.erase(tag);
+      frees++;
+    }
+
+    if(verbose && ((i % (num_ops / 10)) == 0)) {
+      Stats s = compute_stats(alloc);
+      std::cout << "  op " << i << ": live=" << live.size()
+		<< " free_ranges=" << s.free_ranges
+		<< " largest_free=" << (s.largest_free >> 10) << "KB" << std::endl;
+    }
+  }
+  long long stop = Realm::Clock::current_time_in_nanoseconds();
+
+  check_allocations(live);
+  Stats s = compute_stats(alloc);
+  if((s.free_bytes + live_bytes) != mem_size) {
+    std::cout << "ERROR: lost track of memory: free=" << s.free_bytes
+	      << " live=" << live_bytes << " total=" << mem_size << std::endl;
+    error_count++;
+  }
+
+  double elapsed = (stop - start) * 1e-9;
+  std::cout << "allocations=" << allocs << " frees=" << frees
+	    << " failures=" << failures << std::endl;
+  std::cout << "throughput: " << std::fixed << std::setprecision(1)
+	    << ((allocs + frees) / elapsed / 1e3) << " Kops/s" << std::endl;
+  std::cout << "fragmentation: " << s.free_ranges << " free ranges, largest="
+	    << (s.largest_free >> 10) << "KB of " << (s.free_bytes >> 10) << "KB free ("
+	    << std::setprecision(1)
+	    << (s.free_bytes ? (100.0 * (1.0 - double(s.largest_free) / s.free_bytes)) : 0.0)
+	    << "% external)" << std::endl;
+
+  // tear everything down - everything should coalesce back into one range
+  for(std::vector<unsigned>::const_iterator it = live_tags.begin();
+      it != live_tags.end();
+      ++it)
+    alloc.deallocate(*it);
+  s = compute_stats(alloc);
+  if((s.free_ranges != 1) || (s.largest_free != mem_size)) {
+    std::cout << "ERROR: free ranges did not coalesce: " << s.free_ranges
+	      << " ranges, largest=" << s.largest_free << std::endl;
+    error_count++;
+  }
+
+  if(error_count > 0) {
+    std::cout << "ERRORS SEEN" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -8973,6 +8973,78 @@ barrier_arrive_pat      = re.compile(
 barrier_wait_pat        = re.compile(
     prefix+"Phase Barrier Wait (?P<uid>[0-9]+) (?P<iid>[0-9a-f]+)")
 
+# Binary logs (-lg:spy_logfile) hold the arguments of each record in
+# varint form along with definitions of the format strings they were
+# logged with, so we rebuild the text lines and parse them as usual
+binary_filetype_pat     = re.compile(
+    b"FileType: BinaryLegionSpy v: (?P<version>[0-9.]+)")
+binary_node_pat         = re.compile(b"Node: (?P<node>[0-9]+)")
+binary_conversion_pat   = re.compile(r"%(ll|l|z|h)?([dusx])")
+
+class BinaryRecordKind(object):
+    __slots__ = ['literals', 'conversions']
+    def __init__(self, fmt):
+        self.literals = list()
+        self.conversions = list()
+        last = 0
+        for m in binary_conversion_pat.finditer(fmt):
+            self.literals.append(fmt[last:m.start()])
+            # (bits, signed, hex) or None for a string
+            conv = m.group(2)
+            if conv == 's':
+                self.conversions.append(None)
+            else:
+                bits = 32 if m.group(1) is None or m.group(1) == 'h' else 64
+                self.conversions.append((bits, conv == 'd', conv == 'x'))
+            last = m.end()
+        self.literals.append(fmt[last:])
+
+def decode_binary_varint(data, pos):
+    result = 0
+    shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        result |= (byte & 0x7F) << shift
+        if byte < 0x80:
+            return result,pos
+        shift += 7
+
+def decode_binary_record(data, pos, kinds, prefix):
+    # Returns the line for the record at pos (or None for a definition)
+    # along with the position of the next record, raises IndexError if
+    # the record runs past the end of the data
+    kind,pos = decode_binary_varint(data, pos)
+    if kind == 0:
+        kind,pos = decode_binary_varint(data, pos)
+        length,pos = decode_binary_varint(data, pos)
+        if pos + length > len(data):
+            raise IndexError
+        fmt = bytes(data[pos:pos+length]).decode('utf-8')
+        kinds[kind] = BinaryRecordKind(fmt)
+        return None,pos+length
+    record_kind = kinds[kind]
+    pieces = [prefix]
+    for literal,conv in zip(record_kind.literals, record_kind.conversions):
+        pieces.append(literal)
+        value,pos = decode_binary_varint(data, pos)
+        if conv is None:
+            if pos + value > len(data):
+                raise IndexError
+            pieces.append(bytes(data[pos:pos+value]).decode('utf-8', 'replace'))
+            pos += value
+            continue
+        # Undo the zig-zag encoding and then apply the same truncation
+        # and signedness that printf would have for this conversion
+        value = (value >> 1) ^ -(value & 1)
+        bits,signed,hexadecimal = conv
+        value &= (1 << bits) - 1
+        if signed and value >= (1 << (bits - 1)):
+            value -= (1 << bits)
+        pieces.append(('%x' % value) if hexadecimal else str(value))
+    pieces.append(record_kind.literals[-1])
+    return ''.join(pieces),pos
+
 def parse_legion_spy_line(line, state):
     # Quick test to see if the line is even worth considering
     m = prefix_pat.match(line)
@@ -9857,11 +9929,18 @@ class State(object):
     def parse_log_file(self, file_name):
         print('Reading log file %s...' % file_name)
         try:
-            log = open(file_name, 'r')
+            log = open(file_name, 'rb')
+            binary = binary_filetype_pat.match(log.readline()) is not None
+            if not binary:
+                log.close()
+                log = open(file_name, 'r')
         except:
             print('ERROR: Unable to find file '+file_name)
             print('Legion Spy will now exit')
             sys.exit(1)
+        if binary:
+            with log:
+                return self.parse_binary_log_file(log, file_name)
         else:
             with log:
                 matches = 0
@@ -9884,6 +9963,52 @@ class State(object):
             print('WARNING: Skipped %d lines when reading %s' % (skipped,file_name))
         return matches
 
+    def parse_binary_log_file(self, log, file_name):
+        # The rest of the header is the node and then a blank line
+        node = 0
+        while True:
+            line = log.readline()
+            if not line or not line.strip():
+                break
+            m = binary_node_pat.match(line)
+            if m is not None:
+                node = int(m.group('node'))
+        prefix = '[%d - 0] {2}{legion_spy}: ' % node
+        kinds = dict()
+        matches = 0
+        skipped = 0
+        data = bytearray()
+        pos = 0
+        while True:
+            chunk = log.read(1 << 24)
+            if not chunk:
+                break
+            data = data[pos:] + bytearray(chunk)
+            pos = 0
+            while pos < len(data):
+                try:
+                    line,next_pos = decode_binary_record(data, pos, kinds, prefix)
+                except IndexError:
+                    # Record continues in the next chunk
+                    break
+                pos = next_pos
+                if line is None:
+                    continue
+                if parse_legion_spy_line(line, self):
+                    matches += 1
+                else:
+                    skipped += 1
+                    print('Skipping line: ' + line.strip())
+        if pos < len(data):
+            print('WARNING: file %s ends with a truncated record' % file_name)
+        if matches == 0:
+            print('WARNING: file %s contained no valid records!' % file_name)
+        if self.verbose:
+            print('Matched %d records in %s' % (matches,file_name))
+        if skipped > 0:
+            print('WARNING: Skipped %d records when reading %s' % (skipped,file_name))
+        return matches
+
     def post_parse(self, simplify_graphs, need_physical):
         for space in self.index_spaces.itervalues():
             if space.parent is None: